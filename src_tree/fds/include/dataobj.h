@@ -1,24 +1,220 @@
 /*------------------------------------------------------------------------------------------
  *
  *
- *              This file is a property of FORMATION DATA SYSTEMS Inc. 
- * 
- * 
+ *              This file is a property of FORMATION DATA SYSTEMS Inc.
+ *
+ *
  *-----------------------------------------------------------------------------------------*/
 
-typedef  fds_data_hash_t int[4]; /* 128 bit unique hash */
+#ifndef DATAOBJ_H
+#define DATAOBJ_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fds_types.h"
+
+/* 128 bit unique hash (CityHash128 of the object: low = first, high = second).
+ * 4-byte aligned like the int[4] it replaces, so that the descriptors
+ * that contain it are 20 bytes without padding. */
+typedef struct fds_data_hash {
+   fds_uint64_t     low;
+   fds_uint64_t     high;
+} FDS_PACKED FDS_ALIGNED(4) fds_data_hash_t;
+
+typedef fds_uint64_t fds_data_obj_id_t;
+
+/* Values of fds_data_obj_t.archive */
+#define FDS_ARCHIVE_NONE   0x00
+#define FDS_ARCHIVE_LOCAL  0x01
+#define FDS_ARCHIVE_SITE2  0x02
 
-typedef fds_data_obj_t {
-   fds_data_hash_t  data_hash; 
+typedef struct fds_data_obj {
+   fds_data_hash_t  data_hash;
    fds_uint8_t      conflict_id;
    fds_uint8_t      data_obj_size;
    fds_uint8_t      archive;   /* 00=no archive, 01=local archive, 02=site2 archive */
    fds_uint8_t      state;
-};
+} FDS_PACKED FDS_ALIGNED(4) fds_data_obj_t;
 
-
-typedef fds_data_object_pkg {
+/* 32-byte aligned: two packages per cache line, never straddling two.
+ * Arrays of packages on the heap need an aligned allocation
+ * (aligned_alloc or posix_memalign with FDS_CACHE_LINE_SIZE). */
+typedef struct fds_data_object_pkg {
    fds_data_obj_t     data_obj;
    fds_data_obj_id_t  data_obj_id;
    fds_uint32_t       virtual_vol_id;
-};
+} FDS_PACKED FDS_ALIGNED(32) fds_data_object_pkg;
+
+/* Descriptors grouped by cache line: a descriptor never straddles two lines */
+#define FDS_DATA_OBJS_PER_LINE (FDS_CACHE_LINE_SIZE / sizeof(fds_data_obj_t))
+
+typedef struct fds_data_obj_line {
+   fds_data_obj_t   objs[FDS_DATA_OBJS_PER_LINE];
+   fds_uint8_t      pad[FDS_CACHE_LINE_SIZE - FDS_DATA_OBJS_PER_LINE * sizeof(fds_data_obj_t)];
+} FDS_ALIGNED(FDS_CACHE_LINE_SIZE) fds_data_obj_line_t;
+
+FDS_STATIC_ASSERT(sizeof(fds_data_hash_t) == 16, "layout of fds_data_hash_t changed");
+FDS_STATIC_ASSERT(FDS_ALIGNOF(fds_data_hash_t) == 4, "alignment of fds_data_hash_t changed");
+FDS_STATIC_ASSERT(sizeof(fds_data_obj_t) == 20, "layout of fds_data_obj_t changed");
+FDS_STATIC_ASSERT(FDS_ALIGNOF(fds_data_obj_t) == 4, "alignment of fds_data_obj_t changed");
+FDS_STATIC_ASSERT(sizeof(fds_data_object_pkg) == 32, "layout of fds_data_object_pkg changed");
+FDS_STATIC_ASSERT(FDS_ALIGNOF(fds_data_object_pkg) == sizeof(fds_data_object_pkg),
+                  "fds_data_object_pkg is not aligned to its size");
+FDS_STATIC_ASSERT(FDS_CACHE_LINE_SIZE % FDS_ALIGNOF(fds_data_object_pkg) == 0,
+                  "fds_data_object_pkg straddles cache lines");
+FDS_STATIC_ASSERT(sizeof(fds_data_obj_line_t) == FDS_CACHE_LINE_SIZE, "fds_data_obj_line_t is not a cache line");
+
+/*
+ * Structure-of-arrays tables of descriptors: one array per field, so that
+ * scanning millions of descriptors by state or archive reads one byte per
+ * descriptor and never the hashes. Functions that allocate return 0 on
+ * success, -1 if out of memory (the table is unchanged).
+ */
+
+typedef struct fds_data_obj_table {
+   size_t            count;
+   size_t            capacity;
+   fds_data_hash_t  *data_hash;
+   fds_uint8_t      *conflict_id;
+   fds_uint8_t      *data_obj_size;
+   fds_uint8_t      *archive;
+   fds_uint8_t      *state;
+} fds_data_obj_table_t;
+
+typedef struct fds_data_object_pkg_table {
+   fds_data_obj_table_t  objs;
+   fds_data_obj_id_t    *data_obj_id;
+   fds_uint32_t         *virtual_vol_id;
+} fds_data_object_pkg_table_t;
+
+/* Resizes one array of a table to capacity elements */
+static inline int fds_soa_resize(void **array, size_t elem_size, size_t capacity) {
+   void *p = realloc(*array, elem_size * capacity);
+   if (p == NULL) {
+      return -1;
+   }
+   *array = p;
+   return 0;
+}
+
+static inline void fds_data_obj_table_init(fds_data_obj_table_t *t) {
+   memset(t, 0, sizeof(*t));
+}
+
+static inline void fds_data_obj_table_free(fds_data_obj_table_t *t) {
+   free(t->data_hash);
+   free(t->conflict_id);
+   free(t->data_obj_size);
+   free(t->archive);
+   free(t->state);
+   fds_data_obj_table_init(t);
+}
+
+/* Makes room for capacity descriptors. If an array cannot be grown the
+ * ones already grown are only larger than needed. */
+static inline int fds_data_obj_table_reserve(fds_data_obj_table_t *t, size_t capacity) {
+   if (capacity <= t->capacity) {
+      return 0;
+   }
+   if (fds_soa_resize((void **)&t->data_hash, sizeof(fds_data_hash_t), capacity) != 0 ||
+       fds_soa_resize((void **)&t->conflict_id, 1, capacity) != 0 ||
+       fds_soa_resize((void **)&t->data_obj_size, 1, capacity) != 0 ||
+       fds_soa_resize((void **)&t->archive, 1, capacity) != 0 ||
+       fds_soa_resize((void **)&t->state, 1, capacity) != 0) {
+      return -1;
+   }
+   t->capacity = capacity;
+   return 0;
+}
+
+static inline int fds_data_obj_table_append(fds_data_obj_table_t *t, const fds_data_obj_t *obj) {
+   if (t->count == t->capacity &&
+       fds_data_obj_table_reserve(t, t->capacity == 0 ? 1024 : t->capacity * 2) != 0) {
+      return -1;
+   }
+   size_t i = t->count;
+   t->data_hash[i] = obj->data_hash;
+   t->conflict_id[i] = obj->conflict_id;
+   t->data_obj_size[i] = obj->data_obj_size;
+   t->archive[i] = obj->archive;
+   t->state[i] = obj->state;
+   t->count += 1;
+   return 0;
+}
+
+static inline void fds_data_obj_table_get(const fds_data_obj_table_t *t, size_t i, fds_data_obj_t *obj) {
+   obj->data_hash = t->data_hash[i];
+   obj->conflict_id = t->conflict_id[i];
+   obj->data_obj_size = t->data_obj_size[i];
+   obj->archive = t->archive[i];
+   obj->state = t->state[i];
+}
+
+/* Index of the first descriptor at or after from whose byte in column
+ * (t->state or t->archive) is value, t->count if there is none */
+static inline size_t fds_data_obj_table_find(const fds_data_obj_table_t *t, const fds_uint8_t *column,
+                                             size_t from, fds_uint8_t value) {
+   if (from >= t->count) {
+      return t->count;
+   }
+   const void *p = memchr(column + from, value, t->count - from);
+   return p == NULL ? t->count : (size_t)((const fds_uint8_t *)p - column);
+}
+
+/* Number of descriptors whose byte in column is value */
+static inline size_t fds_data_obj_table_count(const fds_data_obj_table_t *t, const fds_uint8_t *column,
+                                              fds_uint8_t value) {
+   size_t n = 0;
+   size_t i;
+   for (i = 0; i < t->count; i++) {
+      n += (column[i] == value);
+   }
+   return n;
+}
+
+static inline void fds_data_object_pkg_table_init(fds_data_object_pkg_table_t *t) {
+   fds_data_obj_table_init(&t->objs);
+   t->data_obj_id = NULL;
+   t->virtual_vol_id = NULL;
+}
+
+static inline void fds_data_object_pkg_table_free(fds_data_object_pkg_table_t *t) {
+   fds_data_obj_table_free(&t->objs);
+   free(t->data_obj_id);
+   free(t->virtual_vol_id);
+   t->data_obj_id = NULL;
+   t->virtual_vol_id = NULL;
+}
+
+static inline int fds_data_object_pkg_table_reserve(fds_data_object_pkg_table_t *t, size_t capacity) {
+   if (capacity <= t->objs.capacity) {
+      return 0;
+   }
+   if (fds_soa_resize((void **)&t->data_obj_id, sizeof(fds_data_obj_id_t), capacity) != 0 ||
+       fds_soa_resize((void **)&t->virtual_vol_id, sizeof(fds_uint32_t), capacity) != 0) {
+      return -1;
+   }
+   return fds_data_obj_table_reserve(&t->objs, capacity);
+}
+
+static inline int fds_data_object_pkg_table_append(fds_data_object_pkg_table_t *t, const fds_data_object_pkg *pkg) {
+   size_t capacity = t->objs.capacity;
+   if (t->objs.count == capacity &&
+       fds_data_object_pkg_table_reserve(t, capacity == 0 ? 1024 : capacity * 2) != 0) {
+      return -1;
+   }
+   size_t i = t->objs.count;
+   t->data_obj_id[i] = pkg->data_obj_id;
+   t->virtual_vol_id[i] = pkg->virtual_vol_id;
+   return fds_data_obj_table_append(&t->objs, &pkg->data_obj);
+}
+
+static inline void fds_data_object_pkg_table_get(const fds_data_object_pkg_table_t *t, size_t i,
+                                                 fds_data_object_pkg *pkg) {
+   fds_data_obj_table_get(&t->objs, i, &pkg->data_obj);
+   pkg->data_obj_id = t->data_obj_id[i];
+   pkg->virtual_vol_id = t->virtual_vol_id[i];
+}
+
+#endif /* DATAOBJ_H */
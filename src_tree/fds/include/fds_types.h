@@ -0,0 +1,34 @@
+/*------------------------------------------------------------------------------------------
+ *
+ *
+ *              This file is a property of FORMATION DATA SYSTEMS Inc.
+ *
+ *
+ *-----------------------------------------------------------------------------------------*/
+
+#ifndef FDS_TYPES_H
+#define FDS_TYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t   fds_uint8_t;
+typedef uint16_t  fds_uint16_t;
+typedef uint32_t  fds_uint32_t;
+typedef uint64_t  fds_uint64_t;
+
+#define FDS_CACHE_LINE_SIZE 64
+
+/* Layout of the structs stored on disk or sent on the wire: no padding
+ * is added by the compiler, the layout is checked with FDS_STATIC_ASSERT */
+#define FDS_PACKED __attribute__((packed))
+#define FDS_ALIGNED(n) __attribute__((aligned(n)))
+#define FDS_ALIGNOF(type) __alignof__(type)
+
+#ifdef __cplusplus
+#define FDS_STATIC_ASSERT(cond, msg) static_assert(cond, msg)
+#else
+#define FDS_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
+#endif
+
+#endif /* FDS_TYPES_H */
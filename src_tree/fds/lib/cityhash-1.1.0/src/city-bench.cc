@@ -0,0 +1,393 @@
+// Benchmarks:
+//   suite: every hash function (CityHash32/64/128, CityHashCrc128/256,
+//     the batch, streaming and tree variants) for size classes from 8
+//     bytes to 1 MB, aligned and unaligned inputs, in cache (the same
+//     buffer every call) and not (buffers picked at random in 512 MB).
+//     Reports the median ns/call over 11 runs, the fastest run, the
+//     spread of the runs around the median and bytes/cycle (of the time
+//     stamp counter, which may not tick at the core clock with frequency
+//     scaling).  A second argument only runs the functions whose name
+//     starts with it.
+//   batch: many buffers of the same size hashed with separate calls and
+//     with CityHash64Batch()/CityHash128Batch(), for sizes from 16 bytes
+//     to 16 KB and several batch widths.
+//   tree: a 64 MB buffer hashed in tree mode by 1 to 16 threads, compared
+//     with a single CityHashCrc128() call.
+// Usage: cityhash_benchmark [suite [function]|batch|tree], suite by default.
+
+#include <algorithm>
+#include <cstdio>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "city.h"
+#include "citycrc.h"
+#include "citytree.h"
+
+static const size_t kMinSize = 16;
+static const size_t kMaxSize = 16 * 1024;
+static const size_t kMaxBatch = 64;
+// Bytes hashed per measurement, so that each one takes a few milliseconds
+static const size_t kBytesPerRun = 64 * 1024 * 1024;
+
+static char data[kMaxSize * kMaxBatch];
+static const char* bufs[kMaxBatch];
+static size_t lens[kMaxBatch];
+static uint64 results64[kMaxBatch];
+static uint128 results128[kMaxBatch];
+static uint64 sink = 0;
+
+static double Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Nanoseconds per buffer, best of 3 runs
+template <class F>
+static double Measure(F f, size_t size, size_t batch) {
+  size_t rounds = kBytesPerRun / (size * batch) + 1;
+  double best = 0;
+  for (int run = 0; run < 3; run++) {
+    double start = Now();
+    for (size_t r = 0; r < rounds; r++) {
+      f(batch);
+    }
+    double ns = (Now() - start) * 1e9 / (rounds * batch);
+    if (run == 0 || ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+struct Scalar64 {
+  void operator()(size_t batch) const {
+    for (size_t i = 0; i < batch; i++) {
+      results64[i] = CityHash64(bufs[i], lens[i]);
+    }
+    sink += results64[0];
+  }
+};
+
+struct Batch64 {
+  void operator()(size_t batch) const {
+    CityHash64Batch(bufs, lens, batch, results64);
+    sink += results64[0];
+  }
+};
+
+struct Scalar128 {
+  void operator()(size_t batch) const {
+    for (size_t i = 0; i < batch; i++) {
+      results128[i] = CityHash128(bufs[i], lens[i]);
+    }
+    sink += Uint128Low64(results128[0]);
+  }
+};
+
+struct Batch128 {
+  void operator()(size_t batch) const {
+    CityHash128Batch(bufs, lens, batch, results128);
+    sink += Uint128Low64(results128[0]);
+  }
+};
+
+static void BenchBatch() {
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = static_cast<char>(i * 2654435761U >> 13);
+  }
+
+  printf("%8s %6s %12s %12s %8s %12s %12s %8s\n", "size", "batch",
+         "64 ns/buf", "64B ns/buf", "speedup",
+         "128 ns/buf", "128B ns/buf", "speedup");
+  for (size_t size = kMinSize; size <= kMaxSize; size *= 2) {
+    for (size_t batch = 1; batch <= kMaxBatch; batch *= 4) {
+      for (size_t i = 0; i < batch; i++) {
+        bufs[i] = data + i * size;
+        lens[i] = size;
+      }
+      double s64 = Measure(Scalar64(), size, batch);
+      double b64 = Measure(Batch64(), size, batch);
+      double s128 = Measure(Scalar128(), size, batch);
+      double b128 = Measure(Batch128(), size, batch);
+      printf("%8zu %6zu %12.1f %12.1f %8.2f %12.1f %12.1f %8.2f\n",
+             size, batch, s64, b64, s64 / b64, s128, b128, s128 / b128);
+    }
+  }
+}
+
+// Time stamp counter, 0 if there is none
+static uint64 Cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static const size_t kSuiteSizes[] = {
+  8, 16, 32, 64, 128, 256, 1024, 4096, 16384, 65536, 1024 * 1024
+};
+static const size_t kSuiteAligns[] = { 0, 1 };
+static const int kSuiteRuns = 11;
+// Buffers hashed per call of a SuiteFn (the batch width)
+static const size_t kSuiteGroup = 16;
+// Bytes hashed per run
+static const size_t kSuiteBytesPerRun = 4 * 1024 * 1024;
+// Out-of-cache buffers are picked from this much memory, which should be
+// larger than the last level cache
+static const size_t kColdSize = 512 * 1024 * 1024;
+// Chunks passed to CityHash128Stream::Update()
+static const size_t kStreamChunk = 4096;
+
+// Hashes n buffers of len bytes
+typedef void (*SuiteFn)(const char* const* bufs, size_t len, size_t n);
+
+static void Suite32(const char* const* bufs, size_t len, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    sink += CityHash32(bufs[i], len);
+  }
+}
+
+static void Suite64(const char* const* bufs, size_t len, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    sink += CityHash64(bufs[i], len);
+  }
+}
+
+static void Suite128(const char* const* bufs, size_t len, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    sink += Uint128Low64(CityHash128(bufs[i], len));
+  }
+}
+
+static void SuiteCrc128(const char* const* bufs, size_t len, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    sink += Uint128Low64(CityHashCrc128(bufs[i], len));
+  }
+}
+
+static void SuiteCrc256(const char* const* bufs, size_t len, size_t n) {
+  uint64 result[4];
+  for (size_t i = 0; i < n; i++) {
+    CityHashCrc256(bufs[i], len, result);
+    sink += result[0];
+  }
+}
+
+static void SuiteBatch64(const char* const* bufs, size_t len, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    lens[i] = len;
+  }
+  CityHash64Batch(bufs, lens, n, results64);
+  sink += results64[0];
+}
+
+static void SuiteBatch128(const char* const* bufs, size_t len, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    lens[i] = len;
+  }
+  CityHash128Batch(bufs, lens, n, results128);
+  sink += Uint128Low64(results128[0]);
+}
+
+static void SuiteStream128(const char* const* bufs, size_t len, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    CityHash128Stream h;
+    h.Init(len);
+    for (size_t done = 0; done < len; done += kStreamChunk) {
+      h.Update(bufs[i] + done, std::min(kStreamChunk, len - done));
+    }
+    sink += Uint128Low64(h.Final());
+  }
+}
+
+static void SuiteTree128(const char* const* bufs, size_t len, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    sink += Uint128Low64(CityHashTree128(bufs[i], len));
+  }
+}
+
+static const struct {
+  const char* name;
+  SuiteFn fn;
+} kSuiteFns[] = {
+  { "CityHash32", Suite32 },
+  { "CityHash64", Suite64 },
+  { "CityHash128", Suite128 },
+  { "CityHashCrc128", SuiteCrc128 },
+  { "CityHashCrc256", SuiteCrc256 },
+  { "CityHash64Batch", SuiteBatch64 },
+  { "CityHash128Batch", SuiteBatch128 },
+  { "CityHash128Stream", SuiteStream128 },
+  { "CityHashTree128", SuiteTree128 },
+};
+
+struct SuiteResult {
+  double ns;       // Median ns/call
+  double min_ns;   // Fastest run
+  double spread;   // Median distance of the runs from the median, in %
+  double bpc;      // Bytes/cycle of the median run, 0 without a TSC
+};
+
+// Runs f over the buffers of ptrs, kSuiteGroup at a time and wrapping
+// around, kSuiteRuns times.
+static SuiteResult RunSuite(SuiteFn f, const std::vector<const char*>& ptrs,
+                            size_t len) {
+  size_t groups = std::max<size_t>(kSuiteBytesPerRun / (len * kSuiteGroup), 1);
+  double ns[kSuiteRuns];
+  double cycles[kSuiteRuns];
+  size_t next = 0;
+  f(&ptrs[0], len, kSuiteGroup);  // Warm up
+  for (int run = 0; run < kSuiteRuns; run++) {
+    double start = Now();
+    uint64 start_cycles = Cycles();
+    for (size_t g = 0; g < groups; g++) {
+      f(&ptrs[next], len, kSuiteGroup);
+      next += kSuiteGroup;
+      if (next + kSuiteGroup > ptrs.size()) {
+        next = 0;
+      }
+    }
+    cycles[run] = static_cast<double>(Cycles() - start_cycles);
+    ns[run] = (Now() - start) * 1e9 / (groups * kSuiteGroup);
+  }
+  double sorted[kSuiteRuns];
+  std::copy(ns, ns + kSuiteRuns, sorted);
+  std::sort(sorted, sorted + kSuiteRuns);
+  SuiteResult r;
+  r.ns = sorted[kSuiteRuns / 2];
+  r.min_ns = sorted[0];
+  double dev[kSuiteRuns];
+  for (int run = 0; run < kSuiteRuns; run++) {
+    dev[run] = ns[run] > r.ns ? ns[run] - r.ns : r.ns - ns[run];
+  }
+  std::sort(dev, dev + kSuiteRuns);
+  r.spread = dev[kSuiteRuns / 2] * 100 / r.ns;
+  r.bpc = 0;
+  for (int run = 0; run < kSuiteRuns; run++) {
+    if (ns[run] == r.ns && cycles[run] > 0) {
+      r.bpc = static_cast<double>(len) * groups * kSuiteGroup / cycles[run];
+    }
+  }
+  return r;
+}
+
+static void BenchSuite(const char* filter) {
+  std::vector<char> cold(kColdSize);
+  for (size_t i = 0; i < kColdSize; i++) {
+    cold[i] = static_cast<char>(i * 2654435761U >> 13);
+  }
+  printf("%-18s %8s %5s %5s %10s %10s %7s %7s\n", "function", "size",
+         "align", "cache", "ns/call", "min ns", "+-%", "B/cycle");
+  for (size_t f = 0; f < sizeof(kSuiteFns) / sizeof(kSuiteFns[0]); f++) {
+    if (filter != NULL &&
+        strncmp(kSuiteFns[f].name, filter, strlen(filter)) != 0) {
+      continue;
+    }
+    for (size_t s = 0; s < sizeof(kSuiteSizes) / sizeof(kSuiteSizes[0]);
+         s++) {
+      size_t len = kSuiteSizes[s];
+      for (size_t a = 0; a < sizeof(kSuiteAligns) / sizeof(kSuiteAligns[0]);
+           a++) {
+        size_t align = kSuiteAligns[a];
+        // In cache: always the same buffer
+        std::vector<const char*> ptrs(kSuiteGroup, &cold[64 + align]);
+        SuiteResult hot = RunSuite(kSuiteFns[f].fn, ptrs, len);
+        // Out of cache: cache-line aligned slots of the cold memory, in
+        // an order the prefetchers cannot follow
+        size_t slot = (len + align + 63) & ~static_cast<size_t>(63);
+        size_t slots = kColdSize / slot;
+        ptrs.resize(std::max(slots, kSuiteGroup));
+        for (size_t i = 0; i < ptrs.size(); i++) {
+          size_t k = (i * 2654435761U) % slots;
+          ptrs[i] = &cold[k * slot + align];
+        }
+        SuiteResult miss = RunSuite(kSuiteFns[f].fn, ptrs, len);
+        const SuiteResult* results[] = { &hot, &miss };
+        const char* cache[] = { "hot", "cold" };
+        for (int c = 0; c < 2; c++) {
+          const SuiteResult& r = *results[c];
+          printf("%-18s %8zu %5zu %5s %10.1f %10.1f %7.1f %7.2f\n",
+                 kSuiteFns[f].name, len, align, cache[c], r.ns, r.min_ns,
+                 r.spread, r.bpc);
+        }
+      }
+    }
+  }
+}
+
+static const size_t kTreeSize = 64 * 1024 * 1024;
+
+// Milliseconds per hash of the kTreeSize bytes at s, best of 5 runs
+template <class F>
+static double MeasureTree(F f, const char* s) {
+  double best = 0;
+  for (int run = 0; run < 5; run++) {
+    double start = Now();
+    sink += Uint128Low64(f(s, kTreeSize));
+    double ms = (Now() - start) * 1e3;
+    if (run == 0 || ms < best) {
+      best = ms;
+    }
+  }
+  return best;
+}
+
+struct Crc128 {
+  uint128 operator()(const char* s, size_t len) const {
+    return CityHashCrc128(s, len);
+  }
+};
+
+struct Tree {
+  CityTreePool* pool;
+  uint128 operator()(const char* s, size_t len) const {
+    return pool->Hash(s, len);
+  }
+};
+
+static void BenchTree() {
+  std::vector<char> buf(kTreeSize);
+  for (size_t i = 0; i < kTreeSize; i++) {
+    buf[i] = static_cast<char>(i * 2654435761U >> 13);
+  }
+  printf("%zu MB, %zu KB leaves, %ld CPUs online\n", kTreeSize >> 20,
+         kCityTreeLeafSize >> 10, sysconf(_SC_NPROCESSORS_ONLN));
+  double crc = MeasureTree(Crc128(), &buf[0]);
+  printf("%8s %10s %10s %8s\n", "threads", "ms", "GB/s", "speedup");
+  printf("%8s %10.2f %10.2f %8s\n", "crc128", crc,
+         kTreeSize / crc / 1e6, "");
+  double one = 0;
+  for (int threads = 1; threads <= 16; threads *= 2) {
+    CityTreePool pool(threads);
+    Tree tree = { &pool };
+    double ms = MeasureTree(tree, &buf[0]);
+    if (threads == 1) {
+      one = ms;
+    }
+    printf("%8d %10.2f %10.2f %8.2f\n", threads, ms,
+           kTreeSize / ms / 1e6, one / ms);
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* mode = argc < 2 ? "suite" : argv[1];
+  if (strcmp(mode, "suite") == 0) {
+    BenchSuite(argc < 3 ? NULL : argv[2]);
+  } else if (strcmp(mode, "batch") == 0) {
+    BenchBatch();
+  } else if (strcmp(mode, "tree") == 0) {
+    BenchTree();
+  } else {
+    fprintf(stderr, "Usage: %s [suite [function]|batch|tree]\n", argv[0]);
+    return 1;
+  }
+  // Keeps the results alive
+  return sink == 42;
+}
@@ -20,11 +20,11 @@
 
 #include <cstdio>
 #include <iostream>
+#include <pthread.h>
 #include <string.h>
 #include "city.h"
-#ifdef __SSE4_2__
 #include "citycrc.h"
-#endif
+#include "citytree.h"
 
 using std::cout;
 using std::cerr;
@@ -1279,7 +1279,6 @@ void Test(const uint64* expected, int offset, int len) {
   Check(expected[4], Uint128High64(u));
   Check(expected[5], Uint128Low64(v));
   Check(expected[6], Uint128High64(v));
-#ifdef __SSE4_2__
   const uint128 y = CityHashCrc128(data + offset, len);
   const uint128 z = CityHashCrc128WithSeed(data + offset, len, kSeed128);
   uint64 crc256_results[4];
@@ -1291,11 +1290,104 @@ void Test(const uint64* expected, int offset, int len) {
   for (int i = 0; i < 4; i++) {
     Check(expected[11 + i], crc256_results[i]);
   }
-#endif
+}
+
+static void *Crc256Thread(void *arg) {
+  CityHashCrc256(data, kDataSize, static_cast<uint64 *>(arg));
+  return NULL;
+}
+
+// Threads racing on the first call, which selects the implementation.
+// Must run before any other CRC-based call.
+void TestCrcFirstCall() {
+  const int kThreads = 8;
+  pthread_t threads[kThreads];
+  uint64 results[kThreads][4];
+  for (int t = 0; t < kThreads; t++) {
+    pthread_create(&threads[t], NULL, Crc256Thread, results[t]);
+  }
+  const uint64* expected = testdata[kTestSize - 1];
+  for (int t = 0; t < kThreads; t++) {
+    pthread_join(threads[t], NULL);
+    for (int i = 0; i < 4; i++) {
+      Check(expected[11 + i], results[t][i]);
+    }
+  }
+}
+
+// The first n test inputs in the given order, hashed in one batch.
+void TestBatch(const int* order, int n) {
+  static const char* bufs[kTestSize];
+  static size_t lens[kTestSize];
+  static uint64 results64[kTestSize];
+  static uint128 results128[kTestSize];
+  for (int k = 0; k < n; k++) {
+    int i = order[k];
+    bufs[k] = i < kTestSize - 1 ? data + i * i : data;
+    lens[k] = i < kTestSize - 1 ? i : kDataSize;
+  }
+  CityHash64Batch(bufs, lens, n, results64);
+  CityHash128Batch(bufs, lens, n, results128);
+  for (int k = 0; k < n; k++) {
+    const uint64* expected = testdata[order[k]];
+    Check(expected[0], results64[k]);
+    Check(expected[3], Uint128Low64(results128[k]));
+    Check(expected[4], Uint128High64(results128[k]));
+  }
+}
+
+// Every test input hashed with CityHash128Stream, in chunks of the given size.
+void TestStream(size_t chunk) {
+  for (int i = 0; i < kTestSize; i++) {
+    const char* s = i < kTestSize - 1 ? data + i * i : data;
+    size_t len = i < kTestSize - 1 ? i : kDataSize;
+    CityHash128Stream u, v;
+    u.Init(len);
+    v.InitWithSeed(len, kSeed128);
+    for (size_t done = 0; done < len; done += chunk) {
+      size_t n = len - done < chunk ? len - done : chunk;
+      u.Update(s + done, n);
+      v.Update(s + done, n);
+    }
+    const uint128 hu = u.Final();
+    const uint128 hv = v.Final();
+    Check(testdata[i][3], Uint128Low64(hu));
+    Check(testdata[i][4], Uint128High64(hu));
+    Check(testdata[i][5], Uint128Low64(hv));
+    Check(testdata[i][6], Uint128High64(hv));
+  }
+}
+
+// Tree mode: the same hash with any number of threads, the CityHashCrc128()
+// of strings of one leaf, and a fixed hash for the whole test data.
+void TestTree() {
+  const size_t lens[] = { 0, 1, kCityTreeLeafSize, kCityTreeLeafSize + 1,
+                          kCityTreeLeafSize * 2 + 1000, kDataSize };
+  const int threads[] = { 1, 2, 3, 8 };
+  for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+    CityTreePool pool(threads[t]);
+    for (size_t k = 0; k < sizeof(lens) / sizeof(lens[0]); k++) {
+      const uint128 expected = CityHashTree128(data, lens[k]);
+      const uint128 actual = pool.Hash(data, lens[k]);
+      Check(Uint128Low64(expected), Uint128Low64(actual));
+      Check(Uint128High64(expected), Uint128High64(actual));
+      if (lens[k] <= kCityTreeLeafSize) {
+        const uint128 crc = CityHashCrc128(data, lens[k]);
+        Check(Uint128Low64(crc), Uint128Low64(actual));
+        Check(Uint128High64(crc), Uint128High64(actual));
+      }
+    }
+  }
+  const uint128 u = CityHashTree128(data, kDataSize);
+  Check(0x8c06f42312096705ULL, Uint128Low64(u));
+  Check(0x2baf877be1ca8b5bULL, Uint128High64(u));
 }
 
 #else
 
+#define TestBatch(order, n)
+#define TestStream(chunk)
+#define TestTree()
 #define Test(a, b, c) Dump((b), (c))
 void Dump(int offset, int len) {
   const uint128 u = CityHash128(data + offset, len);
@@ -1326,10 +1418,38 @@ void Dump(int offset, int len) {
 
 int main(int argc, char** argv) {
   setup();
-  int i = 0;
-  for ( ; i < kTestSize - 1; i++) {
-    Test(testdata[i], i * i, i);
+  TestCrcFirstCall();
+  // Every implementation of the CRC-based variants available on this CPU
+  // gives the same results.
+  const CityHashCrcImpl impls[] = { kCityHashCrcPortable, kCityHashCrcSse42 };
+  for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+    if (!CityHashCrcSetImplementation(impls[k])) {
+      cout << "CRC implementation " << k << " not available, skipped\n";
+      continue;
+    }
+    int i = 0;
+    for ( ; i < kTestSize - 1; i++) {
+      Test(testdata[i], i * i, i);
+    }
+    Test(testdata[i], 0, kDataSize);
+  }
+  // In order (lanes of similar lengths), and interleaved with the longest
+  int order[kTestSize];
+  for (int i = 0; i < kTestSize; i++) {
+    order[i] = i;
+  }
+  TestBatch(order, kTestSize);
+  // An odd number of short inputs, one of them is not paired
+  TestBatch(order, 143);
+  for (int i = 0; i < kTestSize; i++) {
+    order[i] = i % 2 == 0 ? i / 2 : kTestSize - 1 - i / 2;
+  }
+  TestBatch(order, kTestSize);
+  // Chunks smaller than, straddling and larger than the 128-byte blocks
+  const size_t chunks[] = { 1, 7, 16, 100, 128, 200, 4096, kDataSize };
+  for (size_t k = 0; k < sizeof(chunks) / sizeof(chunks[0]); k++) {
+    TestStream(chunks[k]);
   }
-  Test(testdata[i], 0, kDataSize);
+  TestTree();
   return errors > 0;
 }
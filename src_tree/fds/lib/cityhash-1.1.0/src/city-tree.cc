@@ -0,0 +1,165 @@
+// Tree mode of CityHash, see citytree.h.
+
+#include "config.h"
+#include <citycrc.h>
+#include <citytree.h>
+
+#include <algorithm>
+#include <pthread.h>
+#include <vector>
+
+using namespace std;
+
+// Leaf hashes are stored in little-endian order, so that the root hash is
+// the same on all hosts.
+static void StoreLeafHash(char *p, uint64 x) {
+  for (int i = 0; i < 8; i++) {
+    p[i] = static_cast<char>(x >> (i * 8));
+  }
+}
+
+static size_t CityTreeLeaves(size_t len) {
+  return (len + kCityTreeLeafSize - 1) / kCityTreeLeafSize;
+}
+
+// Hashes leaf i of s into hashes + 16 * i.
+static void CityTreeLeaf(const char *s, size_t len, size_t i, char *hashes) {
+  size_t offset = i * kCityTreeLeafSize;
+  size_t n = min(kCityTreeLeafSize, len - offset);
+  uint128 h = CityHashCrc128WithSeed(s + offset, n, uint128(i, len));
+  StoreLeafHash(hashes + 16 * i, Uint128Low64(h));
+  StoreLeafHash(hashes + 16 * i + 8, Uint128High64(h));
+}
+
+static uint128 CityTreeRoot(const char *hashes, size_t leaves, size_t len) {
+  return CityHash128WithSeed(hashes, 16 * leaves, uint128(len, leaves));
+}
+
+uint128 CityHashTree128(const char *s, size_t len) {
+  if (len <= kCityTreeLeafSize) {
+    return CityHashCrc128(s, len);
+  }
+  size_t leaves = CityTreeLeaves(len);
+  vector<char> hashes(16 * leaves);
+  for (size_t i = 0; i < leaves; i++) {
+    CityTreeLeaf(s, len, i, &hashes[0]);
+  }
+  return CityTreeRoot(&hashes[0], leaves, len);
+}
+
+struct CityTreePoolState {
+  pthread_mutex_t mutex;
+  pthread_cond_t work;   // New job, or stop
+  pthread_cond_t done;   // busy reached 0
+  vector<pthread_t> threads;
+  bool stop;
+  uint64 job;            // Number of the current job
+  size_t busy;           // Threads not done with the current job yet
+  // Current job
+  const char *s;
+  size_t len;
+  size_t leaves;
+  size_t next;           // Next leaf to hash, taken atomically
+  vector<char> hashes;
+};
+
+// Hashes leaves of the current job until there are none left.
+static void CityTreeRun(CityTreePoolState *st) {
+  for (;;) {
+    size_t i = __sync_fetch_and_add(&st->next, 1);
+    if (i >= st->leaves) {
+      return;
+    }
+    CityTreeLeaf(st->s, st->len, i, &st->hashes[0]);
+  }
+}
+
+static void *CityTreeWorker(void *arg) {
+  CityTreePoolState *st = static_cast<CityTreePoolState *>(arg);
+  uint64 job = 0;
+  pthread_mutex_lock(&st->mutex);
+  for (;;) {
+    while (!st->stop && st->job == job) {
+      pthread_cond_wait(&st->work, &st->mutex);
+    }
+    if (st->stop) {
+      break;
+    }
+    job = st->job;
+    pthread_mutex_unlock(&st->mutex);
+    CityTreeRun(st);
+    pthread_mutex_lock(&st->mutex);
+    if (--st->busy == 0) {
+      pthread_cond_signal(&st->done);
+    }
+  }
+  pthread_mutex_unlock(&st->mutex);
+  return NULL;
+}
+
+CityTreePool::CityTreePool(int threads) : state_(new CityTreePoolState) {
+  CityTreePoolState *st = state_;
+  pthread_mutex_init(&st->mutex, NULL);
+  pthread_cond_init(&st->work, NULL);
+  pthread_cond_init(&st->done, NULL);
+  st->stop = false;
+  st->job = 0;
+  st->busy = 0;
+  st->s = NULL;
+  st->len = 0;
+  st->leaves = 0;
+  st->next = 0;
+  // Picks the CRC implementation before the threads use it
+  CityHashCrcImplementation();
+  // If some threads cannot be started the others hash more leaves,
+  // the result is the same
+  for (int i = 1; i < threads; i++) {
+    pthread_t t;
+    if (pthread_create(&t, NULL, CityTreeWorker, st) == 0) {
+      st->threads.push_back(t);
+    }
+  }
+}
+
+CityTreePool::~CityTreePool() {
+  CityTreePoolState *st = state_;
+  pthread_mutex_lock(&st->mutex);
+  st->stop = true;
+  pthread_cond_broadcast(&st->work);
+  pthread_mutex_unlock(&st->mutex);
+  for (size_t i = 0; i < st->threads.size(); i++) {
+    pthread_join(st->threads[i], NULL);
+  }
+  pthread_cond_destroy(&st->done);
+  pthread_cond_destroy(&st->work);
+  pthread_mutex_destroy(&st->mutex);
+  delete st;
+}
+
+uint128 CityTreePool::Hash(const char *s, size_t len) {
+  CityTreePoolState *st = state_;
+  if (len <= kCityTreeLeafSize || st->threads.empty()) {
+    return CityHashTree128(s, len);
+  }
+  size_t leaves = CityTreeLeaves(len);
+  pthread_mutex_lock(&st->mutex);
+  st->s = s;
+  st->len = len;
+  st->leaves = leaves;
+  st->next = 0;
+  st->hashes.resize(16 * leaves);
+  st->busy = st->threads.size();
+  st->job++;
+  pthread_cond_broadcast(&st->work);
+  pthread_mutex_unlock(&st->mutex);
+
+  CityTreeRun(st);
+
+  // Every thread has seen the job (and is done with it) before the next one
+  pthread_mutex_lock(&st->mutex);
+  while (st->busy > 0) {
+    pthread_cond_wait(&st->done, &st->mutex);
+  }
+  pthread_mutex_unlock(&st->mutex);
+  return CityTreeRoot(&st->hashes[0], leaves, len);
+}
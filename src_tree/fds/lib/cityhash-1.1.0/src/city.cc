@@ -31,6 +31,7 @@
 #include <city.h>
 
 #include <algorithm>
+#include <assert.h>
 #include <string.h>  // for memcpy and memset
 
 using namespace std;
@@ -335,42 +336,82 @@ static uint64 HashLen33to64(const char *s, size_t len) {
   return b + x;
 }
 
-uint64 CityHash64(const char *s, size_t len) {
+// The 56 bytes of state kept by CityHash64() and CityHash128WithSeed() for
+// long strings: v, w, x, y, and z.
+struct CityState {
+  pair<uint64, uint64> v, w;
+  uint64 x, y, z;
+};
+
+// The inner loop of CityHash64() and CityHash128WithSeed(), hashes the
+// 64-byte chunk at s.
+static inline void CityChunk64(CityState *st, const char *s) {
+  uint64 x = st->x, y = st->y, z = st->z;
+  pair<uint64, uint64> v = st->v, w = st->w;
+  x = Rotate(x + y + v.first + Fetch64(s + 8), 37) * k1;
+  y = Rotate(y + v.second + Fetch64(s + 48), 42) * k1;
+  x ^= w.second;
+  y += v.first + Fetch64(s + 40);
+  z = Rotate(z + w.first, 33) * k1;
+  v = WeakHashLen32WithSeeds(s, v.second * k1, x + w.first);
+  w = WeakHashLen32WithSeeds(s + 32, z + w.second, y + Fetch64(s + 16));
+  std::swap(z, x);
+  st->x = x; st->y = y; st->z = z;
+  st->v = v; st->w = w;
+}
+
+// For strings over 64 bytes we hash the end first, and then as we
+// loop we keep 56 bytes of state: v, w, x, y, and z.
+static inline void CityHash64Init(CityState *st, const char *s, size_t len) {
+  uint64 x = Fetch64(s + len - 40);
+  uint64 y = Fetch64(s + len - 16) + Fetch64(s + len - 56);
+  uint64 z = HashLen16(Fetch64(s + len - 48) + len, Fetch64(s + len - 24));
+  st->v = WeakHashLen32WithSeeds(s + len - 64, len, z);
+  st->w = WeakHashLen32WithSeeds(s + len - 32, y + k1, x);
+  st->x = x * k1 + Fetch64(s);
+  st->y = y;
+  st->z = z;
+}
+
+// Number of 64-byte chunks hashed by CityHash64(), len > 64.
+static inline size_t CityHash64Chunks(size_t len) {
+  return (len - 1) / 64;
+}
+
+static inline uint64 CityHash64Final(const CityState *st) {
+  return HashLen16(HashLen16(st->v.first, st->w.first) +
+                   ShiftMix(st->y) * k1 + st->z,
+                   HashLen16(st->v.second, st->w.second) + st->x);
+}
+
+// CityHash64() of len <= 64 bytes
+static inline uint64 CityHash64Short(const char *s, size_t len) {
   if (len <= 32) {
     if (len <= 16) {
       return HashLen0to16(s, len);
     } else {
       return HashLen17to32(s, len);
     }
-  } else if (len <= 64) {
-    return HashLen33to64(s, len);
   }
+  return HashLen33to64(s, len);
+}
 
-  // For strings over 64 bytes we hash the end first, and then as we
-  // loop we keep 56 bytes of state: v, w, x, y, and z.
-  uint64 x = Fetch64(s + len - 40);
-  uint64 y = Fetch64(s + len - 16) + Fetch64(s + len - 56);
-  uint64 z = HashLen16(Fetch64(s + len - 48) + len, Fetch64(s + len - 24));
-  pair<uint64, uint64> v = WeakHashLen32WithSeeds(s + len - 64, len, z);
-  pair<uint64, uint64> w = WeakHashLen32WithSeeds(s + len - 32, y + k1, x);
-  x = x * k1 + Fetch64(s);
+uint64 CityHash64(const char *s, size_t len) {
+  if (len <= 64) {
+    return CityHash64Short(s, len);
+  }
+
+  CityState st;
+  CityHash64Init(&st, s, len);
 
   // Decrease len to the nearest multiple of 64, and operate on 64-byte chunks.
   len = (len - 1) & ~static_cast<size_t>(63);
   do {
-    x = Rotate(x + y + v.first + Fetch64(s + 8), 37) * k1;
-    y = Rotate(y + v.second + Fetch64(s + 48), 42) * k1;
-    x ^= w.second;
-    y += v.first + Fetch64(s + 40);
-    z = Rotate(z + w.first, 33) * k1;
-    v = WeakHashLen32WithSeeds(s, v.second * k1, x + w.first);
-    w = WeakHashLen32WithSeeds(s + 32, z + w.second, y + Fetch64(s + 16));
-    std::swap(z, x);
+    CityChunk64(&st, s);
     s += 64;
     len -= 64;
   } while (len != 0);
-  return HashLen16(HashLen16(v.first, w.first) + ShiftMix(y) * k1 + z,
-                   HashLen16(v.second, w.second) + x);
+  return CityHash64Final(&st);
 }
 
 uint64 CityHash64WithSeed(const char *s, size_t len, uint64 seed) {
@@ -382,9 +423,15 @@ uint64 CityHash64WithSeeds(const char *s, size_t len,
   return HashLen16(CityHash64(s, len) - seed0, seed1);
 }
 
-// A subroutine for CityHash128().  Returns a decent 128-bit hash for strings
-// of any length representable in signed long.  Based on City and Murmur.
-static uint128 CityMurmur(const char *s, size_t len, uint128 seed) {
+// The state kept by CityMurmur(): a, b, c, d, and the bytes left.
+struct CityMurmurState {
+  uint64 a, b, c, d;
+  signed long l;
+};
+
+// Hashes the ends of s, and all of it if len <= 16.
+static inline void CityMurmurInit(CityMurmurState *st, const char *s,
+                                  size_t len, uint128 seed) {
   uint64 a = Uint128Low64(seed);
   uint64 b = Uint128High64(seed);
   uint64 c = 0;
@@ -398,60 +445,68 @@ static uint128 CityMurmur(const char *s, size_t len, uint128 seed) {
     c = HashLen16(Fetch64(s + len - 8) + k1, a);
     d = HashLen16(b + len, c + Fetch64(s + len - 16));
     a += d;
-    do {
-      a ^= ShiftMix(Fetch64(s) * k1) * k1;
-      a *= k1;
-      b ^= a;
-      c ^= ShiftMix(Fetch64(s + 8) * k1) * k1;
-      c *= k1;
-      d ^= c;
-      s += 16;
-      l -= 16;
-    } while (l > 0);
-  }
-  a = HashLen16(a, c);
-  b = HashLen16(d, b);
+  }
+  st->a = a; st->b = b; st->c = c; st->d = d;
+  st->l = l;
+}
+
+// The loop of CityMurmur(), hashes the 16 bytes at s.
+static inline void CityMurmurStep(CityMurmurState *st, const char *s) {
+  st->a ^= ShiftMix(Fetch64(s) * k1) * k1;
+  st->a *= k1;
+  st->b ^= st->a;
+  st->c ^= ShiftMix(Fetch64(s + 8) * k1) * k1;
+  st->c *= k1;
+  st->d ^= st->c;
+  st->l -= 16;
+}
+
+static inline uint128 CityMurmurFinal(const CityMurmurState *st) {
+  uint64 a = HashLen16(st->a, st->c);
+  uint64 b = HashLen16(st->d, st->b);
   return uint128(a ^ b, HashLen16(b, a));
 }
 
-uint128 CityHash128WithSeed(const char *s, size_t len, uint128 seed) {
-  if (len < 128) {
-    return CityMurmur(s, len, seed);
+// A subroutine for CityHash128().  Returns a decent 128-bit hash for strings
+// of any length representable in signed long.  Based on City and Murmur.
+static uint128 CityMurmur(const char *s, size_t len, uint128 seed) {
+  CityMurmurState st;
+  CityMurmurInit(&st, s, len, seed);
+  while (st.l > 0) {
+    CityMurmurStep(&st, s);
+    s += 16;
   }
+  return CityMurmurFinal(&st);
+}
 
-  // We expect len >= 128 to be the common case.  Keep 56 bytes of state:
-  // v, w, x, y, and z.
-  pair<uint64, uint64> v, w;
+// We expect len >= 128 to be the common case.  Keep 56 bytes of state:
+// v, w, x, y, and z.
+static inline void CityHash128Init(CityState *st, const char *s, size_t len,
+                                   uint128 seed) {
   uint64 x = Uint128Low64(seed);
   uint64 y = Uint128High64(seed);
   uint64 z = len * k1;
-  v.first = Rotate(y ^ k1, 49) * k1 + Fetch64(s);
-  v.second = Rotate(v.first, 42) * k1 + Fetch64(s + 8);
-  w.first = Rotate(y + z, 35) * k1 + x;
-  w.second = Rotate(x + Fetch64(s + 88), 53) * k1;
+  st->v.first = Rotate(y ^ k1, 49) * k1 + Fetch64(s);
+  st->v.second = Rotate(st->v.first, 42) * k1 + Fetch64(s + 8);
+  st->w.first = Rotate(y + z, 35) * k1 + x;
+  st->w.second = Rotate(x + Fetch64(s + 88), 53) * k1;
+  st->x = x;
+  st->y = y;
+  st->z = z;
+}
 
-  // This is the same inner loop as CityHash64(), manually unrolled.
-  do {
-    x = Rotate(x + y + v.first + Fetch64(s + 8), 37) * k1;
-    y = Rotate(y + v.second + Fetch64(s + 48), 42) * k1;
-    x ^= w.second;
-    y += v.first + Fetch64(s + 40);
-    z = Rotate(z + w.first, 33) * k1;
-    v = WeakHashLen32WithSeeds(s, v.second * k1, x + w.first);
-    w = WeakHashLen32WithSeeds(s + 32, z + w.second, y + Fetch64(s + 16));
-    std::swap(z, x);
-    s += 64;
-    x = Rotate(x + y + v.first + Fetch64(s + 8), 37) * k1;
-    y = Rotate(y + v.second + Fetch64(s + 48), 42) * k1;
-    x ^= w.second;
-    y += v.first + Fetch64(s + 40);
-    z = Rotate(z + w.first, 33) * k1;
-    v = WeakHashLen32WithSeeds(s, v.second * k1, x + w.first);
-    w = WeakHashLen32WithSeeds(s + 32, z + w.second, y + Fetch64(s + 16));
-    std::swap(z, x);
-    s += 64;
-    len -= 128;
-  } while (LIKELY(len >= 128));
+// Number of 64-byte chunks hashed in the main loop by
+// CityHash128WithSeed(), len >= 128.
+static inline size_t CityHash128Chunks(size_t len) {
+  return (len / 128) * 2;
+}
+
+// Hashes the last len bytes (len < 128) after the main loop, s points to
+// them.
+static inline uint128 CityHash128Final(CityState *st, const char *s,
+                                       size_t len) {
+  pair<uint64, uint64> v = st->v, w = st->w;
+  uint64 x = st->x, y = st->y, z = st->z;
   x += Rotate(v.first + z, 49) * k0;
   y = y * k0 + Rotate(w.second, 37);
   z = z * k0 + Rotate(w.first, 27);
@@ -477,6 +532,25 @@ uint128 CityHash128WithSeed(const char *s, size_t len, uint128 seed) {
                  HashLen16(x + w.second, y + v.second));
 }
 
+uint128 CityHash128WithSeed(const char *s, size_t len, uint128 seed) {
+  if (len < 128) {
+    return CityMurmur(s, len, seed);
+  }
+
+  CityState st;
+  CityHash128Init(&st, s, len, seed);
+
+  // This is the same inner loop as CityHash64(), manually unrolled.
+  do {
+    CityChunk64(&st, s);
+    s += 64;
+    CityChunk64(&st, s);
+    s += 64;
+    len -= 128;
+  } while (LIKELY(len >= 128));
+  return CityHash128Final(&st, s, len);
+}
+
 uint128 CityHash128(const char *s, size_t len) {
   return len >= 16 ?
       CityHash128WithSeed(s + 16, len - 16,
@@ -484,11 +558,397 @@ uint128 CityHash128(const char *s, size_t len) {
       CityHash128WithSeed(s, len, uint128(k0, k1));
 }
 
-#ifdef __SSE4_2__
+// Streams: the chunks go through the main loop of CityHash128WithSeed() in
+// 128-byte blocks, the state is kept in the object between them.
+
+// Bytes hashed by the main loop of CityHash128WithSeed(), 0 if it uses
+// CityMurmur().
+static inline size_t CityHash128MainLen(size_t len) {
+  return len >= 128 ? len & ~static_cast<size_t>(127) : 0;
+}
+
+void CityHash128Stream::Init(size_t len) {
+  InitWithSeed(len, uint128(k0, k1));
+  // Same as CityHash128(): the first 16 bytes are the seed
+  if (len >= 16) {
+    prefix_ = 16;
+    main_ = CityHash128MainLen(len - 16);
+  }
+}
+
+void CityHash128Stream::InitWithSeed(size_t len, uint128 seed) {
+  len_ = len;
+  done_ = 0;
+  prefix_ = 0;
+  main_ = CityHash128MainLen(len);
+  buffered_ = 0;
+  started_ = false;
+  seed_ = seed;
+}
+
+// Hashes n 128-byte blocks at s
+void CityHash128Stream::Blocks(const char *s, size_t n) {
+  CityState st;
+  if (!started_) {
+    CityHash128Init(&st, s, len_ - prefix_, seed_);
+    started_ = true;
+  } else {
+    st.v = make_pair(v0_, v1_);
+    st.w = make_pair(w0_, w1_);
+    st.x = x_;
+    st.y = y_;
+    st.z = z_;
+  }
+  for (size_t i = 0; i < n; i++) {
+    CityChunk64(&st, s);
+    CityChunk64(&st, s + 64);
+    s += 128;
+  }
+  v0_ = st.v.first;
+  v1_ = st.v.second;
+  w0_ = st.w.first;
+  w1_ = st.w.second;
+  x_ = st.x;
+  y_ = st.y;
+  z_ = st.z;
+}
+
+void CityHash128Stream::Update(const char *s, size_t len) {
+  // More than len_ bytes in total would overflow buf_
+  assert(len <= len_ - done_);
+  len = std::min(len, len_ - done_);
+  if (main_ == 0) {
+    memcpy(buf_ + done_, s, len);
+    done_ += len;
+    return;
+  }
+  if (done_ < prefix_) {
+    size_t n = std::min(len, prefix_ - done_);
+    memcpy(buf_ + 128 + done_, s, n);
+    done_ += n;
+    s += n;
+    len -= n;
+    if (done_ < prefix_) {
+      return;
+    }
+    seed_ = uint128(Fetch64(buf_ + 128), Fetch64(buf_ + 136) + k0);
+  }
+  // Main loop: whole blocks are hashed in place, the others are completed
+  // in buf_ + 128 first.  The last block is kept in buf_ for Final().
+  while (len > 0 && done_ - prefix_ < main_) {
+    if (buffered_ == 0 && len >= 128) {
+      size_t n = std::min(len, main_ - (done_ - prefix_)) / 128;
+      Blocks(s, n);
+      s += n * 128;
+      len -= n * 128;
+      done_ += n * 128;
+      if (done_ - prefix_ == main_) {
+        memcpy(buf_, s - 128, 128);
+      }
+      continue;
+    }
+    size_t n = std::min(len, 128 - buffered_);
+    memcpy(buf_ + 128 + buffered_, s, n);
+    buffered_ += n;
+    done_ += n;
+    s += n;
+    len -= n;
+    if (buffered_ == 128) {
+      Blocks(buf_ + 128, 1);
+      buffered_ = 0;
+      if (done_ - prefix_ == main_) {
+        memcpy(buf_, buf_ + 128, 128);
+      }
+    }
+  }
+  // Tail, less than 128 bytes
+  memcpy(buf_ + 128 + buffered_, s, len);
+  buffered_ += len;
+  done_ += len;
+}
+
+uint128 CityHash128Stream::Final() {
+  if (main_ == 0) {
+    return prefix_ > 0 ? CityHash128(buf_, len_) :
+        CityHash128WithSeed(buf_, len_, seed_);
+  }
+  CityState st;
+  st.v = make_pair(v0_, v1_);
+  st.w = make_pair(w0_, w1_);
+  st.x = x_;
+  st.y = y_;
+  st.z = z_;
+  // The tail can read up to 128 bytes back, into the last block in buf_
+  return CityHash128Final(&st, buf_ + 128, buffered_);
+}
+
+// Batches: the long strings are hashed two at a time, one 64-byte chunk of
+// each in turn.  The two lanes are independent and the CPU overlaps them.
+// (The lanes are in general purpose registers: AVX2 has no 64-bit
+// multiply, emulating it costs more than the parallelism gains.  More than
+// two lanes do not fit in the registers.)  Lanes do not pay off below
+// kBatchMinChunks chunks, those strings are hashed one at a time.
+// The short strings of CityHash128Batch() (CityMurmur()) are paired too,
+// 16 bytes of each in turn, and those of CityHash64Batch() skip the length
+// checks of CityHash64().  This only keeps them as fast as separate calls:
+// the CPU already overlaps the few multiplications of consecutive calls.
+static const int kBatchLanes = 2;
+static const size_t kBatchMinChunks = 16;
+
+struct CityLane {
+  CityState st;
+  const char *s;     // Next chunk
+  size_t chunks;     // Chunks left in the main loop
+  size_t index;      // In the batch
+};
+
+// Runs the main loop of each lane: together while both have chunks left,
+// then one at a time.
+static void CityRunLanes(CityLane *lanes, int n) {
+  size_t common = 0;
+  if (n == 2) {
+    // Local copies, kept in registers
+    common = std::min(lanes[0].chunks, lanes[1].chunks);
+    CityState a = lanes[0].st, b = lanes[1].st;
+    const char *sa = lanes[0].s, *sb = lanes[1].s;
+    for (size_t c = 0; c < common; c++) {
+      CityChunk64(&a, sa);
+      CityChunk64(&b, sb);
+      sa += 64;
+      sb += 64;
+    }
+    lanes[0].st = a;
+    lanes[1].st = b;
+    lanes[0].s = sa;
+    lanes[1].s = sb;
+  }
+  for (int l = 0; l < n; l++) {
+    CityState st = lanes[l].st;
+    const char *s = lanes[l].s;
+    for (size_t c = common; c < lanes[l].chunks; c++) {
+      CityChunk64(&st, s);
+      s += 64;
+    }
+    lanes[l].st = st;
+    lanes[l].s = s;
+  }
+}
+
+static void CityFinish64(CityLane *lanes, int n, uint64 *results) {
+  CityRunLanes(lanes, n);
+  for (int l = 0; l < n; l++) {
+    results[lanes[l].index] = CityHash64Final(&lanes[l].st);
+  }
+}
+
+void CityHash64Batch(const char * const *bufs, const size_t *lens, size_t n,
+                     uint64 *results) {
+  CityLane lanes[kBatchLanes];
+  int pending = 0;
+  for (size_t i = 0; i < n; i++) {
+    const char *s = bufs[i];
+    size_t len = lens[i];
+    if (len <= 64) {
+      results[i] = CityHash64Short(s, len);
+      continue;
+    }
+    if (CityHash64Chunks(len) < kBatchMinChunks) {
+      results[i] = CityHash64(s, len);
+      continue;
+    }
+    CityLane *lane = &lanes[pending++];
+    CityHash64Init(&lane->st, s, len);
+    lane->s = s;
+    lane->chunks = CityHash64Chunks(len);
+    lane->index = i;
+    if (pending == kBatchLanes) {
+      CityFinish64(lanes, pending, results);
+      pending = 0;
+    }
+  }
+  if (pending > 0) {
+    CityFinish64(lanes, pending, results);
+  }
+}
+
+static void CityFinish128(CityLane *lanes, int n, const char * const *bufs,
+                          const size_t *lens, uint128 *results) {
+  CityRunLanes(lanes, n);
+  for (int l = 0; l < n; l++) {
+    // Same offsets as CityHash128(): the first 16 bytes went in the seed
+    size_t len = lens[lanes[l].index] - 16;
+    const char *s = bufs[lanes[l].index] + 16;
+    size_t rest = len - (lanes[l].s - s);
+    results[lanes[l].index] = CityHash128Final(&lanes[l].st, lanes[l].s, rest);
+  }
+}
+
+// Two CityMurmur() at once, 16 bytes of each in turn
+static inline void CityMurmur2(const char *s0, size_t len0, uint128 seed0,
+                               const char *s1, size_t len1, uint128 seed1,
+                               uint128 *result0, uint128 *result1) {
+  CityMurmurState a, b;
+  CityMurmurInit(&a, s0, len0, seed0);
+  CityMurmurInit(&b, s1, len1, seed1);
+  while (a.l > 0 && b.l > 0) {
+    CityMurmurStep(&a, s0);
+    CityMurmurStep(&b, s1);
+    s0 += 16;
+    s1 += 16;
+  }
+  for (; a.l > 0; s0 += 16) {
+    CityMurmurStep(&a, s0);
+  }
+  for (; b.l > 0; s1 += 16) {
+    CityMurmurStep(&b, s1);
+  }
+  *result0 = CityMurmurFinal(&a);
+  *result1 = CityMurmurFinal(&b);
+}
+
+// Same offsets and seed as CityHash128(), len < 16 + 128 (CityMurmur())
+static inline void CityHash128ShortSeed(const char **s, size_t *len,
+                                        uint128 *seed) {
+  if (*len >= 16) {
+    *seed = uint128(Fetch64(*s), Fetch64(*s + 8) + k0);
+    *s += 16;
+    *len -= 16;
+  } else {
+    *seed = uint128(k0, k1);
+  }
+}
+
+void CityHash128Batch(const char * const *bufs, const size_t *lens, size_t n,
+                      uint128 *results) {
+  CityLane lanes[kBatchLanes];
+  int pending = 0;
+  size_t short_pending = n;  // Short string waiting for a pair, n if none
+  for (size_t i = 0; i < n; i++) {
+    const char *s = bufs[i];
+    size_t len = lens[i];
+    if (len < 16 + 128) {
+      if (short_pending == n) {
+        short_pending = i;
+        continue;
+      }
+      const char *s0 = bufs[short_pending];
+      size_t len0 = lens[short_pending];
+      uint128 seed0, seed;
+      CityHash128ShortSeed(&s0, &len0, &seed0);
+      CityHash128ShortSeed(&s, &len, &seed);
+      CityMurmur2(s0, len0, seed0, s, len, seed,
+                  &results[short_pending], &results[i]);
+      short_pending = n;
+      continue;
+    }
+    if (CityHash128Chunks(len - 16) < kBatchMinChunks) {
+      results[i] = CityHash128(s, len);
+      continue;
+    }
+    // Same as CityHash128(): the first 16 bytes are the seed
+    uint128 seed(Fetch64(s), Fetch64(s + 8) + k0);
+    s += 16;
+    len -= 16;
+    CityLane *lane = &lanes[pending++];
+    CityHash128Init(&lane->st, s, len, seed);
+    lane->s = s;
+    lane->chunks = CityHash128Chunks(len);
+    lane->index = i;
+    if (pending == kBatchLanes) {
+      CityFinish128(lanes, pending, bufs, lens, results);
+      pending = 0;
+    }
+  }
+  if (pending > 0) {
+    CityFinish128(lanes, pending, bufs, lens, results);
+  }
+  if (short_pending < n) {
+    results[short_pending] = CityHash128(bufs[short_pending], lens[short_pending]);
+  }
+}
+
 #include <citycrc.h>
+
+// The CRC-based variants are always built.  _mm_crc32_u64() is used when
+// the CPU has it (checked with CPUID at the first call), otherwise a
+// portable CRC-32C that gives the same results.
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CITY_CRC_HW 1
+#include <cpuid.h>
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define CITY_CRC_HW 1
+#include <intrin.h>
 #include <nmmintrin.h>
+#endif
+
+// CRC-32C (Castagnoli, reflected), 8 bytes at a time: the table for
+// slicing-by-8.  Filled once, when the implementation is first selected.
+static uint32 crc32c_table[8][256];
+
+static void InitCrc32cTable() {
+  for (int i = 0; i < 256; i++) {
+    uint32 crc = i;
+    for (int j = 0; j < 8; j++) {
+      crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+    }
+    crc32c_table[0][i] = crc;
+  }
+  for (int i = 0; i < 256; i++) {
+    for (int k = 1; k < 8; k++) {
+      uint32 prev = crc32c_table[k - 1][i];
+      crc32c_table[k][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xff];
+    }
+  }
+}
+
+// Same result as _mm_crc32_u64(crc, v).
+struct Crc32cPortable {
+  static inline uint64 Update(uint64 crc, uint64 v) {
+    uint32 lo = static_cast<uint32>(crc) ^ static_cast<uint32>(v);
+    uint32 hi = static_cast<uint32>(v >> 32);
+    return crc32c_table[7][lo & 0xff] ^
+        crc32c_table[6][(lo >> 8) & 0xff] ^
+        crc32c_table[5][(lo >> 16) & 0xff] ^
+        crc32c_table[4][lo >> 24] ^
+        crc32c_table[3][hi & 0xff] ^
+        crc32c_table[2][(hi >> 8) & 0xff] ^
+        crc32c_table[1][(hi >> 16) & 0xff] ^
+        crc32c_table[0][hi >> 24];
+  }
+};
+
+#ifdef CITY_CRC_HW
+// Only called after CPUID reported SSE4.2.  Without -msse4.2 the
+// intrinsic is not available to gcc, the instruction is emitted directly.
+struct Crc32cSse42 {
+  static inline uint64 Update(uint64 crc, uint64 v) {
+#if defined(__SSE4_2__) || defined(_MSC_VER)
+    return _mm_crc32_u64(crc, v);
+#else
+    __asm__("crc32q %1, %0" : "+r"(crc) : "rm"(v));
+    return crc;
+#endif
+  }
+};
+
+static bool CpuHasSse42() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+#endif
+}
+#endif
 
 // Requires len >= 240.
+template <class Crc>
 static void CityHashCrc256Long(const char *s, size_t len,
                                uint32 seed, uint64 *result) {
   uint64 a = Fetch64(s + 56) + k0;
@@ -522,9 +982,9 @@ static void CityHashCrc256Long(const char *s, size_t len,
     g += e;                                     \
     e += z;                                     \
     g += x;                                     \
-    z = _mm_crc32_u64(z, b + g);                \
-    y = _mm_crc32_u64(y, e + h);                \
-    x = _mm_crc32_u64(x, f + a);                \
+    z = Crc::Update(z, b + g);                  \
+    y = Crc::Update(y, e + h);                  \
+    x = Crc::Update(x, f + a);                  \
     e = Rotate(e, r);                           \
     c += e;                                     \
     s += 40
@@ -577,21 +1037,88 @@ static void CityHashCrc256Long(const char *s, size_t len,
 }
 
 // Requires len < 240.
+template <class Crc>
 static void CityHashCrc256Short(const char *s, size_t len, uint64 *result) {
   char buf[240];
   memcpy(buf, s, len);
   memset(buf + len, 0, 240 - len);
-  CityHashCrc256Long(buf, 240, ~static_cast<uint32>(len), result);
+  CityHashCrc256Long<Crc>(buf, 240, ~static_cast<uint32>(len), result);
 }
 
-void CityHashCrc256(const char *s, size_t len, uint64 *result) {
+template <class Crc>
+static void CityHashCrc256Impl(const char *s, size_t len, uint64 *result) {
   if (LIKELY(len >= 240)) {
-    CityHashCrc256Long(s, len, 0, result);
+    CityHashCrc256Long<Crc>(s, len, 0, result);
   } else {
-    CityHashCrc256Short(s, len, result);
+    CityHashCrc256Short<Crc>(s, len, result);
   }
 }
 
+typedef void (*CityHashCrc256Fn)(const char *s, size_t len, uint64 *result);
+
+struct CrcImpl {
+  CityHashCrcImpl impl;
+  CityHashCrc256Fn fn;
+};
+
+static const CrcImpl kCrcPortable =
+    { kCityHashCrcPortable, CityHashCrc256Impl<Crc32cPortable> };
+#ifdef CITY_CRC_HW
+static const CrcImpl kCrcSse42 =
+    { kCityHashCrcSse42, CityHashCrc256Impl<Crc32cSse42> };
+#endif
+
+static const CrcImpl *SelectCrcImpl() {
+  InitCrc32cTable();
+#ifdef CITY_CRC_HW
+  if (CpuHasSse42()) {
+    return &kCrcSse42;
+  }
+#endif
+  return &kCrcPortable;
+}
+
+// Selected at the first call: the other threads wait for it, and the table
+// is filled before any of them can use the portable implementation.
+static const CrcImpl *DefaultCrcImpl() {
+  static const CrcImpl *selected = SelectCrcImpl();
+  return selected;
+}
+
+// Set by CityHashCrcSetImplementation(), NULL until then.
+static const CrcImpl *crc_forced = NULL;
+
+static inline const CrcImpl *CurrentCrcImpl() {
+  return crc_forced != NULL ? crc_forced : DefaultCrcImpl();
+}
+
+bool CityHashCrcSetImplementation(CityHashCrcImpl impl) {
+  DefaultCrcImpl();
+  switch (impl) {
+    case kCityHashCrcPortable:
+      crc_forced = &kCrcPortable;
+      return true;
+#ifdef CITY_CRC_HW
+    case kCityHashCrcSse42:
+      if (!CpuHasSse42()) {
+        return false;
+      }
+      crc_forced = &kCrcSse42;
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+CityHashCrcImpl CityHashCrcImplementation() {
+  return CurrentCrcImpl()->impl;
+}
+
+void CityHashCrc256(const char *s, size_t len, uint64 *result) {
+  CurrentCrcImpl()->fn(s, len, result);
+}
+
 uint128 CityHashCrc128WithSeed(const char *s, size_t len, uint128 seed) {
   if (len <= 900) {
     return CityHash128WithSeed(s, len, seed);
@@ -614,5 +1141,3 @@ uint128 CityHashCrc128(const char *s, size_t len) {
     return uint128(result[2], result[3]);
   }
 }
-
-#endif
@@ -92,6 +92,53 @@ uint128 CityHash128WithSeed(const char *s, size_t len, uint128 seed);
 // Hash function for a byte array.  Most useful in 32-bit binaries.
 uint32 CityHash32(const char *buf, size_t len);
 
+// Hash functions for n independent byte arrays: results[i] is the same as
+// CityHash64(bufs[i], lens[i]) (or CityHash128()).  Faster than separate
+// calls only for arrays of 1 KB or more (two are hashed at once); shorter
+// arrays, small objects included, take the same time as separate calls.
+void CityHash64Batch(const char * const *bufs, const size_t *lens, size_t n,
+                     uint64 *results);
+void CityHash128Batch(const char * const *bufs, const size_t *lens, size_t n,
+                      uint128 *results);
+
+// Incremental CityHash128(), for strings that are not in one buffer:
+//
+//   CityHash128Stream h;
+//   h.Init(len);
+//   h.Update(chunk1, len1);  // ...as many chunks as needed, in order
+//   uint128 hash = h.Final();
+//
+// The result is the same as CityHash128() (or CityHash128WithSeed(), if
+// InitWithSeed() was used) over the concatenation of the chunks.  The hash
+// depends on the total length from the first bytes on, so it is given to
+// Init(): the chunks must add up to exactly len bytes.  Bytes past len are
+// an error: an assertion fails, or without assertions they are ignored.
+// Chunks can have any size.  Except for the 128-byte blocks that straddle
+// two chunks, the data is hashed where it is, without copies.
+class CityHash128Stream {
+ public:
+  void Init(size_t len);
+  void InitWithSeed(size_t len, uint128 seed);
+  void Update(const char *s, size_t len);
+  uint128 Final();
+
+ private:
+  void Blocks(const char *s, size_t n);
+
+  size_t len_;           // Of the whole string
+  size_t done_;          // Bytes passed to Update() so far
+  size_t prefix_;        // Leading bytes used as the seed (0 or 16)
+  size_t main_;          // Bytes hashed by the main loop, after the prefix
+  size_t buffered_;      // Bytes in buf_ + 128
+  bool started_;         // Main loop state initialized
+  uint128 seed_;
+  uint64 v0_, v1_, w0_, w1_, x_, y_, z_;
+  // Short strings are kept whole in buf_.  Otherwise buf_ + 128 holds the
+  // prefix or a partial block, and buf_ the last block of the main loop,
+  // which is read again with the tail.
+  char buf_[256];
+};
+
 // Hash 128 input bits down to 64 bits of output.
 // This is intended to be a reasonably good hash function.
 inline uint64 Hash128to64(const uint128& x) {
@@ -20,8 +20,10 @@
 //
 // CityHash, by Geoff Pike and Jyrki Alakuijala
 //
-// This file declares the subset of the CityHash functions that require
-// _mm_crc32_u64().  See the CityHash README for details.
+// This file declares the subset of the CityHash functions that are based
+// on CRC-32C.  They use _mm_crc32_u64() if the CPU has it (SSE4.2, checked
+// at the first call) and a portable version of it otherwise: the results
+// are the same.  See the CityHash README for details.
 //
 // Functions in the CityHash family are not suitable for cryptography.
 
@@ -40,4 +42,19 @@ uint128 CityHashCrc128WithSeed(const char *s, size_t len, uint128 seed);
 // Hash function for a byte array.  Sets result[0] ... result[3].
 void CityHashCrc256(const char *s, size_t len, uint64 *result);
 
+// Implementations of the functions above.
+enum CityHashCrcImpl {
+  kCityHashCrcPortable,
+  kCityHashCrcSse42
+};
+
+// The implementation in use, the fastest one available on this CPU
+// unless another one was set.
+CityHashCrcImpl CityHashCrcImplementation();
+
+// Uses the given implementation from now on (i.e. for testing).  Returns
+// false if it is not available on this CPU.  Unlike the functions above it
+// is not thread-safe: no other thread may hash while it is called.
+bool CityHashCrcSetImplementation(CityHashCrcImpl impl);
+
 #endif  // CITY_HASH_CRC_H_
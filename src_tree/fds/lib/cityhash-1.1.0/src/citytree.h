@@ -0,0 +1,46 @@
+// Tree mode of CityHash, for hashing long strings on several cores.
+//
+// The string is split in leaves of kCityTreeLeafSize bytes (the last one
+// can be shorter).  Each leaf is hashed with CityHashCrc128WithSeed(),
+// seeded with its index and the total length, and the root hash is the
+// CityHash128WithSeed() of the leaf hashes.  The leaves do not depend on
+// each other and are hashed in parallel by a CityTreePool; the result only
+// depends on the string, not on the number of threads.  A string of at
+// most one leaf hashes to its CityHashCrc128().
+//
+// The tree hash of a string is NOT its CityHash128() or CityHashCrc128():
+// all the hashes compared to each other must be computed in tree mode.
+
+#ifndef CITY_HASH_TREE_H_
+#define CITY_HASH_TREE_H_
+
+#include <city.h>
+
+// Size of the leaves.  Part of the definition of the hash, changing it
+// changes the hash of all the strings longer than one leaf.
+static const size_t kCityTreeLeafSize = 256 * 1024;
+
+// Tree hash of a byte array, computed by the calling thread.
+uint128 CityHashTree128(const char *s, size_t len);
+
+struct CityTreePoolState;
+
+// Threads hashing the leaves of the tree mode.  Hash() gives the same
+// result as CityHashTree128(), the calling thread hashes leaves as well.
+// One Hash() at a time per pool.
+class CityTreePool {
+ public:
+  // Starts threads - 1 threads, none if threads <= 1.
+  explicit CityTreePool(int threads);
+  ~CityTreePool();
+
+  uint128 Hash(const char *s, size_t len);
+
+ private:
+  CityTreePool(const CityTreePool&);
+  void operator=(const CityTreePool&);
+
+  CityTreePoolState *state_;
+};
+
+#endif  // CITY_HASH_TREE_H_
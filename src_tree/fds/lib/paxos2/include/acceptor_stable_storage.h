@@ -15,4 +15,9 @@ acceptor_record * stablestorage_save_prepare(prepare_req * pr, acceptor_record *
 
 acceptor_record * stablestorage_save_final_value(char * value, size_t size, iid_t iid, ballot_t ballot);
 
+void stablestorage_save_promised_from(iid_t iid, ballot_t ballot);
+int stablestorage_get_promised_from(iid_t * iid, ballot_t * ballot);
+
+int stablestorage_get_highest_iids(iid_t * accepted, iid_t * prepared);
+
 #endif /* end of include guard: ACCEPTOR_STABLE_STORAGE_H_C2XN5QX9 */
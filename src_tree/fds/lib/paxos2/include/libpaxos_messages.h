@@ -2,25 +2,70 @@
 #define LIBPAXOS_MESSAGES_H_HP8GZLGD
 
 /*
-    Paxos message types
+    Wire format: all the structs below are packed, with fixed-width 
+    fields in little-endian byte order, their layout does not depend 
+    on the compiler and is checked at compile time against the schema
+    (see udp_receiver.c).
 */
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The wire format is little-endian, messages are not converted on this host"
+#endif
+
+#define PAXOS_WIRE_PACKED __attribute__((packed))
+
+/*
+    Version written in every message header, messages of versions older 
+    than PAXOS_WIRE_MIN_VERSION are dropped. A version may add message 
+    types (dropped by older receivers) and change the layout of existing 
+    ones: messages of the previous version are converted when received 
+    (see paxos_wire_upgrade), and can be sent in the previous layout while
+    a system is upgraded (see PAXOS_WIRE_SEND_VERSION in paxos_config.h).
+    PAXOS_WIRE_MIN_VERSION is always the previous version, changing a 
+    layout requires raising PAXOS_WIRE_VERSION and updating the conversions.
+    Version 2: client id and sequence numbers in submit_batch, 
+    proposed values start with a paxos_value_tag
+*/
+#define PAXOS_WIRE_VERSION 2
+#define PAXOS_WIRE_MIN_VERSION (PAXOS_WIRE_VERSION - 1)
+
+#ifndef PAXOS_WIRE_SEND_VERSION
+#define PAXOS_WIRE_SEND_VERSION PAXOS_WIRE_VERSION
+#endif
+#if PAXOS_WIRE_SEND_VERSION < PAXOS_WIRE_MIN_VERSION || PAXOS_WIRE_SEND_VERSION > PAXOS_WIRE_VERSION
+#error "PAXOS_WIRE_SEND_VERSION must be between PAXOS_WIRE_MIN_VERSION and PAXOS_WIRE_VERSION"
+#endif
+
+/*
+    Schema of the paxos messages:
+    X(type, id, body struct, size of the body without its variable part)
+    It generates the message types and the compile-time size checks.
+    Ids must fit in the header type field (1 byte).
+*/
+#define PAXOS_WIRE_SCHEMA(X) \
+    X(prepare_reqs,       1,   prepare_req_batch,   4)  /*Phase 1a, P->A*/ \
+    X(prepare_acks,       2,   prepare_ack_batch,   4)  /*Phase 1b, A->P*/ \
+    X(accept_reqs,        4,   accept_req_batch,    4)  /*Phase 2a, P->A*/ \
+    X(accept_acks,        8,   accept_ack_batch,    4)  /*Phase 2b, A->L*/ \
+    X(repeat_reqs,        16,  repeat_req_batch,    4)  /*For progress, L -> A*/ \
+    X(submit,             32,  paxos_no_body,       0)  /*Clients to leader*/ \
+    X(submit_batch,       33,  submit_batch_msg,    6)  /*Clients to leader*/ \
+    X(leader_announce,    64,  leader_announce_msg, 2)  /*Oracle to proposers*/ \
+    X(alive_ping,         65,  alive_ping_msg,      10) /*Proposers to oracle*/ \
+    X(prepare_range_reqs, 128, prepare_range_req,   14) /*Phase 1a for all instances from some iid, P->A*/ \
+    X(prepare_range_acks, 129, prepare_range_ack,   24) /*Phase 1b for the above, A->P*/
+
+#define PAXOS_WIRE_ENUM_ENTRY(TYPE, ID, BODY, SIZE) TYPE = ID,
 
 typedef enum pax_msg_code_e {
-    prepare_reqs=1,     //Phase 1a, P->A
-    prepare_acks=2,     //Phase 1b, A->P
-    accept_reqs=4,      //Phase 2a, P->A
-    accept_acks=8,      //Phase 2b, A->L
-    repeat_reqs=16,     //For progress, L -> A
-    submit=32,          //Clients to leader
-    leader_announce=64, //Oracle to proposers
-    alive_ping=65       //Proposers to oracle
+    PAXOS_WIRE_SCHEMA(PAXOS_WIRE_ENUM_ENTRY)
 } paxos_msg_code;
 
 typedef struct paxos_msg_t {
-    size_t data_size; //Size of 'data' in bytes
-    paxos_msg_code type;
+    uint16_t data_size; //Size of 'data' in bytes
+    uint8_t type;       //paxos_msg_code
+    uint8_t version;    //PAXOS_WIRE_VERSION of the sender
     char data[0];
-} paxos_msg;
+} PAXOS_WIRE_PACKED paxos_msg;
 #define PAXOS_MSG_SIZE(M) (M->data_size + sizeof(paxos_msg))
 
 /* 
@@ -30,7 +75,7 @@ typedef struct paxos_msg_t {
 typedef struct prepare_req_t {
     iid_t iid;
     ballot_t ballot;
-} prepare_req;
+} PAXOS_WIRE_PACKED prepare_req;
 #define PREPARE_REQ_SIZE(M) (sizeof(prepare_req))
 
 //Phase 1b, prepare acknowledgement
@@ -38,18 +83,45 @@ typedef struct prepare_ack_t {
     iid_t iid;
     ballot_t ballot;
     ballot_t value_ballot;
-    size_t value_size;
+    uint32_t value_size;
     char value[0];
-} prepare_ack;
+} PAXOS_WIRE_PACKED prepare_ack;
 #define PREPARE_ACK_SIZE(M) (M->value_size + sizeof(prepare_ack)) 
 
+//Phase 1a for all instances from from_iid on, 
+// (a single phase 1 for a stable leader, see PROPOSER_RANGE_PREPARE)
+typedef struct prepare_range_req_t {
+    short int proposer_id;
+    iid_t from_iid;
+    ballot_t ballot;
+} PAXOS_WIRE_PACKED prepare_range_req;
+
+//Phase 1b for the above, ballot is promised for all instances from from_iid.
+// Instances where a value was accepted (or a higher ballot promised)
+// need a normal phase 1 and are listed in needs_p1. The list is complete 
+// up to listed_to, instances after that need a normal phase 1 too.
+typedef struct prepare_range_ack_t {
+    short int acceptor_id;
+    short int count;
+    iid_t from_iid;
+    ballot_t ballot;
+    iid_t listed_to;
+    iid_t needs_p1[0];
+} PAXOS_WIRE_PACKED prepare_range_ack;
+#define PREPARE_RANGE_ACK_SIZE(M) (sizeof(prepare_range_ack) + (M->count*sizeof(iid_t)))
+//Max number of instances listed in a single prepare_range_ack
+#define PREPARE_RANGE_ACK_MAX_LISTED \
+    ((MAX_UDP_MSG_SIZE - sizeof(paxos_msg) - sizeof(prepare_range_ack)) / sizeof(iid_t))
+//Value of listed_to when the list covers all instances
+#define PREPARE_RANGE_LISTED_ALL ((iid_t)-1)
+
 //Phase 2a, accept request
 typedef struct accept_req_t {
     iid_t iid;
     ballot_t ballot;
-    size_t value_size;
+    uint32_t value_size;
     char value[0];
-} accept_req;
+} PAXOS_WIRE_PACKED accept_req;
 #define ACCEPT_REQ_SIZE(M) (M->value_size + sizeof(accept_req))
 
 //Phase 2b, accept acknowledgement
@@ -58,9 +130,9 @@ typedef struct accept_ack_t {
     ballot_t    ballot;
     ballot_t    value_ballot;
     short int   is_final;
-    size_t      value_size;
+    uint32_t    value_size;
     char        value[0];
-} accept_ack;
+} PAXOS_WIRE_PACKED accept_ack;
 #define ACCEPT_ACK_SIZE(M) (M->value_size + sizeof(accept_ack))
 
 
@@ -72,7 +144,7 @@ typedef struct prepare_req_batch_t {
     short int count;
     short int proposer_id;
     prepare_req prepares[0];
-} prepare_req_batch;
+} PAXOS_WIRE_PACKED prepare_req_batch;
 #define PREPARE_REQ_BATCH_SIZE(M) (sizeof(prepare_req_batch) + (M->count*sizeof(prepare_req)))
 
 
@@ -80,7 +152,7 @@ typedef struct prepare_ack_batch_t {
     short int acceptor_id;
     short int count;
     char data[0];
-} prepare_ack_batch;
+} PAXOS_WIRE_PACKED prepare_ack_batch;
 size_t prepare_ack_batch_size_calc(prepare_ack_batch * pab);
 #define PREPARE_ACK_BATCH_SIZE(M) (prepare_ack_batch_size_calc(M))
 
@@ -89,7 +161,7 @@ typedef struct accept_req_batch_t {
     short int count;
     short int proposer_id;
     char data[0];
-} accept_req_batch;
+} PAXOS_WIRE_PACKED accept_req_batch;
 size_t accept_req_batch_size_calc(accept_req_batch * aab);
 #define ACCEPT_REQ_BATCH_SIZE(M) (accept_req_batch_size_calc(M))
 
@@ -97,28 +169,92 @@ typedef struct accept_ack_batch_t {
     short int   acceptor_id;
     short int   count;
     char        data[0];
-} accept_ack_batch;
+} PAXOS_WIRE_PACKED accept_ack_batch;
 size_t accept_ack_batch_size_calc(accept_ack_batch * aab);
 #define ACCEPT_ACK_BATCH_SIZE(M) (accept_ack_batch_size_calc(M))
 
+//The count iids requested are encoded in requests_size bytes: 
+// the first one as is, the others as difference from the previous one,
+// each one as a varint (see below). Consecutive iids take 1 byte each.
 typedef struct repeat_req_batch_t {
     short int count;
-    iid_t requests[0];
-} repeat_req_batch;
-#define REPEAT_REQ_BATCH_SIZE(B) (sizeof(repeat_req_batch) + (sizeof(iid_t) * B->count))
+    short int requests_size;
+    uint8_t requests[0];
+} PAXOS_WIRE_PACKED repeat_req_batch;
+#define REPEAT_REQ_BATCH_SIZE(B) (sizeof(repeat_req_batch) + B->requests_size)
+
+//Variable length encoding of iids: 7 bits per byte, least significant
+// first, the high bit is set if more bytes follow.
+//Encode returns the bytes written (at most IID_VARINT_MAX_SIZE),
+// decode the bytes read, 0 if buf (len bytes) is not a valid encoding
+#define IID_VARINT_MAX_SIZE 10
+size_t iid_varint_encode(iid_t iid, uint8_t * buf);
+size_t iid_varint_decode(uint8_t * buf, size_t len, iid_t * iid);
+
+//Values coalesced by a submit handle, count entries follow.
+// Each one is identified by the client sequence number, 
+// resubmitting it does not make it decided twice (see paxos_value_tag)
+typedef struct submit_batch_entry_t {
+    uint64_t client_seq;
+    uint16_t value_size;
+    char value[0];
+} PAXOS_WIRE_PACKED submit_batch_entry;
+#define SUBMIT_BATCH_ENTRY_SIZE(E) (sizeof(submit_batch_entry) + E->value_size)
+
+typedef struct submit_batch_msg_t {
+    uint32_t client_id;
+    uint16_t count;
+    char data[0];
+} PAXOS_WIRE_PACKED submit_batch_msg;
+
+//Prefix of every value proposed by the leader, the submission it 
+// comes from. Learners deliver each (client_id, client_seq) only once,
+// and strip the tag. Values submitted without an id (submit, 
+// pax_submit_sharedmem) have client_id PAXOS_NO_CLIENT_ID, values 
+// submitted without a sequence number (pax_submit_nonblock) have 
+// client_seq PAXOS_NO_CLIENT_SEQ, neither is checked for duplicates.
+typedef struct paxos_value_tag_t {
+    uint32_t client_id;
+    uint64_t client_seq;
+    char value[0];
+} PAXOS_WIRE_PACKED paxos_value_tag;
+#define PAXOS_NO_CLIENT_ID 0
+#define PAXOS_NO_CLIENT_SEQ 0
+
+//Body of the messages that have none (i.e. submit, the value follows the header)
+typedef struct paxos_no_body_t {
+    char data[0];
+} PAXOS_WIRE_PACKED paxos_no_body;
 
 /* 
     Failure detection/leader election messages
 */
 typedef struct leader_announce_msg_t {
     short int current_leader;
-} leader_announce_msg;
+} PAXOS_WIRE_PACKED leader_announce_msg;
 
 typedef struct alive_ping_msg_t {
     short int proposer_id;
-    long unsigned int sequence_number;
-} alive_ping_msg;
+    uint64_t sequence_number;
+} PAXOS_WIRE_PACKED alive_ping_msg;
+
+
+
+//Size of the body of a message of this type without its variable part,
+// -1 if the type is not known (i.e. introduced by a newer version)
+int paxos_wire_min_size(int type);
 
+//Converted messages are larger than the original by at most this many bytes
+#define PAXOS_WIRE_COMPAT_MAX_GROWTH MAX_UDP_MSG_SIZE
 
+//Converts (in place) a message of version PAXOS_WIRE_MIN_VERSION to the 
+// layout of PAXOS_WIRE_VERSION, buf_size is the space available for it.
+// Returns 0 on success (or if the layout did not change), -1 if the message 
+// is malformed or the converted one does not fit. See wire_compat.c
+int paxos_wire_upgrade(paxos_msg * m, size_t buf_size);
+//Writes in out (MAX_UDP_MSG_SIZE bytes) the message in the layout of
+// PAXOS_WIRE_MIN_VERSION, never larger than the original one.
+// Returns 0 on success, -1 if the message is malformed
+int paxos_wire_downgrade(paxos_msg * m, paxos_msg * out);
 
 #endif /* end of include guard: LIBPAXOS_MESSAGES_H_HP8GZLGD */
@@ -11,6 +11,7 @@
 
 #include "libpaxos_messages.h"
 #include "values_handler.h"
+#include "submit_session.h"
 /*
     Debug functions, used internally for testing and debug
 */
@@ -20,6 +21,10 @@ void learner_suspend();
 
 int learner_is_closed(iid_t iid);
 
+//Like learner_init, values are delivered as decided: with their 
+// paxos_value_tag and including duplicates (for acceptors and proposers)
+int learner_init_raw(deliver_function f, custom_init_function cif);
+
 typedef accept_ack acceptor_record;
 
 
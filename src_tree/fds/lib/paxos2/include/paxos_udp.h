@@ -13,6 +13,8 @@ typedef struct udp_send_buffer_t {
     int sock;
     struct sockaddr_in addr;
     int dirty;
+    //Last iid added to the current repeat_req_batch
+    iid_t last_repeat_req;
     // size_t bufsize;
     char buffer[MAX_UDP_MSG_SIZE];
 } udp_send_buffer;
@@ -20,7 +22,16 @@ typedef struct udp_send_buffer_t {
 typedef struct udp_receiver_t {
     int sock;
     struct sockaddr_in addr;
-    char recv_buffer[MAX_UDP_MSG_SIZE];
+    //Room for a message of the previous wire version once converted
+    char recv_buffer[MAX_UDP_MSG_SIZE + PAXOS_WIRE_COMPAT_MAX_GROWTH];
+    //Datagrams coalesced by the OS, returned 
+    // one by one by udp_read_next_message
+    char * gro_buffer;
+    int gro_size;
+    int gro_offset;
+    int gro_segment_size;
+    //Datagrams received through io_uring (if not NULL)
+    struct udp_uring_t * uring;
 } udp_receiver;
 
 
@@ -35,15 +46,23 @@ void sendbuf_add_prepare_req(udp_send_buffer * sb, iid_t iid, ballot_t ballot);
 void sendbuf_add_prepare_ack(udp_send_buffer * sb, acceptor_record * rec);
 void sendbuf_add_accept_req(udp_send_buffer * sb, iid_t iid, ballot_t ballot, char * value, size_t val_size);
 void sendbuf_add_submit_val(udp_send_buffer * sb, char * value, size_t val_size);
+void sendbuf_add_submit_batch_val(udp_send_buffer * sb, uint64_t client_seq, char * value, size_t val_size);
 
 
 udp_receiver * udp_receiver_blocking_new(char* address_string, int port);
 udp_receiver * udp_receiver_new(char* address_string, int port);
 int udp_read_next_message(udp_receiver * recv_info);
+int udp_receiver_enable_gro(udp_receiver * rec);
+int udp_receiver_has_pending(udp_receiver * rec);
+int udp_receiver_enable_io_uring(udp_receiver * rec);
+int udp_receiver_get_fd(udp_receiver * rec);
 int udp_receiver_destroy(udp_receiver * rec);
 
 void sendbuf_send_ping(udp_send_buffer * sb, short int proposer_id, long unsigned int sequence_number);
 void sendbuf_send_leader_announce(udp_send_buffer * sb, short int leader_id);
+void sendbuf_send_prepare_range_req(udp_send_buffer * sb, short int proposer_id, iid_t from_iid, ballot_t ballot);
+void sendbuf_send_prepare_range_ack(udp_send_buffer * sb, short int acceptor_id, 
+    iid_t from_iid, ballot_t ballot, iid_t * needs_p1, short int count, iid_t listed_to);
 
 
 void print_paxos_msg(paxos_msg * msg);
@@ -0,0 +1,29 @@
+#ifndef SUBMIT_SESSION_H_Q4M8WZ2K
+#define SUBMIT_SESSION_H_Q4M8WZ2K
+
+#include <stdint.h>
+
+/*
+    Table of the (client_id, client_seq) already seen, used by the leader
+    to drop resubmitted values and by learners to deliver them only once.
+    Bounded: SUBMIT_SESSION_TABLE_SIZE clients, SUBMIT_SESSION_WINDOW 
+    sequence numbers each (see paxos_config.h)
+*/
+typedef struct submit_session_t {
+    uint32_t client_id;
+    uint64_t highest_seq;
+    //Bit i is set if highest_seq-i was seen
+    uint64_t window;
+} submit_session;
+
+typedef struct submit_session_table_t {
+    submit_session sessions[SUBMIT_SESSION_TABLE_SIZE];
+} submit_session_table;
+
+void submit_session_table_clear(submit_session_table * st);
+//Returns 1 if the value was seen already, otherwise records it 
+// and returns 0. Values without client id or sequence number 
+// are never duplicates.
+int submit_session_check(submit_session_table * st, uint32_t client_id, uint64_t client_seq);
+
+#endif /* end of include guard: SUBMIT_SESSION_H_Q4M8WZ2K */
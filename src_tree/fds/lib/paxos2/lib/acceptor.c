@@ -31,6 +31,16 @@ static struct timeval periodic_repeat_interval;
 
 //The highest instance id for which a value was accepted
 static iid_t highest_accepted_iid = 0;
+//The highest instance id for which a (per-instance) promise was made
+static iid_t highest_prepared_iid = 0;
+
+//Promise made for all instances from promised_from_iid on 
+// (see prepare_range_req), ballot is 0 if there is no such promise
+static iid_t promised_from_iid = 0;
+static ballot_t promised_from_ballot = 0;
+
+//Instances listed in the next prepare_range_ack
+static iid_t range_needs_p1[PREPARE_RANGE_ACK_MAX_LISTED];
 
 // TODO periodic retransmission and update-on-deliver are currently in a transaction. Could be prepended to the next instead
 
@@ -38,21 +48,33 @@ static iid_t highest_accepted_iid = 0;
 // Helpers
 /*-------------------------------------------------------------------------*/
 
+//Highest ballot promised for this instance, either with a 
+// per-instance prepare (in the record) or with a range prepare
+static ballot_t
+acc_promised_ballot(iid_t iid, acceptor_record * rec) {
+    ballot_t promised = (rec != NULL ? rec->ballot : 0);
+    if(iid >= promised_from_iid && promised_from_ballot > promised) {
+        promised = promised_from_ballot;
+    }
+    return promised;
+}
+
 //Given an accept request (phase 2a) message and the current record
 // will update the record if the request is legal
 // Return NULL for no changes, the new record if the accept was applied
 static acceptor_record *
 acc_apply_accept(accept_req * ar, acceptor_record * rec) {
     //We already have a more recent ballot
-    if (rec != NULL && rec->ballot < ar->ballot) {
-        LOG(DBG, ("Accept for iid:%u dropped (ballots curr:%u recv:%u)\n", 
-            ar->iid, rec->ballot, ar->ballot));
+    ballot_t promised = acc_promised_ballot(ar->iid, rec);
+    if (promised > ar->ballot) {
+        LOG(DBG, ("Accept for iid:%lu dropped (ballots curr:%u recv:%u)\n", 
+            ar->iid, promised, ar->ballot));
         return NULL;
     }
     
     //Record not found or smaller ballot
     // in both cases overwrite and store
-    LOG(DBG, ("Accepting for iid:%u (ballot:%u)\n", 
+    LOG(DBG, ("Accepting for iid:%lu (ballot:%u)\n", 
         ar->iid, ar->ballot));
     
     //Store the updated record
@@ -61,7 +83,7 @@ acc_apply_accept(accept_req * ar, acceptor_record * rec) {
     //Keep track of highest accepted for retransmission
     if(ar->iid > highest_accepted_iid) {
         highest_accepted_iid = ar->iid;
-        LOG(DBG, ("Highest accepted is now iid:%u\n", 
+        LOG(DBG, ("Highest accepted is now iid:%lu\n", 
             highest_accepted_iid));
     }
     return rec;
@@ -73,27 +95,32 @@ acc_apply_accept(accept_req * ar, acceptor_record * rec) {
 static acceptor_record *
 acc_apply_prepare(prepare_req * pr, acceptor_record * rec) {
     //We already have a more recent ballot
-    if (rec != NULL && rec->ballot >= pr->ballot) {
-        LOG(DBG, ("Prepare request for iid:%u dropped (ballots curr:%u recv:%u)\n", 
-            pr->iid, rec->ballot, pr->ballot));
+    ballot_t promised = acc_promised_ballot(pr->iid, rec);
+    if (promised >= pr->ballot) {
+        LOG(DBG, ("Prepare request for iid:%lu dropped (ballots curr:%u recv:%u)\n", 
+            pr->iid, promised, pr->ballot));
         return NULL;
     }
     
     //Stored value is final, the instance is closed already
     if (rec != NULL && rec->is_final) {
-        LOG(DBG, ("Prepare request for iid:%u dropped \
+        LOG(DBG, ("Prepare request for iid:%lu dropped \
             (stored value is final)\n", pr->iid));
         return NULL;
     }
     
     //Record not found or smaller ballot
     // in both cases overwrite and store
-    LOG(DBG, ("Prepare request is valid for iid:%u (ballot:%u)\n", 
+    LOG(DBG, ("Prepare request is valid for iid:%lu (ballot:%u)\n", 
         pr->iid, pr->ballot));
     
     //Store the updated record
     rec = stablestorage_save_prepare(pr, rec);
 
+    //Keep track of highest prepared for range prepares
+    if(pr->iid > highest_prepared_iid) {
+        highest_prepared_iid = pr->iid;
+    }
     return rec;
 }
 
@@ -130,7 +157,7 @@ acc_periodic_repeater(int fd, short event, void *arg)
     //If some value has been accepted,
     if (highest_accepted_iid > 0) {
         //Rebroadcast most recent (so that learners stay up-to-date)
-        LOG(DBG, ("re-sending most recent accept, iid:%u\n", highest_accepted_iid));
+        LOG(DBG, ("re-sending most recent accept, iid:%lu\n", highest_accepted_iid));
         acc_retransmit_latest_accept();
     }
     
@@ -185,6 +212,68 @@ handle_prepare_req_batch(prepare_req_batch* prb) {
 
 }
 
+//Received a prepare request for all instances from some iid (phase 1a),
+// the promise is saved as a watermark. The answer lists the instances
+// that still need a normal phase 1: some value was accepted or a
+// higher ballot was promised with a per-instance prepare
+static void
+handle_prepare_range_req(prepare_range_req * prr) {
+    
+    //Already promised a higher ballot
+    if(prr->ballot < promised_from_ballot) {
+        LOG(DBG, ("Prepare range from iid:%lu dropped (ballots curr:%u recv:%u)\n", 
+            prr->from_iid, promised_from_ballot, prr->ballot));
+        return;
+    }
+    
+    //Extend the watermark (a retransmission leaves it unchanged).
+    // The new promise also covers instances of the old one, 
+    // promising more than requested is safe
+    iid_t from_iid = prr->from_iid;
+    if(promised_from_ballot != 0 && promised_from_iid < from_iid) {
+        from_iid = promised_from_iid;
+    }
+    if(promised_from_ballot != prr->ballot || promised_from_iid != from_iid) {
+        promised_from_ballot = prr->ballot;
+        promised_from_iid = from_iid;
+        stablestorage_save_promised_from(promised_from_iid, promised_from_ballot);
+        LOG(DBG, ("Promised ballot %u for all instances from iid:%lu\n", 
+            promised_from_ballot, promised_from_iid));
+    }
+    
+    //Find instances that need a normal phase 1
+    iid_t highest_seen = highest_accepted_iid;
+    if(highest_prepared_iid > highest_seen) {
+        highest_seen = highest_prepared_iid;
+    }
+    short int count = 0;
+    iid_t listed_to = PREPARE_RANGE_LISTED_ALL;
+    acceptor_record * rec;
+    iid_t iid;
+    
+    stablestorage_tx_begin();
+    for(iid = prr->from_iid; iid <= highest_seen; iid++) {
+        rec = stablestorage_get_record(iid);
+        if(rec == NULL || (rec->value_size == 0 && rec->ballot < prr->ballot)) {
+            continue;
+        }
+        
+        //Does not fit, the list is complete up to the previous one
+        if((size_t)count == PREPARE_RANGE_ACK_MAX_LISTED) {
+            listed_to = iid - 1;
+            break;
+        }
+        range_needs_p1[count] = iid;
+        count += 1;
+    }
+    stablestorage_tx_end();
+    
+    LOG(DBG, ("Prepare range from iid:%lu valid, %d instances need phase 1\n", 
+        prr->from_iid, count));
+    sendbuf_send_prepare_range_ack(to_proposers, this_acceptor_id, 
+        prr->from_iid, prr->ballot, range_needs_p1, count, listed_to);
+}
+
 //Received a batch of accept requests (phase 2a)
 // may answer with multiple messages, all reads/updates
 // needs to be wrapped into transactions and made persistent
@@ -243,17 +332,28 @@ handle_repeat_req_batch(repeat_req_batch* rrb) {
     
     short int i;
     acceptor_record * rec;
+    iid_t iid = 0, diff;
+    size_t offset = 0, size;
     
     //Iterate over the repeat_req in the batch
     for(i = 0; i < rrb->count; i++) {
+        //Each iid is encoded as difference from the previous one
+        size = iid_varint_decode(&rrb->requests[offset], rrb->requests_size - offset, &diff);
+        if(size == 0) {
+            printf("Invalid repeat request batch dropped\n");
+            break;
+        }
+        offset += size;
+        iid += diff;
+
         //Read the corresponding record
-        rec = stablestorage_get_record(rrb->requests[i]);
+        rec = stablestorage_get_record(iid);
         
         //If a value was accepted, send accept_ack
         if(rec != NULL && rec->value_size > 0) {
             sendbuf_add_accept_ack(to_learners, rec);
         } else {
-            LOG(DBG, ("Cannot retransmit iid:%u no value accepted \n", rrb->requests[i]));
+            LOG(DBG, ("Cannot retransmit iid:%lu no value accepted \n", iid));
         }
     }
     
@@ -272,38 +372,46 @@ acc_handle_newmsg(int sock, short event, void *arg) {
     UNUSED_ARG(event);
     UNUSED_ARG(arg);
     
-    assert(sock == for_acceptor->sock);
-    
-    //Read the next message
-    int valid = udp_read_next_message(for_acceptor);
-    if (valid < 0) {
-        printf("Dropping invalid acceptor message\n");
-        return;
-    }
+    assert(sock == udp_receiver_get_fd(for_acceptor));
     
-    //The message is valid, take the appropriate action
-    // based on the type
-    paxos_msg * msg = (paxos_msg*) &for_acceptor->recv_buffer;
-    switch(msg->type) {
-        case prepare_reqs: {
-            handle_prepare_req_batch((prepare_req_batch*) msg->data);
+    //Multiple datagrams may be read at once (see PAXOS_UDP_GRO, PAXOS_UDP_IO_URING)
+    do {
+        //Read the next message
+        int valid = udp_read_next_message(for_acceptor);
+        if (valid < 0) {
+            printf("Dropping invalid acceptor message\n");
+            continue;
         }
-        break;
-
-        case accept_reqs: {
-            handle_accept_req_batch((accept_req_batch*) msg->data);
-        }
-        break;
-
-        case repeat_reqs: {
-            handle_repeat_req_batch((repeat_req_batch*) msg->data);
-        }
-        break;
-
-        default: {
-            printf("Unknow msg type %d received by acceptor\n", msg->type);
+    
+        //The message is valid, take the appropriate action
+        // based on the type
+        paxos_msg * msg = (paxos_msg*) &for_acceptor->recv_buffer;
+        switch(msg->type) {
+            case prepare_reqs: {
+                handle_prepare_req_batch((prepare_req_batch*) msg->data);
+            }
+            break;
+
+            case prepare_range_reqs: {
+                handle_prepare_range_req((prepare_range_req*) msg->data);
+            }
+            break;
+
+            case accept_reqs: {
+                handle_accept_req_batch((accept_req_batch*) msg->data);
+            }
+            break;
+
+            case repeat_reqs: {
+                handle_repeat_req_batch((repeat_req_batch*) msg->data);
+            }
+            break;
+
+            default: {
+                printf("Unknow msg type %d received by acceptor\n", msg->type);
+            }
         }
-    }
+    } while(udp_receiver_has_pending(for_acceptor));
 }
 //The acceptor runs on top of a learner, if the learner is active
 // (ACCEPTOR_UPDATE_ON_DELIVER is defined), this is the function 
@@ -362,7 +470,11 @@ init_acc_network() {
         printf("Error creating acceptor network receiver\n");
         return ACCEPTOR_ERROR;
     }
-    event_set(&acceptor_msg_event, for_acceptor->sock, EV_READ|EV_PERSIST, acc_handle_newmsg, NULL);
+    if(udp_receiver_enable_io_uring(for_acceptor) != 0) {
+        udp_receiver_enable_gro(for_acceptor);
+    }
+    event_set(&acceptor_msg_event, udp_receiver_get_fd(for_acceptor), EV_READ|EV_PERSIST, acc_handle_newmsg, NULL);
+    event_base_set(learner_get_event_base(), &acceptor_msg_event);
     event_add(&acceptor_msg_event, NULL);
     
     return 0;
@@ -374,6 +486,7 @@ init_acc_timers() {
     
     //Sets the first acc_periodic_repeater invocation timeout
     evtimer_set(&repeat_accept_event, acc_periodic_repeater, NULL);
+    event_base_set(learner_get_event_base(), &repeat_accept_event);
 	evutil_timerclear(&periodic_repeat_interval);
 	periodic_repeat_interval.tv_sec = ACCEPTOR_REPEAT_INTERVAL;
     periodic_repeat_interval.tv_usec = 0;
@@ -389,7 +502,27 @@ init_acc_timers() {
 // Berlekey DB in this case
 static int
 init_acc_stable_storage() {
-    return stablestorage_init(this_acceptor_id);
+    if(stablestorage_init(this_acceptor_id) != 0) {
+        return -1;
+    }
+    
+    //Promise made before a crash (only if recovering)
+    if(stablestorage_get_promised_from(&promised_from_iid, &promised_from_ballot) == 0) {
+        LOG(VRB, ("Recovered promise of ballot %u for all instances from iid:%lu\n", 
+            promised_from_ballot, promised_from_iid));
+    }
+    
+    //The watermarks bound the scan of handle_prepare_range_req,
+    // they must cover the records saved before a crash
+    stablestorage_tx_begin();
+    int result = stablestorage_get_highest_iids(&highest_accepted_iid, &highest_prepared_iid);
+    stablestorage_tx_end();
+    if(result != 0) {
+        return -1;
+    }
+    LOG(VRB, ("Highest accepted iid:%lu, highest prepared iid:%lu\n", 
+        highest_accepted_iid, highest_prepared_iid));
+    return 0;
 }
 
 //Acceptor initialization, this function is invoked by
@@ -451,7 +584,7 @@ int acceptor_init(int acceptor_id) {
     LOG(VRB, ("Acceptor %d starting...\n", this_acceptor_id));
     
     //Starts a learner with a custom init function
-    if (learner_init(acc_deliver_callback, init_acceptor) != 0) {
+    if (learner_init_raw(acc_deliver_callback, init_acceptor) != 0) {
         printf("Could not start the learner!\n");
         return -1;
     }
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <assert.h>
 /*
 Getting started:
@@ -44,6 +45,8 @@ void stablestorage_do_recovery() {
 static char db_env_path[512];
 static char db_filename[512];
 static char db_file_path[512];
+static char promise_file_path[600];
+static char promise_tmp_path[600];
 
 int bdb_init_tx_handle(int tx_mode) {
     int result;
@@ -156,6 +159,8 @@ int stablestorage_init(int acceptor_id) {
     sprintf(db_env_path, ACCEPTOR_DB_PATH);    
     sprintf(db_filename, ACCEPTOR_DB_FNAME);
     sprintf(db_file_path, "%s/%s", db_env_path, db_filename);
+    sprintf(promise_file_path, "%s/promised_from", db_env_path);
+    sprintf(promise_tmp_path, "%s/promised_from.tmp", db_env_path);
     LOG(VRB, ("Opening db file %s/%s\n", db_env_path, db_filename));    
 
     struct stat sb;
@@ -350,11 +355,11 @@ stablestorage_get_record(iid_t iid) {
     
     if(result == DB_NOTFOUND || result == DB_KEYEMPTY) {
         //Record does not exist
-        LOG(DBG, ("The record for iid:%u does not exist\n", iid));
+        LOG(DBG, ("The record for iid:%lu does not exist\n", iid));
         return NULL;
     } else if (result != 0) {
         //Read error!
-        printf("Error while reading record for iid:%u : %s\n",
+        printf("Error while reading record for iid:%lu : %s\n",
             iid, db_strerror(result));
         return NULL;
     }
@@ -487,3 +492,90 @@ stablestorage_save_final_value(char * value, size_t size, iid_t iid, ballot_t ba
     return record_buffer;
 
 }
+
+//Save the promise made for all instances from iid on (see prepare_range_req).
+// It's a single small record, kept in a separate file and replaced atomically
+void
+stablestorage_save_promised_from(iid_t iid, ballot_t ballot) {
+    int result;
+    FILE * f = fopen(promise_tmp_path, "w");
+    assert(f != NULL);
+    
+    result = fprintf(f, "%lu %u\n", iid, ballot);
+    assert(result > 0);
+    result = fflush(f);
+    assert(result == 0);
+    
+    //Same durability of the records
+    if(DURABILITY_MODE == 13 || DURABILITY_MODE == 20) {
+        result = fsync(fileno(f));
+        assert(result == 0);
+    }
+    fclose(f);
+    
+    result = rename(promise_tmp_path, promise_file_path);
+    assert(result == 0);
+}
+
+//Reads the promise saved by stablestorage_save_promised_from,
+// returns -1 if no such promise was made
+int
+stablestorage_get_promised_from(iid_t * iid, ballot_t * ballot) {
+    FILE * f = fopen(promise_file_path, "r");
+    if(f == NULL) {
+        return -1;
+    }
+    
+    int result = fscanf(f, "%lu %u", iid, ballot);
+    fclose(f);
+    if(result != 2) {
+        printf("Error: invalid promise file %s\n", promise_file_path);
+        return -1;
+    }
+    return 0;
+}
+
+//Scans the records to find the highest instance with a value (accepted
+// or final) and the highest instance with any record (value or promise),
+// both are 0 if there is no such instance. Invoked once when recovering,
+// since the acceptor keeps those watermarks in memory only.
+// Scans all records since with DB_BTREE keys are not sorted by iid
+int
+stablestorage_get_highest_iids(iid_t * accepted, iid_t * prepared) {
+    int result;
+    DBC * cursor;
+    DBT dbkey, dbdata;
+    
+    *accepted = 0;
+    *prepared = 0;
+    
+    result = dbp->cursor(dbp, txn, &cursor, 0);
+    if(result != 0) {
+        printf("DB cursor failed: %s\n", db_strerror(result));
+        return -1;
+    }
+    
+    memset(&dbkey, 0, sizeof(DBT));
+    memset(&dbdata, 0, sizeof(DBT));
+    
+    //Data is our buffer
+    dbdata.data = record_buffer;
+    dbdata.ulen = MAX_UDP_MSG_SIZE;
+    dbdata.flags = DB_DBT_USERMEM;
+
+    while((result = cursor->get(cursor, &dbkey, &dbdata, DB_NEXT)) == 0) {
+        if(record_buffer->iid > *prepared) {
+            *prepared = record_buffer->iid;
+        }
+        if(record_buffer->value_ballot > 0 && record_buffer->iid > *accepted) {
+            *accepted = record_buffer->iid;
+        }
+    }
+    cursor->close(cursor);
+    
+    if(result != DB_NOTFOUND) {
+        printf("Error while scanning records: %s\n", db_strerror(result));
+        return -1;
+    }
+    return 0;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
 #include <pthread.h> 
@@ -48,17 +49,31 @@ static custom_init_function custom_init = NULL;
 // the final value and some other informations is passed as argument
 static deliver_function delfun = NULL;
 
+//If set, values are delivered as decided (with their paxos_value_tag)
+// and duplicates are not filtered. Used by acceptors and proposers.
+static int deliver_raw = 0;
+
+//Submissions delivered already, resubmitted values are delivered once
+static submit_session_table delivered_sessions;
+
 //Current status of the learner and related signal
 // The thread calling learner init waits until the new thread completed initialization
 static int learner_ready = LEARNER_STARTING;
 static pthread_mutex_t ready_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  ready_cond = PTHREAD_COND_INITIALIZER;
 static pthread_t learner_thread = NULL;
+//Set by the first learner_init, a process runs a single learner
+static int learner_started = 0;
 struct event init_complete_event;
 
 //Timeval interval to schedule events as soon as possible
 struct timeval asap_interval = {0, 0};
 
+#ifdef PAXOS_BUSY_POLL_USEC
+//Always pending, keeps the event loop from sleeping
+struct event busy_poll_event;
+#endif
+
 //Libevent handle
 static struct event_base * eb;
 // Event: a message was received
@@ -116,7 +131,7 @@ static void lea_store_accept_ack(l_inst_info * ii, short int acceptor_id, accept
 static int lea_update_state(l_inst_info * ii, short int acceptor_id, accept_ack * aa) {
     //First message for this iid
     if(ii->iid == INST_INFO_EMPTY) {
-        LOG(DBG, ("Received first message for instance:%u\n", aa->iid));
+        LOG(DBG, ("Received first message for instance:%lu\n", aa->iid));
         ii->iid = aa->iid;
         ii->last_update_ballot = aa->ballot;
     }
@@ -124,13 +139,13 @@ static int lea_update_state(l_inst_info * ii, short int acceptor_id, accept_ack
     
     //Instance closed already, drop
     if(IS_CLOSED(ii)) {
-        LOG(DBG, ("Dropping accept_ack for iid:%u, already closed\n", aa->iid));
+        LOG(DBG, ("Dropping accept_ack for iid:%lu, already closed\n", aa->iid));
         return 0;
     }
     
     //No previous message to overwrite for this acceptor
     if(ii->acks[acceptor_id] == NULL) {
-        LOG(DBG, ("Got first ack for iid:%u, acceptor:%d\n", \
+        LOG(DBG, ("Got first ack for iid:%lu, acceptor:%d\n", \
             ii->iid, acceptor_id));
         //Save this accept_ack
         lea_store_accept_ack(ii, acceptor_id, aa);
@@ -143,12 +158,12 @@ static int lea_update_state(l_inst_info * ii, short int acceptor_id, accept_ack
     
     //Already more recent info in the record, accept_ack is old
     if(prev_ack->ballot >= aa->ballot) {
-        LOG(DBG, ("Dropping accept_ack for iid:%u, stored ballot is newer or equal\n", aa->iid));
+        LOG(DBG, ("Dropping accept_ack for iid:%lu, stored ballot is newer or equal\n", aa->iid));
         return 0;
     }
     
     //Replace the previous ack since the received ballot is newer
-    LOG(DBG, ("Overwriting previous accept_ack for iid:%u\n", aa->iid));
+    LOG(DBG, ("Overwriting previous accept_ack for iid:%lu\n", aa->iid));
     PAX_FREE(prev_ack);
     lea_store_accept_ack(ii, acceptor_id, aa);
     ii->last_update_ballot = aa->ballot;
@@ -189,7 +204,7 @@ static int lea_check_quorum(l_inst_info * ii) {
     
     //Reached a quorum/majority!
     if(count >= QUORUM) {
-        LOG(DBG, ("Reached quorum, iid:%u is closed!\n", ii->iid));
+        LOG(DBG, ("Reached quorum, iid:%lu is closed!\n", ii->iid));
         ii->final_value = ii->acks[a_valid_index];
         
         //Keep track of highest closed
@@ -205,6 +220,26 @@ static int lea_check_quorum(l_inst_info * ii) {
 
 }
 
+//Delivers the value without its tag, unless it's a duplicate 
+// of one delivered already (same client and sequence number)
+static void lea_deliver_tagged(accept_ack * aa, short int proposer_id) {
+    paxos_value_tag * tag = (paxos_value_tag *)aa->value;
+    if(aa->value_size < sizeof(paxos_value_tag)) {
+        printf("Skipping value without tag, iid:%lu size:%u\n", 
+            current_iid, aa->value_size);
+        return;
+    }
+
+    if(submit_session_check(&delivered_sessions, tag->client_id, tag->client_seq)) {
+        LOG(VRB, ("Skipping duplicate value in iid:%lu, client:%u seq:%lu\n", 
+            current_iid, tag->client_id, tag->client_seq));
+        return;
+    }
+    
+    delfun(tag->value, aa->value_size - sizeof(paxos_value_tag), 
+        current_iid, aa->ballot, proposer_id);
+}
+
 //Invoked when the current_iid is closed.
 // Since other instances may be closed too (curr+1, curr+2), also tries to deliver them
 static void lea_deliver_next_closed() {
@@ -219,7 +254,11 @@ static void lea_deliver_next_closed() {
         
         //Deliver the value trough callback
         short int proposer_id = aa->ballot % MAX_N_OF_PROPOSERS;
-        delfun(aa->value, aa->value_size, current_iid, aa->ballot, proposer_id);
+        if(deliver_raw) {
+            delfun(aa->value, aa->value_size, current_iid, aa->ballot, proposer_id);
+        } else {
+            lea_deliver_tagged(aa, proposer_id);
+        }
         
         //Move to next instance
         current_iid++;
@@ -267,11 +306,11 @@ lea_hole_check(int fd, short event, void *arg) {
     //Periodic check for missing instances
     //(i.e. i+1 closed, but i not closed yet)
     if (highest_iid_seen > current_iid + LEARNER_ARRAY_SIZE) {
-        LOG(0, ("This learner is lagging behind!!!, highest seen:%u, highest delivered:%u\n", 
+        LOG(0, ("This learner is lagging behind!!!, highest seen:%lu, highest delivered:%lu\n", 
             highest_iid_seen, current_iid-1));
         lea_send_repeat_request(current_iid, highest_iid_seen);
     } else if(highest_iid_closed > current_iid) {
-        LOG(VRB, ("Out of sync, highest closed:%u, highest delivered:%u\n", 
+        LOG(VRB, ("Out of sync, highest closed:%lu, highest delivered:%lu\n", 
             highest_iid_closed, current_iid-1));
         //Ask retransmission to acceptors
         lea_send_repeat_request(current_iid, highest_iid_closed);
@@ -297,14 +336,14 @@ static void handle_accept_ack(short int acceptor_id, accept_ack * aa) {
     
     //Already closed and delivered, ignore message
     if(aa->iid < current_iid) {
-        LOG(DBG, ("Dropping accept_ack for already delivered iid:%u\n", aa->iid));
+        LOG(DBG, ("Dropping accept_ack for already delivered iid:%lu\n", aa->iid));
         return;
     }
     
     //We are late w.r.t the current iid, ignore message
     // (The instence received is too ahead and will overwrite something)
     if(aa->iid >= current_iid + LEARNER_ARRAY_SIZE) {
-        LOG(DBG, ("Dropping accept_ack for iid:%u, too far in future\n", aa->iid));
+        LOG(DBG, ("Dropping accept_ack for iid:%lu, too far in future\n", aa->iid));
         return;
     }
 
@@ -314,7 +353,7 @@ static void handle_accept_ack(short int acceptor_id, accept_ack * aa) {
     int relevant = lea_update_state(ii, acceptor_id, aa);
     if(!relevant) {
         //Not really interesting (i.e. a duplicate message)
-        LOG(DBG, ("Learner discarding learn for iid:%u\n", aa->iid));
+        LOG(DBG, ("Learner discarding learn for iid:%lu\n", aa->iid));
         return;
     }
     
@@ -322,7 +361,7 @@ static void handle_accept_ack(short int acceptor_id, accept_ack * aa) {
     // check if instance can be declared closed
     int closed = lea_check_quorum(ii);
     if(!closed) {
-        LOG(DBG, ("Not yet a quorum for iid:%u\n", aa->iid));
+        LOG(DBG, ("Not yet a quorum for iid:%lu\n", aa->iid));
         return;
     }
 
@@ -356,26 +395,29 @@ static void lea_handle_newmsg(int sock, short event, void *arg) {
     UNUSED_ARG(event);
     UNUSED_ARG(arg);
     
-    assert(sock == for_learner->sock);
+    assert(sock == udp_receiver_get_fd(for_learner));
 
-    //Read and validate next message from socket
-    int valid = udp_read_next_message(for_learner);    
-    if (valid < 0) {
-        printf("Dropping invalid learner message\n");
-        return;
-    }
-    
-    paxos_msg * msg = (paxos_msg*) &for_learner->recv_buffer;
-    switch(msg->type) {
-        case accept_acks: {
-            handle_accept_ack_batch((accept_ack_batch*) msg->data);
+    //Multiple datagrams may be read at once (see PAXOS_UDP_GRO, PAXOS_UDP_IO_URING)
+    do {
+        //Read and validate next message from socket
+        int valid = udp_read_next_message(for_learner);    
+        if (valid < 0) {
+            printf("Dropping invalid learner message\n");
+            continue;
         }
-        break;
+    
+        paxos_msg * msg = (paxos_msg*) &for_learner->recv_buffer;
+        switch(msg->type) {
+            case accept_acks: {
+                handle_accept_ack_batch((accept_ack_batch*) msg->data);
+            }
+            break;
 
-        default: {
-            printf("Unknow msg type %d received by learner\n", msg->type);
+            default: {
+                printf("Unknow msg type %d received by learner\n", msg->type);
+            }
         }
-    }
+    } while(udp_receiver_has_pending(for_learner));
 }
 
 /*-------------------------------------------------------------------------*/
@@ -396,6 +438,7 @@ static int init_lea_structs() {
     for(i = 0; i < LEARNER_ARRAY_SIZE; i++) {
         lea_clear_instance_info(&learner_state[i]);
     }
+    submit_session_table_clear(&delivered_sessions);
     return 0;
 }
 
@@ -415,7 +458,11 @@ static int init_lea_network() {
         printf("Error creating learner network receiver\n");
         return LEARNER_ERROR;
     }
-    event_set(&learner_msg_event, for_learner->sock, EV_READ|EV_PERSIST, lea_handle_newmsg, NULL);
+    if(udp_receiver_enable_io_uring(for_learner) != 0) {
+        udp_receiver_enable_gro(for_learner);
+    }
+    event_set(&learner_msg_event, udp_receiver_get_fd(for_learner), EV_READ|EV_PERSIST, lea_handle_newmsg, NULL);
+    event_base_set(eb, &learner_msg_event);
     event_add(&learner_msg_event, NULL);
     
     return 0;
@@ -425,6 +472,7 @@ static int init_lea_network() {
 static int 
 init_lea_timers() {
     evtimer_set(&hole_check_event, lea_hole_check, NULL);
+    event_base_set(eb, &hole_check_event);
 	evutil_timerclear(&hole_check_interval);
 	hole_check_interval.tv_sec = LEARNER_HOLECHECK_INTERVAL / 1000000;
     hole_check_interval.tv_usec = LEARNER_HOLECHECK_INTERVAL % 1000000;
@@ -474,6 +522,7 @@ init_lea_success(int fd, short event, void *arg) {
 static int
 init_lea_signal_ready() {
     evtimer_set(&init_complete_event, init_lea_success, NULL);
+    event_base_set(eb, &init_complete_event);
 	if(event_add(&init_complete_event, &asap_interval) != 0) {
 	   printf("Error while adding lea successful init event\n");
        return -1;
@@ -482,6 +531,43 @@ init_lea_signal_ready() {
 }
 
 
+#ifdef PAXOS_BUSY_POLL_USEC
+//Expires at every loop iteration, so that libevent polls without blocking
+static void
+lea_busy_poll(int fd, short event, void *arg) {
+    UNUSED_ARG(fd);
+    UNUSED_ARG(event);
+    UNUSED_ARG(arg);
+    event_add(&busy_poll_event, &asap_interval);
+}
+#endif
+
+//Pins the learner thread and enables busy polling (if configured)
+static int
+init_lea_low_latency() {
+#ifdef PAXOS_EVENT_THREAD_CPU
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(PAXOS_EVENT_THREAD_CPU, &set);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+        printf("Error pinning learner thread to core %d\n", PAXOS_EVENT_THREAD_CPU);
+        return -1;
+    }
+    LOG(DBG, ("Learner thread pinned to core %d\n", PAXOS_EVENT_THREAD_CPU));
+#endif
+
+#ifdef PAXOS_BUSY_POLL_USEC
+    evtimer_set(&busy_poll_event, lea_busy_poll, NULL);
+    event_base_set(eb, &busy_poll_event);
+    if(event_add(&busy_poll_event, &asap_interval) != 0) {
+        printf("Error while adding busy poll event\n");
+        return -1;
+    }
+    LOG(DBG, ("Learner thread busy polling\n"));
+#endif
+    return 0;
+}
+
 //This function is invoked by libevent in a new thread. It initializes the learner, 
 // and starts the libevent loop (which never returns)
 static void* 
@@ -495,8 +581,9 @@ init_learner_thread(void* arg) {
         return NULL;
     }
     
-    //Initialization of libevent handle
-    if((eb = event_init()) == NULL) {
+    //Private libevent handle, the global one (event_init) is left 
+    // to the application
+    if((eb = event_base_new()) == NULL) {
         init_lea_failure("Error in libevent init\n");
         return NULL;
     }
@@ -518,6 +605,12 @@ init_learner_thread(void* arg) {
         init_lea_failure("Error in learner timers initialization\n");
         return NULL;
     }
+
+    //CPU pinning and busy polling (optional)
+    if(init_lea_low_latency() != 0) {
+        init_lea_failure("Error in learner low latency mode initialization\n");
+        return NULL;
+    }
     
     //Call custom init (i.e. to register additional events)
     if(custom_init != NULL && custom_init() != 0) {
@@ -535,7 +628,7 @@ init_learner_thread(void* arg) {
 
     // Start the libevent loop, should never return
     LOG(DBG, ("Learner thread ready, starting libevent loop\n"));
-    event_dispatch();
+    event_base_dispatch(eb);
     printf("libeven loop terminated\n");
     return NULL;
 }
@@ -549,12 +642,12 @@ init_lea_wait_ready() {
     pthread_mutex_lock(&ready_lock);
     
     while(1) {
-        //Wait for a signal
-        pthread_cond_wait(&ready_cond, &ready_lock);
+        //The learner thread may have set it already
         status = learner_ready;
 
         if(status == LEARNER_STARTING) {
-        //Not ready yet, keep waiting
+        //Not ready yet, wait for a signal
+            pthread_cond_wait(&ready_cond, &ready_lock);
             continue;            
         } else {
         //Status changed
@@ -572,15 +665,34 @@ init_lea_wait_ready() {
     return status;
 }
 
-/*-------------------------------------------------------------------------*/
-// Public functions (see libpaxos.h for more details)
-/*-------------------------------------------------------------------------*/
+//Allows a later learner_init after a failed one
+static void learner_init_failed() {
+    pthread_mutex_lock(&ready_lock);
+    learner_started = 0;
+    pthread_mutex_unlock(&ready_lock);
+}
+
+//Starts the learner thread and waits until it's ready
+static int learner_init_common(deliver_function f, custom_init_function cif) {
+    //The learner state is global to the process
+    pthread_mutex_lock(&ready_lock);
+    int already_started = learner_started;
+    learner_started = 1;
+    if(!already_started) {
+        //A failed learner_init left it to error
+        learner_ready = LEARNER_STARTING;
+    }
+    pthread_mutex_unlock(&ready_lock);
+    if(already_started) {
+        printf("Error: a learner is already running in this process\n");
+        return -1;
+    }
 
-int learner_init(deliver_function f, custom_init_function cif) {
     // Start learner (which starts event_dispatch())
     custom_init = cif;
     if (pthread_create(&learner_thread, NULL, init_learner_thread, (void*) f) != 0) {
         perror("pthread create learner thread");
+        learner_init_failed();
         return -1;
     }
     
@@ -588,6 +700,9 @@ int learner_init(deliver_function f, custom_init_function cif) {
     LOG(DBG, ("Learner thread started, waiting for ready signal\n"));    
     if (init_lea_wait_ready() == LEARNER_ERROR) {
         printf("Learner initialization failed!\n");
+        //The learner thread returned after the error
+        pthread_join(learner_thread, NULL);
+        learner_init_failed();
         return -1;
     }
     
@@ -595,6 +710,25 @@ int learner_init(deliver_function f, custom_init_function cif) {
     return 0;
 }
 
+/*-------------------------------------------------------------------------*/
+// Public functions (see libpaxos.h for more details)
+/*-------------------------------------------------------------------------*/
+
+int learner_init(deliver_function f, custom_init_function cif) {
+    deliver_raw = 0;
+    return learner_init_common(f, cif);
+}
+
+int learner_init_raw(deliver_function f, custom_init_function cif) {
+    deliver_raw = 1;
+    return learner_init_common(f, cif);
+}
+
+
+struct event_base * learner_get_event_base() {
+    return eb;
+}
+
 //TODO: comment or categorize...
 void learner_suspend() {
     //Remove active events
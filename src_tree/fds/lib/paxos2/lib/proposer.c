@@ -88,6 +88,23 @@ struct phase2_info {
 };
 struct phase2_info p2_info;
 
+#ifdef PROPOSER_RANGE_PREPARE
+//Phase 1 executed once for all instances from from_iid
+struct range_phase1_info {
+    ballot_t        ballot;
+    iid_t           from_iid;
+    unsigned int    acks_bitvector;
+    unsigned int    acks_count;
+    //Set when a quorum promised the ballot
+    int             ready;
+    //Instances up to ready_to need no phase 1, except the listed ones
+    iid_t           ready_to;
+    unsigned int    needs_p1[PROPOSER_ARRAY_SIZE/32];
+    struct timeval  timeout;
+};
+struct range_phase1_info range_p1_info;
+#endif
+
 //Required by leader
 static void pro_clear_instance_info(p_inst_info * ii);
 
@@ -122,14 +139,14 @@ pro_save_prepare_ack(p_inst_info * ii, prepare_ack * pa, short int acceptor_id)
     
     //Ack from already received!
     if(ii->promises_bitvector & (1<<acceptor_id)) {
-        LOG(DBG, ("Dropping duplicate promise from:%d, iid:%u, \n", acceptor_id, ii->iid));
+        LOG(DBG, ("Dropping duplicate promise from:%d, iid:%lu, \n", acceptor_id, ii->iid));
         return;
     }
     
     // promise is new
     ii->promises_bitvector &= (1<<acceptor_id);
     ii->promises_count++;
-    LOG(DBG, ("Received valid promise from:%d, iid:%u, \n", acceptor_id, ii->iid));
+    LOG(DBG, ("Received valid promise from:%d, iid:%lu, \n", acceptor_id, ii->iid));
     
     //Promise contains no value
     if(pa->value_size == 0) {
@@ -170,7 +187,7 @@ pro_save_prepare_ack(p_inst_info * ii, prepare_ack * pa, short int acceptor_id)
 
 void 
 pro_deliver_callback(char * value, size_t size, iid_t iid, ballot_t ballot, int proposer) {
-    LOG(DBG, ("Instance iid:%u delivered to proposer\n", iid));
+    LOG(DBG, ("Instance iid:%lu delivered to proposer\n", iid));
     
     //If leader, take the appropriate action
     if(LEADER_IS_ME) {
@@ -185,19 +202,81 @@ pro_deliver_callback(char * value, size_t size, iid_t iid, ballot_t ballot, int
 // Event handlers
 /*-------------------------------------------------------------------------*/
 
+#ifdef PROPOSER_RANGE_PREPARE
+static void
+handle_prepare_range_ack(prepare_range_ack * pra) {
+    
+    //Ignore if not the current leader
+    if(!LEADER_IS_ME) {
+        return;
+    }
+    
+    // If not for the current range prepare, drop
+    if(range_p1_info.ready || 
+        pra->ballot != range_p1_info.ballot || 
+        pra->from_iid != range_p1_info.from_iid) {
+        LOG(DBG, ("Range promise dropped, from iid:%lu ballot:%u\n", 
+            pra->from_iid, pra->ballot));
+        return;
+    }
+
+    //Ack from already received!
+    if(range_p1_info.acks_bitvector & (1<<pra->acceptor_id)) {
+        LOG(DBG, ("Dropping duplicate range promise from:%d\n", pra->acceptor_id));
+        return;
+    }
+    range_p1_info.acks_bitvector |= (1<<pra->acceptor_id);
+    range_p1_info.acks_count += 1;
+    
+    //Only instances listed by all acceptors in the quorum 
+    // can skip phase 1
+    if(pra->listed_to < range_p1_info.ready_to) {
+        range_p1_info.ready_to = pra->listed_to;
+    }
+    short int i;
+    for(i = 0; i < pra->count; i++) {
+        iid_t iid = pra->needs_p1[i];
+        iid_t offset = iid - range_p1_info.from_iid;
+        if(iid < range_p1_info.from_iid) {
+            continue;
+        }
+        if(offset < PROPOSER_ARRAY_SIZE) {
+            range_p1_info.needs_p1[offset/32] |= (1 << (offset % 32));
+        } else if(iid <= range_p1_info.ready_to) {
+            //Too far to keep track of, phase 1 for this one and the next
+            range_p1_info.ready_to = iid - 1;
+        }
+    }
+    LOG(DBG, ("Range promise from acceptor %d, %d instances need phase 1\n", 
+        pra->acceptor_id, pra->count));
+    
+    //Not a majority yet
+    if(range_p1_info.acks_count < QUORUM) {
+        return;
+    }
+    
+    //Quorum reached, open instances and send values
+    range_p1_info.ready = 1;
+    LOG(VRB, ("Ballot %u promised for all instances from iid:%lu\n", 
+        range_p1_info.ballot, range_p1_info.from_iid));
+    leader_open_instances_p1();
+    leader_open_instances_p2_new();
+}
+#endif
+
 //Returns 1 if the instance became ready, 0 otherwise
 static int
 handle_prepare_ack(prepare_ack * pa, short int acceptor_id) {
     p_inst_info * ii = GET_PRO_INSTANCE(pa->iid);
     // If not p1_pending, drop
     if(ii->status != p1_pending) {
-        LOG(DBG, ("Promise dropped, iid:%u not pending\n", pa->iid));
+        LOG(DBG, ("Promise dropped, iid:%lu not pending\n", pa->iid));
         return 0;
     }
     
     // If not our ballot, drop
     if(pa->ballot != ii->my_ballot) {
-        LOG(DBG, ("Promise dropped, iid:%u not our ballot\n", pa->iid));
+        LOG(DBG, ("Promise dropped, iid:%lu not our ballot\n", pa->iid));
         return 0;
     }
     
@@ -207,7 +286,7 @@ handle_prepare_ack(prepare_ack * pa, short int acceptor_id) {
     
     //Not a majority yet for this instance
     if(ii->promises_count < QUORUM) {
-        LOG(DBG, ("Not yet a quorum for iid:%u\n", pa->iid));
+        LOG(DBG, ("Not yet a quorum for iid:%lu\n", pa->iid));
         return 0;
     }
     
@@ -216,7 +295,7 @@ handle_prepare_ack(prepare_ack * pa, short int acceptor_id) {
     p1_info.pending_count -= 1;
     p1_info.ready_count += 1;
 
-    LOG(DBG, ("Quorum for iid:%u reached\n", pa->iid));
+    LOG(DBG, ("Quorum for iid:%lu reached\n", pa->iid));
     
     return 1;
 }
@@ -266,28 +345,38 @@ pro_handle_newmsg(int sock, short event, void *arg) {
     UNUSED_ARG(event);
     UNUSED_ARG(arg);
     
-    assert(sock == for_proposer->sock);
+    assert(sock == udp_receiver_get_fd(for_proposer));
     
-    //Read the next message
-    int valid = udp_read_next_message(for_proposer);
-    if (valid < 0) {
-        printf("Dropping invalid proposer message\n");
-        return;
-    }
-
-    //The message is valid, take the appropriate action
-    // based on the type
-    paxos_msg * msg = (paxos_msg*) &for_proposer->recv_buffer;
-    switch(msg->type) {
-        case prepare_acks: {
-            handle_prepare_ack_batch((prepare_ack_batch*) msg->data);
+    //Multiple datagrams may be read at once (see PAXOS_UDP_GRO, PAXOS_UDP_IO_URING)
+    do {
+        //Read the next message
+        int valid = udp_read_next_message(for_proposer);
+        if (valid < 0) {
+            printf("Dropping invalid proposer message\n");
+            continue;
         }
-        break;
 
-        default: {
-            printf("Unknow msg type %d received from acceptors\n", msg->type);
+        //The message is valid, take the appropriate action
+        // based on the type
+        paxos_msg * msg = (paxos_msg*) &for_proposer->recv_buffer;
+        switch(msg->type) {
+            case prepare_acks: {
+                handle_prepare_ack_batch((prepare_ack_batch*) msg->data);
+            }
+            break;
+
+#ifdef PROPOSER_RANGE_PREPARE
+            case prepare_range_acks: {
+                handle_prepare_range_ack((prepare_range_ack*) msg->data);
+            }
+            break;
+#endif
+
+            default: {
+                printf("Unknow msg type %d received from acceptors\n", msg->type);
+            }
         }
-    }
+    } while(udp_receiver_has_pending(for_proposer));
 }
 
 //This function is invoked when a new message is ready to be read
@@ -299,38 +388,41 @@ pro_handle_oracle_msg(int sock, short event, void *arg) {
     UNUSED_ARG(event);
     UNUSED_ARG(arg);
     
-    assert(sock == from_oracle->sock);
+    assert(sock == udp_receiver_get_fd(from_oracle));
     
-    //Read the next message
-    int valid = udp_read_next_message(from_oracle);
-    if (valid < 0) {
-        printf("Dropping invalid oracle message\n");
-        return;
-    }
+    //Multiple datagrams may be read at once (see PAXOS_UDP_GRO, PAXOS_UDP_IO_URING)
+    do {
+        //Read the next message
+        int valid = udp_read_next_message(from_oracle);
+        if (valid < 0) {
+            printf("Dropping invalid oracle message\n");
+            continue;
+        }
 
-    //The message is valid, take the appropriate action
-    // based on the type
-    paxos_msg * msg = (paxos_msg*) &from_oracle->recv_buffer;
-    switch(msg->type) {
-        case leader_announce: {
-            leader_announce_msg * la = (leader_announce_msg *)msg->data;
-            if(LEADER_IS_ME && la->current_leader != this_proposer_id) {
-            //Some other proposer was nominated leader instead of this one, 
-            // step down from leadership
-                leader_shutdown();
-            } else if (!LEADER_IS_ME 
-                && la->current_leader == this_proposer_id) {
-            //This proposer has just been promoted to leader
-                leader_init();
+        //The message is valid, take the appropriate action
+        // based on the type
+        paxos_msg * msg = (paxos_msg*) &from_oracle->recv_buffer;
+        switch(msg->type) {
+            case leader_announce: {
+                leader_announce_msg * la = (leader_announce_msg *)msg->data;
+                if(LEADER_IS_ME && la->current_leader != this_proposer_id) {
+                //Some other proposer was nominated leader instead of this one, 
+                // step down from leadership
+                    leader_shutdown();
+                } else if (!LEADER_IS_ME 
+                    && la->current_leader == this_proposer_id) {
+                //This proposer has just been promoted to leader
+                    leader_init();
+                }
+                current_leader_id = la->current_leader;
             }
-            current_leader_id = la->current_leader;
-        }
-        break;
+            break;
 
-        default: {
-            printf("Unknow msg type %d received from oracle\n", msg->type);
+            default: {
+                printf("Unknow msg type %d received from oracle\n", msg->type);
+            }
         }
-    }
+    } while(udp_receiver_has_pending(from_oracle));
 }
 
 //Called when it's time to ping the failure oracle
@@ -369,7 +461,11 @@ init_pro_network() {
         printf("Error creating proposer network receiver\n");
         return PROPOSER_ERROR;
     }
-    event_set(&proposer_msg_event, for_proposer->sock, EV_READ|EV_PERSIST, pro_handle_newmsg, NULL);
+    if(udp_receiver_enable_io_uring(for_proposer) != 0) {
+        udp_receiver_enable_gro(for_proposer);
+    }
+    event_set(&proposer_msg_event, udp_receiver_get_fd(for_proposer), EV_READ|EV_PERSIST, pro_handle_newmsg, NULL);
+    event_base_set(learner_get_event_base(), &proposer_msg_event);
     event_add(&proposer_msg_event, NULL);
     
     return 0;
@@ -392,11 +488,16 @@ init_pro_fd_events() {
         printf("Error creating oracle->proposer network receiver\n");
         return PROPOSER_ERROR;
     }
-    event_set(&oracle_msg_event, from_oracle->sock, EV_READ|EV_PERSIST, pro_handle_oracle_msg, NULL);
+    if(udp_receiver_enable_io_uring(from_oracle) != 0) {
+        udp_receiver_enable_gro(from_oracle);
+    }
+    event_set(&oracle_msg_event, udp_receiver_get_fd(from_oracle), EV_READ|EV_PERSIST, pro_handle_oracle_msg, NULL);
+    event_base_set(learner_get_event_base(), &oracle_msg_event);
     event_add(&oracle_msg_event, NULL);
 
     //Set timer for sending alive pings
     evtimer_set(&fe_ping_event, pro_ping_failure_detector, NULL);
+    event_base_set(learner_get_event_base(), &fe_ping_event);
     evutil_timerclear(&fe_ping_interval);
     fe_ping_interval.tv_sec = (FAILURE_DETECTOR_PING_INTERVAL / 1000000);
     fe_ping_interval.tv_usec = (FAILURE_DETECTOR_PING_INTERVAL % 1000000);
@@ -488,7 +589,7 @@ int proposer_init(int proposer_id) {
     LOG(VRB, ("Proposer %d starting...\n", this_proposer_id));
     
     //Starts a learner with a custom init function
-    if (learner_init(pro_deliver_callback, init_proposer) != 0) {
+    if (learner_init_raw(pro_deliver_callback, init_proposer) != 0) {
         printf("Could not start the learner!\n");
         return -1;
     }
@@ -15,6 +15,7 @@ struct leader_event_counters {
     long unsigned int p1_timeout;
     long unsigned int p2_timeout;
     long unsigned int p2_waits_p1;
+    long unsigned int p1_skipped;
 };
 struct leader_event_counters lead_counters;
 struct event print_events_event;
@@ -24,6 +25,7 @@ static void clear_event_counters() {
     lead_counters.p1_timeout = 0;    
     lead_counters.p2_timeout = 0;
     lead_counters.p2_waits_p1 = 0;
+    lead_counters.p1_skipped = 0;
 }
 
 static void 
@@ -32,19 +34,25 @@ leader_print_event_counters(int fd, short event, void *arg) {
     UNUSED_ARG(event);
     UNUSED_ARG(arg);
     printf("-----------------------------------------------\n");
-    printf("current_iid:%u\n", current_iid);
+    printf("current_iid:%lu\n", current_iid);
     printf("Phase 1_____________________:\n");
     printf("p1_timeout:%lu\n", lead_counters.p1_timeout);
     printf("p1_info.pending_count:%u\n", p1_info.pending_count);
     printf("p1_info.ready_count:%u\n", p1_info.ready_count);
-    printf("p1_info.highest_open:%u\n", p1_info.highest_open);
+    printf("p1_info.highest_open:%lu\n", p1_info.highest_open);
+#ifdef PROPOSER_RANGE_PREPARE
+    printf("p1_skipped:%lu\n", lead_counters.p1_skipped);
+    printf("range_p1_info.from_iid:%lu\n", range_p1_info.from_iid);
+    printf("range_p1_info.ready:%d\n", range_p1_info.ready);
+#endif
     printf("Phase 2_____________________:\n");    
     printf("p2_timeout:%lu\n", lead_counters.p2_timeout);
     printf("p2_waits_p1:%lu\n", lead_counters.p2_waits_p1);
     printf("p2_info.open_count:%u\n", p2_info.open_count);
-    printf("p2_info.next_unused_iid:%u\n", p2_info.next_unused_iid);
+    printf("p2_info.next_unused_iid:%lu\n", p2_info.next_unused_iid);
     printf("Misc._______________________:\n");
     printf("dropped_count:%lu\n", vh_get_dropped_count());
+    printf("duplicates_count:%lu\n", vh_get_duplicates_count());
     printf("-----------------------------------------------\n");
     
     //Keep printing if the current leader is still this proposer
@@ -62,11 +70,10 @@ leader_print_event_counters(int fd, short event, void *arg) {
 /*-------------------------------------------------------------------------*/
 
 static void
-leader_set_expiration(p_inst_info * ii, unsigned int usec_interval) {
+leader_set_deadline(struct timeval * deadline, unsigned int usec_interval) {
     struct timeval current_time;
     gettimeofday(&current_time, NULL);
 
-    struct timeval * deadline = &ii->timeout;
     const unsigned int a_second = 1000000; 
 
     //Set seconds
@@ -85,6 +92,11 @@ leader_set_expiration(p_inst_info * ii, unsigned int usec_interval) {
     deadline->tv_usec = (usec_sum % a_second);
 }
 
+static void
+leader_set_expiration(p_inst_info * ii, unsigned int usec_interval) {
+    leader_set_deadline(&ii->timeout, usec_interval);
+}
+
 static int
 leader_is_expired(struct timeval * deadline, struct timeval * time_now) {
     return (deadline->tv_sec < time_now->tv_sec ||
@@ -103,7 +115,7 @@ leader_check_p1_pending() {
 
     //Create an empty prepare batch in send buffer
     sendbuf_clear(to_acceptors, prepare_reqs, this_proposer_id);
-    LOG(DBG, ("Checking pending phase 1 from %u to %u\n",
+    LOG(DBG, ("Checking pending phase 1 from %lu to %lu\n",
         current_iid, p1_info.highest_open));
     
     //Get current time for checking expired    
@@ -119,7 +131,7 @@ leader_check_p1_pending() {
         
         //Still pending -> it's expired
         if(ii->status == p1_pending && leader_is_expired(&ii->timeout, &time_now)) {
-            LOG(DBG, ("Phase 1 of instance %u expired!\n", ii->iid));
+            LOG(DBG, ("Phase 1 of instance %lu expired!\n", ii->iid));
 
             //Reset fields used for previous phase 1
             ii->promises_bitvector = 0;
@@ -146,6 +158,47 @@ leader_check_p1_pending() {
     sendbuf_flush(to_acceptors);
 }
 
+#ifdef PROPOSER_RANGE_PREPARE
+//Sends a single prepare for all instances from the next one to open,
+// with a ballot higher than the previous range prepare
+static void
+leader_start_range_p1() {
+    if(range_p1_info.ballot == 0) {
+        range_p1_info.ballot = FIRST_BALLOT;
+    } else {
+        range_p1_info.ballot = NEXT_BALLOT(range_p1_info.ballot);
+    }
+    range_p1_info.from_iid = p1_info.highest_open + 1;
+    range_p1_info.acks_bitvector = 0;
+    range_p1_info.acks_count = 0;
+    range_p1_info.ready = 0;
+    range_p1_info.ready_to = PREPARE_RANGE_LISTED_ALL;
+    memset(range_p1_info.needs_p1, 0, sizeof(range_p1_info.needs_p1));
+    
+    LOG(DBG, ("Sending prepare for all instances from %lu (ballot %u)\n", 
+        range_p1_info.from_iid, range_p1_info.ballot));
+    sendbuf_send_prepare_range_req(to_acceptors, this_proposer_id, 
+        range_p1_info.from_iid, range_p1_info.ballot);
+    leader_set_deadline(&range_p1_info.timeout, P1_TIMEOUT_INTERVAL);
+}
+
+//Returns 1 if the instance was promised by the range prepare
+// and needs no phase 1
+static int
+leader_range_covers(iid_t iid) {
+    if(!range_p1_info.ready || 
+        iid < range_p1_info.from_iid || iid > range_p1_info.ready_to) {
+        return 0;
+    }
+    iid_t offset = iid - range_p1_info.from_iid;
+    if(offset < PROPOSER_ARRAY_SIZE && 
+        (range_p1_info.needs_p1[offset/32] & (1 << (offset % 32)))) {
+        return 0;
+    }
+    return 1;
+}
+#endif
+
 //Opens instances at the "end" of the proposer state array 
 //Those instances were not opened before
 static void
@@ -153,6 +206,13 @@ leader_open_instances_p1() {
     int active_count = p1_info.pending_count + p1_info.ready_count;
     
     assert(active_count >= 0);
+
+#ifdef PROPOSER_RANGE_PREPARE
+    //Wait until a quorum promised all instances
+    if(!range_p1_info.ready) {
+        return;
+    }
+#endif
     
     if(active_count >= (PROPOSER_PREEXEC_WIN_SIZE/2)) {
         //More than half are active/pending
@@ -168,6 +228,7 @@ leader_open_instances_p1() {
     assert(to_open >= (PROPOSER_PREEXEC_WIN_SIZE/2));
 
     iid_t i, curr_iid;
+    unsigned int pending_count = 0;
     p_inst_info * ii;
     for(i = 1; i <= to_open; i++) {
         //Get instance from state array
@@ -177,18 +238,33 @@ leader_open_instances_p1() {
         
         //Create initial record
         ii->iid = curr_iid;
-        ii->status = p1_pending;
+#ifdef PROPOSER_RANGE_PREPARE
+        if(leader_range_covers(curr_iid)) {
+            //Already promised, ready for phase 2
+            ii->status = p1_ready;
+            ii->my_ballot = range_p1_info.ballot;
+            p1_info.ready_count += 1;
+            COUNT_EVENT(p1_skipped);
+            continue;
+        }
+        //Some value may be accepted, normal phase 1 
+        // with a ballot higher than the range one
+        ii->my_ballot = NEXT_BALLOT(range_p1_info.ballot);
+#else
         ii->my_ballot = FIRST_BALLOT;
+#endif
+        ii->status = p1_pending;
         //Send prepare to acceptors
         sendbuf_add_prepare_req(to_acceptors, ii->iid, ii->my_ballot);
         leader_set_expiration(ii, P1_TIMEOUT_INTERVAL);       
+        pending_count += 1;
     }
 
     //Send if something is still there
     sendbuf_flush(to_acceptors);
     
     //Keep track of pending count
-    p1_info.pending_count += to_open;
+    p1_info.pending_count += pending_count;
 
     //Set new higher bound for checking
     p1_info.highest_open += to_open; 
@@ -214,6 +290,17 @@ leader_periodic_p1_check(int fd, short event, void *arg)
     UNUSED_ARG(event);
     UNUSED_ARG(arg);
     
+#ifdef PROPOSER_RANGE_PREPARE
+    //The range prepare expired, retry with a higher ballot
+    struct timeval time_now;
+    gettimeofday(&time_now, NULL);
+    if(!range_p1_info.ready && leader_is_expired(&range_p1_info.timeout, &time_now)) {
+        LOG(DBG, ("Phase 1 from instance %lu expired!\n", range_p1_info.from_iid));
+        leader_start_range_p1();
+        COUNT_EVENT(p1_timeout);
+    }
+#endif
+
     //All instances in status p1_pending are expired
     // increment ballot and re-send prepare_req
     leader_check_p1_pending();
@@ -358,7 +445,7 @@ leader_open_instances_p2_new() {
         
         //Next unused is not ready, stop
         if(ii->status != p1_ready || ii->iid != p2_info.next_unused_iid) {
-            LOG(DBG, ("Next instance to use for P2 (iid:%u) is not ready yet\n", p2_info.next_unused_iid));
+            LOG(DBG, ("Next instance to use for P2 (iid:%lu) is not ready yet\n", p2_info.next_unused_iid));
             COUNT_EVENT(p2_waits_p1);
             break;
         }
@@ -415,7 +502,7 @@ leader_periodic_p2_check(int fd, short event, void *arg) {
             p2_info.open_count -= 1;
             //The rest (i.e. answering client)
             // is done when the value is actually delivered
-            LOG(VRB, ("Instance %u closed, waiting for deliver\n", i));
+            LOG(VRB, ("Instance %lu closed, waiting for deliver\n", i));
             continue;
         }
         
@@ -432,7 +519,7 @@ leader_periodic_p2_check(int fd, short event, void *arg) {
         sendbuf_add_prepare_req(to_acceptors, ii->iid, ii->my_ballot);
         leader_set_expiration(ii, P1_TIMEOUT_INTERVAL);
         
-        LOG(VRB, ("Instance %u restarts from phase 1\n", i));
+        LOG(VRB, ("Instance %lu restarts from phase 1\n", i));
 
         COUNT_EVENT(p2_timeout);
 
@@ -456,7 +543,7 @@ static void
 leader_deliver(char * value, size_t size, iid_t iid, ballot_t ballot, int proposer) {
     UNUSED_ARG(ballot);
     UNUSED_ARG(proposer);
-    LOG(DBG, ("Instance %u delivered to Leader\n", iid));
+    LOG(DBG, ("Instance %lu delivered to Leader\n", iid));
 
     //Verify that the value is the one found or associated
     p_inst_info * ii = GET_PRO_INSTANCE(iid);
@@ -516,6 +603,7 @@ leader_init() {
 #ifdef LEADER_EVENTS_UPDATE_INTERVAL
     clear_event_counters();
     evtimer_set(&print_events_event, leader_print_event_counters, NULL);
+    event_base_set(learner_get_event_base(), &print_events_event);
     evutil_timerclear(&print_events_interval);
     print_events_interval.tv_sec = (LEADER_EVENTS_UPDATE_INTERVAL / 1000000);
     print_events_interval.tv_usec = (LEADER_EVENTS_UPDATE_INTERVAL % 1000000);
@@ -533,10 +621,17 @@ leader_init() {
     p1_info.ready_count = 0;
     // Set so that next p1 to open is current_iid
     p1_info.highest_open = current_iid - 1;
+
+#ifdef PROPOSER_RANGE_PREPARE
+    //Phase 1 for all instances from current_iid at once,
+    // instances are opened when a quorum answers
+    leader_start_range_p1();
+#endif
     
     //Initialize timer and corresponding event for
     // checking timeouts of instances, phase 1
     evtimer_set(&p1_check_event, leader_periodic_p1_check, NULL);
+    event_base_set(learner_get_event_base(), &p1_check_event);
     evutil_timerclear(&p1_check_interval);
     p1_check_interval.tv_sec = 0; //(P1_TIMEOUT_INTERVAL/3 / 1000000);
     p1_check_interval.tv_usec = 10000; //(P1_TIMEOUT_INTERVAL/3 % 1000000);
@@ -551,6 +646,7 @@ leader_init() {
     //Initialize timer and corresponding event for
     // checking timeouts of instances, phase 2
     evtimer_set(&p2_check_event, leader_periodic_p2_check, NULL);
+    event_base_set(learner_get_event_base(), &p2_check_event);
     evutil_timerclear(&p2_check_interval);
     p2_check_interval.tv_sec = (((int)P2_CHECK_INTERVAL) / 1000000);
     p2_check_interval.tv_usec = ((P2_CHECK_INTERVAL) % 1000000);
@@ -566,6 +662,11 @@ leader_shutdown() {
 
     evtimer_del(&p1_check_event);
     evtimer_del(&p2_check_event);
+
+#ifdef PROPOSER_RANGE_PREPARE
+    //The next leader_init starts with a higher ballot
+    range_p1_info.ready = 0;
+#endif
     
 #ifdef LEADER_EVENTS_UPDATE_INTERVAL
     evtimer_del(&print_events_event);
@@ -14,6 +14,10 @@ static vh_value_wrapper * vh_list_head = NULL;
 static vh_value_wrapper * vh_list_tail = NULL;
 
 static long unsigned int dropped_count = 0;
+static long unsigned int duplicates_count = 0;
+
+//Submissions already pending or decided, to drop resubmitted values
+static submit_session_table sessions;
 
 static struct event leader_msg_event;
 static udp_receiver * for_leader;
@@ -30,6 +34,19 @@ vh_wrap_value(char * value, size_t size) {
     return vw;
 }
 
+//Wraps a submitted value, prefixed by the tag that identifies it
+static vh_value_wrapper * 
+vh_wrap_tagged_value(uint32_t client_id, uint64_t client_seq, char * value, size_t size) {
+    vh_value_wrapper * vw = PAX_MALLOC(sizeof(vh_value_wrapper) + sizeof(paxos_value_tag) + size);
+    vw->value_size = sizeof(paxos_value_tag) + size;
+    vw->next = NULL;
+    paxos_value_tag * tag = (paxos_value_tag *)vw->value;
+    tag->client_id = client_id;
+    tag->client_seq = client_seq;
+    memcpy(tag->value, value, size);
+    return vw;
+}
+
 //Return 0 for equals, like memcmp()
 int vh_value_compare(vh_value_wrapper * vw1, vh_value_wrapper * vw2) {
     if(vw1->value_size != vw2->value_size) {
@@ -45,28 +62,43 @@ vh_handle_newmsg(int sock, short event, void *arg) {
     UNUSED_ARG(event);
     UNUSED_ARG(arg);
     
-    assert(sock == for_leader->sock);
+    assert(sock == udp_receiver_get_fd(for_leader));
     
-    //Read the next message
-    int valid = udp_read_next_message(for_leader);
-    if (valid < 0) {
-        printf("Dropping invalid client-to-leader message\n");
-        return;
-    }
-
-    //The message is valid, take the appropriate action
-    // based on the type
-    paxos_msg * msg = (paxos_msg*) &for_leader->recv_buffer;
-    switch(msg->type) {
-        case submit: {
-            vh_enqueue_value(msg->data, msg->data_size);
+    //Multiple datagrams may be read at once (see PAXOS_UDP_GRO, PAXOS_UDP_IO_URING)
+    do {
+        //Read the next message
+        int valid = udp_read_next_message(for_leader);
+        if (valid < 0) {
+            printf("Dropping invalid client-to-leader message\n");
+            continue;
         }
-        break;
 
-        default: {
-            printf("Unknow msg type %d received by proposer\n", msg->type);
+        //The message is valid, take the appropriate action
+        // based on the type
+        paxos_msg * msg = (paxos_msg*) &for_leader->recv_buffer;
+        switch(msg->type) {
+            case submit: {
+                vh_enqueue_value(PAXOS_NO_CLIENT_ID, 0, msg->data, msg->data_size);
+            }
+            break;
+
+            case submit_batch: {
+                submit_batch_msg * sbm = (submit_batch_msg *)msg->data;
+                size_t offset = sizeof(submit_batch_msg);
+                int i;
+                for(i = 0; i < sbm->count; i++) {
+                    submit_batch_entry * sbe = (submit_batch_entry *)&msg->data[offset];
+                    vh_enqueue_value(sbm->client_id, sbe->client_seq, sbe->value, sbe->value_size);
+                    offset += SUBMIT_BATCH_ENTRY_SIZE(sbe);
+                }
+            }
+            break;
+
+            default: {
+                printf("Unknow msg type %d received by proposer\n", msg->type);
+            }
         }
-    }
+    } while(udp_receiver_has_pending(for_leader));
 }
 
 int
@@ -76,6 +108,8 @@ vh_init() {
     vh_list_head = NULL;
     vh_list_tail = NULL;
     dropped_count = 0;
+    duplicates_count = 0;
+    submit_session_table_clear(&sessions);
     
     // Start listening on net where clients send values
     for_leader = udp_receiver_new(PAXOS_SUBMIT_NET);
@@ -83,7 +117,11 @@ vh_init() {
         printf("Error creating proposer network receiver\n");
         return -1;
     }
-    event_set(&leader_msg_event, for_leader->sock, EV_READ|EV_PERSIST, vh_handle_newmsg, NULL);
+    if(udp_receiver_enable_io_uring(for_leader) != 0) {
+        udp_receiver_enable_gro(for_leader);
+    }
+    event_set(&leader_msg_event, udp_receiver_get_fd(for_leader), EV_READ|EV_PERSIST, vh_handle_newmsg, NULL);
+    event_base_set(learner_get_event_base(), &leader_msg_event);
     event_add(&leader_msg_event, NULL);    
     
     return 0;
@@ -121,7 +159,14 @@ long unsigned int vh_get_dropped_count() {
     return dc;
 }
 
-void vh_enqueue_value(char * value, size_t value_size) {
+long unsigned int vh_get_duplicates_count() {
+    pthread_mutex_lock(&pending_list_lock);
+    long unsigned int dc = duplicates_count;
+    pthread_mutex_unlock(&pending_list_lock);
+    return dc;
+}
+
+void vh_enqueue_value(uint32_t client_id, uint64_t client_seq, char * value, size_t value_size) {
     
     pthread_mutex_lock(&pending_list_lock);
     //Create wrapper
@@ -135,7 +180,18 @@ void vh_enqueue_value(char * value, size_t value_size) {
         return;
     }
     
-    vh_value_wrapper * new_vw = vh_wrap_value(value, value_size);
+    //Resubmitted by the client, already pending or decided
+    // (checked after the one above: a value dropped is not recorded, 
+    // the client has to resubmit it)
+    if(submit_session_check(&sessions, client_id, client_seq)) {
+        duplicates_count += 1;
+        pthread_mutex_unlock(&pending_list_lock);
+        LOG(VRB, ("Duplicate value dropped, client:%u seq:%lu\n", 
+            client_id, client_seq));
+        return;
+    }
+    
+    vh_value_wrapper * new_vw = vh_wrap_tagged_value(client_id, client_seq, value, value_size);
     
     /* List is empty*/
 	if (vh_list_head == NULL && vh_list_tail == NULL) {
@@ -211,5 +267,5 @@ void vh_notify_client(unsigned int result, vh_value_wrapper * vw) {
 }
 
 void pax_submit_sharedmem(char* value, size_t val_size) {
-    vh_enqueue_value(value, val_size);
+    vh_enqueue_value(PAXOS_NO_CLIENT_ID, 0, value, val_size);
 }
@@ -1,28 +1,154 @@
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "event.h"
 
 #include "libpaxos.h"
 #include "libpaxos_priv.h"
 #include "paxos_udp.h"
 
+static void pax_submit_linger_expired(int fd, short event, void *arg);
+
+//Client ids should be unique among the clients submitting to the 
+// same leader, mixes time, process id and handle address
+static uint32_t pax_submit_new_client_id(paxos_submit_handle * psh) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uint64_t x = ((uint64_t)now.tv_sec * 1000000 + now.tv_usec) ^ 
+        ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)psh;
+    //Finalizer of splitmix64
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x = x ^ (x >> 31);
+    uint32_t id = (uint32_t)x;
+    return (id == PAXOS_NO_CLIENT_ID) ? 1 : id;
+}
+
 paxos_submit_handle * pax_submit_handle_init() {
-    //TODO print errors, 
+    return pax_submit_handle_init_linger(0);
+}
+
+paxos_submit_handle * pax_submit_handle_init_linger(unsigned int linger_usec) {
+    //TODO print errors,
     paxos_submit_handle * psh = malloc(sizeof(paxos_submit_handle));
     if(psh == NULL) {
         return NULL;
     }
-    
+
     psh->sendbuf = udp_sendbuf_new(PAXOS_SUBMIT_NET);
     if(psh->sendbuf == NULL) {
         return NULL;
     }
-    
+
+    psh->linger_usec = linger_usec;
+    timerclear(&psh->flush_deadline);
+    psh->linger_event = NULL;
+    psh->client_id = pax_submit_new_client_id(psh);
+    psh->next_seq = 1;
+    psh->low_seq = 1;
+    psh->done_window = 0;
+
+    //Batch flushed by a timer in the learner thread, if any
+    struct event_base * eb = learner_get_event_base();
+    if(linger_usec > 0 && eb != NULL) {
+        struct event * ev = malloc(sizeof(struct event));
+        if(ev == NULL) {
+            return NULL;
+        }
+        evtimer_set(ev, pax_submit_linger_expired, psh);
+        event_base_set(eb, ev);
+        psh->linger_event = ev;
+    }
+
     return psh;
 }
 
-int pax_submit_nonblock(paxos_submit_handle * h, char * value, size_t val_size) {
+void pax_submit_flush(paxos_submit_handle * h) {
     udp_send_buffer* sb = (udp_send_buffer*)h->sendbuf;
-    sendbuf_clear(sb, submit, 0);
-    sendbuf_add_submit_val(sb, value, val_size);
     sendbuf_flush(sb);
+    sendbuf_clear(sb, submit_batch, 0);
+    timerclear(&h->flush_deadline);
+}
+
+uint64_t pax_submit_new_seq(paxos_submit_handle * h) {
+    uint64_t seq = h->next_seq;
+    h->next_seq += 1;
+    return seq;
+}
+
+void pax_submit_done(paxos_submit_handle * h, uint64_t client_seq) {
+    if(client_seq < h->low_seq || client_seq >= h->low_seq + SUBMIT_SESSION_WINDOW) {
+        return;
+    }
+    h->done_window |= (1ULL << (client_seq - h->low_seq));
+    
+    //Move past the completed ones
+    while(h->done_window & 1) {
+        h->done_window >>= 1;
+        h->low_seq += 1;
+    }
+}
+
+static void pax_submit_linger_expired(int fd, short event, void *arg) {
+    UNUSED_ARG(fd);
+    UNUSED_ARG(event);
+    paxos_submit_handle * h = arg;
+    LOG(DBG, ("Submit linger time expired, sending batch\n"));
+    pax_submit_flush(h);
+}
+
+//Adds the value to the batch (or sends it)
+static int pax_submit_tagged(paxos_submit_handle * h, uint64_t client_seq, char * value, size_t val_size) {
+    udp_send_buffer* sb = (udp_send_buffer*)h->sendbuf;
+    submit_batch_msg * sbm = (submit_batch_msg *)((paxos_msg *)&sb->buffer)->data;
+
+    //No batching, one value per datagram
+    if(h->linger_usec == 0) {
+        sendbuf_clear(sb, submit_batch, 0);
+        sbm->client_id = h->client_id;
+        sendbuf_add_submit_batch_val(sb, client_seq, value, val_size);
+        sendbuf_flush(sb);
+        return 0;
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    //Batch is full or waited too long already, send it
+    paxos_msg * m = (paxos_msg *) &sb->buffer;
+    if(sb->dirty &&
+        (PAXOS_MSG_SIZE(m) + sizeof(submit_batch_entry) + val_size >= MAX_UDP_MSG_SIZE ||
+        timercmp(&now, &h->flush_deadline, >))) {
+        pax_submit_flush(h);
+    }
+
+    //First value of a new batch
+    if(!sb->dirty) {
+        sendbuf_clear(sb, submit_batch, 0);
+        sbm->client_id = h->client_id;
+        struct timeval linger = {h->linger_usec / 1000000, h->linger_usec % 1000000};
+        timeradd(&now, &linger, &h->flush_deadline);
+        if(h->linger_event != NULL) {
+            event_add((struct event *)h->linger_event, &linger);
+        }
+    }
+
+    sendbuf_add_submit_batch_val(sb, client_seq, value, val_size);
     return 0;
 }
+
+int pax_submit_nonblock(paxos_submit_handle * h, char * value, size_t val_size) {
+    return pax_submit_tagged(h, PAXOS_NO_CLIENT_SEQ, value, val_size);
+}
+
+int pax_submit_idempotent(paxos_submit_handle * h, uint64_t client_seq, char * value, size_t val_size) {
+    //Completed, or too far ahead for the leader to tell apart 
+    // the values still outstanding from the completed ones
+    if(client_seq < h->low_seq || client_seq >= h->low_seq + SUBMIT_SESSION_WINDOW) {
+        LOG(DBG, ("Not submitting seq:%lu, outstanding from seq:%lu\n", 
+            client_seq, h->low_seq));
+        return -1;
+    }
+    return pax_submit_tagged(h, client_seq, value, val_size);
+}
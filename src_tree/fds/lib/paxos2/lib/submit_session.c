@@ -0,0 +1,57 @@
+#include <string.h>
+
+#include "libpaxos.h"
+#include "libpaxos_priv.h"
+
+#if SUBMIT_SESSION_WINDOW > 64
+#error "SUBMIT_SESSION_WINDOW is at most 64"
+#endif
+#if (SUBMIT_SESSION_TABLE_SIZE & (SUBMIT_SESSION_TABLE_SIZE - 1)) != 0
+#error "SUBMIT_SESSION_TABLE_SIZE is not a power of 2"
+#endif
+
+//Slot of a client, multiplicative hashing
+#define GET_SESSION(ST, C) \
+    &(ST)->sessions[((C) * 2654435761U) & (SUBMIT_SESSION_TABLE_SIZE-1)]
+
+void submit_session_table_clear(submit_session_table * st) {
+    memset(st, '\0', sizeof(submit_session_table));
+}
+
+int submit_session_check(submit_session_table * st, uint32_t client_id, uint64_t client_seq) {
+    if(client_id == PAXOS_NO_CLIENT_ID || client_seq == PAXOS_NO_CLIENT_SEQ) {
+        return 0;
+    }
+    
+    submit_session * s = GET_SESSION(st, client_id);
+
+    //New client (or replacing another one in the same slot)
+    if(s->client_id != client_id) {
+        s->client_id = client_id;
+        s->highest_seq = client_seq;
+        s->window = 1;
+        return 0;
+    }
+    
+    //Newer than all seen, move the window forward
+    if(client_seq > s->highest_seq) {
+        uint64_t shift = client_seq - s->highest_seq;
+        s->window = (shift >= 64) ? 1 : ((s->window << shift) | 1);
+        s->highest_seq = client_seq;
+        return 0;
+    }
+    
+    //Too old: clients keep less than SUBMIT_SESSION_WINDOW sequence numbers 
+    // outstanding (see pax_submit_idempotent), the value was completed
+    uint64_t age = s->highest_seq - client_seq;
+    if(age >= SUBMIT_SESSION_WINDOW) {
+        return 1;
+    }
+    
+    uint64_t bit = (1ULL << age);
+    if(s->window & bit) {
+        return 1;
+    }
+    s->window |= bit;
+    return 0;
+}
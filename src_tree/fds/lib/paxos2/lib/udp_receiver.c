@@ -2,10 +2,65 @@
 #include <memory.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <netinet/udp.h>
 
 #include "libpaxos_priv.h"
 #include "paxos_udp.h"
 
+#ifdef PAXOS_UDP_IO_URING
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+/*
+    Compile-time checks of the wire format against the schema 
+    in libpaxos_messages.h
+*/
+#define PAXOS_WIRE_SIZE_CHECK(TYPE, ID, BODY, SIZE) \
+    _Static_assert(sizeof(BODY) == (SIZE), "layout of " #BODY " differs from the wire schema"); \
+    _Static_assert((ID) > 0 && (ID) <= UINT8_MAX, "id of " #TYPE " does not fit the message header");
+PAXOS_WIRE_SCHEMA(PAXOS_WIRE_SIZE_CHECK)
+
+_Static_assert(sizeof(paxos_msg) == 4, "layout of paxos_msg changed");
+_Static_assert(sizeof(prepare_req) == 12, "layout of prepare_req changed");
+_Static_assert(sizeof(prepare_ack) == 20, "layout of prepare_ack changed");
+_Static_assert(sizeof(accept_req) == 16, "layout of accept_req changed");
+_Static_assert(sizeof(accept_ack) == 22, "layout of accept_ack changed");
+_Static_assert(sizeof(submit_batch_entry) == 10, "layout of submit_batch_entry changed");
+_Static_assert(sizeof(paxos_value_tag) == 12, "layout of paxos_value_tag changed");
+_Static_assert(MAX_UDP_MSG_SIZE <= UINT16_MAX, "message size does not fit the message header");
+
+#define PAXOS_WIRE_MIN_SIZE_CASE(TYPE, ID, BODY, SIZE) \
+    case TYPE: return (SIZE);
+
+int paxos_wire_min_size(int type) {
+    switch(type) {
+        PAXOS_WIRE_SCHEMA(PAXOS_WIRE_MIN_SIZE_CASE)
+        default: return -1;
+    }
+}
+
+size_t iid_varint_decode(uint8_t * buf, size_t len, iid_t * iid) {
+    iid_t result = 0;
+    size_t i;
+    for(i = 0; i < len && i < IID_VARINT_MAX_SIZE; i++) {
+        iid_t group = buf[i] & 0x7F;
+        //The last byte holds only the highest bit
+        if(i == IID_VARINT_MAX_SIZE - 1 && group > 1) {
+            return 0;
+        }
+        result |= (group << (7 * i));
+        if((buf[i] & 0x80) == 0) {
+            *iid = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
 //Calculate size of dynamic structure by iterating
 size_t prepare_ack_batch_size_calc(prepare_ack_batch * pab) {
     size_t total_size = 0;
@@ -80,6 +135,38 @@ static int validate_paxos_msg(paxos_msg * m, size_t msg_size) {
         return -1;
     }
     
+    //Sender too old to interoperate
+    if(m->version < PAXOS_WIRE_MIN_VERSION) {
+        printf("Invalid message, wire version:%d (min is %d)\n", 
+            m->version, PAXOS_WIRE_MIN_VERSION);
+        return -1;
+    }
+    
+    //Sender not upgraded yet, convert to the current layout
+    if(m->version < PAXOS_WIRE_VERSION) {
+        if(paxos_wire_upgrade(m, MAX_UDP_MSG_SIZE + PAXOS_WIRE_COMPAT_MAX_GROWTH) != 0) {
+            printf("Invalid message, cannot convert msg_type:%d from wire version:%d\n", 
+                m->type, m->version);
+            return -1;
+        }
+        msg_size = PAXOS_MSG_SIZE(m);
+    }
+    
+    int min_size = paxos_wire_min_size(m->type);
+    //Type introduced by a newer version, ignored
+    if(min_size < 0 && m->version > PAXOS_WIRE_VERSION) {
+        LOG(DBG, ("Dropping message of unknown type:%d (wire version:%d)\n", 
+            m->type, m->version));
+        return -1;
+    }
+    
+    //Shorter than its fixed part
+    if(min_size >= 0 && m->data_size < min_size) {
+        printf("Invalid message, truncated msg_type:%d size:%u\n", 
+            m->type, (unsigned int)m->data_size);
+        return -1;
+    }
+    
     switch(m->type) {
         case prepare_reqs: {
             prepare_req_batch * prb = (prepare_req_batch *)m->data;
@@ -127,6 +214,10 @@ static int validate_paxos_msg(paxos_msg * m, size_t msg_size) {
         
         case repeat_reqs: {
             repeat_req_batch * rrb = (repeat_req_batch *)m->data;
+            if(rrb->requests_size < 0) {
+                printf("Invalid repeat request size:%d\n", rrb->requests_size);
+                return -1;
+            }
             expected_size += REPEAT_REQ_BATCH_SIZE(rrb);
         }
         break;
@@ -136,6 +227,30 @@ static int validate_paxos_msg(paxos_msg * m, size_t msg_size) {
         }
         break;
         
+        case submit_batch: {
+            //Entries should add up to the message size
+            submit_batch_msg * sbm = (submit_batch_msg *)m->data;
+            size_t offset = sizeof(submit_batch_msg);
+            int i;
+            for(i = 0; i < sbm->count; i++) {
+                submit_batch_entry * sbe = (submit_batch_entry *)&m->data[offset];
+                if(offset + sizeof(submit_batch_entry) > m->data_size || 
+                    offset + SUBMIT_BATCH_ENTRY_SIZE(sbe) > m->data_size) {
+                    printf("Invalid submit batch, entry %d exceeds size:%u\n", 
+                        i, (unsigned int)m->data_size);
+                    return -1;
+                }
+                offset += SUBMIT_BATCH_ENTRY_SIZE(sbe);
+            }
+            if(offset != m->data_size) {
+                printf("Invalid submit batch, entries size:%u msg size:%u\n", 
+                    (unsigned int)offset, (unsigned int)m->data_size);
+                return -1;
+            }
+            expected_size += offset;
+        }
+        break;
+        
         case alive_ping: {
             expected_size += sizeof(alive_ping_msg);
         }
@@ -145,6 +260,28 @@ static int validate_paxos_msg(paxos_msg * m, size_t msg_size) {
             expected_size += sizeof(leader_announce_msg);
         }
         break;
+
+        case prepare_range_reqs: {
+            prepare_range_req * prr = (prepare_range_req *)m->data;
+            //Proposer id out of bounds
+            if(prr->proposer_id < 0 || prr->proposer_id >= MAX_N_OF_PROPOSERS) {
+                printf("Invalida proposer id:%d\n", prr->proposer_id);
+                return -1;
+            }
+            expected_size += sizeof(prepare_range_req);
+        }
+        break;
+
+        case prepare_range_acks: {
+            prepare_range_ack * pra = (prepare_range_ack *)m->data;
+            //Acceptor id out of bounds
+            if(pra->acceptor_id < 0 || pra->acceptor_id >= N_OF_ACCEPTORS) {
+                printf("Invalida acceptor id:%d\n", pra->acceptor_id);
+                return -1;
+            }
+            expected_size += PREPARE_RANGE_ACK_SIZE(pra);
+        }
+        break;
         
         default: {
             printf("Unknow paxos message type:%d\n", m->type);
@@ -161,7 +298,7 @@ static int validate_paxos_msg(paxos_msg * m, size_t msg_size) {
 }
 
 void print_paxos_msg(paxos_msg * msg) {
-    printf("[msg=%d size:%lu+%lu ", 
+    printf("[msg=%d size:%lu+%u ", 
         msg->type, sizeof(paxos_msg), msg->data_size);
     
     int i;
@@ -176,7 +313,7 @@ void print_paxos_msg(paxos_msg * msg) {
             prepare_req * pr;
             for(i = 0; i < prb->count; i++) {
                 pr = (prepare_req *) &prb->prepares[i];
-                printf("\n (%d) iid:%u bal:%u ", 
+                printf("\n (%d) iid:%lu bal:%u ", 
                     (int)i, pr->iid, pr->ballot);
             }
 
@@ -191,7 +328,7 @@ void print_paxos_msg(paxos_msg * msg) {
             prepare_ack * pa;
             for(i = 0; i < pab->count; i++) {
                 pa = (prepare_ack *) &pab->data[offset];
-                printf("\n (%p)(%d) iid:%u bal:%u vbal:%u val_size:%lu", 
+                printf("\n (%p)(%d) iid:%lu bal:%u vbal:%u val_size:%u", 
                     (void*)pa, (int)i, pa->iid, pa->ballot, 
                     pa->value_ballot, pa->value_size);
                 offset += PREPARE_ACK_SIZE(pa);
@@ -208,7 +345,7 @@ void print_paxos_msg(paxos_msg * msg) {
             accept_req * ar;
             for(i = 0; i < arb->count; i++) {
                 ar = (accept_req *) &arb->data[offset];
-                printf("\n (%d) iid:%u bal:%u val_size:%lu", 
+                printf("\n (%d) iid:%lu bal:%u val_size:%u", 
                     (int)i, ar->iid, ar->ballot, ar->value_size);
                 offset += ACCEPT_REQ_SIZE(ar);
             }
@@ -223,7 +360,7 @@ void print_paxos_msg(paxos_msg * msg) {
             accept_ack * aa;
             for(i = 0; i < aab->count; i++) {
                 aa = (accept_ack *) &aab->data[offset];
-                printf("\n (%d) iid:%u bal:%u vbal:%u val_size:%lu", 
+                printf("\n (%d) iid:%lu bal:%u vbal:%u val_size:%u", 
                     (int)i, aa->iid, aa->ballot, 
                     aa->value_ballot, aa->value_size);
                 offset += ACCEPT_ACK_SIZE(aa);
@@ -234,10 +371,39 @@ void print_paxos_msg(paxos_msg * msg) {
         case repeat_reqs: {
             repeat_req_batch * rrb = (repeat_req_batch *)msg->data;
             printf("(repeat request batch)\n");
-            printf(" count:%d\n", rrb->count);
+            printf(" count:%d size:%d\n", rrb->count, rrb->requests_size);
+            iid_t iid = 0, diff;
+            size_t size;
             for(i = 0; i < rrb->count; i++) {
-                printf("\n (%d) iid:%u ", 
-                    (int)i, rrb->requests[i]);
+                size = iid_varint_decode(&rrb->requests[offset], rrb->requests_size - offset, &diff);
+                if(size == 0) {
+                    printf("\n invalid encoding");
+                    break;
+                }
+                offset += size;
+                iid += diff;
+                printf("\n (%d) iid:%lu ", 
+                    (int)i, iid);
+            }
+        }
+        break;
+
+        case prepare_range_reqs: {
+            prepare_range_req * prr = (prepare_range_req *)msg->data;
+            printf("(prepare range request)\n");
+            printf(" sender proposer:%d, from iid:%lu bal:%u", 
+                prr->proposer_id, prr->from_iid, prr->ballot);
+        }
+        break;
+
+        case prepare_range_acks: {
+            prepare_range_ack * pra = (prepare_range_ack *)msg->data;
+            printf("(prepare range acknowledgement)\n");
+            printf(" sender acceptor:%d, from iid:%lu bal:%u listed to:%lu count:%d\n", 
+                pra->acceptor_id, pra->from_iid, pra->ballot, pra->listed_to, pra->count);
+            for(i = 0; i < pra->count; i++) {
+                printf("\n (%d) needs phase 1 iid:%lu ", 
+                    (int)i, pra->needs_p1[i]);
             }
         }
         break;
@@ -249,9 +415,242 @@ void print_paxos_msg(paxos_msg * msg) {
     printf("]\n");
 }
 
+/*** IO_URING ***/
+
+#if defined(PAXOS_UDP_IO_URING) && defined(IORING_RECV_MULTISHOT)
+
+//Minimal io_uring receiver: a multishot receive is armed on the socket,
+// the kernel picks one of the registered buffers for each datagram 
+// and posts a completion. The ring file descriptor is readable 
+// while there are completions to process.
+struct udp_uring_t {
+    int fd;
+    int sock;
+    void * sq_ptr;
+    size_t sq_size;
+    unsigned * sq_tail;
+    unsigned * sq_mask;
+    unsigned * sq_array;
+    struct io_uring_sqe * sqes;
+    size_t sqes_size;
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned * cq_mask;
+    struct io_uring_cqe * cqes;
+    struct io_uring_buf_ring * buf_ring;
+    unsigned short buf_ring_tail;
+    char * buffers;
+    int armed;
+};
+
+static void udp_uring_destroy(struct udp_uring_t * ur) {
+    if(ur == NULL) {
+        return;
+    }
+    if(ur->buf_ring != NULL) {
+        munmap(ur->buf_ring, PAXOS_UDP_IO_URING_BUFFERS * sizeof(struct io_uring_buf));
+    }
+    if(ur->sqes != NULL) {
+        munmap(ur->sqes, ur->sqes_size);
+    }
+    if(ur->sq_ptr != NULL) {
+        munmap(ur->sq_ptr, ur->sq_size);
+    }
+    close(ur->fd);
+    if(ur->buffers != NULL) {
+        PAX_FREE(ur->buffers);
+    }
+    PAX_FREE(ur);
+}
+
+//Gives a buffer (back) to the kernel
+static void udp_uring_provide_buffer(struct udp_uring_t * ur, int bid) {
+    struct io_uring_buf * buf;
+    buf = &ur->buf_ring->bufs[ur->buf_ring_tail & (PAXOS_UDP_IO_URING_BUFFERS - 1)];
+    buf->addr = (unsigned long)&ur->buffers[bid * MAX_UDP_MSG_SIZE];
+    buf->len = MAX_UDP_MSG_SIZE;
+    buf->bid = bid;
+    ur->buf_ring_tail++;
+    __atomic_store_n(&ur->buf_ring->tail, ur->buf_ring_tail, __ATOMIC_RELEASE);
+}
+
+//(Re)starts the multishot receive
+static int udp_uring_arm(struct udp_uring_t * ur) {
+    unsigned tail = *ur->sq_tail;
+    struct io_uring_sqe * sqe = &ur->sqes[tail & *ur->sq_mask];
+    memset(sqe, '\0', sizeof(struct io_uring_sqe));
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = ur->sock;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    ur->sq_array[tail & *ur->sq_mask] = tail & *ur->sq_mask;
+    __atomic_store_n(ur->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    if(syscall(__NR_io_uring_enter, ur->fd, 1, 0, 0, NULL, 0) != 1) {
+        perror("io_uring_enter");
+        return -1;
+    }
+    ur->armed = 1;
+    return 0;
+}
+
+static struct udp_uring_t * udp_uring_new(int sock) {
+    struct io_uring_params p;
+    memset(&p, '\0', sizeof(struct io_uring_params));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = 2 * PAXOS_UDP_IO_URING_BUFFERS;
+    int fd = syscall(__NR_io_uring_setup, 4, &p);
+    if(fd < 0) {
+        perror("io_uring_setup");
+        return NULL;
+    }
+    //Old kernels map the queues separately, not supported
+    if(!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        close(fd);
+        return NULL;
+    }
+
+    struct udp_uring_t * ur = PAX_MALLOC(sizeof(struct udp_uring_t));
+    memset(ur, '\0', sizeof(struct udp_uring_t));
+    ur->fd = fd;
+    ur->sock = sock;
+
+    //Map submission and completion queues
+    ur->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if(cq_size > ur->sq_size) {
+        ur->sq_size = cq_size;
+    }
+    char * q = mmap(NULL, ur->sq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(q == MAP_FAILED) {
+        perror("mmap");
+        udp_uring_destroy(ur);
+        return NULL;
+    }
+    ur->sq_ptr = q;
+    ur->sq_tail = (unsigned *)(q + p.sq_off.tail);
+    ur->sq_mask = (unsigned *)(q + p.sq_off.ring_mask);
+    ur->sq_array = (unsigned *)(q + p.sq_off.array);
+    ur->cq_head = (unsigned *)(q + p.cq_off.head);
+    ur->cq_tail = (unsigned *)(q + p.cq_off.tail);
+    ur->cq_mask = (unsigned *)(q + p.cq_off.ring_mask);
+    ur->cqes = (struct io_uring_cqe *)(q + p.cq_off.cqes);
+    ur->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ur->sqes = mmap(NULL, ur->sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(ur->sqes == MAP_FAILED) {
+        perror("mmap");
+        ur->sqes = NULL;
+        udp_uring_destroy(ur);
+        return NULL;
+    }
+
+    //Register the buffers
+    ur->buffers = PAX_MALLOC(PAXOS_UDP_IO_URING_BUFFERS * MAX_UDP_MSG_SIZE);
+    ur->buf_ring = mmap(NULL, PAXOS_UDP_IO_URING_BUFFERS * sizeof(struct io_uring_buf), 
+        PROT_READ|PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE, -1, 0);
+    if(ur->buf_ring == MAP_FAILED) {
+        perror("mmap");
+        ur->buf_ring = NULL;
+        udp_uring_destroy(ur);
+        return NULL;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, '\0', sizeof(struct io_uring_buf_reg));
+    reg.ring_addr = (unsigned long)ur->buf_ring;
+    reg.ring_entries = PAXOS_UDP_IO_URING_BUFFERS;
+    reg.bgid = 0;
+    if(syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        perror("io_uring_register");
+        udp_uring_destroy(ur);
+        return NULL;
+    }
+    int i;
+    for(i = 0; i < PAXOS_UDP_IO_URING_BUFFERS; i++) {
+        udp_uring_provide_buffer(ur, i);
+    }
+
+    if(udp_uring_arm(ur) != 0) {
+        udp_uring_destroy(ur);
+        return NULL;
+    }
+    return ur;
+}
+
+static int udp_uring_has_pending(struct udp_uring_t * ur) {
+    return (*ur->cq_head != __atomic_load_n(ur->cq_tail, __ATOMIC_ACQUIRE));
+}
+
+//Copies the next datagram received into dest,
+// returns its size or -1 if there is none
+static int udp_uring_read(struct udp_uring_t * ur, char * dest) {
+    int msg_size = -1;
+    while(msg_size < 0) {
+        if(!udp_uring_has_pending(ur)) {
+            //Restarting may complete immediately if data is ready
+            if(ur->armed || udp_uring_arm(ur) != 0) {
+                break;
+            }
+            continue;
+        }
+        unsigned head = *ur->cq_head;
+        struct io_uring_cqe * cqe = &ur->cqes[head & *ur->cq_mask];
+        if(cqe->flags & IORING_CQE_F_BUFFER) {
+            int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            if(cqe->res >= 0) {
+                msg_size = cqe->res;
+                memcpy(dest, &ur->buffers[bid * MAX_UDP_MSG_SIZE], msg_size);
+            }
+            udp_uring_provide_buffer(ur, bid);
+        }
+        //Out of buffers or error, stopped
+        if(!(cqe->flags & IORING_CQE_F_MORE)) {
+            if(cqe->res < 0 && cqe->res != -ENOBUFS) {
+                printf("io_uring receive failed: %s\n", strerror(-cqe->res));
+            }
+            ur->armed = 0;
+        }
+        __atomic_store_n(ur->cq_head, head + 1, __ATOMIC_RELEASE);
+    }
+
+    if(!ur->armed) {
+        udp_uring_arm(ur);
+    }
+    return msg_size;
+}
+
+#else
+
+struct udp_uring_t {
+    int fd;
+};
+
+static struct udp_uring_t * udp_uring_new(int sock) {
+    UNUSED_ARG(sock);
+    return NULL;
+}
+
+static void udp_uring_destroy(struct udp_uring_t * ur) {
+    UNUSED_ARG(ur);
+}
+
+static int udp_uring_has_pending(struct udp_uring_t * ur) {
+    UNUSED_ARG(ur);
+    return 0;
+}
+
+static int udp_uring_read(struct udp_uring_t * ur, char * dest) {
+    UNUSED_ARG(ur);
+    UNUSED_ARG(dest);
+    return -1;
+}
+
+#endif
+
 //Creates a new blocking UDP multicast receiver for the given address/port
 udp_receiver * udp_receiver_blocking_new(char* address_string, int port) {
     udp_receiver * rec = PAX_MALLOC(sizeof(udp_receiver));
+    memset(rec, '\0', sizeof(udp_receiver));
 
     struct ip_mreq mreq;
     
@@ -317,6 +716,14 @@ udp_receiver * udp_receiver_new(char* address_string, int port) {
         perror("fcntl2");
         return NULL;
     }
+
+#if defined(PAXOS_BUSY_POLL_USEC) && defined(SO_BUSY_POLL)
+    // Poll the device queue when reading (may require CAP_NET_ADMIN)
+    int busy_poll = PAXOS_BUSY_POLL_USEC;
+    if (setsockopt(rec->sock, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(int)) != 0) {
+        perror("setsockopt, setting SO_BUSY_POLL");
+    }
+#endif
     
     LOG(DBG, ("Socket %d created for address %s:%d (receive mode)\n", rec->sock, address_string, port));
     return rec;
@@ -335,15 +742,137 @@ int udp_receiver_destroy(udp_receiver * rec) {
     LOG(DBG, ("Socket %d closed\n", rec->sock));
     
     //Free the structure
+    if(rec->gro_buffer != NULL) {
+        PAX_FREE(rec->gro_buffer);
+    }
+    udp_uring_destroy(rec->uring);
     PAX_FREE(rec);
     return ret;
 }
 
+//Asks the OS to coalesce datagrams received, so that multiple ones are 
+// read with a single system call (only if PAXOS_UDP_GRO is defined).
+//Whoever reads from this receiver must call udp_read_next_message 
+// until udp_receiver_has_pending returns 0
+// Returns 0 if enabled, -1 otherwise
+int udp_receiver_enable_gro(udp_receiver * rec) {
+#if defined(PAXOS_UDP_GRO) && defined(UDP_GRO)
+    int activate = 1;
+    if (setsockopt(rec->sock, IPPROTO_UDP, UDP_GRO, &activate, sizeof(int)) != 0) {
+        perror("setsockopt, setting UDP_GRO");
+        return -1;
+    }
+    rec->gro_buffer = PAX_MALLOC(PAXOS_UDP_GRO_BUFFER_SIZE);
+    rec->gro_size = 0;
+    rec->gro_offset = 0;
+    LOG(DBG, ("Socket %d receives coalesced datagrams\n", rec->sock));
+    return 0;
+#else
+    UNUSED_ARG(rec);
+    return -1;
+#endif
+}
+
+//Returns 1 if some datagram was already read from the socket
+// but not returned by udp_read_next_message yet
+int udp_receiver_has_pending(udp_receiver * rec) {
+    if(rec->uring != NULL) {
+        return udp_uring_has_pending(rec->uring);
+    }
+    return (rec->gro_offset < rec->gro_size);
+}
+
+//Datagrams are received through io_uring (only if PAXOS_UDP_IO_URING 
+// is defined), GRO is not used. The file descriptor to watch for 
+// new messages changes, see udp_receiver_get_fd
+// Returns 0 if enabled, -1 otherwise
+int udp_receiver_enable_io_uring(udp_receiver * rec) {
+    rec->uring = udp_uring_new(rec->sock);
+    if(rec->uring == NULL) {
+        return -1;
+    }
+    LOG(DBG, ("Socket %d receives through io_uring\n", rec->sock));
+    return 0;
+}
+
+//File descriptor that becomes readable when a new message is available
+int udp_receiver_get_fd(udp_receiver * rec) {
+    if(rec->uring != NULL) {
+        return rec->uring->fd;
+    }
+    return rec->sock;
+}
+
+//Reads (possibly) multiple datagrams into the gro buffer
+static int udp_read_coalesced(udp_receiver * rec) {
+    struct iovec iov;
+    iov.iov_base = rec->gro_buffer;
+    iov.iov_len = PAXOS_UDP_GRO_BUFFER_SIZE;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr mh;
+    memset(&mh, '\0', sizeof(struct msghdr));
+    mh.msg_name = &rec->addr;
+    mh.msg_namelen = sizeof(struct sockaddr_in);
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = control;
+    mh.msg_controllen = sizeof(control);
+
+    int size = recvmsg(rec->sock, &mh, 0);
+    if (size < 0) {
+        return size;
+    }
+
+    //Size of each datagram, if more than one
+    rec->gro_segment_size = size;
+#ifdef UDP_GRO
+    struct cmsghdr * cmsg;
+    for(cmsg = CMSG_FIRSTHDR(&mh); cmsg != NULL; cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+        if(cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+            memcpy(&rec->gro_segment_size, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+#endif
+    rec->gro_size = size;
+    rec->gro_offset = 0;
+    return size;
+}
+
 //Tries to read the next message from socket into the local buffer.
 // This function is registered with libevent and invoked automatically 
 // when a new message is available in the system buffer.
 // Returns 0 for a valid message, -1 otherwise
 int udp_read_next_message(udp_receiver * recv_info) {
+
+    //Received through io_uring, copy the next one in the local buffer
+    if(recv_info->uring != NULL) {
+        int msg_size = udp_uring_read(recv_info->uring, recv_info->recv_buffer);
+        if(msg_size < 0) {
+            return -1;
+        }
+        return validate_paxos_msg((paxos_msg*)recv_info->recv_buffer, msg_size);
+    }
+
+    //Coalesced datagrams, copy the next one in the local buffer
+    if(recv_info->gro_buffer != NULL) {
+        if(!udp_receiver_has_pending(recv_info) && udp_read_coalesced(recv_info) < 0) {
+            perror("recvmsg");
+            return -1;
+        }
+        int msg_size = recv_info->gro_size - recv_info->gro_offset;
+        if(msg_size > recv_info->gro_segment_size) {
+            msg_size = recv_info->gro_segment_size;
+        }
+        if(msg_size > MAX_UDP_MSG_SIZE) {
+            printf("Dropping datagram of size %d\n", msg_size);
+            recv_info->gro_offset += msg_size;
+            return -1;
+        }
+        memcpy(recv_info->recv_buffer, &recv_info->gro_buffer[recv_info->gro_offset], msg_size);
+        recv_info->gro_offset += msg_size;
+        return validate_paxos_msg((paxos_msg*)recv_info->recv_buffer, msg_size);
+    }
     
     //Get the message
     socklen_t addrlen = sizeof(struct sockaddr);
@@ -61,12 +61,21 @@ void sendbuf_clear(udp_send_buffer * sb, paxos_msg_code type, short int sender_i
             m->data_size += sizeof(repeat_req_batch);
             repeat_req_batch * rrb = (repeat_req_batch *)&m->data;
             rrb->count = 0;    
+            rrb->requests_size = 0;
+            sb->last_repeat_req = 0;
         } break;
 
         //Client
         case submit: {
             m->data_size += 0;
         } break;
+
+        case submit_batch: {
+            m->data_size += sizeof(submit_batch_msg);
+            submit_batch_msg * sbm = (submit_batch_msg *)&m->data;
+            sbm->client_id = PAXOS_NO_CLIENT_ID;
+            sbm->count = 0;
+        } break;
             
         default: {            
             printf("Invalid message type %d for sendbuf_clear!\n", 
@@ -191,19 +200,34 @@ void sendbuf_add_repeat_req(udp_send_buffer * sb, iid_t iid) {
     paxos_msg * m = (paxos_msg *) &sb->buffer;
     assert(m->type == repeat_reqs);
 
-    if(PAXOS_MSG_SIZE(m) + sizeof(iid_t) >= MAX_UDP_MSG_SIZE) {
-        // Next iid to add does not fit, flush the current 
+    if(PAXOS_MSG_SIZE(m) + IID_VARINT_MAX_SIZE >= MAX_UDP_MSG_SIZE) {
+        // Next iid to add may not fit, flush the current 
         // message before adding it
         sendbuf_flush(sb);
         sendbuf_clear(sb, m->type, -1);
     }
     
     sb->dirty = 1;
-    m->data_size += sizeof(iid_t);
     
+    //Difference from the previous one (modulo 2^64 if smaller)
     repeat_req_batch * rrb = (repeat_req_batch *)&m->data;
-    rrb->requests[rrb->count] = iid;
+    size_t size = iid_varint_encode(iid - sb->last_repeat_req, 
+        &rrb->requests[rrb->requests_size]);
+    rrb->requests_size += size;
+    m->data_size += size;
     rrb->count += 1;
+    sb->last_repeat_req = iid;
+}
+
+size_t iid_varint_encode(iid_t iid, uint8_t * buf) {
+    size_t i = 0;
+    while(iid >= 0x80) {
+        buf[i] = (uint8_t)(iid | 0x80);
+        iid >>= 7;
+        i++;
+    }
+    buf[i] = (uint8_t)iid;
+    return i + 1;
 }
 
 void sendbuf_add_submit_val(udp_send_buffer * sb, char * value, size_t val_size) {
@@ -215,6 +239,32 @@ void sendbuf_add_submit_val(udp_send_buffer * sb, char * value, size_t val_size)
     memcpy(m->data, value, val_size);
 }
 
+//Adds a value to the current message (a submit_batch)
+void sendbuf_add_submit_batch_val(udp_send_buffer * sb, uint64_t client_seq, char * value, size_t val_size) {
+    paxos_msg * m = (paxos_msg *) &sb->buffer;
+    assert(m->type == submit_batch);
+    submit_batch_msg * sbm = (submit_batch_msg *)&m->data;
+
+    size_t entry_size = sizeof(submit_batch_entry) + val_size;
+    if(PAXOS_MSG_SIZE(m) + entry_size >= MAX_UDP_MSG_SIZE) {
+        // Next value does not fit, flush the current 
+        // message before adding it (same client)
+        uint32_t client_id = sbm->client_id;
+        sendbuf_flush(sb);
+        sendbuf_clear(sb, m->type, 0);
+        sbm->client_id = client_id;
+    }
+
+    submit_batch_entry * sbe = (submit_batch_entry *)&m->data[m->data_size];
+    sbe->client_seq = client_seq;
+    sbe->value_size = val_size;
+    memcpy(sbe->value, value, val_size);
+
+    sb->dirty = 1;
+    m->data_size += entry_size;
+    sbm->count += 1;
+}
+
 void sendbuf_send_ping(udp_send_buffer * sb, short int proposer_id, long unsigned int sequence_number) {
     paxos_msg * m = (paxos_msg *) &sb->buffer;
     sb->dirty = 1;
@@ -226,6 +276,36 @@ void sendbuf_send_ping(udp_send_buffer * sb, short int proposer_id, long unsigne
     sendbuf_flush(sb);
 }
 
+void sendbuf_send_prepare_range_req(udp_send_buffer * sb, short int proposer_id, iid_t from_iid, ballot_t ballot) {
+    paxos_msg * m = (paxos_msg *) &sb->buffer;
+    sb->dirty = 1;
+    m->type = prepare_range_reqs;
+    m->data_size = sizeof(prepare_range_req);
+    prepare_range_req * prr = (prepare_range_req *) m->data;
+    prr->proposer_id = proposer_id;
+    prr->from_iid = from_iid;
+    prr->ballot = ballot;
+    sendbuf_flush(sb);
+}
+
+void sendbuf_send_prepare_range_ack(udp_send_buffer * sb, short int acceptor_id, 
+    iid_t from_iid, ballot_t ballot, iid_t * needs_p1, short int count, iid_t listed_to) {
+    assert(count >= 0 && (size_t)count <= PREPARE_RANGE_ACK_MAX_LISTED);
+
+    paxos_msg * m = (paxos_msg *) &sb->buffer;
+    sb->dirty = 1;
+    m->type = prepare_range_acks;
+    prepare_range_ack * pra = (prepare_range_ack *) m->data;
+    pra->acceptor_id = acceptor_id;
+    pra->count = count;
+    pra->from_iid = from_iid;
+    pra->ballot = ballot;
+    pra->listed_to = listed_to;
+    memcpy(pra->needs_p1, needs_p1, count * sizeof(iid_t));
+    m->data_size = PREPARE_RANGE_ACK_SIZE(pra);
+    sendbuf_flush(sb);
+}
+
 void sendbuf_send_leader_announce(udp_send_buffer * sb, short int leader_id) {
     paxos_msg * m = (paxos_msg *) &sb->buffer;
     sb->dirty = 1;
@@ -252,8 +332,21 @@ void sendbuf_flush(udp_send_buffer * sb) {
     
     //Send the current message in buffer
     paxos_msg * m = (paxos_msg *) &sb->buffer;
+    m->version = PAXOS_WIRE_VERSION;
+    
+#if PAXOS_WIRE_SEND_VERSION != PAXOS_WIRE_VERSION
+    //Previous layout while upgrading, see paxos_config.h
+    char compat[MAX_UDP_MSG_SIZE];
+    if(paxos_wire_downgrade(m, (paxos_msg *)compat) != 0) {
+        printf("Cannot send msg_type:%d with wire version %d\n", 
+            m->type, PAXOS_WIRE_SEND_VERSION);
+        return;
+    }
+    m = (paxos_msg *)compat;
+#endif
+    
     cnt = sendto(sb->sock,              //Sock
-        sb->buffer,                     //Data
+        m,                              //Data
         PAXOS_MSG_SIZE(m),              //Data size
         0,                              //Flags
         (struct sockaddr *)&sb->addr,   //Addr
@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include <memory.h>
+#include <stdio.h>
+
+#include "libpaxos_priv.h"
+
+/*
+    Conversions between the message layouts of PAXOS_WIRE_MIN_VERSION
+    and PAXOS_WIRE_VERSION (see libpaxos_messages.h). When a new version
+    changes some layouts, they are replaced by the conversions from the
+    new previous version.
+
+    Version 1: no client id and sequence numbers in submit_batch,
+    proposed values without paxos_value_tag. Values of version 1 get
+    a tag with PAXOS_NO_CLIENT_ID and PAXOS_NO_CLIENT_SEQ (never checked
+    for duplicates), the tag is stripped when sending to version 1.
+*/
+
+typedef struct submit_batch_entry_v1_t {
+    uint16_t value_size;
+    char value[0];
+} PAXOS_WIRE_PACKED submit_batch_entry_v1;
+
+typedef struct submit_batch_msg_v1_t {
+    uint16_t count;
+    char data[0];
+} PAXOS_WIRE_PACKED submit_batch_msg_v1;
+
+_Static_assert(PAXOS_WIRE_VERSION == 2, "conversions are for the layouts of version 1");
+_Static_assert(MAX_UDP_MSG_SIZE + PAXOS_WIRE_COMPAT_MAX_GROWTH <= UINT16_MAX,
+    "converted message size does not fit the message header");
+
+//Copies count entries of a batch: a fixed part of entry_size bytes
+// ending with the value size (uint32_t), then the value. Values that are
+// not empty get a tag (upgrade) or lose it (downgrade).
+// Returns the bytes written in dst, -1 if src is malformed or dst too small
+static int convert_values(char * src, size_t src_size, char * dst, size_t dst_size,
+    short int count, size_t entry_size, int upgrade) {
+
+    size_t src_offset = 0, dst_offset = 0;
+    uint32_t value_size;
+    short int i;
+
+    for(i = 0; i < count; i++) {
+        if(src_offset + entry_size > src_size) {
+            return -1;
+        }
+        char * entry = &src[src_offset];
+        memcpy(&value_size, &entry[entry_size - sizeof(uint32_t)], sizeof(uint32_t));
+        if(value_size > src_size - src_offset - entry_size) {
+            return -1;
+        }
+        char * value = &entry[entry_size];
+        src_offset += entry_size + value_size;
+
+        size_t new_size = value_size;
+        if(value_size > 0 && upgrade) {
+            new_size += sizeof(paxos_value_tag);
+        } else if(value_size > 0) {
+            if(value_size < sizeof(paxos_value_tag)) {
+                return -1;
+            }
+            new_size -= sizeof(paxos_value_tag);
+            value += sizeof(paxos_value_tag);
+        }
+        if(dst_offset + entry_size + new_size > dst_size) {
+            return -1;
+        }
+
+        memcpy(&dst[dst_offset], entry, entry_size);
+        value_size = new_size;
+        memcpy(&dst[dst_offset + entry_size - sizeof(uint32_t)], &value_size, sizeof(uint32_t));
+        dst_offset += entry_size;
+
+        if(new_size > 0 && upgrade) {
+            paxos_value_tag * tag = (paxos_value_tag *)&dst[dst_offset];
+            tag->client_id = PAXOS_NO_CLIENT_ID;
+            tag->client_seq = PAXOS_NO_CLIENT_SEQ;
+            memcpy(tag->value, value, new_size - sizeof(paxos_value_tag));
+        } else {
+            memcpy(&dst[dst_offset], value, new_size);
+        }
+        dst_offset += new_size;
+    }
+
+    //Entries should add up to the message size
+    return (src_offset == src_size ? (int)dst_offset : -1);
+}
+
+//Entry size and count of the batches of values, 0 for other types
+static size_t batch_entry_size(paxos_msg * m, short int * count) {
+    switch(m->type) {
+        case prepare_acks:
+            *count = ((prepare_ack_batch *)m->data)->count;
+            return sizeof(prepare_ack);
+        case accept_reqs:
+            *count = ((accept_req_batch *)m->data)->count;
+            return sizeof(accept_req);
+        case accept_acks:
+            *count = ((accept_ack_batch *)m->data)->count;
+            return sizeof(accept_ack);
+        default:
+            return 0;
+    }
+}
+
+static int upgrade_submit_batch(paxos_msg * m, char * src, size_t buf_size) {
+    submit_batch_msg_v1 * old = (submit_batch_msg_v1 *)src;
+    if(m->data_size < sizeof(submit_batch_msg_v1)) {
+        return -1;
+    }
+
+    submit_batch_msg * sbm = (submit_batch_msg *)m->data;
+    sbm->client_id = PAXOS_NO_CLIENT_ID;
+    sbm->count = old->count;
+
+    size_t src_offset = sizeof(submit_batch_msg_v1);
+    size_t dst_offset = sizeof(submit_batch_msg);
+    size_t dst_size = buf_size - sizeof(paxos_msg);
+    int i;
+    for(i = 0; i < old->count; i++) {
+        submit_batch_entry_v1 * old_entry = (submit_batch_entry_v1 *)&src[src_offset];
+        if(src_offset + sizeof(submit_batch_entry_v1) > m->data_size ||
+            src_offset + sizeof(submit_batch_entry_v1) + old_entry->value_size > m->data_size) {
+            return -1;
+        }
+        if(dst_offset + sizeof(submit_batch_entry) + old_entry->value_size > dst_size) {
+            return -1;
+        }
+        submit_batch_entry * sbe = (submit_batch_entry *)&m->data[dst_offset];
+        sbe->client_seq = PAXOS_NO_CLIENT_SEQ;
+        sbe->value_size = old_entry->value_size;
+        memcpy(sbe->value, old_entry->value, old_entry->value_size);
+        src_offset += sizeof(submit_batch_entry_v1) + old_entry->value_size;
+        dst_offset += SUBMIT_BATCH_ENTRY_SIZE(sbe);
+    }
+    if(src_offset != m->data_size) {
+        return -1;
+    }
+
+    m->data_size = dst_offset;
+    return 0;
+}
+
+int paxos_wire_upgrade(paxos_msg * m, size_t buf_size) {
+    short int count;
+    size_t entry_size = batch_entry_size(m, &count);
+    if(entry_size == 0 && m->type != submit_batch) {
+        m->version = PAXOS_WIRE_VERSION;
+        return 0;
+    }
+
+    //Converted from a copy, in the original buffer
+    char src[MAX_UDP_MSG_SIZE];
+    if(PAXOS_MSG_SIZE(m) > MAX_UDP_MSG_SIZE || buf_size < sizeof(paxos_msg)) {
+        return -1;
+    }
+    memcpy(src, m->data, m->data_size);
+
+    if(entry_size > 0) {
+        //Batch header (ids and count) does not change
+        size_t header_size = paxos_wire_min_size(m->type);
+        if(m->data_size < header_size) {
+            return -1;
+        }
+        int size = convert_values(&src[header_size], m->data_size - header_size,
+            &m->data[header_size], buf_size - sizeof(paxos_msg) - header_size,
+            count, entry_size, 1);
+        if(size < 0) {
+            return -1;
+        }
+        m->data_size = header_size + size;
+    } else if(upgrade_submit_batch(m, src, buf_size) != 0) {
+        return -1;
+    }
+
+    m->version = PAXOS_WIRE_VERSION;
+    return 0;
+}
+
+int paxos_wire_downgrade(paxos_msg * m, paxos_msg * out) {
+    memcpy(out, m, sizeof(paxos_msg));
+    out->version = PAXOS_WIRE_MIN_VERSION;
+
+    short int count;
+    size_t entry_size = batch_entry_size(m, &count);
+    if(entry_size > 0) {
+        size_t header_size = paxos_wire_min_size(m->type);
+        memcpy(out->data, m->data, header_size);
+        int size = convert_values(&m->data[header_size], m->data_size - header_size,
+            &out->data[header_size], MAX_UDP_MSG_SIZE - sizeof(paxos_msg) - header_size,
+            count, entry_size, 0);
+        if(size < 0) {
+            return -1;
+        }
+        out->data_size = header_size + size;
+        return 0;
+    }
+
+    if(m->type == submit_batch) {
+        submit_batch_msg * sbm = (submit_batch_msg *)m->data;
+        submit_batch_msg_v1 * old = (submit_batch_msg_v1 *)out->data;
+        old->count = sbm->count;
+        size_t src_offset = sizeof(submit_batch_msg);
+        size_t dst_offset = sizeof(submit_batch_msg_v1);
+        int i;
+        for(i = 0; i < sbm->count; i++) {
+            submit_batch_entry * sbe = (submit_batch_entry *)&m->data[src_offset];
+            submit_batch_entry_v1 * old_entry = (submit_batch_entry_v1 *)&out->data[dst_offset];
+            old_entry->value_size = sbe->value_size;
+            memcpy(old_entry->value, sbe->value, sbe->value_size);
+            src_offset += SUBMIT_BATCH_ENTRY_SIZE(sbe);
+            dst_offset += sizeof(submit_batch_entry_v1) + sbe->value_size;
+        }
+        out->data_size = dst_offset;
+        return 0;
+    }
+
+    memcpy(out->data, m->data, m->data_size);
+    return 0;
+}
@@ -1,6 +1,7 @@
 #ifndef _LIBPAXOS_H_
 #define _LIBPAXOS_H_
 #include <sys/types.h>
+#include <sys/time.h>
 #include <stdint.h>
 #include "paxos_config.h"
 
@@ -8,15 +9,16 @@
     The maximum size that can be submitted by a client.
     Set MAX_UDP_MSG_SIZE in config file to reflect your network MTU.
     Max packet size minus largest header possible
-    (should be accept_ack_batch+accept_ack, around 30 bytes)
+    (should be accept_ack_batch+accept_ack, around 30 bytes, 
+    plus the tag identifying the submission, 12 bytes)
 */
-#define PAXOS_MAX_VALUE_SIZE (MAX_UDP_MSG_SIZE - 40)
+#define PAXOS_MAX_VALUE_SIZE (MAX_UDP_MSG_SIZE - 52)
 
 /* 
     Alias for instance identificator and ballot number.
 */
 typedef unsigned int ballot_t;
-typedef uint32_t iid_t;
+typedef uint64_t iid_t;
 
 /* 
     When starting a learner you must pass a function to be invoked whenever
@@ -44,13 +46,22 @@ typedef int (* custom_init_function)(void);
 
 /*
     Starts a learner and returns when the initialization is complete.
-    Return value is 0 if successful
+    Return value is 0 if successful, -1 if a learner is already running
+    or the initialization failed (then it can be invoked again).
+    A process runs a single learner: the roles keep their state in 
+    file-scope variables and use the addresses in paxos_config.h.
+    Acceptors and proposers start the learner themselves, so a process
+    is either a client, an acceptor or a proposer.
+    (Multiple groups per process are supported by ring_paxos only, 
+    see learner_init_on_base and lp_event_pool.h there)
     f -> A deliver_function invoked when a value is delivered.
          This argument cannot be NULL
          It's called by an internal thread therefore:
          i)  it must be quick
          ii) you must synchronize/lock externally if this function touches data
              shared with some other thread (i.e. the one that calls learner init)
+         A value resubmitted by a client (see pax_submit_idempotent) is 
+         delivered once, the instances deciding it again are skipped.
     cif -> A custom_init_function invoked by the internal libevent thread, 
            invoked when the normal learner initialization is completed
            Can be used to add other events to the existing event loop.
@@ -59,6 +70,19 @@ typedef int (* custom_init_function)(void);
 */
 int learner_init(deliver_function f, custom_init_function cif);
 
+/*
+    The libevent base of the learner thread. The thread does not use 
+    the libevent global base (event_init), so events added by a 
+    custom_init_function must be bound to this base with event_base_set
+    before event_add.
+    Example:
+        evtimer_set(&my_event, my_callback, NULL);
+        event_base_set(learner_get_event_base(), &my_event);
+        event_add(&my_event, &my_interval);
+*/
+struct event_base;
+struct event_base * learner_get_event_base(void);
+
 /*
     Starts an acceptor and returns when the initialization is complete.
     Return value is 0 if successful
@@ -104,21 +128,78 @@ int proposer_init_cif(int proposer_id, custom_init_function cif);
 */
 typedef struct paxos_submit_handle_t {
     void * sendbuf;
+    //Values batched if not 0, see pax_submit_handle_init_linger
+    unsigned int linger_usec;
+    struct timeval flush_deadline;
+    void * linger_event;
+    //Identifies the values submitted trough this handle,
+    // see pax_submit_idempotent
+    uint32_t client_id;
+    uint64_t next_seq;
+    //Lowest sequence number not completed yet (see pax_submit_done),
+    // bit i of done_window is set if low_seq+i is completed
+    uint64_t low_seq;
+    uint64_t done_window;
 } paxos_submit_handle;
 
 /*
     Creates a new handle for this client to submit values.
     Different threads in a process can have their personal handle
     or share a common one (locking is up to you!)
+    Each value is sent immediately in its own datagram.
 */
 paxos_submit_handle * pax_submit_handle_init();
 
+/*
+    Like pax_submit_handle_init, but values are batched for up to 
+    linger_usec microseconds (e.g. SUBMIT_BATCH_LINGER, 0 disables batching).
+    If the process runs a learner, a timer in its libevent thread flushes
+    the batch in time: values must then be submitted from that thread only
+    (i.e. in the deliver function or in events added by custom_init_function).
+    Without a learner, a batch is only sent by the next submit after the
+    linger time, or by pax_submit_flush: call it when done submitting.
+*/
+paxos_submit_handle * pax_submit_handle_init_linger(unsigned int linger_usec);
+
 /*
     This call sends a value to the current leader and returns immediately.
+    With batching, the value may wait in the handle for the linger time.
     There is no guarantee that the value even reached the leader.
+    The value has no sequence number: if it is submitted again, 
+    it is proposed and delivered again.
 */
 int pax_submit_nonblock(paxos_submit_handle * h, char * value, size_t val_size);
 
+/*
+    Returns a new sequence number for a value submitted trough this handle
+*/
+uint64_t pax_submit_new_seq(paxos_submit_handle * h);
+
+/*
+    Like pax_submit_nonblock, the value is identified by client_seq 
+    (from pax_submit_new_seq). Submitting it again with the same client_seq
+    (i.e. after a timeout) is safe: the leader does not propose it again 
+    if it's still pending or already decided, and learners deliver it 
+    at most once.
+    The value is outstanding until pax_submit_done is called for client_seq.
+    Returns -1 (the value is not sent) if client_seq was completed already,
+    or if it is SUBMIT_SESSION_WINDOW or more ahead of the oldest value
+    outstanding: the leader and the learners only track that many 
+    sequence numbers per client.
+*/
+int pax_submit_idempotent(paxos_submit_handle * h, uint64_t client_seq, char * value, size_t val_size);
+
+/*
+    The value submitted with client_seq was delivered, or will not be
+    submitted again
+*/
+void pax_submit_done(paxos_submit_handle * h, uint64_t client_seq);
+
+/*
+    Sends the values batched in the handle (if any) immediately
+*/
+void pax_submit_flush(paxos_submit_handle * h);
+
 void pax_submit_sharedmem(char* value, size_t val_size);
 
 #endif /* _LIBPAXOS_H_ */
@@ -53,6 +53,17 @@
     Unit is microseconds - i.e. 1000 = 1ms */
 #define P2_CHECK_INTERVAL 1000
 
+/*
+    If defined, the leader executes phase 1 once for all instances
+    from the first one it opens (a single prepare_range_req) instead 
+    of one prepare_req per instance in the PROPOSER_PREEXEC_WIN_SIZE window.
+    Acceptors keep the promise as a watermark. Instances where some
+    value was already accepted (or a higher ballot promised) still
+    go through a normal phase 1.
+    Undefine to always execute phase 1 per instance.
+*/
+#define PROPOSER_RANGE_PREPARE
+
 /* 
     The maximum number of proposers must be fixed beforehand
     (this is because of unique ballot generation).
@@ -113,6 +124,19 @@
 */
 #define LEADER_MAX_QUEUE_LENGTH 50
 
+/*
+    Suggested linger time for submit handles that batch values 
+    (see pax_submit_handle_init_linger): the values submitted by a client
+    are coalesced into a single datagram, sent when full or when the first 
+    value in it has waited for this long. Handles created with
+    pax_submit_handle_init do not batch.
+    The timer is only available in processes running a learner, 
+    others check the linger time when the next value is submitted, 
+    or call pax_submit_flush.
+    Unit is microseconds.
+*/
+#define SUBMIT_BATCH_LINGER 1000
+
 
 /*** FAILURE DETECTOR SETTINGS ***/
 
@@ -121,7 +145,23 @@
     to the failure oracle.
     Unit is microseconds.
 */
-#define FAILURE_DETECTOR_PING_INTERVAL 3000000
+#define FAILURE_DETECTOR_PING_INTERVAL 100000
+
+/*
+    The oracle (see tests/example_oracle.c) suspects a proposer that sent
+    no 'alive' message for this long, and elects a new leader if it was the 
+    current one. A crashed leader is replaced within this time.
+    Unit is microseconds.
+*/
+#define ORACLE_SUSPECT_TIMEOUT 500000
+
+/*
+    The oracle suspects a proposer earlier if its 'alive' message is
+    unlikely to be just late, given the intervals between the previous ones:
+    the chance must be below 10^-ORACLE_PHI_THRESHOLD (accrual failure detector).
+    Lower values detect crashes sooner but depose slow leaders more often.
+*/
+#define ORACLE_PHI_THRESHOLD 8
 
 /*** ACCEPTORS DB SETTINGS ***/
 
@@ -198,6 +238,55 @@
 */
 // #define PAXOS_UDP_SEND_NONBLOCK
 
+/*
+  If defined, the protocol receivers ask the OS to coalesce datagrams 
+  (UDP_GRO, Linux only) and read multiple ones with a single system call.
+  Ignored if not supported.
+*/
+// #define PAXOS_UDP_GRO
+
+/*
+  Size of the buffer for coalesced datagrams (if PAXOS_UDP_GRO is defined)
+*/
+#define PAXOS_UDP_GRO_BUFFER_SIZE 65535
+
+/*
+  If defined, the protocol receivers use io_uring (Linux 6.0 or later):
+  a multishot receive stays armed on PAXOS_UDP_IO_URING_BUFFERS 
+  pre-registered buffers and datagrams are read without system calls.
+  Falls back to normal reads if not supported, 
+  PAXOS_UDP_GRO is ignored when active.
+*/
+// #define PAXOS_UDP_IO_URING
+
+/*
+  Number of buffers registered by each receiver (must be a power of 2)
+*/
+#define PAXOS_UDP_IO_URING_BUFFERS 64
+
+/*
+  Wire version of the messages sent (see PAXOS_WIRE_VERSION in 
+  libpaxos_messages.h). To upgrade a running system to a release that 
+  changes the wire format, first restart every process with the new 
+  release built with the definition below, then restart them again 
+  built without it. Messages of the previous version are always understood.
+*/
+// #define PAXOS_WIRE_SEND_VERSION (PAXOS_WIRE_VERSION - 1)
+
+/*
+  If defined, the libevent thread (started by learner_init, also running 
+  acceptor and proposer) never sleeps in the event loop, it keeps polling
+  to avoid the wake up delay when a message arrives. Burns a CPU core.
+  Receivers also busy-poll the device queue (SO_BUSY_POLL, Linux only) 
+  for up to this many microseconds.
+*/
+// #define PAXOS_BUSY_POLL_USEC 50
+
+/*
+  If defined, the libevent thread is pinned to this CPU core (Linux only)
+*/
+// #define PAXOS_EVENT_THREAD_CPU 1
+
 /*** STRUCTURES SETTINGS ***/
 
 /*
@@ -214,6 +303,24 @@
 */
 #define LEARNER_ARRAY_SIZE 2048
 
+/*
+  Number of clients tracked by the leader and by each learner to 
+  suppress resubmitted values (see pax_submit_idempotent). 
+  Clients mapped to the same slot replace each other, a duplicate 
+  submitted by a replaced client is not detected.
+  MUST be a power of 2
+*/
+#define SUBMIT_SESSION_TABLE_SIZE 1024
+
+/*
+  Sequence numbers tracked for each client, the ones older than 
+  this (w.r.t. the highest seen) are considered duplicates. 
+  It's also the limit of values outstanding in a submit handle
+  (see pax_submit_idempotent).
+  At most 64 (the window is kept in a bitmap)
+*/
+#define SUBMIT_SESSION_WINDOW 64
+
 
 /*** DEBUGGING SETTINGS ***/
 
@@ -125,17 +125,26 @@ ab_handle_repeat_req_batch(repeat_req_batch * rrb) {
 
     short int i;
     accept_ack * aa;
+    iid_t iid = 0, diff;
+    size_t offset = 0, size;
     
     //Iterate over the repeat_req in the batch
     for(i = 0; i < rrb->count; i++) {
+        size = iid_varint_decode(&rrb->requests[offset], rrb->requests_size - offset, &diff);
+        if(size == 0) {
+            break;
+        }
+        offset += size;
+        iid += diff;
+
         //Read the corresponding record
-        aa = stablestorage_get_record(rrb->requests[i]);
+        aa = stablestorage_get_record(iid);
         
         //If a value was accepted, send accept_ack
         if(aa != NULL && aa->value_size > 0) {
             sendbuf_add_accept_ack(to_learners, aa);
         } else {
-            LOG(DBG, ("Cannot retransmit iid:%u no value accepted \n", aa->iid));
+            LOG(DBG, ("Cannot retransmit iid:%lu no value accepted \n", iid));
         }
     }
     //Flush the send buffer if there's something
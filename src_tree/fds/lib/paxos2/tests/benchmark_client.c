@@ -14,9 +14,11 @@ static int start_time;
 static int end_time;
 static int force_exit = 0;
  
-static int delivered_count = 0;
+static iid_t delivered_count = 0;
+static iid_t last_delivered_iid = 0;
 static int submitted_count = 0;
 static int retried_count = 0;
+static int lost_count = 0;
 
 static struct event cl_periodic_event;
 static struct timeval cl_periodic_interval;
@@ -24,6 +26,7 @@ static struct timeval cl_periodic_interval;
 typedef struct client_value_record_t {
     struct timeval creation_time;
     struct timeval expire_time;
+    uint64_t client_seq;
     size_t value_size;
     char value[PAXOS_MAX_VALUE_SIZE];
 } client_value_record;
@@ -39,6 +42,9 @@ int max_val_size = PAXOS_MAX_VALUE_SIZE;
 int duration = 40;
 int print_step = 10;
 int wait_after_init=0;
+int loss_percent = 0;
+int idempotent = 1;
+unsigned int linger_usec = 0;
 struct timeval values_timeout;
 
 //Latency statistics
@@ -62,6 +68,9 @@ void pusage() {
     printf("\t-p N : print submit count every N values\n");
     printf("\t-s N : saves a latency sample every N values sent\n");
     printf("\t-w N : after initialization is completed, wait N seconds before submitting\n");
+    printf("\t-l N : drops N%% of the values submitted (simulated loss)\n");
+    printf("\t-n   : resubmits timed-out values as new ones (not idempotent)\n");
+    printf("\t-b N : batches the values submitted for up to N microseconds (e.g. %d)\n", SUBMIT_BATCH_LINGER);
     printf("\t-h   : prints this message\n");    
 }
 
@@ -73,7 +82,7 @@ void handle_cltr_c (int sig) {
 void parse_args(int argc, char * const argv[]) {
 
     int c;
-    while((c = getopt(argc, argv, "c:m:M:d:t:p:s:w:h")) != -1) {
+    while((c = getopt(argc, argv, "c:m:M:d:t:p:s:w:l:nb:h")) != -1) {
         switch(c) {
             case 'c': {
                 concurrent_values = atoi(optarg);
@@ -116,6 +125,21 @@ void parse_args(int argc, char * const argv[]) {
             }
             break;
 
+            case 'l': {
+                loss_percent = atoi(optarg);
+            }
+            break;
+
+            case 'n': {
+                idempotent = 0;
+            }
+            break;
+
+            case 'b': {
+                linger_usec = atoi(optarg);
+            }
+            break;
+
             
             case 'h':
             default: {
@@ -136,6 +160,9 @@ print_benchmark_parameters () {
     printf("max_val_size set to: %d\n", max_val_size);
     printf("duration set to: %d\n", duration);
     printf("Initial submission delay set to: %d\n", wait_after_init);   
+    printf("Simulated loss set to: %d%%\n", loss_percent);
+    printf("Idempotent resubmission: %s\n", (idempotent ? "yes" : "no"));
+    printf("Submit batching linger set to: %u usec\n", linger_usec);
 }
 
 static void 
@@ -221,6 +248,17 @@ save_latency_info (client_value_record * cvr, struct timeval * curr_time) {
     }
 }
 
+//Sends the value to proposers and returns immediately, 
+// unless it's dropped to simulate a lossy network
+static void 
+send_value(client_value_record * cvr) {
+    if(loss_percent > 0 && (random() % 100) < loss_percent) {
+        lost_count += 1;
+        return;
+    }
+    pax_submit_idempotent(psh, cvr->client_seq, cvr->value, cvr->value_size);
+}
+
 static void 
 submit_old_value(client_value_record * cvr) {
     retried_count += 1;
@@ -232,8 +270,13 @@ submit_old_value(client_value_record * cvr) {
     gettimeofday(&time_now, NULL);
     sum_timevals(&cvr->expire_time, &time_now, &values_timeout);
     
-    //Send the value to proposers and return immediately
-    pax_submit_nonblock(psh, cvr->value, cvr->value_size);
+    //Same sequence number, delivered once even if 
+    // the previous submission was not lost
+    if(!idempotent) {
+        pax_submit_done(psh, cvr->client_seq);
+        cvr->client_seq = pax_submit_new_seq(psh);
+    }
+    send_value(cvr);
 }
 
 size_t random_value_gen(char * buf) {
@@ -266,8 +309,8 @@ submit_new_value(client_value_record * cvr) {
     //Set expiration as creation+timeout
     sum_timevals(&cvr->expire_time, &cvr->creation_time, &values_timeout);
     
-    //Send the value to proposers and return immediately
-    pax_submit_nonblock(psh, cvr->value, cvr->value_size);
+    cvr->client_seq = pax_submit_new_seq(psh);
+    send_value(cvr);
     
 }
 
@@ -318,7 +361,14 @@ cl_periodic_timeout_check(int fd, short event, void *arg) {
 //Before learner init returns
 int cl_init() {
     
-    psh = pax_submit_handle_init();
+    //The handle keeps at most that many values outstanding
+    if(concurrent_values > SUBMIT_SESSION_WINDOW) {
+        printf("Client init failed [at most %d concurrent values]\n", SUBMIT_SESSION_WINDOW);
+        return -1;
+    }
+    
+    //Values are only submitted from this thread, batching is safe
+    psh = pax_submit_handle_init_linger(linger_usec);
     if (psh == NULL) {
         printf("Client init failed [submit handle]\n");
         return -1;        
@@ -343,6 +393,7 @@ int cl_init() {
     
     //And set a timeout to check expired ones,
     evtimer_set(&cl_periodic_event, cl_periodic_timeout_check, NULL);    
+    event_base_set(learner_get_event_base(), &cl_periodic_event);
     set_timeout_check();
     
     return 0;
@@ -350,8 +401,10 @@ int cl_init() {
 
 void cl_deliver(char* value, size_t val_size, iid_t iid, ballot_t ballot, int proposer) {
 
+    //Instances deciding a duplicate are skipped
     delivered_count += 1;
-    assert((int)iid == delivered_count);
+    assert(iid > last_delivered_iid);
+    last_delivered_iid = iid;
     
     struct timeval time_now;
     gettimeofday(&time_now, NULL);
@@ -365,6 +418,7 @@ void cl_deliver(char* value, size_t val_size, iid_t iid, ballot_t ballot, int pr
                 memcmp(value, iter->value, val_size) == 0) {
             //Our value, submit a new one!
             save_latency_info(iter, &time_now);
+            pax_submit_done(psh, iter->client_seq);
             submit_new_value(iter);
             break;
         }    
@@ -413,11 +467,15 @@ int main (int argc, char const *argv[]) {
         sleep(1);
     }    
     
-    printf("Total delivered:%u\n", delivered_count);
+    printf("Total delivered:%lu\n", delivered_count);
     printf("\tRate:%f\n", ((float)delivered_count/duration));
     printf("Total submitted:%u\n", submitted_count);
     printf("\tRate:%f\n", ((float)submitted_count/duration));
     printf("Timed-out values:%u\n", retried_count);
+    printf("Lost values (simulated):%u\n", lost_count);
+    //Instances not delivered decided a value twice
+    printf("Instances used:%lu\n", last_delivered_iid);
+    printf("\tWasted on duplicates:%lu\n", (last_delivered_iid - delivered_count));
 
     double min_lat_ms = ((double)min_latency.tv_sec * 1000) +
         ((double)min_latency.tv_usec / 1000);
@@ -1,8 +1,13 @@
 //This is a very simple failure detector
 //Which has the responsibility to elect a leader among the proposer
-//In this case alive_ping messages received are ignored (just printed)
-//The leader is by default 0 and can be changed via prompt
+//The leader is by default 0, it is replaced as soon as it is suspected
+// (no alive_ping for ORACLE_SUSPECT_TIMEOUT, or one very late w.r.t. the
+// previous ones, see ORACLE_PHI_THRESHOLD in paxos_config.h)
+// by the proposer with the lowest id that is not suspected.
+//The leader can also be forced via prompt
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include <unistd.h>
 #include <sys/time.h>
 #include <pthread.h>
@@ -19,6 +24,24 @@ pthread_mutex_t oracle_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_t announce_thread;
 pthread_t user_input_thread;
 pthread_t get_pings_thread;
+pthread_t monitor_thread;
+
+//Intervals (in milliseconds) between the last alive_ping of each proposer
+#define PING_HISTORY_SIZE 100
+typedef struct proposer_pings_t {
+    int heard;
+    struct timeval last_ping;
+    long unsigned last_seq;
+    double intervals[PING_HISTORY_SIZE];
+    int count;
+    int next;
+    double sum;
+    double sum_squares;
+} proposer_pings;
+
+proposer_pings pings[MAX_N_OF_PROPOSERS];
+//Proposers never heard are not suspected before this
+struct timeval startup_deadline;
 
 void oracle_lock() {
     pthread_mutex_lock(&oracle_mutex);
@@ -28,38 +51,142 @@ void oracle_unlock() {
     pthread_mutex_unlock(&oracle_mutex);
 }
 
+double msec_between(struct timeval * from, struct timeval * to) {
+    return ((to->tv_sec - from->tv_sec) * 1000.0) + 
+        ((to->tv_usec - from->tv_usec) / 1000.0);
+}
+
 void init_oracle_state() {
     //Initialize state
+    memset(pings, 0, sizeof(pings));
+    gettimeofday(&startup_deadline, NULL);
+    startup_deadline.tv_sec += (ORACLE_SUSPECT_TIMEOUT / 1000000);
+    startup_deadline.tv_usec += (ORACLE_SUSPECT_TIMEOUT % 1000000);
+    if(startup_deadline.tv_usec >= 1000000) {
+        startup_deadline.tv_sec += 1;
+        startup_deadline.tv_usec -= 1000000;
+    }
 }
+
 void update_oracle_state(short int proposer_id, long unsigned int seq_num, struct timeval * current_time) {
-    current_time = current_time;
-    printf("Got a ping n:%lu from proposer %d \n", seq_num, proposer_id);
-    // short int new_leader;
-    //...update rules here...
+    if(proposer_id < 0 || proposer_id >= MAX_N_OF_PROPOSERS) {
+        printf("Ping from invalid proposer %d\n", proposer_id);
+        return;
+    }
     
-    //Lock before updating current_leader!
-    // oracle_lock();
-    // current_leader = new_leader;
-    // oracle_unlock();
+    oracle_lock();
+    proposer_pings * pp = &pings[proposer_id];
+    if(!pp->heard) {
+        printf("Proposer %d is alive\n", proposer_id);
+    } else {
+        double interval = msec_between(&pp->last_ping, current_time);
+        if(pp->count == PING_HISTORY_SIZE) {
+            double oldest = pp->intervals[pp->next];
+            pp->sum -= oldest;
+            pp->sum_squares -= (oldest * oldest);
+        } else {
+            pp->count += 1;
+        }
+        pp->intervals[pp->next] = interval;
+        pp->next = (pp->next + 1) % PING_HISTORY_SIZE;
+        pp->sum += interval;
+        pp->sum_squares += (interval * interval);
+    }
+    pp->heard = 1;
+    pp->last_ping = *current_time;
+    pp->last_seq = seq_num;
+    oracle_unlock();
+}
+
+//-log10 of the probability that the next ping is just late
+// (normal distribution of the intervals, logistic approximation)
+//Must hold the lock
+double get_phi(proposer_pings * pp, struct timeval * now) {
+    double mean = (FAILURE_DETECTOR_PING_INTERVAL / 1000.0);
+    double stddev = 0;
+    if(pp->count > 0) {
+        mean = pp->sum / pp->count;
+        double variance = (pp->sum_squares / pp->count) - (mean * mean);
+        stddev = (variance > 0 ? sqrt(variance) : 0);
+    }
+    //Pings are very regular on an idle network,
+    // do not suspect a proposer for a slightly late one
+    if(stddev < mean / 2) {
+        stddev = mean / 2;
+    }
+    
+    double elapsed = msec_between(&pp->last_ping, now);
+    double y = (elapsed - mean) / stddev;
+    double e = exp(-y * (1.5976 + 0.070566 * y * y));
+    if(elapsed > mean) {
+        return -log10(e / (1.0 + e));
+    } else {
+        return -log10(1.0 - 1.0 / (1.0 + e));
+    }
+}
+
+//Must hold the lock
+int is_suspected(short int proposer_id, struct timeval * now) {
+    proposer_pings * pp = &pings[proposer_id];
+    if(!pp->heard) {
+        return (msec_between(&startup_deadline, now) > 0);
+    }
+    if(msec_between(&pp->last_ping, now) > (ORACLE_SUSPECT_TIMEOUT / 1000.0)) {
+        return 1;
+    }
+    return (get_phi(pp, now) > ORACLE_PHI_THRESHOLD);
+}
+
+//The current leader until it is suspected, then the
+// lowest proposer alive (if any). Must hold the lock
+short int elect_leader(struct timeval * now) {
+    if(!is_suspected(current_leader, now)) {
+        return current_leader;
+    }
+    short int i;
+    for(i = 0; i < MAX_N_OF_PROPOSERS; i++) {
+        if(pings[i].heard && !is_suspected(i, now)) {
+            return i;
+        }
+    }
+    return current_leader;
 }
 
 void * broadcast_current_leader(void * arg) {
     arg = arg;
     while(1) {
-        //Get current leader
+        //Send the current leader
         oracle_lock();
-        short int leader = current_leader;        
+        sendbuf_send_leader_announce(to_proposers, current_leader);
         oracle_unlock();
         
-        //Send it
-        sendbuf_send_leader_announce(to_proposers, leader);
-        
         //Sleep for a while
         sleep(announce_interval);
     }
     return NULL;
 }
 
+void * monitor_proposers(void * arg) {
+    arg = arg;
+    struct timeval current_time;
+    while(1) {
+        usleep(FAILURE_DETECTOR_PING_INTERVAL / 4);
+        
+        oracle_lock();
+        gettimeofday(&current_time, NULL);
+        short int leader = elect_leader(&current_time);
+        if(leader != current_leader) {
+            printf("Proposer %d is suspected, leader is now proposer %d\n", 
+                current_leader, leader);
+            current_leader = leader;
+            //Announce it right away
+            sendbuf_send_leader_announce(to_proposers, current_leader);
+        }
+        oracle_unlock();
+    }
+    return NULL;
+}
+
 void * get_proposer_pings(void * arg) {
     arg = arg;
     struct timeval current_time;
@@ -119,6 +246,7 @@ void * get_user_input(void * arg) {
 
         printf("Leader is now proposer %d\n", proposer_id);
         current_leader = proposer_id;
+        sendbuf_send_leader_announce(to_proposers, current_leader);
         
         oracle_unlock();
     }
@@ -147,13 +275,15 @@ int main (int argc, char const *argv[])
     
     oracle_lock();
 
-    // Starts 3 threads sharing a global lock
+    // Starts 4 threads sharing a global lock
     //Thread 1: periodically send current leader
     pthread_create(&announce_thread, NULL, broadcast_current_leader, NULL);
     //Thread 2: Receive alive_ping from proposers
     pthread_create(&get_pings_thread, NULL, get_proposer_pings, NULL);    
     //Thread 3: Ask the user to force a particular leader
     pthread_create(&user_input_thread, NULL, get_user_input, NULL);
+    //Thread 4: Elect a new leader when the current one is suspected
+    pthread_create(&monitor_thread, NULL, monitor_proposers, NULL);
 
     oracle_unlock();
     
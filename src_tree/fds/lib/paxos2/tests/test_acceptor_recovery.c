@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "libpaxos.h"
+#include "libpaxos_priv.h"
+#include "acceptor_stable_storage.h"
+#include "paxos_udp.h"
+
+/*
+    An acceptor accepts a value, crashes and is restarted with 
+    acceptor_init_recover. A new leader then sends a prepare_range_req:
+    the acceptor must list the instance with the value in its 
+    prepare_range_ack, otherwise the leader would skip phase 1 for it
+    and could overwrite a value that may have been chosen.
+    Exits with 0 if the value survives, 1 otherwise.
+*/
+
+#define ACCEPTOR_ID 0
+#define CHOSEN_IID 3
+#define CHOSEN_BALLOT 11
+//Per-instance promise, after the value
+#define PREPARED_IID 5
+#define PREPARED_BALLOT 21
+//Ballot of the new leader
+#define RANGE_BALLOT 121
+
+static char chosen_value[] = "accepted before the crash";
+
+//What the acceptor did before crashing, saved as it would save it
+static int save_and_crash() {
+    char buf[sizeof(accept_req) + sizeof(chosen_value)];
+    accept_req * ar = (accept_req *)buf;
+    prepare_req pr;
+    
+    if(stablestorage_init(ACCEPTOR_ID) != 0) {
+        return -1;
+    }
+    
+    stablestorage_tx_begin();
+    ar->iid = CHOSEN_IID;
+    ar->ballot = CHOSEN_BALLOT;
+    ar->value_size = sizeof(chosen_value);
+    memcpy(ar->value, chosen_value, sizeof(chosen_value));
+    stablestorage_save_accept(ar);
+    
+    pr.iid = PREPARED_IID;
+    pr.ballot = PREPARED_BALLOT;
+    stablestorage_save_prepare(&pr, stablestorage_get_record(PREPARED_IID));
+    stablestorage_tx_end();
+    
+    return stablestorage_shutdown();
+}
+
+//Sends prepare range requests until an ack is received,
+// returns 1 if the chosen instance is listed
+static int prepare_range_lists_chosen() {
+    udp_receiver * from_acceptors = udp_receiver_blocking_new(PAXOS_PROPOSERS_NET);
+    udp_send_buffer * to_acceptors = udp_sendbuf_new(PAXOS_ACCEPTORS_NET);
+    if(from_acceptors == NULL || to_acceptors == NULL) {
+        printf("Network init failed\n");
+        return 0;
+    }
+    
+    struct timeval timeout = {1, 0};
+    setsockopt(from_acceptors->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    
+    int attempt;
+    for(attempt = 0; attempt < 10; attempt++) {
+        sendbuf_send_prepare_range_req(to_acceptors, 0, 1, RANGE_BALLOT);
+        
+        if(udp_read_next_message(from_acceptors) < 0) {
+            continue;
+        }
+        paxos_msg * msg = (paxos_msg*) &from_acceptors->recv_buffer;
+        if(msg->type != prepare_range_acks) {
+            continue;
+        }
+        
+        prepare_range_ack * pra = (prepare_range_ack *)msg->data;
+        if(pra->ballot != RANGE_BALLOT) {
+            continue;
+        }
+        printf("Acceptor %d lists %d instances up to %lu\n", 
+            pra->acceptor_id, pra->count, pra->listed_to);
+        
+        short int i;
+        for(i = 0; i < pra->count; i++) {
+            if(pra->needs_p1[i] == CHOSEN_IID) {
+                return 1;
+            }
+        }
+        return (pra->listed_to < CHOSEN_IID);
+    }
+    printf("No prepare_range_ack received\n");
+    return 0;
+}
+
+int main () {
+    
+    if(save_and_crash() != 0) {
+        printf("Could not save the records before the crash!\n");
+        exit(1);
+    }
+    
+    if(acceptor_init_recover(ACCEPTOR_ID) != 0) {
+        printf("Could not recover the acceptor!\n");
+        exit(1);
+    }
+    
+    int ok = prepare_range_lists_chosen();
+    printf("%s: value of iid %d %s the range prepare\n", (ok ? "OK" : "FAIL"),
+        CHOSEN_IID, (ok ? "survives" : "is lost by"));
+    
+    acceptor_exit();
+    return (ok ? 0 : 1);
+}
@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "libpaxos.h"
+#include "libpaxos_priv.h"
+#include "paxos_udp.h"
+
+/*
+    A sender of the previous wire version (messages built byte by byte
+    in the layouts of version 1) talks to a receiver of the current one:
+    values without tag get one with PAXOS_NO_CLIENT_ID, submit batches
+    get client ids and sequence numbers, malformed messages are dropped.
+    Messages converted back to version 1 (as sent with
+    PAXOS_WIRE_SEND_VERSION) lose the tags.
+    Exits with 0 if all the checks pass, 1 otherwise.
+*/
+
+#define CHECK(C) if(!(C)) { \
+    printf("FAIL: %s (line %d)\n", #C, __LINE__); \
+    exit(1); \
+}
+
+static udp_receiver * receiver;
+static udp_send_buffer * sender;
+
+//Sends the message as it is (without stamping the current version)
+// and returns it once received, NULL if dropped
+static paxos_msg * send_and_receive(char * buf, size_t data_size,
+    paxos_msg_code type, uint8_t version) {
+
+    paxos_msg * m = (paxos_msg *)buf;
+    m->data_size = data_size;
+    m->type = type;
+    m->version = version;
+    int sent = sendto(sender->sock, buf, PAXOS_MSG_SIZE(m), 0,
+        (struct sockaddr *)&sender->addr, sizeof(struct sockaddr_in));
+    CHECK(sent == (int)PAXOS_MSG_SIZE(m));
+
+    if(udp_read_next_message(receiver) != 0) {
+        return NULL;
+    }
+    return (paxos_msg *)receiver->recv_buffer;
+}
+
+//Appends an accept_ack of version 1 (value without tag) to buf
+static size_t add_v1_accept_ack(char * buf, size_t offset, iid_t iid, char * value, uint32_t size) {
+    accept_ack * aa = (accept_ack *)&buf[offset];
+    aa->iid = iid;
+    aa->ballot = 11;
+    aa->value_ballot = 11;
+    aa->is_final = 0;
+    aa->value_size = size;
+    memcpy(aa->value, value, size);
+    return offset + ACCEPT_ACK_SIZE(aa);
+}
+
+static void check_accept_acks() {
+    char buf[MAX_UDP_MSG_SIZE];
+    paxos_msg * m = (paxos_msg *)buf;
+    accept_ack_batch * aab = (accept_ack_batch *)m->data;
+    aab->acceptor_id = 1;
+    aab->count = 2;
+    size_t size = sizeof(accept_ack_batch);
+    size = add_v1_accept_ack(m->data, size, 5, "hello", 5);
+    size = add_v1_accept_ack(m->data, size, 6, NULL, 0);
+
+    paxos_msg * r = send_and_receive(buf, size, accept_acks, 1);
+    CHECK(r != NULL);
+    CHECK(r->version == PAXOS_WIRE_VERSION);
+    CHECK(r->data_size == size + sizeof(paxos_value_tag));
+    accept_ack_batch * r_aab = (accept_ack_batch *)r->data;
+    CHECK(r_aab->acceptor_id == 1 && r_aab->count == 2);
+
+    accept_ack * aa = (accept_ack *)r_aab->data;
+    CHECK(aa->iid == 5 && aa->ballot == 11);
+    CHECK(aa->value_size == sizeof(paxos_value_tag) + 5);
+    paxos_value_tag * tag = (paxos_value_tag *)aa->value;
+    CHECK(tag->client_id == PAXOS_NO_CLIENT_ID && tag->client_seq == PAXOS_NO_CLIENT_SEQ);
+    CHECK(memcmp(tag->value, "hello", 5) == 0);
+
+    //No value, no tag
+    aa = (accept_ack *)&r_aab->data[ACCEPT_ACK_SIZE(aa)];
+    CHECK(aa->iid == 6 && aa->value_size == 0);
+
+    //Value past the end of the message
+    aab->count = 3;
+    CHECK(send_and_receive(buf, size, accept_acks, 1) == NULL);
+}
+
+static void check_submit_batch() {
+    char buf[MAX_UDP_MSG_SIZE];
+    paxos_msg * m = (paxos_msg *)buf;
+
+    //Version 1: count, then (value_size, value) for each entry
+    uint16_t count = 2, size_1 = 2, size_2 = 3;
+    size_t size = 0;
+    memcpy(&m->data[size], &count, 2);
+    size += 2;
+    memcpy(&m->data[size], &size_1, 2);
+    memcpy(&m->data[size + 2], "ab", 2);
+    size += 4;
+    memcpy(&m->data[size], &size_2, 2);
+    memcpy(&m->data[size + 2], "cde", 3);
+    size += 5;
+
+    paxos_msg * r = send_and_receive(buf, size, submit_batch, 1);
+    CHECK(r != NULL);
+    submit_batch_msg * sbm = (submit_batch_msg *)r->data;
+    CHECK(sbm->client_id == PAXOS_NO_CLIENT_ID && sbm->count == 2);
+    submit_batch_entry * sbe = (submit_batch_entry *)sbm->data;
+    CHECK(sbe->client_seq == PAXOS_NO_CLIENT_SEQ && sbe->value_size == 2);
+    CHECK(memcmp(sbe->value, "ab", 2) == 0);
+    sbe = (submit_batch_entry *)&sbm->data[SUBMIT_BATCH_ENTRY_SIZE(sbe)];
+    CHECK(sbe->client_seq == PAXOS_NO_CLIENT_SEQ && sbe->value_size == 3);
+    CHECK(memcmp(sbe->value, "cde", 3) == 0);
+    CHECK(r->data_size == sizeof(submit_batch_msg) + 2 * sizeof(submit_batch_entry) + 5);
+
+    //Entries do not add up to the message size
+    CHECK(send_and_receive(buf, size - 1, submit_batch, 1) == NULL);
+}
+
+static void check_downgrade() {
+    char value[sizeof(paxos_value_tag) + 5];
+    paxos_value_tag * tag = (paxos_value_tag *)value;
+    tag->client_id = 7;
+    tag->client_seq = 8;
+    memcpy(tag->value, "hello", 5);
+
+    sendbuf_clear(sender, accept_reqs, 0);
+    sendbuf_add_accept_req(sender, 5, 11, value, sizeof(value));
+    sendbuf_add_accept_req(sender, 6, 11, value, 0);
+    paxos_msg * m = (paxos_msg *)sender->buffer;
+
+    char buf[MAX_UDP_MSG_SIZE];
+    paxos_msg * old = (paxos_msg *)buf;
+    CHECK(paxos_wire_downgrade(m, old) == 0);
+    CHECK(old->version == PAXOS_WIRE_MIN_VERSION);
+    CHECK(old->data_size == m->data_size - sizeof(paxos_value_tag));
+    accept_req * ar = (accept_req *)((accept_req_batch *)old->data)->data;
+    CHECK(ar->iid == 5 && ar->value_size == 5);
+    CHECK(memcmp(ar->value, "hello", 5) == 0);
+
+    //And back, the tag is lost
+    paxos_msg * r = send_and_receive(buf, old->data_size, accept_reqs, 1);
+    CHECK(r != NULL);
+    CHECK(r->data_size == m->data_size);
+    ar = (accept_req *)((accept_req_batch *)r->data)->data;
+    tag = (paxos_value_tag *)ar->value;
+    CHECK(ar->value_size == sizeof(value) && tag->client_id == PAXOS_NO_CLIENT_ID);
+    CHECK(memcmp(tag->value, "hello", 5) == 0);
+
+    //Value shorter than a tag
+    sendbuf_clear(sender, accept_reqs, 0);
+    sendbuf_add_accept_req(sender, 7, 11, value, 4);
+    CHECK(paxos_wire_downgrade(m, old) != 0);
+}
+
+int main () {
+
+    receiver = udp_receiver_blocking_new(PAXOS_LEARNERS_NET);
+    sender = udp_sendbuf_new(PAXOS_LEARNERS_NET);
+    if(receiver == NULL || sender == NULL) {
+        printf("Network init failed\n");
+        exit(1);
+    }
+    struct timeval timeout = {1, 0};
+    setsockopt(receiver->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    check_accept_acks();
+    check_submit_batch();
+    check_downgrade();
+
+    printf("OK: messages of wire version %d are understood\n", PAXOS_WIRE_MIN_VERSION);
+    return 0;
+}
@@ -127,6 +127,7 @@ int my_custom_init() {
     update_check_interval.tv_sec = 1;
     update_check_interval.tv_usec = 0;
     evtimer_set(&update_check_event, periodic_check, NULL);    
+    event_base_set(learner_get_event_base(), &update_check_event);
     event_add(&update_check_event, &update_check_interval);
     
     return 0;
@@ -2,11 +2,13 @@
 #define LP_CONFIG_PARSER_H_FKVUY8M6
 
 #include <sys/time.h>
+#include <stdbool.h>
 
 #include "paxos_config.h"
 
 struct acceptor_info_t;
 typedef struct acceptor_info_t acceptor_info;
+struct event_base;
 struct config_mngr_t;
 typedef struct config_mngr_t config_mngr;
 
@@ -37,10 +39,44 @@ struct timeval * lpconfig_get_retransmit_request_interval(config_mngr * cfg);
 int lpconfig_get_default_autoflush_interval(config_mngr * cfg);
 
 int lpconfig_get_socket_buffers_size(config_mngr * cfg);
+int lpconfig_get_mcast_fec_group_size(config_mngr * cfg);
+int lpconfig_get_udp_offload_segments(config_mngr * cfg);
+int lpconfig_get_udp_io_uring_buffers(config_mngr * cfg);
+//Low latency mode, see enable_low_latency_mode in lp_timers.h
+int lpconfig_get_busy_poll_usec(config_mngr * cfg);
+int lpconfig_get_cpu_core(config_mngr * cfg);
+//Wire version of the messages sent, older than LP_WIRE_VERSION
+// only while upgrading a running ring (see lp_wire.h)
+int lpconfig_get_wire_version(config_mngr * cfg);
+
+//Failure detection and leader election among acceptors, see lp_leader_election.h
+// (disabled unless heartbeat_interval is set, then acceptor 1 is always the leader)
+struct timeval * lpconfig_get_heartbeat_interval(config_mngr * cfg);
+struct timeval * lpconfig_get_failure_detection_timeout(config_mngr * cfg);
+int lpconfig_get_phi_threshold(config_mngr * cfg);
+bool lpconfig_heartbeats_enabled(config_mngr * cfg);
+
+//Leases granted by acceptors to the leader, required to answer
+// read index requests (see learner_read_index in lp_learner.h)
+struct timeval * lpconfig_get_leader_lease_duration(config_mngr * cfg);
+bool lpconfig_leases_enabled(config_mngr * cfg);
+
+//Libevent base where the events of the modules using this configuration
+// are registered (sockets, timers, queues). NULL (the default) is the
+// current base, i.e. the one created by the last event_init
+struct event_base * lpconfig_get_event_base(config_mngr * cfg);
+void lpconfig_set_event_base(config_mngr * cfg, struct event_base * base);
 
 char * lpconfig_get_mcast_addr(config_mngr * cfg);
 int lpconfig_get_mcast_port(config_mngr * cfg);
 
+//Multicast group ordered by this ring and range of volumes it covers
+// (defaults to group 0, all volumes)
+int lpconfig_get_group_id(config_mngr * cfg);
+volume_id_t lpconfig_get_group_first_volume(config_mngr * cfg);
+volume_id_t lpconfig_get_group_last_volume(config_mngr * cfg);
+bool lpconfig_group_has_volume(config_mngr * cfg, volume_id_t volume);
+
 char * lpconfig_get_ring_inbound_addr(config_mngr * cfg);
 int lpconfig_get_ring_inbound_port(config_mngr * cfg);
 
@@ -58,9 +94,11 @@ uint8_t lpconfig_get_incarnation_number(config_mngr * cfg);
 unsigned lpconfig_get_quorum_size(config_mngr * cfg);
 
 int lpconfig_get_working_set_size(config_mngr * cfg);
+int lpconfig_get_delivery_overflow_size(config_mngr * cfg);
 int lpconfig_get_max_active_instances(config_mngr * cfg);
 int lpconfig_get_preexecution_window_size(config_mngr * cfg);
 int lpconfig_get_max_p2_open_per_iteration(config_mngr * cfg);
+int lpconfig_get_adaptive_rate_control(config_mngr * cfg);
 
 int lpconfig_get_max_client_values_queue_size(config_mngr * cfg);
 
@@ -1,3 +1,6 @@
+#ifndef LP_DELIVERY_QUEUE_H_3HUP9YQA
+#define LP_DELIVERY_QUEUE_H_3HUP9YQA
+
 #include <stdlib.h>
 
 #include "paxos_config.h"
@@ -13,11 +16,13 @@ typedef struct delivery_queue_t delivery_queue;
 
 //Action to take when the next value is being delivered
 typedef void(*deliver_callback)(void*, size_t, void*);
-//Action to take when the value for the next command to deliver is unknown
-typedef void(*missing_cmdmap_callback)(iid_t, void*);
-//Action to take when the next command to deliver is unknown, but some future
+//Action to take when the value for the next commands to deliver is unknown
+// (invoked once for each range first...last of consecutive instances)
+typedef void(*missing_cmdmap_callback)(iid_t, iid_t, void*);
+//Action to take when the next commands to deliver are unknown, but some future
 // command is already known (a "gap" is detected)
-typedef void(*missing_acceptance_callback)(iid_t, void*);
+// (invoked once for each range first...last of consecutive instances)
+typedef void(*missing_acceptance_callback)(iid_t, iid_t, void*);
 //Action to take after checking for gaps
 typedef void(*post_check_callback)(void*);
 
@@ -51,3 +56,11 @@ void delivery_queue_handle_acceptance(
 void dq_deliver_loop(delivery_queue * dq);
 
 void dq_delayed_start();
+
+//Number of instances known (mapping or acceptance) but not delivered yet
+unsigned dq_pending_count(delivery_queue * dq);
+
+//All the instances up to this one were delivered to the application
+iid_t dq_get_highest_delivered(delivery_queue * dq);
+
+#endif /* end of include guard: LP_DELIVERY_QUEUE_H_3HUP9YQA */
@@ -0,0 +1,32 @@
+#ifndef LP_EVENT_POOL_H_W8N3JR5T
+#define LP_EVENT_POOL_H_W8N3JR5T
+
+#include <event.h>
+
+//A fixed set of threads, each running its own libevent base.
+//Independent instances (i.e. learners of different groups) are
+// spread over the bases, see learner_init_on_base in lp_learner.h
+// and lpconfig_set_event_base in lp_config_parser.h.
+//Libevent bases are not thread safe: events must be added before
+// event_pool_start or from a callback running in the same base.
+//Instances sharing a base are served by the same thread, 
+// instances on different bases may run concurrently.
+
+struct event_pool_t;
+typedef struct event_pool_t event_pool;
+
+//Creates threads_count bases (threads are not started yet)
+event_pool * event_pool_init(int threads_count);
+
+int event_pool_get_threads_count(event_pool * ep);
+
+//Base of the (index % threads_count)-th thread
+struct event_base * event_pool_get_base(event_pool * ep, int index);
+
+//Starts one thread per base, each thread runs its event loop
+void event_pool_start(event_pool * ep);
+
+//Breaks the event loop of each thread and waits for them to exit
+void event_pool_stop(event_pool * ep);
+
+#endif /* end of include guard: LP_EVENT_POOL_H_W8N3JR5T */
@@ -0,0 +1,36 @@
+#ifndef LP_FAILURE_DETECTION_H_P4T7XK2W
+#define LP_FAILURE_DETECTION_H_P4T7XK2W
+
+#include <stdbool.h>
+#include <sys/time.h>
+
+#include "paxos_config.h"
+#include "lp_config_parser.h"
+
+//Accrual (phi) failure detector for the acceptors.
+//For each acceptor the intervals between the last FD_HISTORY_SIZE
+// heartbeats are remembered, the suspicion level phi grows with the
+// time elapsed since the last heartbeat, relative to the intervals
+// observed so far: phi is -log10 of the probability that the next
+// heartbeat is still on its way (normal distribution of the intervals).
+//An acceptor is suspected if phi is above phi_threshold or if it sent
+// nothing for failure_detection_timeout (see lp_config_parser.h).
+//An acceptor never heard is not suspected until failure_detection_timeout
+// from the creation of the detector (the others may be starting too).
+
+struct failure_detector_t;
+typedef struct failure_detector_t failure_detector;
+
+failure_detector * failure_detector_init(config_mngr * cfg);
+
+//A heartbeat from acceptor was received at time now
+void fd_heartbeat(failure_detector * fd, acceptor_id_t acceptor, struct timeval * now);
+
+//Current suspicion level for acceptor (0 if never heard)
+double fd_get_phi(failure_detector * fd, acceptor_id_t acceptor, struct timeval * now);
+
+bool fd_is_suspected(failure_detector * fd, acceptor_id_t acceptor, struct timeval * now);
+
+void failure_detector_destroy(failure_detector * fd);
+
+#endif /* end of include guard: LP_FAILURE_DETECTION_H_P4T7XK2W */
@@ -0,0 +1,62 @@
+#ifndef LP_GROUPS_H_Q7T2XK4D
+#define LP_GROUPS_H_Q7T2XK4D
+
+#include "paxos_config.h"
+#include "lp_learner.h"
+#include "lp_submit_proxy.h"
+
+//Partitioned multicast: each group is an independent ring (with its own
+// config file, multicast address and instance stream) ordering the commands
+// of a range of volumes (see the 'group' line in example_config.cfg).
+//Learners subscribe only to the groups covering the volumes they host,
+// submitters route each command to the group owning its volume.
+//Order is guaranteed per group, commands of different groups are not ordered.
+
+//Action to take when a value is delivered by some group
+typedef void(*group_deliver_callback)(int group_id, void* value, size_t size, void* arg);
+
+struct group_learner_t;
+typedef struct group_learner_t group_learner;
+
+// Initializes a learner for each group (config file in config_paths)
+// whose volumes overlap with first_volume...last_volume. Groups not
+// overlapping are ignored, their multicast address is never joined.
+// Returns -1 if there are more than MAX_GROUPS config files, if two groups
+// have the same id or overlapping volumes, or if a learner cannot be started
+// (the learners already started keep running, their values are dropped).
+//Warning! this must be called
+// AFTER event_init and BEFORE event_dispatch
+int group_learner_init(
+	const char ** config_paths,
+	int paths_count,
+	volume_id_t first_volume,
+	volume_id_t last_volume,
+	group_deliver_callback dcb,
+	void * cb_arg,
+	group_learner ** gl_ptr);
+
+//Number of groups this learner subscribed to
+int group_learner_get_groups_count(group_learner * gl);
+
+//Learner of the i-th subscribed group
+learner_context * group_learner_get_learner(group_learner * gl, int index);
+
+//Prints statistic of learner events for each subscribed group
+void group_learner_print_eventcounters(group_learner * gl);
+
+struct group_submit_proxy_t;
+typedef struct group_submit_proxy_t group_submit_proxy;
+
+// Initializes a submit proxy for each group (config file in config_paths),
+// returns NULL if there are no config files or more than MAX_GROUPS, or if
+// two groups have the same id or overlapping volumes
+group_submit_proxy * group_submit_proxy_udp_init(const char ** config_paths, int paths_count);
+
+// Submit a value to the group ordering the given volume,
+// returns -1 if no group covers that volume
+int group_submit_command(group_submit_proxy * gsp, volume_id_t volume, submit_cmd_msg * scm);
+
+// Flushes (sends) the pending packet of each group immediately
+void group_submit_proxy_flush_now(group_submit_proxy * gsp);
+
+#endif /* end of include guard: LP_GROUPS_H_Q7T2XK4D */
@@ -0,0 +1,52 @@
+#ifndef LP_LEADER_ELECTION_H_C6R2MW9J
+#define LP_LEADER_ELECTION_H_C6R2MW9J
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "paxos_config.h"
+#include "lp_config_parser.h"
+#include "ringpaxos_messages.h"
+
+//Leader election among the acceptors (only if heartbeat_interval is set).
+//Every heartbeat_interval each acceptor sends a heartbeat to all the others,
+// on their ring port. The leader is the first candidate that is not suspected
+// by the failure detector (see lp_failure_detection.h), this acceptor is 
+// never suspected by itself. Candidates are all the acceptors by increasing id,
+// unless set with leader_election_set_candidates.
+//A crashed leader is replaced within failure_detection_timeout plus one
+// heartbeat_interval, once all acceptors suspect it they agree on the new one.
+//Events are registered in the base of cfg (see lpconfig_get_event_base).
+
+struct leader_election_t;
+typedef struct leader_election_t leader_election;
+
+//Invoked when the leader changes or some acceptor 
+// becomes suspected (or is trusted again)
+typedef void(*election_change_callback)(void * arg);
+
+//Starts sending heartbeats, the calling process must be acceptor
+// self_acceptor_id of cfg
+leader_election *
+leader_election_init(
+    election_change_callback cb, /*Called when the leader or suspects change (optional)*/
+    void * cb_arg,
+    config_mngr * cfg
+    );
+
+//Must be invoked for each heartbeat received on the ring port
+void leader_election_handle_heartbeat(leader_election * le, heartbeat_msg * msg, size_t size);
+
+acceptor_id_t leader_election_get_leader(leader_election * le);
+
+//Acceptors that can be leader, in order of preference
+// (the callback is invoked if the leader changes)
+void leader_election_set_candidates(leader_election * le, acceptor_id_t * candidates, int count);
+
+//Whether acceptor was suspected at the last check (never for this acceptor)
+bool leader_election_is_suspected(leader_election * le, acceptor_id_t acceptor);
+
+//Number of times the leader changed since init
+long unsigned leader_election_get_changes_count(leader_election * le);
+
+#endif /* end of include guard: LP_LEADER_ELECTION_H_C6R2MW9J */
@@ -1,3 +1,6 @@
+#ifndef LP_LEARNER_H_M5R0DV6E
+#define LP_LEARNER_H_M5R0DV6E
+
 #include "lp_delivery_queue.h"
 #include "lp_topology.h"
 
@@ -13,11 +16,32 @@ typedef void(*custom_init_func)(void*);
 // AFTER event_init and BEFORE event_dispatch
 int learner_init(const char * config_file_path, custom_init_func cust_init, deliver_callback dcb, void * cb_arg, learner_context ** learner_ptr);
 
+// Same as learner_init, but the learner events are registered in base
+// (e.g. one from lp_event_pool.h), so that multiple learners can run
+// independently in the same process. NULL is the current libevent base
+int learner_init_on_base(struct event_base * base, const char * config_file_path, custom_init_func cust_init, deliver_callback dcb, void * cb_arg, learner_context ** learner_ptr);
+
 //Prints statistic of learner events
 //i.e. message loss, retransmission requests, etc
 void learner_print_eventcounters(learner_context * l);
 
 void learner_delayed_start(learner_context * l);
 
+//Invoked when a read can be served from the local state: every value
+// decided before learner_read_index was called has been delivered.
+//If success is false the leader holds no valid lease (see leader_lease_duration
+// in example_config.cfg), the read must go through Paxos instead 
+// (i.e. by submitting a no-op and waiting for its delivery)
+typedef void(*read_ready_callback)(bool success, void * arg);
+
+//Linearizable read without a consensus round: asks the leader for its read index
+// (all reads issued while a request is in flight share the next one) and
+// invokes cb once this learner delivered up to it. Callbacks are invoked in order.
+//Returns -1 (cb is never invoked) if MAX_PENDING_READS reads are already
+// waiting, the read must go through Paxos or be issued again later.
+int learner_read_index(learner_context * l, read_ready_callback cb, void * arg);
+
 topolo_mngr * learner_get_topolo_mngr(learner_context * l);
-config_mngr * learner_get_config_mngr(learner_context * l);
\ No newline at end of file
+config_mngr * learner_get_config_mngr(learner_context * l);
+
+#endif /* end of include guard: LP_LEARNER_H_M5R0DV6E */
@@ -35,6 +35,15 @@ mcaster_storage_mngr * mcaster_storage_init(config_mngr * cfg, clival_mngr * cvm
 // Retrieve current informations about some instance
 mcaster_instance_record * mcaster_storage_get(mcaster_storage_mngr * msm, iid_t instance_number);
 
+// Lowest instance still in the storage, when instances
+// up to highest_iid were opened
+iid_t mcaster_storage_lowest_iid(mcaster_storage_mngr * msm, iid_t highest_iid);
+
+// Forgets all the instances (their values are freed), for a leader that
+// is promoted again after another one ran. Keys assigned afterwards are
+// still different from the ones assigned before.
+void mcaster_storage_reset(mcaster_storage_mngr * msm);
+
 // Assign a client value to some instance
 // The leader will try to deliver that value in that instance
 // (unless forced by the protocol to do otherwise)
@@ -52,3 +61,10 @@ void mcaster_storage_replace_assigned_value(
     command_id * cmd_key, 
     void * cmd_value, 
     size_t cmd_size);
+
+// Instance from which a newly elected leader starts, given the highest 
+// instance it promised/accepted as a regular acceptor. All the instances 
+// up to that one were closed by the previous leader, the following ones 
+// may still be open and are still in the acceptors storage 
+// (working_set_size is larger than the instances in progress)
+iid_t mcaster_storage_takeover_iid(config_mngr * cfg, iid_t highest_seen);
@@ -1,28 +1,18 @@
+#ifndef LP_NETWORK_H_Q3HN7T5B
+#define LP_NETWORK_H_Q3HN7T5B
+
 #include "paxos_config.h"
 
 #include "lp_config_parser.h"
+#include "lp_wire.h"
 
 // The following objects take care of sending/receiving network data
 
 #define UDP_STATS //Enable UDP senders/receivers statistics
 
+// Message types, see the schema in lp_wire.h
 typedef enum lp_msg_type_e {
-    // Ring Paxos
-    phase1=1,
-	phase1_range=2,
-    phase2=3,
-    command_map=4,
-    refusal=5,
-    acceptance=6,
-	map_request=7,
-	chosenval_request=8,
-	client_submit=9,
-    
-    /*...*/
-    
-    test1=512,
-    test2=513,
-    test3=514,
+    LP_WIRE_SCHEMA(LP_WIRE_ENUM_ENTRY)
     notype=0
 } lp_msg_type;
 
@@ -30,9 +20,31 @@ typedef enum lp_msg_type_e {
 // (multiple messages can be sent in the same packet)
 typedef struct lp_message_header_t {
     uint16_t size;
-    lp_msg_type type;
+    uint8_t type;       //lp_msg_type
+    uint8_t version;    //LP_WIRE_VERSION of the sender
+    char data[0];
+} LP_WIRE_PACKED lp_message_header;
+
+// Forward error correction (only if enabled for the sender/receiver),
+// handled internally, never delivered to the receiving callback.
+// First message of each protected packet, 
+// the rest of the packet is the original payload.
+// Sequence numbers are only comparable within the same incarnation,
+// it changes when the sender restarts and when packet_seq wraps around
+typedef struct fec_header_msg_t {
+    uint32_t incarnation;
+    uint32_t packet_seq;
+} LP_WIRE_PACKED fec_header_msg;
+
+// Sent after packet_seq first_seq...(first_seq+packets_count-1),
+// data is the XOR of their payloads, size_xor the XOR of their sizes
+typedef struct fec_parity_msg_t {
+    uint32_t incarnation;
+    uint32_t first_seq;
+    uint16_t packets_count;
+    uint16_t size_xor;
     char data[0];
-}lp_message_header;
+} LP_WIRE_PACKED fec_parity_msg;
 
 /*
 UDP Receiver 
@@ -74,8 +86,23 @@ void udp_receiver_set_postread_callback(udp_receiver * ur, receive_cb cb);
 //Invoked after delivering all messages in the packet
 void udp_receiver_set_postdeliver_callback(udp_receiver * ur, receive_cb cb);
 
+//Enables reconstruction of lost packets, group_size must match the sender
+// (done by mcast_receiver_init if mcast_fec_group_size is set)
+void udp_receiver_enable_fec(udp_receiver * ur, int group_size);
+
+//Enables reading multiple coalesced packets at once, if supported by the OS
+// (done by udp_receiver_init if udp_offload_segments is set)
+void udp_receiver_enable_offload(udp_receiver * ur);
+
+//Receives through io_uring with buffers_count pre-registered buffers
+// instead of one read per packet, returns false if not supported
+// (done by udp_receiver_init if udp_io_uring_buffers is set)
+bool udp_receiver_enable_io_uring(udp_receiver * ur, int buffers_count);
+
 //Prints bandwidth statistics for this receiver
 void udp_receiver_print_stats(udp_receiver * ur, int current_time);
+//Number of read system calls performed by this receiver
+long unsigned udp_receiver_get_syscalls(udp_receiver * ur);
 
 
 /*
@@ -100,6 +127,10 @@ mcast_sender_init(
     config_mngr * cfg
     );
 
+//Sends to a different address from now on (i.e. after a topology change),
+// pending packets are flushed to the old one first. Returns false on error
+bool udp_sender_reconnect(udp_sender * us, char * addr_str, int port);
+
 //Buffered send, appends the message to the current packet
 //If it does not fit, the current packet is flushed.
 void net_send_udp(udp_sender * us, void * data, int size, lp_msg_type type);
@@ -110,8 +141,23 @@ void udp_sender_enable_autoflush(udp_sender * us, unsigned milliseconds);
 //Enable automatic flushing with interval defined in the configuration file
 void udp_sender_enable_default_autoflush(udp_sender * us);
 
+//Sends a parity packet after every group_size packets
+// (done by mcast_sender_init if mcast_fec_group_size is set)
+void udp_sender_enable_fec(udp_sender * us, int group_size);
+
+//Passes up to max_segments full packets at once to the OS, if supported
+// (done by udp_sender_init if udp_offload_segments is set)
+void udp_sender_enable_offload(udp_sender * us, int max_segments);
+
+//Queues packets in buffers_count io_uring buffers, submitted together
+// once per event loop iteration, returns false if not supported
+// (done by udp_sender_init if udp_io_uring_buffers is set)
+bool udp_sender_enable_io_uring(udp_sender * us, int buffers_count);
+
 //Prints bandwidth statistics for this sender
 void udp_sender_print_stats(udp_sender * us, int current_time);
+//Number of send system calls performed by this sender
+long unsigned udp_sender_get_syscalls(udp_sender * us);
 
 /*
 TCP Client
@@ -133,3 +179,5 @@ TCP Client
 /*
 TCP Server
 */
+
+#endif /* end of include guard: LP_NETWORK_H_Q3HN7T5B */
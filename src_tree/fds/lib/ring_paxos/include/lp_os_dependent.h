@@ -29,6 +29,12 @@ at the moment, only Linux and Apple OS X are supported.
 
 #endif
 
+#include <stdbool.h>
+
 int get_os_max_wbuf_size();
 int get_os_max_rbuf_size();
 
+//Binds the calling thread to the given CPU core,
+// returns false if not possible/supported
+bool set_cpu_affinity(int core);
+
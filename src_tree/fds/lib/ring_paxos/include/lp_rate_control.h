@@ -0,0 +1,34 @@
+#ifndef LP_RATE_CONTROL_H_P4XW2R9K
+#define LP_RATE_CONTROL_H_P4XW2R9K
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "lp_config_parser.h"
+
+// Rate of the multicaster: max number of instances opened at each clock
+// tick, between 1 and max_p2_open_per_iteration. If adaptive_rate_control
+// is set, it is halved when a learner reports congestion (at most once per
+// retransmit_request_interval), and increased by one at each clock tick
+// otherwise. If not set, it stays at max_p2_open_per_iteration.
+
+typedef struct rate_control_t {
+	config_mngr * cfg;
+	unsigned limit;
+	//No change to the limit until this deadline (after a decrease)
+	struct timeval hold_timeout;
+} rate_control;
+
+//Starts at the maximum rate
+void rate_control_init(rate_control * rc, config_mngr * cfg);
+
+//A learner missed missing_count messages and has pending_count 
+// instances not delivered yet, returns true if the limit was decreased
+bool rate_control_on_feedback(rate_control * rc, uint32_t missing_count, 
+	uint32_t pending_count, struct timeval * now);
+
+//Clock tick of the multicaster, returns true if the limit was increased
+bool rate_control_on_tick(rate_control * rc, struct timeval * now);
+
+#endif /* end of include guard: LP_RATE_CONTROL_H_P4XW2R9K */
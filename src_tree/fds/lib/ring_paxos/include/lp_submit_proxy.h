@@ -1,10 +1,15 @@
+#ifndef LP_SUBMIT_PROXY_H_8ZC3WJ1N
+#define LP_SUBMIT_PROXY_H_8ZC3WJ1N
+
+#include "lp_config_parser.h"
+#include "ringpaxos_messages.h"
 
 // This object can be used by applications willing to submit values through Paxos
 
 typedef struct submit_cmd_msg_t {
-	size_t cmd_size;
-	void * cmd_value[0];
-} submit_cmd_msg;
+	uint32_t cmd_size;
+	char cmd_value[0];
+} LP_WIRE_PACKED submit_cmd_msg;
 #define SUBMIT_CMD_MSG_SIZE(M) (sizeof(submit_cmd_msg) + M->cmd_size)
 
 typedef struct submit_proxy_t submit_proxy;
@@ -19,3 +24,12 @@ void submit_command(submit_proxy * sp, submit_cmd_msg * scm);
 // Normally the proxy tries to batch multiple values into a single packet
 // this call forces to flush (send) the packet immediately
 void submit_proxy_flush_now(submit_proxy * sp);
+
+// Configuration of the ring this proxy submits to
+config_mngr * submit_proxy_get_config_mngr(submit_proxy * sp);
+
+// Values are sent to the current leader, applications that receive
+// topology messages (i.e. also learners) pass them here to follow leader changes
+void submit_proxy_handle_topology_msg(submit_proxy * sp, topology_msg * msg, size_t size);
+
+#endif /* end of include guard: LP_SUBMIT_PROXY_H_8ZC3WJ1N */
@@ -2,6 +2,8 @@
 #include <sys/time.h>
 #include <event.h>
 
+#include "lp_config_parser.h"
+
 // Timer utilities on top of libevent
 
 struct periodic_event_t; 
@@ -17,9 +19,34 @@ set_periodic_event(
     void* arg /*Argument passed to above function*/
     );
 
+//Same as above, the event is registered in base
+// (NULL is the current libevent base)
+periodic_event *  
+set_periodic_event_on_base(
+    struct event_base * base,
+    struct timeval * interval,
+    periodic_event_callback cb,
+    void* arg
+    );
+
+//Binds an event to base, must be called after event_set
+// and before event_add. NULL leaves it in the current base
+void event_bind_base(struct event_base * base, struct event * ev);
+
 //Timeval arithmetics, sets the deadline for a timer
 // based on current time + timeout time
 void timer_set_timeout(struct timeval * current_time, struct timeval * variable, struct timeval * interval);
 
 // Checks wether some timeout has expired
 bool timer_is_expired(struct timeval * deadline_time, struct timeval * curr_time);
+
+//The event loop never sleeps: a timer that expires immediately 
+// is always pending, so libevent keeps polling without blocking
+// (base NULL is the current libevent base)
+void enable_busy_poll(struct event_base * base);
+
+//Pins the calling thread to cpu_core and enables busy polling
+// if busy_poll_usec is set in the configuration (both optional)
+//Warning! this must be called
+// AFTER event_init and BEFORE event_dispatch
+void enable_low_latency_mode(config_mngr * cfg);
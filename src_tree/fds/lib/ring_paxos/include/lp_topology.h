@@ -5,9 +5,17 @@
 
 #include "paxos_config.h"
 #include "lp_config_parser.h"
+#include "lp_network.h"
+#include "ringpaxos_messages.h"
 
-//This part is stubbed and not completely implemented yet
-// This object is responsible of maintaining the current topology for the ring
+// This object is responsible of maintaining the current topology for the ring:
+// the acceptors that are members of the ring, their order and the leader.
+// Initially all the acceptors in the configuration are members,
+// by increasing id, and the leader is acceptor 1.
+// The topology can be changed at runtime by any process (see the
+// reconfiguration calls below), the new one is sent to all acceptors and
+// multicast by the leader to learners. Each change has a new version number,
+// older versions received later are ignored.
 
 // Description of the current topology
 struct topology_info_t;
@@ -16,6 +24,8 @@ typedef struct topology_info_t topology_info;
 struct topolo_mngr_t;
 typedef struct topolo_mngr_t topolo_mngr;
 
+// Invoked when the topology changes: members, order, leader or,
+// if heartbeats are enabled, the acceptors suspected to be crashed
 typedef void(*topo_change_callback)(topology_info*, void*);
 
 int topology_mngr_init(
@@ -26,12 +36,23 @@ int topology_mngr_init(
     );
 
 // Get the name of successor in the ring
+// (acceptors suspected to be crashed are skipped)
 acceptor_id_t lptopo_get_successor_id(topolo_mngr * tm);
 
 // Get address and port number of successor in the ring
 char * lptopo_get_successor_addr(topolo_mngr * tm);
 int lptopo_get_successor_port(topolo_mngr * tm);
 
+// Get the current Paxos leader: the preferred one (see lptopo_set_leader)
+// unless heartbeats are enabled and it is suspected, then the first
+// member after it in ring order that is not (see lp_leader_election.h).
+// Only acceptors take part in the election, other processes learn
+// the leader from the topology multicast by it
+acceptor_id_t lptopo_get_leader_id(topolo_mngr * tm);
+
+// The member after the leader, it receives phase 2 first
+acceptor_id_t lptopo_get_first_in_ring_id(topolo_mngr * tm);
+
 // Get the address and port of Paxos leader
 char * lptopo_get_leader_addr(topolo_mngr * tm);
 int lptopo_get_leader_ring_port(topolo_mngr * tm);
@@ -40,5 +61,33 @@ int lptopo_get_leader_ring_port(topolo_mngr * tm);
 // and retransmission requests
 int lptopo_get_leader_clients_port(topolo_mngr * tm);
 
+// Members of the ring, position 0...(ring_size-1) in ring order
+uint32_t lptopo_get_version(topolo_mngr * tm);
+int lptopo_get_ring_size(topolo_mngr * tm);
+acceptor_id_t lptopo_get_ring_member(topolo_mngr * tm, int position);
+bool lptopo_is_member(topolo_mngr * tm, acceptor_id_t acceptor);
+
+// Reconfiguration: each call creates a new version of the topology,
+// sends it to all the acceptors (the current members and the new ones)
+// and applies it locally. They return -1 if the result is not valid
+// (i.e. acceptor not in the configuration, less members than quorum_size)
+
+// Adds an acceptor at position (-1 is the end of the ring)
+int lptopo_add_acceptor(topolo_mngr * tm, acceptor_id_t acceptor, int position);
+// Removes an acceptor, if it is the preferred leader the next member takes its role
+int lptopo_remove_acceptor(topolo_mngr * tm, acceptor_id_t acceptor);
+// Replaces the members and their order
+int lptopo_set_ring_order(topolo_mngr * tm, acceptor_id_t * members, int count);
+// Moves the leader/multicaster role to some other member
+int lptopo_set_leader(topolo_mngr * tm, acceptor_id_t acceptor);
+
+// Acceptors must pass here every heartbeat received on the ring port
+void lptopo_handle_heartbeat(topolo_mngr * tm, heartbeat_msg * msg, size_t size);
+
+// Every topology message received must be passed here
+void lptopo_handle_topology_msg(topolo_mngr * tm, topology_msg * msg, size_t size);
+
+// Sends the current topology through us (i.e. from the leader to learners)
+void lptopo_send_topology(topolo_mngr * tm, udp_sender * us);
 
 #endif /* end of include guard: LP_TOPOLOGY_H_9RRA6C3S */
@@ -0,0 +1,48 @@
+#ifndef LP_URING_H_M3V8QZ2C
+#define LP_URING_H_M3V8QZ2C
+
+#include <stdbool.h>
+
+//Minimal io_uring engine (Linux only) used by the UDP sockets
+// when udp_io_uring_buffers is set, see network_udp.c.
+//Each socket has its own ring. The ring file descriptor becomes
+// readable when completions are available, so it can be watched
+// by libevent like a normal socket.
+
+struct uring_t;
+typedef struct uring_t uring;
+
+//Invoked for each datagram received, the buffer is reused after it returns
+typedef void(*uring_datagram_cb)(char * buf, int size, void * arg);
+
+//Creates a ring that keeps a multishot receive armed on sock,
+// using buffers_count (power of 2) pre-registered buffers of buffer_size.
+// Returns NULL if io_uring (or multishot receive) is not supported
+uring * uring_recv_init(int sock, int buffers_count, int buffer_size);
+
+//Invokes cb for each datagram received so far, returns how many
+int uring_recv_dispatch(uring * u, uring_datagram_cb cb, void * arg);
+
+//Creates a ring for sending from sock (connected) using
+// buffers_count buffers of buffer_size.
+// Returns NULL if io_uring is not supported
+uring * uring_send_init(int sock, int buffers_count, int buffer_size);
+
+//Returns a free buffer to fill, waits for a previous send
+// to complete if all buffers are in use
+char * uring_send_get_buffer(uring * u);
+
+//Queues a send of the buffer (obtained from uring_send_get_buffer),
+// the buffer cannot be used after this call
+void uring_send_queue(uring * u, char * buf, int size);
+
+//Submits all sends queued with a single system call
+void uring_submit(uring * u);
+
+//File descriptor to watch for completions
+int uring_get_fd(uring * u);
+
+//Number of system calls made by this ring
+long unsigned uring_get_syscalls(uring * u);
+
+#endif /* end of include guard: LP_URING_H_M3V8QZ2C */
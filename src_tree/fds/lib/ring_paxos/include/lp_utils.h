@@ -14,6 +14,7 @@ ballot_t make_first_ballot(acceptor_id_t acc_id, unsigned incarnation);
 ballot_t raise_ballot(ballot_t current_b, ballot_t ballot_to_beat);
 ballot_t increment_ballot(ballot_t b);
 bool is_my_ballot(ballot_t b, acceptor_id_t acc_id, unsigned incarnation);
+acceptor_id_t get_ballot_owner(ballot_t b);
 
 void clear_cmd_key(command_id * cmd_key);
 char * print_cmd_key(command_id * cmd_key, char * str);
@@ -0,0 +1,42 @@
+#ifndef LP_VARINT_H_W6B3MZ8E
+#define LP_VARINT_H_W6B3MZ8E
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "paxos_config.h"
+
+//Variable-length encoding of 64-bit integers (LEB128): 7 bits per byte,
+// least significant group first, the high bit is set if more bytes follow.
+//Values below 2^7 take 1 byte, below 2^14 take 2 bytes, ...
+// and the largest ones VARINT_MAX_SIZE bytes.
+//Used on the wire for instance numbers and command keys, so that
+// messages do not grow with 64-bit identifiers in the common case
+// (small values or small differences between consecutive ones).
+
+#define VARINT_MAX_SIZE 10
+
+//Writes v in buf (at least VARINT_MAX_SIZE bytes free),
+// returns the number of bytes written
+size_t varint_encode(uint64_t v, uint8_t * buf);
+
+//Reads a value from buf (at most len bytes) into v,
+// returns the number of bytes read or 0 if buf does not contain a valid value
+size_t varint_decode(const uint8_t * buf, size_t len, uint64_t * v);
+
+//Number of bytes varint_encode writes for v
+size_t varint_size(uint64_t v);
+
+//Maps signed differences to small unsigned values: 0,-1,1,-2,2... -> 0,1,2,3,4...
+#define ZIGZAG_ENCODE(D) ((((uint64_t)(D)) << 1) ^ (uint64_t)(((int64_t)(D)) >> 63))
+#define ZIGZAG_DECODE(Z) ((int64_t)(((uint64_t)(Z)) >> 1) ^ -((int64_t)((Z) & 1)))
+
+//Sequence of command keys: the multicaster id and incarnation are
+// written as is, the sequence number as difference from the previous
+// key in the sequence (prev, a cleared key for the first one).
+//Consecutive keys of the same multicaster take 3 bytes each.
+#define CMD_KEY_MAX_ENCODED_SIZE (2 + VARINT_MAX_SIZE)
+size_t cmd_key_encode(command_id * key, command_id * prev, uint8_t * buf);
+size_t cmd_key_decode(const uint8_t * buf, size_t len, command_id * prev, command_id * key);
+
+#endif /* end of include guard: LP_VARINT_H_W6B3MZ8E */
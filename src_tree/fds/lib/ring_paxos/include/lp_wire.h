@@ -0,0 +1,89 @@
+#ifndef LP_WIRE_H_D5K2QN7V
+#define LP_WIRE_H_D5K2QN7V
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Wire format of the messages exchanged through the network objects.
+// Each message in a packet starts with a lp_message_header (see lp_network.h),
+// all the structs that travel on the wire are packed and only contain
+// fixed-width fields, in little-endian byte order: the layout does not
+// depend on the compiler and is checked at compile time against the
+// schema below (see wire_schema.c).
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The wire format is little-endian, messages are not converted on this host"
+#endif
+
+#define LP_WIRE_PACKED __attribute__((packed))
+
+// Version written in every message header.
+// Messages of versions older than LP_WIRE_MIN_VERSION are dropped.
+// A version may add message types (skipped by older receivers) and change
+// the layout of existing ones: messages of the previous version are converted
+// when received (see lp_wire_upgrade), and can be sent in the previous layout
+// while a ring is upgraded (see wire_version in example_config.cfg).
+// LP_WIRE_MIN_VERSION is always the previous version, changing a layout
+// requires raising LP_WIRE_VERSION and updating the conversions.
+// Version 2: sender incarnation in fec_header and fec_parity
+// Version 3: compact instance numbers and keys in phase2, command_map, acceptance
+#define LP_WIRE_VERSION 3
+#define LP_WIRE_MIN_VERSION (LP_WIRE_VERSION - 1)
+
+// Messages without a body
+typedef struct lp_no_body_t {
+	char data[0];
+} lp_no_body;
+
+// Schema of all the message types:
+// X(type, id, body struct, size of the body without its variable part).
+// It generates the lp_msg_type enum, the compile-time size checks
+// and the table used by receivers to drop truncated messages.
+// Ids must fit in the header type field (1 byte), 0 is notype.
+#define LP_WIRE_SCHEMA(X) \
+	/* Ring Paxos */ \
+	X(phase1,               1,  phase1_msg,              38) \
+	X(phase1_range,         2,  phase1_range_msg,        24) \
+	X(phase2,               3,  phase2_wire_msg,         8) \
+	X(command_map,          4,  cmdmap_wire_msg,         0) \
+	X(refusal,              5,  lp_no_body,              0) \
+	X(acceptance,           6,  acceptance_wire_msg,     0) \
+	X(map_request,          7,  map_requests_msg,        4) \
+	X(chosenval_request,    8,  chosencmd_requests_msg,  4) \
+	X(client_submit,        9,  submit_cmd_msg,          4) \
+	X(phase2_range,         10, phase2_range_msg,        4) \
+	X(acceptance_batch,     11, acceptance_batch_msg,    18) \
+	X(learner_feedback,     12, learner_feedback_msg,    8) \
+	X(fec_header,           13, fec_header_msg,          8) \
+	X(fec_parity,           14, fec_parity_msg,          12) \
+	X(padding,              15, lp_no_body,              0) \
+	X(heartbeat,            16, heartbeat_msg,           1) \
+	X(topology,             17, topology_msg,            (7 + MAX_ACCEPTORS)) \
+	X(lease,                18, lease_msg,               23) \
+	X(read_index_request,   19, read_index_request_msg,  4) \
+	X(read_index,           20, read_index_msg,          13) \
+	/* Tests, opaque */ \
+	X(test1,                252, lp_no_body,             0) \
+	X(test2,                253, lp_no_body,             0) \
+	X(test3,                254, lp_no_body,             0)
+
+#define LP_WIRE_ENUM_ENTRY(TYPE, ID, BODY, SIZE) TYPE = ID,
+
+// Minimum size of a message of this type, -1 if the type is not known
+// (i.e. introduced by a newer version)
+int lp_wire_min_size(int type);
+
+// Converted bodies are larger than the original by at most this many bytes
+#define LP_WIRE_COMPAT_MAX_GROWTH 32
+
+// Convert the body of a message from the layout of LP_WIRE_MIN_VERSION
+// to the one of LP_WIRE_VERSION (upgrade) or the other way around (downgrade).
+// If the layout of the type changed, the converted body is written in out
+// (size + LP_WIRE_COMPAT_MAX_GROWTH bytes) and its size is returned.
+// Return 0 if the layout did not change (the body is used as is), 
+// -1 if the body is malformed. See wire_compat.c
+int lp_wire_upgrade(int type, void * body, size_t size, void * out);
+int lp_wire_downgrade(int type, void * body, size_t size, void * out);
+
+#endif /* end of include guard: LP_WIRE_H_D5K2QN7V */
@@ -5,22 +5,58 @@
 
 typedef uint8_t acceptor_id_t;
 typedef uint32_t ballot_t;
-typedef long unsigned iid_t;
+typedef uint64_t iid_t;
+typedef uint32_t volume_id_t;
 
+// Sequence numbers never wrap, packed to keep messages compact.
+// The per-instance messages carry it encoded (see cmd_key_encode),
+// a few bytes for the usual sequence numbers instead of 10.
 typedef struct command_id_t {
     uint8_t mcaster_id;
     uint8_t mcaster_incarnation;
-    uint16_t cmd_seqnum;
-} command_id;
+    uint64_t cmd_seqnum;
+} __attribute__((packed)) command_id;
 
 #define MAX_TCP_PAYLOAD (9000-16) //Multiple of MTU - tcp header
 #define MAX_UDP_PAYLOAD (9000-12) //Multiple of MTU - largest udp header+pseudoheader
 #define MAX_MESSAGE_SIZE (MAX_TCP_PAYLOAD - 4) //Remove sizeof(lp_message_header)
 
+// With UDP segmentation offload, multiple packets of MAX_UDP_PAYLOAD 
+// bytes are sent/received at once (see udp_offload_segments in example_config.cfg)
+#define UDP_OFFLOAD_MAX_BYTES 65507
+#define UDP_OFFLOAD_MAX_SEGMENTS (UDP_OFFLOAD_MAX_BYTES / MAX_UDP_PAYLOAD)
+
+// Maximum number of packet buffers registered with io_uring
+// by each socket (see udp_io_uring_buffers in example_config.cfg)
+#define UDP_IO_URING_MAX_BUFFERS 4096
+
 #define MAX_ACCEPTORS 10
 
+// Maximum number of multicast packets protected by a single 
+// parity packet (see mcast_fec_group_size in example_config.cfg)
+#define FEC_MAX_GROUP_SIZE 32
+
+// Maximum number of multicast groups (i.e. rings) a single process
+// can subscribe to or submit to, see lp_groups.h
+#define MAX_GROUPS 16
+
 #define MAX_QUEUE_SIZE_BYTES (1024u*1024u*1024u) // 1GB
 
+// Backing file for the learners delivery queue overflow 
+// (see delivery_overflow_size in example_config.cfg)
+#define DQ_OVERFLOW_FILE_TEMPLATE "/tmp/lp_dq_overflow_XXXXXX"
+
+// Number of heartbeat inter-arrival times remembered for each acceptor
+// by the failure detector (see heartbeat_interval in example_config.cfg)
+#define FD_HISTORY_SIZE 100
+
+// The leader considers its lease expired this much earlier than acceptors
+// (percent of leader_lease_duration), to tolerate clocks running at different rates
+#define LEASE_CLOCK_DRIFT_PERCENT 10
+
+// Maximum number of reads waiting for a read index in a learner
+#define MAX_PENDING_READS 4096
+
 /*
 	The following defines the verbosity level,
 	individual modules can be enabled selectively by ORing them, 
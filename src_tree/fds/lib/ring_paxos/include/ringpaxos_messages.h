@@ -1,17 +1,24 @@
+#ifndef RINGPAXOS_MESSAGES_H_K8D2VN4Q
+#define RINGPAXOS_MESSAGES_H_K8D2VN4Q
+
 #include <stdbool.h>
 
-// Message types used in ring-paxos
+#include "paxos_config.h"
+#include "lp_wire.h"
+#include "lp_varint.h"
+
+// Message types used in ring-paxos, see the wire format in lp_wire.h
 
 typedef struct phase1_msg_t {
     iid_t inst_number;
     ballot_t ballot;
-    unsigned promises_count;
+    uint32_t promises_count;
     ballot_t highest_accepted_ballot;
     ballot_t highest_promised_ballot;
     command_id cmd_key;
-    size_t cmd_size;
+    uint32_t cmd_size;
     char cmd_value[0];
-} phase1_msg;
+} LP_WIRE_PACKED phase1_msg;
 #define PH1_MSG_SIZE(M) (sizeof(phase1_msg) + M->cmd_size)
 #define PH1_MSG_SIZE_S(M) (sizeof(phase1_msg) + M.cmd_size)
 
@@ -19,42 +26,165 @@ typedef struct phase1_range_msg_t {
 	iid_t from;	
 	iid_t to;	
 	ballot_t ballot;	
-	unsigned promises_count;
-} phase1_range_msg;
+	uint32_t promises_count;
+} LP_WIRE_PACKED phase1_range_msg;
+
+// Messages sent for every instance: on the wire the instance number 
+// is a varint and the key is encoded with cmd_key_encode (from a cleared key),
+// see lp_varint.h. The *_wire_msg types are what travels, the
+// *_msg_decode functions fill the corresponding *_msg type
+// and return false if the message is malformed.
 
 typedef struct phase2_msg_t {
     iid_t inst_number;
     ballot_t ballot;
-    unsigned accepts_count;
+    uint32_t accepts_count;
     command_id cmd_key;
 } phase2_msg;
 
+typedef struct phase2_wire_msg_t {
+    ballot_t ballot;
+    uint32_t accepts_count; //Fixed size, incremented in place by acceptors
+    uint8_t data[0];        //inst_number, cmd_key
+} LP_WIRE_PACKED phase2_wire_msg;
+#define PH2_WIRE_MSG_MAX_SIZE (sizeof(phase2_wire_msg) + VARINT_MAX_SIZE + CMD_KEY_MAX_ENCODED_SIZE)
+
+size_t phase2_msg_encode(phase2_msg * msg, phase2_wire_msg * wire);
+bool phase2_msg_decode(phase2_wire_msg * wire, size_t size, phase2_msg * msg);
+
+// Phase 2 for a run of instances in a single ring message,
+// each acceptor sets its bit in accept_bitmap for the entries it accepts
+typedef struct phase2_range_entry_t {
+    iid_t inst_number;
+    ballot_t ballot;
+    command_id cmd_key;
+    uint16_t accept_bitmap;
+} LP_WIRE_PACKED phase2_range_entry;
+
+typedef struct phase2_range_msg_t {
+    uint32_t entries_count;
+    phase2_range_entry entries[0];
+} LP_WIRE_PACKED phase2_range_msg;
+#define PH2_RANGE_MSG_SIZE(M) (sizeof(phase2_range_msg) + (M->entries_count*sizeof(phase2_range_entry)))
+#define PH2_RANGE_MAX_ENTRIES ((MAX_MESSAGE_SIZE - sizeof(phase2_range_msg)) / sizeof(phase2_range_entry))
+#define ACCEPTOR_BIT(ID) ((uint16_t)(1 << (ID)))
+
 typedef struct cmdmap_msg_t {
     iid_t inst_number;
     command_id cmd_key;
-    size_t cmd_size;
-    char cmd_value[0];
+    uint32_t cmd_size;
+    char * cmd_value;       //Points into the wire message once decoded
 } cmdmap_msg;
-#define CMDMAP_MSG_SIZE(M) (sizeof(cmdmap_msg) + M->cmd_size)
+
+typedef struct cmdmap_wire_msg_t {
+    uint8_t data[0];        //inst_number, cmd_key, cmd_size (varint), cmd_value
+} LP_WIRE_PACKED cmdmap_wire_msg;
+#define CMDMAP_WIRE_MSG_MAX_SIZE(CMD_SIZE) \
+    (2 * VARINT_MAX_SIZE + CMD_KEY_MAX_ENCODED_SIZE + (CMD_SIZE))
+
+size_t cmdmap_msg_encode(cmdmap_msg * msg, cmdmap_wire_msg * wire);
+bool cmdmap_msg_decode(cmdmap_wire_msg * wire, size_t size, cmdmap_msg * msg);
 
 typedef struct acceptance_msg_t {
     iid_t inst_number;
     command_id cmd_key;
 } acceptance_msg;
 
+typedef struct acceptance_wire_msg_t {
+    uint8_t data[0];        //inst_number, cmd_key
+} LP_WIRE_PACKED acceptance_wire_msg;
+#define ACCEPTANCE_WIRE_MSG_MAX_SIZE (VARINT_MAX_SIZE + CMD_KEY_MAX_ENCODED_SIZE)
+
+size_t acceptance_msg_encode(acceptance_msg * msg, acceptance_wire_msg * wire);
+bool acceptance_msg_decode(acceptance_wire_msg * wire, size_t size, acceptance_msg * msg);
+
+// Acceptance of multiple instances at once: instance (from + i) is decided
+// if bit i of decided_bitmap is set, the chosen keys follow in the same order,
+// encoded with cmd_key_encode (see lp_varint.h) in keys_size bytes
+typedef struct acceptance_batch_msg_t {
+    iid_t from;
+    uint64_t decided_bitmap;
+    uint16_t keys_size;
+    uint8_t cmd_keys[0];
+} LP_WIRE_PACKED acceptance_batch_msg;
+#define ACCEPTANCE_BATCH_MSG_SIZE(M) (sizeof(acceptance_batch_msg) + M->keys_size)
+#define ACCEPTANCE_BATCH_MAX_INSTANCES 64
+
+// Decodes the keys of the decided instances, in order, into keys
+// (ACCEPTANCE_BATCH_MAX_INSTANCES entries). Returns the number of decided
+// instances, or -1 if the message is malformed (no key should be used).
+int acceptance_batch_msg_decode(acceptance_batch_msg * msg, size_t size, command_id * keys);
+
+// Periodically sent by learners to the multicaster, used for rate control
+typedef struct learner_feedback_msg_t {
+	uint32_t missing_count;   //Missing mappings/acceptances since last feedback
+	uint32_t pending_count;   //Instances received but not delivered yet
+} LP_WIRE_PACKED learner_feedback_msg;
+
+// Periodically sent by each acceptor to all the others (on their ring port),
+// used for failure detection and leader election, see lp_leader_election.h
+typedef struct heartbeat_msg_t {
+	acceptor_id_t acceptor_id;
+} LP_WIRE_PACKED heartbeat_msg;
+
+// Ring members in ring order and leader, see lp_topology.h.
+// Sent to all acceptors (on their ring port) by the process that changes it,
+// the leader multicasts it to learners as well.
+typedef struct topology_msg_t {
+	uint32_t version;
+	acceptor_id_t preferred_leader;
+	//The one elected, differs from preferred_leader if it crashed
+	acceptor_id_t leader;
+	uint8_t ring_size;
+	acceptor_id_t ring[MAX_ACCEPTORS];
+} LP_WIRE_PACKED topology_msg;
+
+// Lease renewal, sent by the leader around the ring (in the same packets 
+// as phase 2 when there is traffic). Each acceptor that grants the lease 
+// sets its bit in grants_bitmap, the lease starts at sent (leader clock).
+typedef struct lease_msg_t {
+	acceptor_id_t leader;
+	int64_t sent_sec;
+	int32_t sent_usec;
+	uint16_t grants_bitmap;
+	//Highest instance accepted by the acceptors granting the lease
+	iid_t highest_accepted;
+} LP_WIRE_PACKED lease_msg;
+
+// Sent by learners to the leader ring port, nonce is random
+typedef struct read_index_request_msg_t {
+	uint32_t nonce;
+} LP_WIRE_PACKED read_index_request_msg;
+
+// Reply to read_index_request, multicast by the leader.
+// If valid, all instances up to read_index are decided.
+typedef struct read_index_msg_t {
+	uint32_t nonce;
+	uint8_t valid;
+	iid_t read_index;
+} LP_WIRE_PACKED read_index_msg;
+
+// Instances first...last (included)
+typedef struct iid_range_t {
+	iid_t first;
+	iid_t last;
+} LP_WIRE_PACKED iid_range;
+
 typedef struct chosencmd_requests_msg_t {
-	unsigned requests_count;
-	iid_t inst_number[0];
-} chosencmd_requests_msg;
-#define FINVAL_REQS_MSG_SIZE(M) (sizeof(chosencmd_requests_msg) + (M->requests_count*sizeof(iid_t)))
+	uint32_t requests_count;
+	iid_range ranges[0];
+} LP_WIRE_PACKED chosencmd_requests_msg;
+#define FINVAL_REQS_MSG_SIZE(M) (sizeof(chosencmd_requests_msg) + (M->requests_count*sizeof(iid_range)))
 
 
 typedef struct map_requests_msg_t {
-	unsigned requests_count;
-	iid_t inst_number[0];
-} map_requests_msg;
-#define CMDMAP_REQS_MSG_SIZE(M) (sizeof(map_requests_msg) + (M->requests_count*sizeof(iid_t)))
+	uint32_t requests_count;
+	iid_range ranges[0];
+} LP_WIRE_PACKED map_requests_msg;
+#define CMDMAP_REQS_MSG_SIZE(M) (sizeof(map_requests_msg) + (M->requests_count*sizeof(iid_range)))
 
-#define REPEAT_REQUEST_MAX_ENTRIES (((MAX_MESSAGE_SIZE - sizeof(map_requests_msg)) / sizeof(iid_t)) -1)
+#define REPEAT_REQUEST_MAX_ENTRIES (((MAX_MESSAGE_SIZE - sizeof(map_requests_msg)) / sizeof(iid_range)) -1)
 
 #define MAX_COMMAND_SIZE (MAX_MESSAGE_SIZE - sizeof(phase1_msg))
+
+#endif /* end of include guard: RINGPAXOS_MESSAGES_H_K8D2VN4Q */
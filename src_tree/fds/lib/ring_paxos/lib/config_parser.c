@@ -12,6 +12,7 @@
 #include "lp_os_dependent.h"
 #include "lp_config_parser.h"
 #include "lp_config_parser_macros.h"
+#include "lp_wire.h"
 
 struct acceptor_info_t {
     acceptor_id_t id;
@@ -36,15 +37,35 @@ struct config_mngr_t {
 	struct timeval retransmit_request_interval;
 	
     int socket_buffers_size;
+    int mcast_fec_group_size;
+    int udp_offload_segments;
+    int udp_io_uring_buffers;
+    int busy_poll_usec;
+    int cpu_core;
+    int wire_version;
+
+    struct timeval heartbeat_interval;
+    struct timeval failure_detection_timeout;
+    int phi_threshold;
+    struct timeval leader_lease_duration;
+
+    struct event_base * event_base;
     
     char mcast_addr[16];
     int mcast_port;
+
+    bool group_set;
+    int group_id;
+    volume_id_t group_first_volume;
+    volume_id_t group_last_volume;
     
     unsigned quorum_size;
 	int working_set_size;
+	int delivery_overflow_size;
 	int max_active_instances;
 	int preexecution_window_size;
 	int max_p2_open_per_iteration;
+	int adaptive_rate_control;
 
 	int max_client_values_queue_size;
     
@@ -68,20 +89,42 @@ CONF_GETTER(default_autoflush_interval, int);
 CONF_GETTER_P(retransmit_request_interval, struct timeval *);
 
 CONF_GETTER(socket_buffers_size, int);
+CONF_GETTER(mcast_fec_group_size, int);
+CONF_GETTER(udp_offload_segments, int);
+CONF_GETTER(udp_io_uring_buffers, int);
+CONF_GETTER(busy_poll_usec, int);
+CONF_GETTER(cpu_core, int);
+CONF_GETTER(wire_version, int);
+CONF_GETTER_P(heartbeat_interval, struct timeval *);
+CONF_GETTER_P(failure_detection_timeout, struct timeval *);
+CONF_GETTER_P(leader_lease_duration, struct timeval *);
+CONF_GETTER(phi_threshold, int);
+CONF_GETTER(event_base, struct event_base *);
 
 
 CONF_GETTER(mcast_addr, char *);
 CONF_GETTER(mcast_port, int);
 
+CONF_GETTER(group_id, int);
+CONF_GETTER(group_first_volume, volume_id_t);
+CONF_GETTER(group_last_volume, volume_id_t);
+
 CONF_GETTER(quorum_size, unsigned);
 
 CONF_GETTER(working_set_size, int);
+CONF_GETTER(delivery_overflow_size, int);
 CONF_GETTER(max_active_instances, int);
 CONF_GETTER(preexecution_window_size, int);
 
 CONF_GETTER(max_p2_open_per_iteration, int);
+CONF_GETTER(adaptive_rate_control, int);
 CONF_GETTER(max_client_values_queue_size, int);
 
+void lpconfig_set_event_base(config_mngr * cfg, struct event_base * base) {
+    assert(cfg->initialized);
+    cfg->event_base = base;
+}
+
 void lpconfig_destroy(config_mngr * cfg) {
     if(cfg != NULL) {
         free(cfg);
@@ -132,6 +175,21 @@ int lpconfig_get_ring_port_of(config_mngr * cfg, acceptor_id_t acceptor) {
     return (lpconfig_get_acceptor_info(cfg, acceptor))->inbound_port;
 }
 
+bool lpconfig_heartbeats_enabled(config_mngr * cfg) {
+    struct timeval * interval = lpconfig_get_heartbeat_interval(cfg);
+    return (interval->tv_sec > 0 || interval->tv_usec > 0);
+}
+
+bool lpconfig_leases_enabled(config_mngr * cfg) {
+    struct timeval * duration = lpconfig_get_leader_lease_duration(cfg);
+    return (duration->tv_sec > 0 || duration->tv_usec > 0);
+}
+
+bool lpconfig_group_has_volume(config_mngr * cfg, volume_id_t volume) {
+    return (volume >= lpconfig_get_group_first_volume(cfg) && 
+        volume <= lpconfig_get_group_last_volume(cfg));
+}
+
 /**** PUBLIC ****/
 
 int
@@ -157,6 +215,9 @@ config_mngr_init(
         cm->cb = cb;
 		cm->cb_arg = cb_arg;
         cm->self_acceptor_id = acceptor_id;
+
+        //Not pinned unless set
+        cm->cpu_core = -1;
         
         //Parse line by line
         cm = open_and_parse(config_path, cm);
@@ -258,10 +319,32 @@ static config_mngr * open_and_parse(const char * config_path, config_mngr * cm)
 		PARSE_INTEGER(default_autoflush_interval);
 
 		PARSE_INTEGER(socket_buffers_size);
+
+		PARSE_INTEGER(mcast_fec_group_size);
+
+		PARSE_INTEGER(udp_offload_segments);
+
+		PARSE_INTEGER(udp_io_uring_buffers);
+
+		PARSE_INTEGER(busy_poll_usec);
+
+		PARSE_INTEGER(cpu_core);
+
+		PARSE_INTEGER(wire_version);
+
+		PARSE_TIMEVAL(heartbeat_interval);
+
+		PARSE_TIMEVAL(failure_detection_timeout);
+
+		PARSE_INTEGER(phi_threshold);
+
+		PARSE_TIMEVAL(leader_lease_duration);
         
 		PARSE_INTEGER(quorum_size);
 
 		PARSE_INTEGER(working_set_size);
+
+		PARSE_INTEGER(delivery_overflow_size);
 		
 		PARSE_INTEGER(max_active_instances);
 		
@@ -269,6 +352,8 @@ static config_mngr * open_and_parse(const char * config_path, config_mngr * cm)
 		
 		PARSE_INTEGER(max_p2_open_per_iteration);
 
+		PARSE_INTEGER(adaptive_rate_control);
+
 		PARSE_INTEGER(max_client_values_queue_size);
 		
 		// Multicast info line
@@ -280,6 +365,19 @@ static config_mngr * open_and_parse(const char * config_path, config_mngr * cm)
             continue;
         }
 
+        // Multicast group line
+        if(starts_with("group", LINE_BUFFER)) {
+            // GROUP_ID FIRST_VOLUME LAST_VOLUME
+            if(sscanf(LINE_BUFFER, "%s %d %u %u", IGNOREBUFFER, &cm->group_id, 
+                &cm->group_first_volume, &cm->group_last_volume) != 4) {
+                goto ERROR_LABEL;
+            }
+            cm->group_set = true;
+            LOG_MSG(INFO, ("Group %d orders volumes %u...%u\n", 
+                cm->group_id, cm->group_first_volume, cm->group_last_volume));
+            continue;
+        }
+
         // An acceptor info line
         if(starts_with("acceptor", LINE_BUFFER)) {
             acceptor_id_t acc_id = 0;
@@ -357,6 +455,22 @@ static int validate_config(config_mngr * cfg) {
 	VALIDATE_ADDRESS(lpconfig_get_mcast_addr(cfg));
 	VALIDATE_PORTNUMBER(lpconfig_get_mcast_port(cfg));
 
+	//Multicast group, if not set this ring orders every volume
+	if(!cfg->group_set) {
+		cfg->group_id = 0;
+		cfg->group_first_volume = 0;
+		cfg->group_last_volume = UINT32_MAX;
+	}
+	if(cfg->group_id < 0) {
+		printf("Error: invalid group id %d\n", cfg->group_id);
+		goto VALIDATE_ERROR_LABEL;
+	}
+	if(cfg->group_first_volume > cfg->group_last_volume) {
+		printf("Error: group first volume (%u) is bigger than last volume (%u)\n", 
+			cfg->group_first_volume, cfg->group_last_volume);
+		goto VALIDATE_ERROR_LABEL;
+	}
+
 	// Multicaster time variables
 	VALIDATE_TIMEVAL_NONZERO(lpconfig_get_p1_interval(cfg));
 	VALIDATE_TIMEVAL_NONZERO(lpconfig_get_p2_interval(cfg));
@@ -382,6 +496,56 @@ static int validate_config(config_mngr * cfg) {
 	VALIDATE_INT_NONZERO_OR_DEFAULT(cfg->preexecution_window_size, 50);
 	VALIDATE_INT_NONZERO_OR_DEFAULT(cfg->max_p2_open_per_iteration, 10);
 	VALIDATE_INT_NONZERO_OR_DEFAULT(cfg->max_client_values_queue_size, 100);
+	if(cfg->delivery_overflow_size < 0) {
+		printf("Error: delivery_overflow_size cannot be negative\n");
+		goto VALIDATE_ERROR_LABEL;
+	}
+	if(cfg->mcast_fec_group_size < 0 || cfg->mcast_fec_group_size > FEC_MAX_GROUP_SIZE) {
+		printf("Error: mcast_fec_group_size must be between 0 and %d\n", FEC_MAX_GROUP_SIZE);
+		goto VALIDATE_ERROR_LABEL;
+	}
+	if(cfg->udp_offload_segments < 0 || cfg->udp_offload_segments > (int)UDP_OFFLOAD_MAX_SEGMENTS) {
+		printf("Error: udp_offload_segments must be between 0 and %d\n", (int)UDP_OFFLOAD_MAX_SEGMENTS);
+		goto VALIDATE_ERROR_LABEL;
+	}
+	if(cfg->udp_io_uring_buffers < 0 || cfg->udp_io_uring_buffers > UDP_IO_URING_MAX_BUFFERS ||
+		(cfg->udp_io_uring_buffers & (cfg->udp_io_uring_buffers - 1)) != 0) {
+		printf("Error: udp_io_uring_buffers must be 0 or a power of 2 up to %d\n", UDP_IO_URING_MAX_BUFFERS);
+		goto VALIDATE_ERROR_LABEL;
+	}
+	if(cfg->busy_poll_usec < 0) {
+		printf("Error: invalid busy_poll_usec %d\n", cfg->busy_poll_usec);
+		goto VALIDATE_ERROR_LABEL;
+	}
+	if(cfg->cpu_core < -1) {
+		printf("Error: invalid cpu_core %d\n", cfg->cpu_core);
+		goto VALIDATE_ERROR_LABEL;
+	}
+	//Only set while upgrading
+	if(cfg->wire_version == 0) {
+		cfg->wire_version = LP_WIRE_VERSION;
+	}
+	if(cfg->wire_version < LP_WIRE_MIN_VERSION || cfg->wire_version > LP_WIRE_VERSION) {
+		printf("Error: wire_version must be between %d and %d\n", LP_WIRE_MIN_VERSION, LP_WIRE_VERSION);
+		goto VALIDATE_ERROR_LABEL;
+	}
+
+	// Failure detection, only if heartbeats are enabled
+	if(lpconfig_get_heartbeat_interval(cfg)->tv_sec < 0 || lpconfig_get_heartbeat_interval(cfg)->tv_usec < 0) {
+		printf("Error: invalid heartbeat_interval\n");
+		goto VALIDATE_ERROR_LABEL;
+	}
+	if(lpconfig_heartbeats_enabled(cfg)) {
+		VALIDATE_TIMEVAL_NONZERO_OR_DEFAULT(lpconfig_get_failure_detection_timeout(cfg), 0, 500000);
+		VALIDATE_TIMEVAL_GREATER_EQUAL_THAN(lpconfig_get_failure_detection_timeout(cfg), lpconfig_get_heartbeat_interval(cfg));
+		VALIDATE_INT_NONZERO_OR_DEFAULT(cfg->phi_threshold, 8);
+	}
+
+	// Leader leases, disabled by default
+	if(lpconfig_get_leader_lease_duration(cfg)->tv_sec < 0 || lpconfig_get_leader_lease_duration(cfg)->tv_usec < 0) {
+		printf("Error: invalid leader_lease_duration\n");
+		goto VALIDATE_ERROR_LABEL;
+	}
 	
 	
 	// Validate other params
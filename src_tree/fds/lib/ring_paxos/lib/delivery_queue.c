@@ -2,7 +2,10 @@
 #include <assert.h>
 #include <memory.h>
 #include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 
 #include "paxos_config.h"
 #include "lp_delivery_queue.h"
@@ -23,6 +26,14 @@ typedef struct dq_entry_t {
 	struct timeval finval_request_timeout;
 } dq_entry;
 
+//Instances beyond the end of the circular buffer are spilled to 
+// an overflow area (a memory-mapped file) and pulled back in order 
+// as the buffer moves forward
+typedef struct dq_overflow_slot_t {
+    dq_entry entry;
+    cmd_slot cmd;
+} dq_overflow_slot;
+
 struct delivery_queue_t {
 	void * del_cb_arg;
 	void * callbacks_arg;
@@ -31,6 +42,14 @@ struct delivery_queue_t {
     dq_entry * queue_array;
     cmd_slot * cmd_slot_array;
 
+    //Same indexing as queue_array, one bit per entry, mirror 
+    // has_mapping/has_final_value so that gaps are found a word at a time
+    uint64_t * mapping_bits;
+    uint64_t * final_value_bits;
+
+    size_t overflow_size;
+    dq_overflow_slot * overflow_array;
+
     iid_t highest_delivered;
     iid_t highest_seen_closed;
     iid_t highest_seen_cmdmap;
@@ -65,12 +84,79 @@ void dq_clear_entry(dq_entry * e) {
 	e->finval_request_timeout.tv_usec = 0;
 }
 
+#define DQ_BITS_PER_WORD 64
+#define DQ_BITS_WORDS(SIZE) ((SIZE + DQ_BITS_PER_WORD - 1) / DQ_BITS_PER_WORD)
+
+static
+void dq_bit_assign(uint64_t * bits, size_t index, bool value) {
+	uint64_t mask = (1ULL << (index % DQ_BITS_PER_WORD));
+	if(value) {
+		bits[index / DQ_BITS_PER_WORD] |= mask;
+	} else {
+		bits[index / DQ_BITS_PER_WORD] &= ~mask;
+	}
+}
+
+//Must be invoked after changing the state of an entry in the circular buffer
+static
+void dq_sync_bits(delivery_queue * dq, iid_t inst_number, dq_entry * e) {
+	size_t index = inst_number % dq->queue_size;
+	dq_bit_assign(dq->mapping_bits, index, e->has_mapping);
+	dq_bit_assign(dq->final_value_bits, index, e->has_final_value);
+}
+
+//Returns the first instance in first...last that is not deliverable yet
+// (mapping or final value unknown), or 0 if all are.
+//Range must be within the circular buffer
+static
+iid_t dq_next_incomplete(delivery_queue * dq, iid_t first, iid_t last) {
+	while(first <= last) {
+		size_t index = first % dq->queue_size;
+		size_t word = index / DQ_BITS_PER_WORD;
+		unsigned bit = index % DQ_BITS_PER_WORD;
+
+		//Bits of this word that map to instances first, first+1, ...
+		// the last word may be partially used, then the buffer wraps
+		size_t span = DQ_BITS_PER_WORD - bit;
+		if(span > dq->queue_size - index) {
+			span = dq->queue_size - index;
+		}
+		if(span > (size_t)(last - first) + 1) {
+			span = (size_t)(last - first) + 1;
+		}
+
+		uint64_t incomplete = ~(dq->mapping_bits[word] & dq->final_value_bits[word]) >> bit;
+		if(span < DQ_BITS_PER_WORD) {
+			incomplete &= ((1ULL << span) - 1);
+		}
+		if(incomplete != 0) {
+			return first + __builtin_ctzll(incomplete);
+		}
+		first += span;
+	}
+	return 0;
+}
+
 void dq_delayed_start(delivery_queue * dq) {
 	//TODO HACK to allow a learner to start later on without
 	//delivering all previous values;
 	dq->late_start = true;
 }
 
+iid_t dq_get_highest_delivered(delivery_queue * dq) {
+	assert(dq->initialized);
+	return dq->highest_delivered;
+}
+
+unsigned dq_pending_count(delivery_queue * dq) {
+	assert(dq->initialized);
+	iid_t highest_seen = IID_MAX(dq->highest_seen_closed, dq->highest_seen_cmdmap);
+	if(highest_seen <= dq->highest_delivered) {
+		return 0;
+	}
+	return (unsigned)(highest_seen - dq->highest_delivered);
+}
+
 static
 dq_entry * dq_get_entry(delivery_queue * dq, iid_t inst_number) {
 	assert(dq->initialized);
@@ -95,6 +181,86 @@ cmd_slot * dq_get_slot(delivery_queue * dq, dq_entry * e) {
     return cs;
 }
 
+static
+bool dq_is_in_overflow(delivery_queue * dq, iid_t inst_number) {
+	return (inst_number >= (dq->highest_delivered + dq->queue_size) &&
+		inst_number < (dq->highest_delivered + dq->queue_size + dq->overflow_size));
+}
+
+static
+dq_overflow_slot * dq_get_overflow_slot(delivery_queue * dq, iid_t inst_number) {
+	assert(dq->initialized);
+	assert(dq_is_in_overflow(dq, inst_number));
+
+	dq_overflow_slot * os = &dq->overflow_array[inst_number % dq->overflow_size];
+	assert(os->entry.inst_number == inst_number || os->entry.inst_number == 0);
+	os->entry.inst_number = inst_number;
+	return os;
+}
+
+//Invoked when the circular buffer moves forward, brings back the 
+// instance that just entered the buffer (if it was spilled)
+static
+void dq_reload_from_overflow(delivery_queue * dq, iid_t inst_number) {
+	if(dq->overflow_size == 0) {
+		return;
+	}
+
+	dq_overflow_slot * os = &dq->overflow_array[inst_number % dq->overflow_size];
+	if(os->entry.inst_number != inst_number) {
+		return;
+	}
+
+	dq_entry * e = dq_get_entry(dq, inst_number);
+	assert(!e->has_mapping && !e->has_final_value);
+	LOG_MSG(DELIVERY_Q, ("Reloading inst:%lu from overflow\n", inst_number));
+
+	CMD_KEY_COPY(&e->cmd_key, &os->entry.cmd_key);
+	e->has_mapping = os->entry.has_mapping;
+	e->has_final_value = os->entry.has_final_value;
+	dq_sync_bits(dq, inst_number, e);
+	if(os->entry.has_mapping) {
+		cmd_slot * cs = dq_get_slot(dq, e);
+		cs->size = os->cmd.size;
+		memcpy(cs->data, os->cmd.data, os->cmd.size);
+	}
+	dq_clear_entry(&os->entry);
+}
+
+//Creates the overflow area, a file mapped in memory 
+// so that pages not in use can be written back by the OS
+static
+dq_overflow_slot * dq_overflow_init(size_t overflow_size) {
+	char path[] = DQ_OVERFLOW_FILE_TEMPLATE;
+	size_t bytes = overflow_size * sizeof(dq_overflow_slot);
+
+	int fd = mkstemp(path);
+	if(fd < 0) {
+		perror("mkstemp");
+		return NULL;
+	}
+	//File is removed as soon as it's closed and unmapped
+	unlink(path);
+
+	if(ftruncate(fd, bytes) != 0) {
+		perror("ftruncate");
+		close(fd);
+		return NULL;
+	}
+
+	void * area = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(area == MAP_FAILED) {
+		perror("mmap");
+		return NULL;
+	}
+	LOG_MSG(INFO, ("Delivery queue overflow: %lu instances (%lu Mbytes)\n", 
+		overflow_size, bytes/(1024*1024)));
+
+	//File is initially zero-filled, all entries are empty
+	return area;
+}
+
 static
 void dq_periodic_check(void * arg) {
     delivery_queue * dq = arg;
@@ -107,51 +273,69 @@ void dq_periodic_check(void * arg) {
 	struct timeval time_now;
 	gettimeofday(&time_now, NULL);
 
-    iid_t i;
     iid_t upper_limit = IID_MAX(dq->highest_seen_closed, dq->highest_seen_cmdmap);
-    for(i = dq->highest_delivered+1; i <= upper_limit; i++) {
+	//Dont try to read beyond the limits of the current circular buffer
+	if(upper_limit >= (dq->highest_delivered + dq->queue_size)) {
+		upper_limit = dq->highest_delivered + dq->queue_size - 1;
+	}
+
+	//Consecutive instances to request are reported as a single range
+	iid_t map_first = 0, map_last = 0;
+	iid_t fin_first = 0, fin_last = 0;
+
+    //Deliverable instances are skipped a word at a time
+    iid_t i = dq->highest_delivered+1;
+    while(i <= upper_limit && (i = dq_next_incomplete(dq, i, upper_limit)) != 0) {
 
-		//Dont try to read beyond the limits of the current circular buffer
-		if(i >= (dq->highest_delivered + dq->queue_size)) {
-			break;
-		}
-        
         //Get entry in circular buffer
         e = dq_get_entry(dq, i);
 		assert(e->inst_number == i);
 
-		//This instance is deliverable as it is, skip to next
-		if(e->has_mapping && e->has_final_value) {
-			continue;
-		}
-
         //Unknown mapping, request it
-        if( ! e->has_mapping ) {
-	
-			//Not already requested recently
-			if((e->cmdmap_request_timeout.tv_sec == 0 &&
-			   e->cmdmap_request_timeout.tv_usec == 0) ||
-			   timer_is_expired(&e->cmdmap_request_timeout, &time_now)) {
-				LOG_MSG(DELIVERY_Q, ("Missing map for inst:%lu\n", e->inst_number));
-				dq->mcm_cb(i, dq->callbacks_arg);
-				timer_set_timeout(&time_now, &e->cmdmap_request_timeout, &dq->request_timeout);
+        //(if not already requested recently)
+        if( ! e->has_mapping && 
+			((e->cmdmap_request_timeout.tv_sec == 0 &&
+			e->cmdmap_request_timeout.tv_usec == 0) ||
+			timer_is_expired(&e->cmdmap_request_timeout, &time_now))) {
+			LOG_MSG(DELIVERY_Q, ("Missing map for inst:%lu\n", e->inst_number));
+			timer_set_timeout(&time_now, &e->cmdmap_request_timeout, &dq->request_timeout);
+			if(map_first != 0 && map_last + 1 == i) {
+				map_last = i;
+			} else {
+				if(map_first != 0) {
+					dq->mcm_cb(map_first, map_last, dq->callbacks_arg);
+				}
+				map_first = map_last = i;
 			}
         }
         
         //Some instance higher than this one is already closed
         //request final value for this one.
-        if(i < dq->highest_seen_closed) {
-	
-			//Not already requested recently
-			if((e->finval_request_timeout.tv_sec != 0 &&
-			   e->finval_request_timeout.tv_usec != 0) ||
-			   timer_is_expired(&e->finval_request_timeout, &time_now)) {
-				LOG_MSG(DELIVERY_Q, ("Missing acceptance for inst:%lu\n", e->inst_number));
-				dq->mac_cb(i, dq->callbacks_arg);
-				timer_set_timeout(&time_now, &e->finval_request_timeout, &dq->request_timeout);
+        //(if not already requested recently)
+        if( ! e->has_final_value && i < dq->highest_seen_closed &&
+			((e->finval_request_timeout.tv_sec == 0 &&
+			e->finval_request_timeout.tv_usec == 0) ||
+			timer_is_expired(&e->finval_request_timeout, &time_now))) {
+			LOG_MSG(DELIVERY_Q, ("Missing acceptance for inst:%lu\n", e->inst_number));
+			timer_set_timeout(&time_now, &e->finval_request_timeout, &dq->request_timeout);
+			if(fin_first != 0 && fin_last + 1 == i) {
+				fin_last = i;
+			} else {
+				if(fin_first != 0) {
+					dq->mac_cb(fin_first, fin_last, dq->callbacks_arg);
+				}
+				fin_first = fin_last = i;
 			}
-		}        
+		}
+		i++;
     }
+	if(map_first != 0) {
+		dq->mcm_cb(map_first, map_last, dq->callbacks_arg);
+	}
+	if(fin_first != 0) {
+		dq->mac_cb(fin_first, fin_last, dq->callbacks_arg);
+	}
+
     //Invoke post-check callback if set
     if(dq->pc_cb != NULL) {
         dq->pc_cb(dq->callbacks_arg);
@@ -193,6 +377,16 @@ delivery_queue * delivery_queue_init(
 
     dq->queue_array = calloc(dq->queue_size, sizeof(dq_entry));
     assert(dq->queue_array != NULL);
+
+    dq->mapping_bits = calloc(DQ_BITS_WORDS(dq->queue_size), sizeof(uint64_t));
+    dq->final_value_bits = calloc(DQ_BITS_WORDS(dq->queue_size), sizeof(uint64_t));
+    assert(dq->mapping_bits != NULL && dq->final_value_bits != NULL);
+
+    dq->overflow_size = (size_t)lpconfig_get_delivery_overflow_size(dq->cfg);
+    if(dq->overflow_size > 0) {
+        dq->overflow_array = dq_overflow_init(dq->overflow_size);
+        assert(dq->overflow_array != NULL);
+    }
     
     dq_entry * e;
     iid_t i;
@@ -205,7 +399,8 @@ delivery_queue * delivery_queue_init(
 	dq->request_timeout.tv_usec = 10000; //TODO make this a config parameter
     
     //Set periodic event for detecting gaps
-    dq->periodic_gap_check = set_periodic_event(lpconfig_get_delivery_check_interval(dq->cfg), dq_periodic_check, dq);
+    dq->periodic_gap_check = set_periodic_event_on_base(lpconfig_get_event_base(dq->cfg),
+        lpconfig_get_delivery_check_interval(dq->cfg), dq_periodic_check, dq);
     
 	dq->initialized = true;
 
@@ -229,57 +424,37 @@ void dq_deliver_loop(delivery_queue * dq) {
 		dq->del_cb(&cs->data, cs->size, dq->del_cb_arg);
 		//Clear instance, we don't need it anymore
 		dq_clear_entry(e);
+		dq_sync_bits(dq, dq->highest_delivered+1, e);
 
 		// move cursor of next deliverable
 		dq->highest_delivered += 1;
 		
+		//Last slot of the buffer is now free
+		dq_reload_from_overflow(dq, dq->highest_delivered + dq->queue_size - 1);
+		
 		e = dq_get_entry(dq, dq->highest_delivered+1);
 	}
 }
 
-void delivery_queue_handle_command_map(
-    delivery_queue * dq, 
-    iid_t inst_number,
+//Updates the state of an entry (in the circular buffer or in the overflow)
+// when a command_map is received. 
+//Returns true if the entry just became deliverable
+static
+bool dq_update_mapping(
+    dq_entry * e,
+    cmd_slot * cs,
     command_id * cmd_key,
     size_t cmd_size,
     void * cmd_value
     )
 {
-	assert(dq->initialized);
-	
-	if(dq->late_start) {
-		dq->highest_delivered = inst_number-1;
-		dq->late_start = false;
-	}
-	
-    //This is too far in the future and would override 
-    // some other instance, ignore it
-    if(inst_number >= (dq->highest_delivered + dq->queue_size)) {
-        LOG_MSG(DELIVERY_Q, ("Ignoring future instance %lu\n", inst_number));
-        return;
-	} else if (inst_number <= dq->highest_delivered) {
-        LOG_MSG(DELIVERY_Q, ("Ignoring old instance %lu\n", inst_number));
-        return;
-	}
-	
-	//Inst number is within working bounds
-    
-    //Keep track of highest seen mapping
-    if(inst_number > dq->highest_seen_cmdmap) {
-        dq->highest_seen_cmdmap = inst_number;
-    }
-    
-    dq_entry * e = dq_get_entry(dq, inst_number);
-	assert(e->inst_number == inst_number);
-
-	cmd_slot * cs = dq_get_slot(dq, e);
-	assert(cs != NULL);
+	iid_t inst_number = e->inst_number;
 	
 	//We already know all about this instance 
 	// (but it wasn't delivered yet, probably because of some gap)
 	if(e->has_final_value && e->has_mapping) {
 		LOG_MSG(DELIVERY_Q, ("Instance %lu is already deliverable\n", inst_number));
-		return;
+		return false;
 	}
 	
 	//We know some mapping already but not the chosen value key
@@ -300,7 +475,7 @@ void delivery_queue_handle_command_map(
 			cs->size = cmd_size;
 			memcpy(cs->data, cmd_value, cmd_size);
 		}
-		return;
+		return false;
 	}
 	
 	//We know the key of the value chosen, but not the command value mapping
@@ -314,15 +489,14 @@ void delivery_queue_handle_command_map(
 			cs->size = cmd_size;
 			memcpy(cs->data, cmd_value, cmd_size);
 			e->has_mapping = true;
-			//It may be possible to deliver this (and following) values now
-			dq_deliver_loop(dq);
+			return true;
 		} else {
 			//Mapping does not match, since accepted value won't change
 			// we can safely drop it [edge M3]
 			LOG_MSG(DELIVERY_Q, ("Got mapping different from chosen value, inst:%lu\n",
 				inst_number));
 		}
-		return;
+		return false;
 	}
 	
 	//Mapping AND chosen key are not known, save the mapping received
@@ -332,48 +506,27 @@ void delivery_queue_handle_command_map(
 	CMD_KEY_COPY((&e->cmd_key), cmd_key);
 	cs->size = cmd_size;
 	memcpy(cs->data, cmd_value, cmd_size);
-	e->has_mapping = true;			
-	
+	e->has_mapping = true;
+	return false;
 }
 
-void delivery_queue_handle_acceptance(
-    delivery_queue * dq, 
-    iid_t inst_number,
+//Updates the state of an entry (in the circular buffer or in the overflow)
+// when an acceptance is received. 
+//Returns true if the entry just became deliverable
+static
+bool dq_update_acceptance(
+    dq_entry * e,
     command_id * cmd_key
     )
 {
-	assert(dq->initialized);
-	
-	if(dq->late_start) {
-		dq->highest_delivered = inst_number-1;
-		dq->late_start = false;
-	}
-	
-	//Keep track of highest seen mapping
-    if(inst_number > dq->highest_seen_closed) {
-        dq->highest_seen_closed = inst_number;
-    }
-
-    //This is too far in the future and would override 
-    // some other instance, ignore it
-    if(inst_number >= (dq->highest_delivered + dq->queue_size)) {
-        LOG_MSG(DELIVERY_Q, ("Ignoring future instance %lu\n", inst_number));
-        return;
-	} else if (inst_number <= dq->highest_delivered) {
-        LOG_MSG(DELIVERY_Q, ("Ignoring old instance %lu\n", inst_number));
-        return;
-	}
-	
-	//Inst number is within working bounds
-
-    dq_entry * e = dq_get_entry(dq, inst_number);
+	iid_t inst_number = e->inst_number;
 	bool same_key = CMD_KEY_EQUALS((&e->cmd_key), cmd_key);
 	
 	//We already know all about this instance 
 	// (but it wasn't delivered yet, probably because of some gap)
 	if(e->has_final_value && e->has_mapping) {
 		assert(same_key == true);
-		return;
+		return false;
 	}
 	
 	//We know some mapping already but not the chosen value key
@@ -384,8 +537,7 @@ void delivery_queue_handle_acceptance(
 			LOG_MSG(DELIVERY_Q, ("Received final value for known mapping, inst:%lu is deliverable\n",
 				inst_number));
 			e->has_final_value = true;
-			//It may be possible to deliver this (and following) values now
-			dq_deliver_loop(dq);
+			return true;
 		} else {
 			//The key of the final value is different from the mapping that we have
 			//Save the final key (that won't change), drop the mapping [edge A3]
@@ -395,13 +547,13 @@ void delivery_queue_handle_acceptance(
 			e->has_mapping = false;
 			CMD_KEY_COPY(&e->cmd_key, cmd_key);
 		}
-		return;
+		return false;
 	}
 	
 	//We know the key of the value chosen, but not the command value mapping [edge A2]
 	if(e->has_final_value) {
 		assert(CMD_KEY_EQUALS((&e->cmd_key), cmd_key));		
-		return;
+		return false;
 	}
 	
 	//Nothing is known, store the final value key [edge A1]
@@ -409,4 +561,106 @@ void delivery_queue_handle_acceptance(
 	e->has_final_value = true;
 	LOG_MSG(DELIVERY_Q, ("Learned final value inst:%lu, mapping is not known\n",
 		inst_number));
+	return false;
+}
+
+void delivery_queue_handle_command_map(
+    delivery_queue * dq, 
+    iid_t inst_number,
+    command_id * cmd_key,
+    size_t cmd_size,
+    void * cmd_value
+    )
+{
+	assert(dq->initialized);
+	
+	if(dq->late_start) {
+		dq->highest_delivered = inst_number-1;
+		dq->late_start = false;
+	}
+	
+    //This is beyond the circular buffer, spill it to 
+    // the overflow area if there is room, ignore it otherwise
+    if(inst_number >= (dq->highest_delivered + dq->queue_size)) {
+		if(!dq_is_in_overflow(dq, inst_number)) {
+	        LOG_MSG(DELIVERY_Q, ("Ignoring future instance %lu\n", inst_number));
+	        return;
+		}
+		if(inst_number > dq->highest_seen_cmdmap) {
+			dq->highest_seen_cmdmap = inst_number;
+		}
+		dq_overflow_slot * os = dq_get_overflow_slot(dq, inst_number);
+		LOG_MSG(DELIVERY_Q, ("Spilling mapping of inst:%lu to overflow\n", inst_number));
+		dq_update_mapping(&os->entry, &os->cmd, cmd_key, cmd_size, cmd_value);
+        return;
+	} else if (inst_number <= dq->highest_delivered) {
+        LOG_MSG(DELIVERY_Q, ("Ignoring old instance %lu\n", inst_number));
+        return;
+	}
+	
+	//Inst number is within working bounds
+    
+    //Keep track of highest seen mapping
+    if(inst_number > dq->highest_seen_cmdmap) {
+        dq->highest_seen_cmdmap = inst_number;
+    }
+    
+    dq_entry * e = dq_get_entry(dq, inst_number);
+	assert(e->inst_number == inst_number);
+
+	cmd_slot * cs = dq_get_slot(dq, e);
+	assert(cs != NULL);
+	
+	bool deliverable = dq_update_mapping(e, cs, cmd_key, cmd_size, cmd_value);
+	dq_sync_bits(dq, inst_number, e);
+	if(deliverable) {
+		//It may be possible to deliver this (and following) values now
+		dq_deliver_loop(dq);
+	}
+}
+
+void delivery_queue_handle_acceptance(
+    delivery_queue * dq, 
+    iid_t inst_number,
+    command_id * cmd_key
+    )
+{
+	assert(dq->initialized);
+	
+	if(dq->late_start) {
+		dq->highest_delivered = inst_number-1;
+		dq->late_start = false;
+	}
+	
+	//Keep track of highest seen mapping
+    if(inst_number > dq->highest_seen_closed) {
+        dq->highest_seen_closed = inst_number;
+    }
+
+    //This is beyond the circular buffer, spill it to 
+    // the overflow area if there is room, ignore it otherwise
+    if(inst_number >= (dq->highest_delivered + dq->queue_size)) {
+		if(!dq_is_in_overflow(dq, inst_number)) {
+	        LOG_MSG(DELIVERY_Q, ("Ignoring future instance %lu\n", inst_number));
+	        return;
+		}
+		dq_overflow_slot * os = dq_get_overflow_slot(dq, inst_number);
+		LOG_MSG(DELIVERY_Q, ("Spilling acceptance of inst:%lu to overflow\n", inst_number));
+		dq_update_acceptance(&os->entry, cmd_key);
+        return;
+	} else if (inst_number <= dq->highest_delivered) {
+        LOG_MSG(DELIVERY_Q, ("Ignoring old instance %lu\n", inst_number));
+        return;
+	}
+	
+	//Inst number is within working bounds
+
+    dq_entry * e = dq_get_entry(dq, inst_number);
+
+	bool deliverable = dq_update_acceptance(e, cmd_key);
+	dq_sync_bits(dq, inst_number, e);
+	if(deliverable) {
+		//It may be possible to deliver this (and following) values now
+		dq_deliver_loop(dq);
+	}
 }
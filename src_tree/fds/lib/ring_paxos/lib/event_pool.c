@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "lp_event_pool.h"
+#include "lp_timers.h"
+#include "lp_utils.h"
+
+//How often each thread checks if it should exit
+#define EVENT_POOL_STOP_CHECK_USEC 10000
+
+typedef struct event_pool_slot_t {
+	event_pool * parent;
+	struct event_base * base;
+	pthread_t thread;
+	periodic_event * stop_check;
+} event_pool_slot;
+
+struct event_pool_t {
+	int threads_count;
+	event_pool_slot * slots;
+	//Set by event_pool_stop, read by all threads
+	volatile bool stopping;
+	bool running;
+	bool initialized;
+};
+
+//Loopbreak is not safe from another thread, 
+// each base breaks its own loop when asked to stop
+static void event_pool_stop_check(void * arg) {
+	event_pool_slot * s = arg;
+	if(s->parent->stopping) {
+		event_base_loopbreak(s->base);
+	}
+}
+
+static void * event_pool_thread(void * arg) {
+	event_pool_slot * s = arg;
+	event_base_dispatch(s->base);
+	return NULL;
+}
+
+event_pool * event_pool_init(int threads_count) {
+	assert(threads_count > 0);
+
+	event_pool * ep = calloc(1, sizeof(event_pool));
+	assert(ep != NULL);
+	assert(!ep->initialized);
+
+	ep->slots = calloc(threads_count, sizeof(event_pool_slot));
+	assert(ep->slots != NULL);
+	ep->threads_count = threads_count;
+
+	struct timeval interval = {0, EVENT_POOL_STOP_CHECK_USEC};
+	int i;
+	for(i = 0; i < threads_count; i++) {
+		event_pool_slot * s = &ep->slots[i];
+		s->parent = ep;
+		s->base = event_base_new();
+		assert(s->base != NULL);
+		//Also keeps the loop alive while the base has no other event
+		s->stop_check = set_periodic_event_on_base(s->base, &interval, event_pool_stop_check, s);
+		assert(s->stop_check != NULL);
+	}
+
+	ep->initialized = true;
+	LOG_MSG(DEBUG, ("Event pool initialized with %d threads\n", threads_count));
+	return ep;
+}
+
+int event_pool_get_threads_count(event_pool * ep) {
+	assert(ep->initialized);
+	return ep->threads_count;
+}
+
+struct event_base * event_pool_get_base(event_pool * ep, int index) {
+	assert(ep->initialized);
+	assert(index >= 0);
+	return ep->slots[index % ep->threads_count].base;
+}
+
+void event_pool_start(event_pool * ep) {
+	assert(ep->initialized);
+	assert(!ep->running);
+
+	ep->stopping = false;
+	int i, result;
+	for(i = 0; i < ep->threads_count; i++) {
+		result = pthread_create(&ep->slots[i].thread, NULL, event_pool_thread, &ep->slots[i]);
+		assert(result == 0);
+	}
+	ep->running = true;
+}
+
+void event_pool_stop(event_pool * ep) {
+	assert(ep->initialized);
+	assert(ep->running);
+
+	ep->stopping = true;
+	int i, result;
+	for(i = 0; i < ep->threads_count; i++) {
+		result = pthread_join(ep->slots[i].thread, NULL);
+		assert(result == 0);
+	}
+	ep->running = false;
+}
@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+
+#include "lp_utils.h"
+#include "lp_timers.h"
+#include "lp_failure_detection.h"
+
+//Heartbeats on an idle network are very regular, with a tiny
+// deviation phi would explode on the first heartbeat slightly late.
+// The deviation used is never below this fraction of the mean interval
+#define FD_MIN_STDDEV_RATIO 0.5
+
+//Inter-arrival times (in milliseconds) of the last heartbeats of an acceptor
+typedef struct fd_history_t {
+	bool heard;
+	struct timeval last_heartbeat;
+	double intervals[FD_HISTORY_SIZE];
+	int count;
+	int next;
+	double sum;
+	double sum_squares;
+} fd_history;
+
+struct failure_detector_t {
+	config_mngr * cfg;
+
+	//Acceptors not heard yet are not suspected before this deadline
+	struct timeval startup_deadline;
+	double timeout_msec;
+	double phi_threshold;
+	//Mean interval assumed until the first interval is observed
+	double expected_interval_msec;
+
+	fd_history history[MAX_ACCEPTORS];
+
+	bool initialized;
+};
+
+/*** HELPERS ***/
+
+static double timeval_to_msec(struct timeval * tv) {
+	return (tv->tv_sec * 1000.0) + (tv->tv_usec / 1000.0);
+}
+
+static double elapsed_msec(struct timeval * from, struct timeval * to) {
+	return timeval_to_msec(to) - timeval_to_msec(from);
+}
+
+static fd_history * get_history(failure_detector * fd, acceptor_id_t acceptor) {
+	assert(fd->initialized);
+	assert(acceptor < MAX_ACCEPTORS);
+	return &fd->history[acceptor];
+}
+
+static void add_interval(fd_history * h, double interval) {
+	if(h->count == FD_HISTORY_SIZE) {
+		//Replace the oldest interval
+		double oldest = h->intervals[h->next];
+		h->sum -= oldest;
+		h->sum_squares -= (oldest * oldest);
+	} else {
+		h->count += 1;
+	}
+	h->intervals[h->next] = interval;
+	h->next = (h->next + 1) % FD_HISTORY_SIZE;
+	h->sum += interval;
+	h->sum_squares += (interval * interval);
+}
+
+//-log10 of the probability that an interval is longer than elapsed,
+// using the logistic approximation of the normal distribution
+static double compute_phi(double elapsed, double mean, double stddev) {
+	double y = (elapsed - mean) / stddev;
+	double e = exp(-y * (1.5976 + 0.070566 * y * y));
+	if(elapsed > mean) {
+		return -log10(e / (1.0 + e));
+	} else {
+		return -log10(1.0 - 1.0 / (1.0 + e));
+	}
+}
+
+/*** PUBLIC ***/
+
+failure_detector * failure_detector_init(config_mngr * cfg) {
+	assert(lpconfig_heartbeats_enabled(cfg));
+
+	failure_detector * fd = calloc(1, sizeof(failure_detector));
+	assert(fd != NULL);
+	assert(!fd->initialized);
+
+	fd->cfg = cfg;
+	fd->timeout_msec = timeval_to_msec(lpconfig_get_failure_detection_timeout(cfg));
+	fd->phi_threshold = lpconfig_get_phi_threshold(cfg);
+	fd->expected_interval_msec = timeval_to_msec(lpconfig_get_heartbeat_interval(cfg));
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	timer_set_timeout(&now, &fd->startup_deadline, lpconfig_get_failure_detection_timeout(cfg));
+
+	fd->initialized = true;
+	return fd;
+}
+
+void fd_heartbeat(failure_detector * fd, acceptor_id_t acceptor, struct timeval * now) {
+	fd_history * h = get_history(fd, acceptor);
+
+	if(h->heard) {
+		double interval = elapsed_msec(&h->last_heartbeat, now);
+		if(interval < 0) {
+			//Reordered or clock moved back
+			return;
+		}
+		add_interval(h, interval);
+	}
+	h->heard = true;
+	h->last_heartbeat = *now;
+}
+
+double fd_get_phi(failure_detector * fd, acceptor_id_t acceptor, struct timeval * now) {
+	fd_history * h = get_history(fd, acceptor);
+	if(!h->heard) {
+		return 0;
+	}
+
+	double mean = fd->expected_interval_msec;
+	double stddev = 0;
+	if(h->count > 0) {
+		mean = h->sum / h->count;
+		double variance = (h->sum_squares / h->count) - (mean * mean);
+		stddev = (variance > 0 ? sqrt(variance) : 0);
+	}
+	if(stddev < mean * FD_MIN_STDDEV_RATIO) {
+		stddev = mean * FD_MIN_STDDEV_RATIO;
+	}
+	if(stddev <= 0) {
+		return 0;
+	}
+	return compute_phi(elapsed_msec(&h->last_heartbeat, now), mean, stddev);
+}
+
+bool fd_is_suspected(failure_detector * fd, acceptor_id_t acceptor, struct timeval * now) {
+	fd_history * h = get_history(fd, acceptor);
+
+	if(!h->heard) {
+		return timer_is_expired(&fd->startup_deadline, now);
+	}
+	if(elapsed_msec(&h->last_heartbeat, now) > fd->timeout_msec) {
+		return true;
+	}
+	return (fd_get_phi(fd, acceptor, now) > fd->phi_threshold);
+}
+
+void failure_detector_destroy(failure_detector * fd) {
+	if(fd != NULL) {
+		fd->initialized = false;
+		free(fd);
+	}
+}
@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/time.h>
+
+#include "lp_utils.h"
+#include "lp_timers.h"
+#include "lp_network.h"
+#include "lp_failure_detection.h"
+#include "lp_leader_election.h"
+
+struct leader_election_t {
+	config_mngr * cfg;
+	failure_detector * fd;
+
+	acceptor_id_t self_id;
+	acceptor_id_t leader;
+	long unsigned changes_count;
+
+	//Candidates to leadership, in order of preference
+	acceptor_id_t candidates[MAX_ACCEPTORS];
+	int candidates_count;
+	//Suspects at the last check
+	bool suspected[MAX_ACCEPTORS];
+
+	//One sender to the ring port of each other acceptor
+	udp_sender * peers_send[MAX_ACCEPTORS];
+	periodic_event * heartbeat_ev;
+
+	election_change_callback cb;
+	void * cb_arg;
+
+	bool initialized;
+};
+
+/*** HELPERS ***/
+
+static bool is_acceptor(config_mngr * cfg, acceptor_id_t id) {
+	return (id > 0 && id < MAX_ACCEPTORS &&
+		lpconfig_get_ring_port_of(cfg, id) != 0);
+}
+
+//Checks suspects again, the leader is the first candidate not suspected
+static void update_leader(leader_election * le, struct timeval * now) {
+	bool changed = false;
+	acceptor_id_t i;
+	for(i = 1; i < MAX_ACCEPTORS; i++) {
+		if(i == le->self_id || !is_acceptor(le->cfg, i)) {
+			continue;
+		}
+		bool suspected = fd_is_suspected(le->fd, i, now);
+		if(suspected != le->suspected[i]) {
+			LOG_MSG(INFO, ("Acceptor %d is %s\n", (int)i, (suspected ? "suspected" : "trusted again")));
+			le->suspected[i] = suspected;
+			changed = true;
+		}
+	}
+
+	//Nobody can be trusted, keep the current one
+	acceptor_id_t new_leader = le->leader;
+	int c;
+	for(c = 0; c < le->candidates_count; c++) {
+		if(!le->suspected[le->candidates[c]]) {
+			new_leader = le->candidates[c];
+			break;
+		}
+	}
+
+	if(new_leader != le->leader) {
+		LOG_MSG(INFO, ("Leader changed from acceptor %d to acceptor %d\n",
+			(int)le->leader, (int)new_leader));
+		le->leader = new_leader;
+		le->changes_count += 1;
+		changed = true;
+	}
+
+	if(changed && le->cb != NULL) {
+		le->cb(le->cb_arg);
+	}
+}
+
+static void send_heartbeats(void * arg) {
+	leader_election * le = arg;
+	assert(le->initialized);
+
+	heartbeat_msg hb;
+	hb.acceptor_id = le->self_id;
+
+	acceptor_id_t i;
+	for(i = 1; i < MAX_ACCEPTORS; i++) {
+		if(le->peers_send[i] != NULL) {
+			net_send_udp(le->peers_send[i], &hb, sizeof(heartbeat_msg), heartbeat);
+			udp_sender_force_flush(le->peers_send[i]);
+		}
+	}
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	update_leader(le, &now);
+}
+
+/*** PUBLIC ***/
+
+leader_election *
+leader_election_init(
+    election_change_callback cb,
+    void * cb_arg,
+    config_mngr * cfg
+    )
+{
+	acceptor_id_t self = lpconfig_get_self_acceptor_id(cfg);
+	assert(lpconfig_heartbeats_enabled(cfg));
+	assert(is_acceptor(cfg, self));
+
+	leader_election * le = calloc(1, sizeof(leader_election));
+	assert(le != NULL);
+	assert(!le->initialized);
+
+	le->cfg = cfg;
+	le->self_id = self;
+
+	le->fd = failure_detector_init(cfg);
+	assert(le->fd != NULL);
+
+	acceptor_id_t i;
+	for(i = 1; i < MAX_ACCEPTORS; i++) {
+		if(!is_acceptor(cfg, i)) {
+			continue;
+		}
+		le->candidates[le->candidates_count] = i;
+		le->candidates_count += 1;
+		if(i == self) {
+			continue;
+		}
+		le->peers_send[i] = udp_sender_init(
+			lpconfig_get_ip_addr_of(cfg, i),
+			lpconfig_get_ring_port_of(cfg, i),
+			cfg);
+		assert(le->peers_send[i] != NULL);
+	}
+
+	le->initialized = true;
+
+	//Nobody is suspected yet, the leader is the first candidate
+	// (callback not set yet, this is not a change)
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	le->leader = self;
+	update_leader(le, &now);
+	le->changes_count = 0;
+	le->cb = cb;
+	le->cb_arg = cb_arg;
+
+	le->heartbeat_ev = set_periodic_event_on_base(lpconfig_get_event_base(cfg),
+		lpconfig_get_heartbeat_interval(cfg),
+		send_heartbeats,
+		le);
+	assert(le->heartbeat_ev != NULL);
+
+	LOG_MSG(INFO, ("Leader election started, current leader is acceptor %d\n", (int)le->leader));
+	return le;
+}
+
+void leader_election_handle_heartbeat(leader_election * le, heartbeat_msg * msg, size_t size) {
+	assert(le->initialized);
+
+	if(size != sizeof(heartbeat_msg) || !is_acceptor(le->cfg, msg->acceptor_id) ||
+		msg->acceptor_id == le->self_id) {
+		LOG_MSG(WARNING, ("Warning: invalid heartbeat discarded\n"));
+		return;
+	}
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	fd_heartbeat(le->fd, msg->acceptor_id, &now);
+	update_leader(le, &now);
+}
+
+acceptor_id_t leader_election_get_leader(leader_election * le) {
+	assert(le->initialized);
+	return le->leader;
+}
+
+void leader_election_set_candidates(leader_election * le, acceptor_id_t * candidates, int count) {
+	assert(le->initialized);
+	assert(count > 0 && count < MAX_ACCEPTORS);
+
+	int c;
+	for(c = 0; c < count; c++) {
+		assert(is_acceptor(le->cfg, candidates[c]));
+	}
+	memcpy(le->candidates, candidates, count * sizeof(acceptor_id_t));
+	le->candidates_count = count;
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	update_leader(le, &now);
+}
+
+bool leader_election_is_suspected(leader_election * le, acceptor_id_t acceptor) {
+	assert(le->initialized);
+	assert(acceptor < MAX_ACCEPTORS);
+	return le->suspected[acceptor];
+}
+
+long unsigned leader_election_get_changes_count(leader_election * le) {
+	assert(le->initialized);
+	return le->changes_count;
+}
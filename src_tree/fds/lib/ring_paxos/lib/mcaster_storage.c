@@ -10,7 +10,7 @@ struct mcaster_storage_mngr_t {
 	
 	bool initialized;
 	
-    uint16_t seq_number;
+    uint64_t seq_number;
     long unsigned array_size;
     mcaster_instance_record instances_array[0];
 };
@@ -22,9 +22,6 @@ static void create_value_key(mcaster_storage_mngr * msm, command_id * cmd_key) {
     cmd_key->mcaster_incarnation = lpconfig_get_incarnation_number(msm->cfg);
     cmd_key->cmd_seqnum = msm->seq_number;
     msm->seq_number += 1;
-    if(msm->seq_number == 0xFFFF) {
-        msm->seq_number = 1; 
-    }
 }
 
 static void
@@ -66,6 +63,19 @@ mcaster_storage_mngr * mcaster_storage_init(config_mngr * cfg, clival_mngr * cvm
     return msm;
 }
 
+void mcaster_storage_reset(mcaster_storage_mngr * msm) {
+	assert(msm->initialized);
+
+	long unsigned i;
+	mcaster_instance_record * mir;
+	for(i = 0; i < msm->array_size; i++) {
+		mir = &msm->instances_array[i];
+		free(mir->assigned_cmd_value);
+		mcaster_storage_clear_record(mir);
+	}
+	//seq_number is not reset, the incarnation number is the same
+}
+
 mcaster_instance_record * mcaster_storage_get(mcaster_storage_mngr * msm, iid_t inst_number) {
 	assert(msm->initialized);
 	
@@ -135,22 +145,45 @@ void mcaster_storage_replace_assigned_value(
     CMD_KEY_COPY(assigned_cmd_key, cmd_key);
     
 
-    //If we get lucky, the identifier is different but the value is the same
-    if(mir->assigned_cmd_size == cmd_size &&
-    memcmp(mir->assigned_cmd_value, cmd_value, cmd_size) == 0) {
-        //Just the key must be replaced
-        return;
+    //No value of ours was assigned (i.e. value of a previous leader
+    // found while pre-executing phase 1), nothing to push back
+    if(mir->assigned_cmd_value != NULL) {
+        //If we get lucky, the identifier is different but the value is the same
+        if(mir->assigned_cmd_size == cmd_size &&
+        memcmp(mir->assigned_cmd_value, cmd_value, cmd_size) == 0) {
+            //Just the key must be replaced
+            return;
+        }
+        
+        //Push back our command in the queue, it will be sent later 
+        // in some other instance. Then do phase 2 with the returned one.
+        bool success;
+        success = cvm_push_back_value(msm->cvm, mir->assigned_cmd_value, mir->assigned_cmd_size);
+        assert(success == true);
     }
-    
-    
-    //Push back our command in the queue, it will be sent later 
-    // in some other instance. Then do phase 2 with the returned one.
-    bool success;
-    success = cvm_push_back_value(msm->cvm, mir->assigned_cmd_value, mir->assigned_cmd_size);
-    assert(success == true);
 
     //Copy the received value there;
     mir->assigned_cmd_size = cmd_size;
     mir->assigned_cmd_value = malloc(cmd_size);
     memcpy(mir->assigned_cmd_value, cmd_value, cmd_size);
 }
+
+iid_t mcaster_storage_takeover_iid(config_mngr * cfg, iid_t highest_seen) {
+	//The previous leader kept at most max_active_instances open in phase 2
+	// and preexecution_window_size more in phase 1, anything older is closed
+	iid_t in_progress = (iid_t)lpconfig_get_max_active_instances(cfg) + 
+		(iid_t)lpconfig_get_preexecution_window_size(cfg);
+	
+	if(highest_seen <= in_progress) {
+		return 0;
+	}
+	return highest_seen - in_progress;
+}
+
+iid_t mcaster_storage_lowest_iid(mcaster_storage_mngr * msm, iid_t highest_iid) {
+	assert(msm->initialized);
+	if(highest_iid < msm->array_size) {
+		return 1;
+	}
+	return highest_iid - msm->array_size + 1;
+}
@@ -1,5 +1,8 @@
 #include <stdio.h>
+#include <stdbool.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
 #include <fcntl.h>
 #include <assert.h>
 
@@ -56,3 +59,71 @@ void socket_set_bufsize(int sock, int size) {
         LOG_MSG(WARNING, ("(Your OS is probably limiting the maximum size, use sysctl to discover and set\n"));
     }
 }
+
+//UDP segmentation offload: a single send of more than size bytes 
+// is split by the kernel (or the NIC) into datagrams of size bytes.
+//Returns false if not supported by this OS
+bool socket_set_udp_segment(int sock, int size) {
+#ifdef UDP_SEGMENT
+    if (setsockopt(sock, IPPROTO_UDP, UDP_SEGMENT, &size, sizeof(int)) != 0) {
+        LOG_MSG(WARNING, ("WARNING: UDP segmentation offload not available\n"));
+        return false;
+    }
+    return true;
+#else
+    UNUSED_ARG(sock);
+    UNUSED_ARG(size);
+    return false;
+#endif
+}
+
+//Path MTU of a connected socket (for multicast, the MTU of 
+// the outgoing interface). Returns -1 if not available
+int socket_get_path_mtu(int sock) {
+#ifdef IP_MTU
+    int mtu = 0;
+    socklen_t size = sizeof(int);
+    if (getsockopt(sock, IPPROTO_IP, IP_MTU, &mtu, &size) != 0) {
+        perror("getsockopt, reading IP_MTU");
+        return -1;
+    }
+    return mtu;
+#else
+    UNUSED_ARG(sock);
+    return -1;
+#endif
+}
+
+//UDP receive offload: datagrams of the same flow can be 
+// coalesced and received with a single read.
+//Returns false if not supported by this OS
+bool socket_set_udp_gro(int sock) {
+#ifdef UDP_GRO
+    int activate = 1;
+    if (setsockopt(sock, IPPROTO_UDP, UDP_GRO, &activate, sizeof(int)) != 0) {
+        LOG_MSG(WARNING, ("WARNING: UDP receive offload not available\n"));
+        return false;
+    }
+    return true;
+#else
+    UNUSED_ARG(sock);
+    return false;
+#endif
+}
+
+//Busy polling: reads on this socket poll the device queue
+// for up to usec microseconds before sleeping.
+//Returns false if not supported (or not allowed) by this OS
+bool socket_set_busy_poll(int sock, int usec) {
+#ifdef SO_BUSY_POLL
+    if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(int)) != 0) {
+        LOG_MSG(WARNING, ("WARNING: Failed to set SO_BUSY_POLL to %d usec\n", usec));
+        return false;
+    }
+    return true;
+#else
+    UNUSED_ARG(sock);
+    UNUSED_ARG(usec);
+    return false;
+#endif
+}
@@ -8,6 +8,9 @@
 #include <assert.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netinet/udp.h>
 
 #include <event.h>
 
@@ -15,11 +18,32 @@
 #include "lp_timers.h"
 #include "lp_config_parser.h"
 #include "lp_utils.h"
+#include "lp_uring.h"
 
 // Defined in network_common.c
 void socket_set_reuse_port(int sock);
 void socket_set_nonblocking(int sock);
 void socket_set_bufsize(int sock, int size);
+bool socket_set_udp_segment(int sock, int size);
+int socket_get_path_mtu(int sock);
+bool socket_set_udp_gro(int sock);
+bool socket_set_busy_poll(int sock, int usec);
+
+//Largest packet that can be protected by a parity packet,
+// bigger ones are sent without forward error correction
+#define FEC_MAX_PROTECTED_SIZE (MAX_UDP_PAYLOAD - sizeof(lp_message_header) - sizeof(fec_parity_msg))
+
+//IPv4 and UDP headers, the rest of the path MTU is payload
+#define UDP_IPV4_HEADERS_SIZE 28
+//Path MTU assumed if the OS does not report it (ethernet)
+#define UDP_DEFAULT_PATH_MTU 1500
+
+static void fec_xor(char * dst, const char * src, size_t len) {
+    size_t i;
+    for(i = 0; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
 
 /*************************************************
    UDP Receiver 
@@ -49,57 +73,139 @@ struct udp_receiver_t {
 	int last_print_time;
 	long unsigned msg_received;
 	long unsigned tot_msg_received;
+	long unsigned recv_syscalls;
+
+	//Packets may be coalesced by the OS (UDP_GRO)
+	bool offload;
+
+	//Packets received through io_uring (if not NULL)
+	uring * uring;
+
+	//Forward error correction, state of the current block of packets
+	int fec_group_size;
+	bool fec_block_started;
+	uint32_t fec_incarnation;
+	uint32_t fec_block_first;
+	uint32_t fec_received_bitmap;
+	int fec_received_count;
+	uint16_t fec_size_xor;
+	uint16_t fec_max_size;
+	char * fec_xor_buf;
+	char * fec_recovered_buf;
+	long unsigned fec_recovered;
+	long unsigned fec_lost;
+
+	//Messages of the previous wire version are converted here
+	char * compat_buf;
   
 	bool initialized;
 };
 
-static void
-udp_read_callback_wrapper(int fd, short event, void *arg)
-{
-    UNUSED_ARG(event);
-    
-    udp_receiver * ur = arg;
-	assert(ur->initialized);
-	
-    int datasize;
-    
-    //Invoke the pre-receive callback (if set)
-    if(ur->pre_recv_cb != NULL) {
-        ur->pre_recv_cb(ur->cb_arg);
-    }
+static void udp_deliver_packet(udp_receiver * ur, char * buf, uint16_t udatasize);
 
-    //Get the message
-    socklen_t addrlen = sizeof(struct sockaddr);
-    datasize = recvfrom(fd,                 //Socket to read from
-        ur->recv_buf,                       //Where to store the msg
-        ur->recv_buf_size, 					//Size of buffer
-        MSG_WAITALL,                        //Get the entire message
-        (struct sockaddr *)&ur->saddr,      //Address
-        &addrlen);                          //Address length
+//Packets missing from the previous block could not be recovered
+static void fec_start_block(udp_receiver * ur, uint32_t first_seq) {
+	if(ur->fec_block_started) {
+		ur->fec_lost += (ur->fec_group_size - ur->fec_received_count);
+	}
 
-    //Error in recvfrom
-    if (datasize < 0) {
-        perror("recvfrom");
-        return;
-    }
+	memset(ur->fec_xor_buf, '\0', ur->fec_max_size);
+	ur->fec_max_size = 0;
+	ur->fec_size_xor = 0;
+	ur->fec_received_bitmap = 0;
+	ur->fec_received_count = 0;
+	ur->fec_block_first = first_seq;
+	ur->fec_block_started = true;
+}
 
-#ifdef UDP_STATS
-	ur->bytes_received += datasize;
-	ur->msg_received += 1;
-#endif
+//A protected packet was received, add it to the current block
+static void fec_track_packet(udp_receiver * ur, fec_header_msg * fh, char * payload, uint16_t size) {
+	if(ur->fec_group_size == 0) {
+		return;
+	}
 
-    //Invoke the post-receive callback (if set)
-    if(ur->post_recv_cb != NULL) {
-        ur->post_recv_cb(ur->cb_arg);
-    }
-    
-    uint16_t udatasize = (uint16_t)datasize;
-    //A packet may contain different messages, 
-    // invoke the receiving callback for each one
+	uint32_t first_seq = fh->packet_seq - (fh->packet_seq % ur->fec_group_size);
+	if(ur->fec_block_started && fh->incarnation != ur->fec_incarnation) {
+		//The sender restarted (or wrapped around), 
+		// its sequence numbers can't be compared with the current block
+		LOG_MSG(NETWORK, ("New FEC sender incarnation %u (was %u), restarting from packet %u\n",
+			fh->incarnation, ur->fec_incarnation, fh->packet_seq));
+		ur->fec_incarnation = fh->incarnation;
+		fec_start_block(ur, first_seq);
+	} else if(!ur->fec_block_started || (int32_t)(first_seq - ur->fec_block_first) > 0) {
+		ur->fec_incarnation = fh->incarnation;
+		fec_start_block(ur, first_seq);
+	} else if(first_seq != ur->fec_block_first) {
+		//Late packet of an old block
+		return;
+	}
+
+	uint32_t bit = (1u << (fh->packet_seq - first_seq));
+	if(ur->fec_received_bitmap & bit) {
+		return;
+	}
+	ur->fec_received_bitmap |= bit;
+	ur->fec_received_count += 1;
+	ur->fec_size_xor ^= size;
+	if(size > ur->fec_max_size) {
+		ur->fec_max_size = size;
+	}
+	fec_xor(ur->fec_xor_buf, payload, size);
+}
+
+//If a single packet of the block is missing, rebuild and deliver it
+static void fec_handle_parity(udp_receiver * ur, fec_parity_msg * fp, size_t size) {
+	if(ur->fec_group_size == 0) {
+		return;
+	}
+
+	if(fp->packets_count != ur->fec_group_size) {
+		LOG_MSG(WARNING, ("WARNING: parity for %u packets, expected %d, check mcast_fec_group_size\n",
+			fp->packets_count, ur->fec_group_size));
+		return;
+	}
+
+	if(!ur->fec_block_started || fp->incarnation != ur->fec_incarnation || 
+		fp->first_seq != ur->fec_block_first) {
+		return;
+	}
+
+	//Nothing to recover, or too many losses
+	if(ur->fec_received_count != (ur->fec_group_size - 1)) {
+		return;
+	}
+
+	uint16_t recovered_size = fp->size_xor ^ ur->fec_size_xor;
+	if(recovered_size > (size - sizeof(fec_parity_msg))) {
+		LOG_MSG(WARNING, ("WARNING: corrupted parity packet, dropping it\n"));
+		return;
+	}
+
+	int i;
+	for(i = 0; i < ur->fec_group_size; i++) {
+		if((ur->fec_received_bitmap & (1u << i)) == 0) {
+			break;
+		}
+	}
+	ur->fec_received_bitmap |= (1u << i);
+	ur->fec_received_count += 1;
+
+	memcpy(ur->fec_recovered_buf, fp->data, recovered_size);
+	fec_xor(ur->fec_recovered_buf, ur->fec_xor_buf, recovered_size);
+	ur->fec_recovered += 1;
+	LOG_MSG(NETWORK, ("Recovered packet %u (%u bytes) from parity\n", 
+		fp->first_seq + i, recovered_size));
+
+	udp_deliver_packet(ur, ur->fec_recovered_buf, recovered_size);
+}
+
+//A packet may contain different messages, 
+// invoke the receiving callback for each one
+static void udp_deliver_packet(udp_receiver * ur, char * buf, uint16_t udatasize) {
     uint16_t current_offset = 0;
     lp_message_header * next_msg;    
     while(current_offset < udatasize) {
-        next_msg = (lp_message_header *)&ur->recv_buf[current_offset];
+        next_msg = (lp_message_header *)&buf[current_offset];
         
         //This message has invalid size, to avoid strange behavior, 
         // drop the entire packet.
@@ -109,6 +215,65 @@ udp_read_callback_wrapper(int fd, short event, void *arg)
             break;
         }
 
+		//Sender too old to interoperate, drop the entire packet
+		if(next_msg->version < LP_WIRE_MIN_VERSION) {
+			LOG_MSG(WARNING, ("WARNING: message of wire version %u (min is %u), dropping this packet\n",
+				next_msg->version, LP_WIRE_MIN_VERSION));
+			break;
+		}
+
+		int min_size = lp_wire_min_size(next_msg->type);
+		//Type introduced by a newer version, skip it
+		if(min_size < 0) {
+			LOG_MSG(NETWORK, ("Skipping message of unknown type:%u (wire version %u)\n",
+				next_msg->type, next_msg->version));
+			current_offset += (next_msg->size + sizeof(lp_message_header));
+			continue;
+		}
+
+		//Sender not upgraded yet, convert the body if its layout changed
+		void * data = next_msg->data;
+		size_t size = next_msg->size;
+		if(next_msg->version < LP_WIRE_VERSION) {
+			int compat_size = lp_wire_upgrade(next_msg->type, data, size, ur->compat_buf);
+			if(compat_size < 0) {
+				LOG_MSG(WARNING, ("WARNING: malformed message of wire version %u [%d bytes, type:%u], dropping it\n",
+					next_msg->version, next_msg->size, next_msg->type));
+				current_offset += (next_msg->size + sizeof(lp_message_header));
+				continue;
+			}
+			if(compat_size > 0) {
+				data = ur->compat_buf;
+				size = compat_size;
+			}
+		}
+
+		//Shorter than its fixed part
+		if(size < (size_t)min_size) {
+			LOG_MSG(WARNING, ("WARNING: truncated message detected [%d bytes, type:%u], dropping this packet\n",
+				next_msg->size, next_msg->type));
+			break;
+		}
+
+		//Rest of the packet is empty (see udp_sender_flush_full)
+		if(next_msg->type == padding) {
+			break;
+		}
+
+		//Forward error correction messages are consumed here
+		if(next_msg->type == fec_header) {
+			uint16_t payload_offset = current_offset + sizeof(lp_message_header) + next_msg->size;
+			fec_track_packet(ur, (fec_header_msg*)next_msg->data, 
+				&buf[payload_offset], udatasize - payload_offset);
+			current_offset = payload_offset;
+			continue;
+		}
+		if(next_msg->type == fec_parity) {
+			fec_handle_parity(ur, (fec_parity_msg*)next_msg->data, next_msg->size);
+			current_offset += (next_msg->size + sizeof(lp_message_header));
+			continue;
+		}
+
 #ifdef MESSAGE_LOSS_PROBABILITY
 		//If the above symbol is defined, simulate random packet loss
 		if((random() % 100) < MESSAGE_LOSS_PROBABILITY) {
@@ -118,17 +283,109 @@ udp_read_callback_wrapper(int fd, short event, void *arg)
 			//Packet is not "lost"
 			LOG_MSG(NETWORK, ("Delivering %u bytes of network data (type:%d)\n", 
 				next_msg->size, next_msg->type));
-	        ur->cb(&next_msg->data, next_msg->size, next_msg->type, ur->cb_arg);
+	        ur->cb(data, size, next_msg->type, ur->cb_arg);
 		}
 #else
 		//Normal case, no (voluntary) packet loss
 		LOG_MSG(NETWORK, ("Delivering %u bytes of network data (type:%d)\n", 
 			next_msg->size, next_msg->type));
-        ur->cb(&next_msg->data, next_msg->size, next_msg->type, ur->cb_arg);
+        ur->cb(data, size, next_msg->type, ur->cb_arg);
 #endif     
 		//Move cursor forward to next message in packet
         current_offset += (next_msg->size + sizeof(lp_message_header));
     }
+}
+
+//Like recvfrom, but also returns the size of the packets 
+// if multiple ones were coalesced by the OS (0 otherwise)
+static int udp_recv_offload(udp_receiver * ur, int fd, int * segment_size) {
+    struct iovec iov;
+    iov.iov_base = ur->recv_buf;
+    iov.iov_len = ur->recv_buf_size;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr mh;
+    memset(&mh, '\0', sizeof(struct msghdr));
+    mh.msg_name = &ur->saddr;
+    mh.msg_namelen = sizeof(struct sockaddr_in);
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = control;
+    mh.msg_controllen = sizeof(control);
+
+    *segment_size = 0;
+    int datasize = recvmsg(fd, &mh, 0);
+    if(datasize < 0) {
+        return datasize;
+    }
+
+#ifdef UDP_GRO
+    struct cmsghdr * cmsg;
+    for(cmsg = CMSG_FIRSTHDR(&mh); cmsg != NULL; cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+        if(cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+            memcpy(segment_size, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+#endif
+    return datasize;
+}
+
+static void
+udp_read_callback_wrapper(int fd, short event, void *arg)
+{
+    UNUSED_ARG(event);
+    
+    udp_receiver * ur = arg;
+	assert(ur->initialized);
+	
+    int datasize;
+    
+    //Invoke the pre-receive callback (if set)
+    if(ur->pre_recv_cb != NULL) {
+        ur->pre_recv_cb(ur->cb_arg);
+    }
+
+    //Get the message
+    int segment_size = 0;
+    if(ur->offload) {
+        datasize = udp_recv_offload(ur, fd, &segment_size);
+    } else {
+        socklen_t addrlen = sizeof(struct sockaddr);
+        datasize = recvfrom(fd,                 //Socket to read from
+            ur->recv_buf,                       //Where to store the msg
+            ur->recv_buf_size, 					//Size of buffer
+            MSG_WAITALL,                        //Get the entire message
+            (struct sockaddr *)&ur->saddr,      //Address
+            &addrlen);                          //Address length
+    }
+
+    //Error in recvfrom
+    if (datasize < 0) {
+        perror("recvfrom");
+        return;
+    }
+
+    //Not coalesced, a single packet
+    if(segment_size <= 0 || segment_size > datasize) {
+        segment_size = datasize;
+    }
+
+#ifdef UDP_STATS
+	ur->bytes_received += datasize;
+	ur->msg_received += (datasize + segment_size - 1) / segment_size;
+	ur->recv_syscalls += 1;
+#endif
+
+    //Invoke the post-receive callback (if set)
+    if(ur->post_recv_cb != NULL) {
+        ur->post_recv_cb(ur->cb_arg);
+    }
+    
+    int offset;
+    for(offset = 0; offset < datasize; offset += segment_size) {
+        int size = (datasize - offset < segment_size ? datasize - offset : segment_size);
+        udp_deliver_packet(ur, &ur->recv_buf[offset], (uint16_t)size);
+    }
 
     //Invoke the post-deliver callback (if set)
     if(ur->post_dlvr_cb != NULL) {
@@ -136,6 +393,41 @@ udp_read_callback_wrapper(int fd, short event, void *arg)
     }
 }
 
+//Invoked by uring_recv_dispatch for each packet
+static void udp_uring_deliver(char * buf, int size, void * arg) {
+    udp_receiver * ur = arg;
+#ifdef UDP_STATS
+	ur->bytes_received += size;
+	ur->msg_received += 1;
+#endif
+    udp_deliver_packet(ur, buf, (uint16_t)size);
+}
+
+//Like udp_read_callback_wrapper, but packets were already 
+// received by the kernel in the registered buffers
+static void
+udp_uring_callback_wrapper(int fd, short event, void *arg)
+{
+    UNUSED_ARG(fd);
+    UNUSED_ARG(event);
+
+    udp_receiver * ur = arg;
+	assert(ur->initialized);
+
+    if(ur->pre_recv_cb != NULL) {
+        ur->pre_recv_cb(ur->cb_arg);
+    }
+    if(ur->post_recv_cb != NULL) {
+        ur->post_recv_cb(ur->cb_arg);
+    }
+
+    uring_recv_dispatch(ur->uring, udp_uring_deliver, ur);
+
+    if(ur->post_dlvr_cb != NULL) {
+        ur->post_dlvr_cb(ur->cb_arg);
+    }
+}
+
 udp_receiver *
 udp_receiver_init(
     char* addr_str,        /*Listen address (optional)*/
@@ -179,6 +471,8 @@ udp_receiver_init(
         //Get buffer size and allocate it
         ur->recv_buf_size = MAX_UDP_PAYLOAD;
         ur->recv_buf = calloc(1, ur->recv_buf_size);
+        ur->compat_buf = calloc(1, MAX_MESSAGE_SIZE + LP_WIRE_COMPAT_MAX_GROWTH);
+        assert(ur->recv_buf != NULL && ur->compat_buf != NULL);
         
         // Create socket and set options
         ur->sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -191,6 +485,9 @@ udp_receiver_init(
 		if(lpconfig_get_socket_buffers_size(ur->cfg) > 0) {
 	        socket_set_bufsize(ur->sock, lpconfig_get_socket_buffers_size(ur->cfg));			
 		}
+		if(lpconfig_get_busy_poll_usec(ur->cfg) > 0) {
+			socket_set_busy_poll(ur->sock, lpconfig_get_busy_poll_usec(ur->cfg));
+		}
 
         // Configure address and bind
         bzero(&ur->saddr, sizeof(struct sockaddr_in));
@@ -205,6 +502,7 @@ udp_receiver_init(
 
         // Create receive event
         event_set(&ur->recv_event, ur->sock, EV_READ|EV_PERSIST, udp_read_callback_wrapper, ur);
+        event_bind_base(lpconfig_get_event_base(ur->cfg), &ur->recv_event);
         event_add(&ur->recv_event, NULL);
 
 	//Bandwidth Statistics
@@ -215,6 +513,13 @@ udp_receiver_init(
         
 		ur->initialized = true;
 
+        if(lpconfig_get_udp_io_uring_buffers(ur->cfg) > 0) {
+            udp_receiver_enable_io_uring(ur, lpconfig_get_udp_io_uring_buffers(ur->cfg));
+        }
+        if(lpconfig_get_udp_offload_segments(ur->cfg) > 0 && ur->uring == NULL) {
+            udp_receiver_enable_offload(ur);
+        }
+
         LOG_MSG(INFO, ("Created receiver for UDP port %d\n", port));
         return ur;
     }
@@ -253,6 +558,10 @@ udp_receiver *
 	}
 
 	assert(ur->initialized);
+
+	if(lpconfig_get_mcast_fec_group_size(cfg) > 0) {
+		udp_receiver_enable_fec(ur, lpconfig_get_mcast_fec_group_size(cfg));
+	}
 	
 	LOG_MSG(INFO, ("Created receiver for multicast address %s:%d\n", addr_str, port));
 	return ur;
@@ -274,6 +583,59 @@ void udp_receiver_set_postdeliver_callback(udp_receiver * ur, receive_cb cb) {
     ur->post_dlvr_cb = cb;
 }
 
+void udp_receiver_enable_fec(udp_receiver * ur, int group_size) {
+	assert(ur->initialized);
+	assert(group_size > 0 && group_size <= FEC_MAX_GROUP_SIZE);
+	assert(ur->fec_group_size == 0);
+
+	ur->fec_xor_buf = calloc(1, MAX_UDP_PAYLOAD);
+	ur->fec_recovered_buf = calloc(1, MAX_UDP_PAYLOAD);
+	assert(ur->fec_xor_buf != NULL && ur->fec_recovered_buf != NULL);
+	ur->fec_group_size = group_size;
+	LOG_MSG(INFO, ("Forward error correction enabled (1 parity every %d packets)\n", group_size));
+}
+
+void udp_receiver_enable_offload(udp_receiver * ur) {
+	//Packets read by io_uring are not split
+	if(ur->uring != NULL || !socket_set_udp_gro(ur->sock)) {
+		return;
+	}
+
+	//Buffer must fit multiple coalesced packets
+	free(ur->recv_buf);
+	ur->recv_buf_size = UDP_OFFLOAD_MAX_BYTES;
+	ur->recv_buf = calloc(1, ur->recv_buf_size);
+	assert(ur->recv_buf != NULL);
+	ur->offload = true;
+}
+
+bool udp_receiver_enable_io_uring(udp_receiver * ur, int buffers_count) {
+	assert(ur->initialized);
+	assert(!ur->offload && ur->uring == NULL);
+
+	ur->uring = uring_recv_init(ur->sock, buffers_count, MAX_UDP_PAYLOAD);
+	if(ur->uring == NULL) {
+		LOG_MSG(WARNING, ("WARNING: io_uring not supported, using normal reads on port %d\n", 
+			ntohs(ur->saddr.sin_port)));
+		return false;
+	}
+
+	//Watch the ring instead of the socket
+	event_del(&ur->recv_event);
+	event_set(&ur->recv_event, uring_get_fd(ur->uring), EV_READ|EV_PERSIST, udp_uring_callback_wrapper, ur);
+	event_bind_base(lpconfig_get_event_base(ur->cfg), &ur->recv_event);
+	event_add(&ur->recv_event, NULL);
+	LOG_MSG(INFO, ("Receiving through io_uring (%d buffers)\n", buffers_count));
+	return true;
+}
+
+long unsigned udp_receiver_get_syscalls(udp_receiver * ur) {
+	if(ur->uring != NULL) {
+		return ur->recv_syscalls + uring_get_syscalls(ur->uring);
+	}
+	return ur->recv_syscalls;
+}
+
 void udp_receiver_print_stats(udp_receiver * ur, int current_time) {
 #ifndef UDP_STATS
 	return;
@@ -298,7 +660,10 @@ void udp_receiver_print_stats(udp_receiver * ur, int current_time) {
 	ur->msg_received = 0;
 	ur->last_print_time = current_time;
 	
-	printf("  %lu message received\n", ur->tot_msg_received);
+	printf("  %lu message received (%lu read calls)\n", ur->tot_msg_received, ur->recv_syscalls);
+	if(ur->fec_group_size > 0) {
+		printf("  %lu packets recovered by FEC, %lu lost\n", ur->fec_recovered, ur->fec_lost);
+	}
 }
 
 /*************************************************
@@ -317,6 +682,8 @@ struct udp_sender_t {
     char * send_buf;
     int send_buf_size;
     int current_buf_size;
+	//Messages are batched in a packet up to this size
+	int packet_size;
 	periodic_event * autoflush_event;
 	
 	//Bandwidth Statistics
@@ -324,6 +691,36 @@ struct udp_sender_t {
 	int last_print_time;
 	long unsigned msg_sent;
 	long unsigned tot_msg_sent;
+	long unsigned send_syscalls;
+
+	//With segmentation offload, full packets are accumulated in 
+	// offload_buf (send_buf points to the one being filled) and
+	// passed to the OS at once. Segments fit in the path MTU
+	int offload_segments;
+	int offload_segment_size;
+	int offload_count;
+	char * offload_buf;
+
+	//Packets queued in io_uring (if not NULL), send_buf is 
+	// one of its buffers and changes at each flush
+	uring * uring;
+	bool uring_submit_scheduled;
+
+	//Forward error correction, the parity buffer 
+	// accumulates the packets of the current block
+	int fec_group_size;
+	uint32_t fec_incarnation;
+	uint32_t fec_next_seq;
+	int fec_block_count;
+	uint16_t fec_max_size;
+	char * fec_parity_buf;
+	long unsigned fec_parity_sent;
+	long unsigned fec_unprotected;
+
+	//Version written in the headers, if older than LP_WIRE_VERSION
+	// messages are converted to its layout in compat_buf
+	int wire_version;
+	char * compat_buf;
 	
 	bool initialized;
 };
@@ -350,6 +747,12 @@ udp_sender_init(
         
 		us->cfg = cfg;
 
+		us->wire_version = lpconfig_get_wire_version(cfg);
+		if(us->wire_version != LP_WIRE_VERSION) {
+			us->compat_buf = calloc(1, MAX_MESSAGE_SIZE + LP_WIRE_COMPAT_MAX_GROWTH);
+			assert(us->compat_buf != NULL);
+		}
+
         //Copy the IP address string
         assert(addr_str != NULL);
         if (strlen(addr_str) >= 16 || strlen(addr_str) < 7) {
@@ -365,6 +768,7 @@ udp_sender_init(
         us->current_buf_size = 0;
         us->send_buf_size = MAX_UDP_PAYLOAD;
         us->send_buf = calloc(1, us->send_buf_size);
+        us->packet_size = MAX_MESSAGE_SIZE;
 
         // Create socket and set options
         us->sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -401,6 +805,13 @@ udp_sender_init(
 
 		us->initialized = true;
 
+		if(lpconfig_get_udp_io_uring_buffers(us->cfg) > 0) {
+			udp_sender_enable_io_uring(us, lpconfig_get_udp_io_uring_buffers(us->cfg));
+		}
+		if(lpconfig_get_udp_offload_segments(us->cfg) > 0 && us->uring == NULL) {
+			udp_sender_enable_offload(us, lpconfig_get_udp_offload_segments(us->cfg));
+		}
+
         LOG_MSG(INFO, ("Created sender for UDP address %s:%d\n", us->ip_str, port));
         return us;
  
@@ -409,6 +820,9 @@ udp_sender_init_error:
     if (us->send_buf != NULL) {
         free(us->send_buf);
     }
+    if (us->compat_buf != NULL) {
+        free(us->compat_buf);
+    }
     free(us);
     return NULL;
 }
@@ -446,21 +860,248 @@ udp_sender *
 
 	assert(us->initialized);
 
+	if(lpconfig_get_mcast_fec_group_size(cfg) > 0) {
+		udp_sender_enable_fec(us, lpconfig_get_mcast_fec_group_size(cfg));
+	}
+
 	LOG_MSG(INFO, ("Created sender for multicast address %s:%d\n", addr_str, port));
 	return us;
 }
 
+//Sends the parity of the current block and starts a new one
+static void fec_send_parity(udp_sender * us) {
+	lp_message_header * mh = (lp_message_header *)us->fec_parity_buf;
+	fec_parity_msg * fp = (fec_parity_msg *)mh->data;
+
+	mh->size = sizeof(fec_parity_msg) + us->fec_max_size;
+	mh->type = fec_parity;
+	mh->version = us->wire_version;
+	fp->incarnation = us->fec_incarnation;
+	fp->first_seq = us->fec_next_seq - us->fec_group_size;
+	fp->packets_count = us->fec_group_size;
+
+	int data_sent = send(us->sock, us->fec_parity_buf, sizeof(lp_message_header) + mh->size, 0);
+	us->send_syscalls += 1;
+	if(data_sent < 0) {
+		perror("send");
+	} else {
+		us->fec_parity_sent += 1;
+	}
+
+	memset(fp->data, '\0', us->fec_max_size);
+	fp->size_xor = 0;
+	us->fec_max_size = 0;
+	us->fec_block_count = 0;
+
+	//Blocks are aligned to multiples of the group size, 
+	// wrap around at a block boundary and let receivers know
+	if(us->fec_next_seq > (UINT32_MAX - us->fec_group_size)) {
+		us->fec_next_seq = 0;
+		us->fec_incarnation += 1;
+	}
+}
+
+//Sends the current packet preceded by a fec_header, 
+// returns the number of payload bytes sent
+static int fec_send_protected(udp_sender * us) {
+	char header_buf[sizeof(lp_message_header) + sizeof(fec_header_msg)];
+	lp_message_header * mh = (lp_message_header *)header_buf;
+	fec_header_msg * fh = (fec_header_msg *)mh->data;
+	mh->size = sizeof(fec_header_msg);
+	mh->type = fec_header;
+	mh->version = us->wire_version;
+	fh->incarnation = us->fec_incarnation;
+	fh->packet_seq = us->fec_next_seq;
+	us->fec_next_seq += 1;
+
+	struct iovec iov[2];
+	iov[0].iov_base = header_buf;
+	iov[0].iov_len = sizeof(header_buf);
+	iov[1].iov_base = us->send_buf;
+	iov[1].iov_len = us->current_buf_size;
+	struct msghdr msg;
+	memset(&msg, '\0', sizeof(struct msghdr));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+	int data_sent = sendmsg(us->sock, &msg, 0);
+	us->send_syscalls += 1;
+
+	//Added to the parity even if the send failed, 
+	// receivers may still be able to rebuild it
+	fec_parity_msg * fp = (fec_parity_msg *)((lp_message_header *)us->fec_parity_buf)->data;
+	fec_xor(fp->data, us->send_buf, us->current_buf_size);
+	fp->size_xor ^= (uint16_t)us->current_buf_size;
+	if(us->current_buf_size > us->fec_max_size) {
+		us->fec_max_size = us->current_buf_size;
+	}
+	us->fec_block_count += 1;
+	if(us->fec_block_count == us->fec_group_size) {
+		fec_send_parity(us);
+	}
+
+	if(data_sent < 0) {
+		return data_sent;
+	}
+	return data_sent - sizeof(header_buf);
+}
+
+//Sends the full packets accumulated plus the current one with a single call,
+// the OS splits them (they all have size offload_segment_size, except the last one)
+static int udp_offload_send(udp_sender * us) {
+	int segment_size = us->offload_segment_size;
+	int segments = us->offload_count + (us->current_buf_size > 0 ? 1 : 0);
+	int total_size = us->offload_count * segment_size + us->current_buf_size;
+	int result = 0;
+
+	//Segment size given with the send, the socket default is no segmentation
+	// (a message larger than a segment is sent alone, see net_send_udp)
+	struct iovec iov = {us->offload_buf, total_size};
+	struct msghdr mh;
+	memset(&mh, '\0', sizeof(struct msghdr));
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+#ifdef UDP_SEGMENT
+	char control[CMSG_SPACE(sizeof(uint16_t))];
+	memset(control, '\0', sizeof(control));
+	mh.msg_control = control;
+	mh.msg_controllen = sizeof(control);
+	struct cmsghdr * cm = CMSG_FIRSTHDR(&mh);
+	cm->cmsg_level = SOL_UDP;
+	cm->cmsg_type = UDP_SEGMENT;
+	cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+	*((uint16_t *)CMSG_DATA(cm)) = (uint16_t)segment_size;
+#endif
+
+	int data_sent = sendmsg(us->sock, &mh, 0);
+	us->send_syscalls += 1;
+
+	if(data_sent < 0) {
+		//Not supported for this destination (i.e. the interface
+		// cannot do checksum offload), send packets one by one from now on
+		perror("send (segmentation offload)");
+		LOG_MSG(WARNING, ("WARNING: disabling UDP segmentation offload for %s:%d\n", 
+			us->ip_str, ntohs(us->saddr.sin_port)));
+		us->offload_segments = 0;
+
+		int offset;
+		data_sent = 0;
+		for(offset = 0; offset < total_size; offset += segment_size) {
+			int size = (total_size - offset < segment_size ? total_size - offset : segment_size);
+			int sent = send(us->sock, &us->offload_buf[offset], size, 0);
+			us->send_syscalls += 1;
+			if(sent < 0) {
+				perror("send");
+				result = 1;
+			} else {
+				data_sent += sent;
+			}
+		}
+	}
+	LOG_MSG(NETWORK, ("Send buffer flushed, %u bytes in %d packets\n", data_sent, segments));
+#ifdef UDP_STATS
+	us->bytes_sent += data_sent;
+	us->msg_sent += segments;
+#endif
+
+	us->offload_count = 0;
+	us->current_buf_size = 0;
+	us->send_buf = us->offload_buf;
+	if(us->offload_segments == 0) {
+		us->packet_size = MAX_MESSAGE_SIZE;
+	}
+	return result;
+}
+
+//Submits the packets queued in the current event loop iteration
+static void udp_uring_submit_cb(int fd, short event, void * arg) {
+	UNUSED_ARG(fd);
+	UNUSED_ARG(event);
+
+	udp_sender * us = arg;
+	us->uring_submit_scheduled = false;
+	uring_submit(us->uring);
+}
+
+//Queues the current packet, it is actually sent when 
+// control returns to the event loop
+static int udp_uring_send(udp_sender * us) {
+	uring_send_queue(us->uring, us->send_buf, us->current_buf_size);
+	us->send_buf = uring_send_get_buffer(us->uring);
+
+	if(!us->uring_submit_scheduled) {
+		struct timeval now = {0, 0};
+		struct event_base * base = lpconfig_get_event_base(us->cfg);
+		int result = (base != NULL ?
+			event_base_once(base, -1, EV_TIMEOUT, udp_uring_submit_cb, us, &now) :
+			event_once(-1, EV_TIMEOUT, udp_uring_submit_cb, us, &now));
+		if(result != 0) {
+			uring_submit(us->uring);
+		} else {
+			us->uring_submit_scheduled = true;
+		}
+	}
+	return us->current_buf_size;
+}
+
+//Invoked when the current packet is full: with segmentation offload
+// it's padded and kept until more packets are full or an explicit flush
+static void udp_sender_flush_full(udp_sender * us) {
+	if(us->offload_segments == 0 || us->fec_group_size > 0) {
+		udp_sender_force_flush(us);
+		return;
+	}
+
+	//All packets but the last must have the same size, fill with padding
+	int free_space = us->offload_segment_size - us->current_buf_size;
+	if(free_space > 0) {
+		if(free_space < (int)sizeof(lp_message_header)) {
+			//Cannot be padded, goes as last packet
+			udp_sender_force_flush(us);
+			return;
+		}
+		lp_message_header * mh = (lp_message_header *)&us->send_buf[us->current_buf_size];
+		mh->size = free_space - sizeof(lp_message_header);
+		mh->type = padding;
+		mh->version = us->wire_version;
+	}
+
+	us->offload_count += 1;
+	us->current_buf_size = 0;
+	us->send_buf = &us->offload_buf[us->offload_count * us->offload_segment_size];
+	if(us->offload_count == us->offload_segments) {
+		udp_offload_send(us);
+	}
+}
+
 int 
 udp_sender_force_flush(udp_sender * us) {
 	assert(us->initialized);
     assert(us->current_buf_size <= us->send_buf_size);
+
+    //Full packets are waiting to be sent, this one is the last
+    if(us->offload_count > 0) {
+        return udp_offload_send(us);
+    }
     
     //Nothing to send
     if(us->current_buf_size == 0) {
         return 0;
     }
     
-    int data_sent = send(us->sock, us->send_buf, us->current_buf_size, 0);
+    int data_sent;
+    if(us->fec_group_size > 0 && us->current_buf_size <= (int)FEC_MAX_PROTECTED_SIZE) {
+        data_sent = fec_send_protected(us);
+    } else {
+        if(us->fec_group_size > 0) {
+            us->fec_unprotected += 1;
+        }
+        if(us->uring != NULL) {
+            data_sent = udp_uring_send(us);
+        } else {
+            data_sent = send(us->sock, us->send_buf, us->current_buf_size, 0);
+            us->send_syscalls += 1;
+        }
+    }
     if(data_sent < 0) {
         perror("send");
 		us->current_buf_size = 0;
@@ -492,11 +1133,29 @@ net_send_udp(udp_sender * us, void * data, int size, lp_msg_type type) {
 		return;
 	}
 
+	//Previous layout while the ring is upgraded (see lp_wire.h)
+	if(us->compat_buf != NULL) {
+		int compat_size = lp_wire_downgrade(type, data, size, us->compat_buf);
+		if(compat_size < 0 || compat_size > MAX_MESSAGE_SIZE) {
+			printf("Error: cannot send message of type %d [%d bytes] with wire version %d\n",
+				type, size, us->wire_version);
+			return;
+		}
+		if(compat_size > 0) {
+			data = us->compat_buf;
+			size = compat_size;
+		}
+	}
+
     int total_size = size + sizeof(lp_message_header);
+    //Does not fit in a segment (with offload), sent alone without segmentation
+    bool oversize = (total_size > us->packet_size);
 	
     //If data does not fit in the current buffer, flush it.
-    if(us->current_buf_size + total_size > MAX_MESSAGE_SIZE) {
+    if(oversize) {
         udp_sender_force_flush(us);
+    } else if(us->current_buf_size + total_size > us->packet_size) {
+        udp_sender_flush_full(us);
     }
     
 	LOG_MSG(NETWORK, ("Adding %u (+%lu) bytes to send buffer\n", 
@@ -506,6 +1165,7 @@ net_send_udp(udp_sender * us, void * data, int size, lp_msg_type type) {
     lp_message_header * destination = (lp_message_header *)&us->send_buf[us->current_buf_size];
     destination->size = size;
     destination->type = type;
+    destination->version = us->wire_version;
     
     //Copy the message data
     memcpy(destination->data, data, size);
@@ -514,8 +1174,10 @@ net_send_udp(udp_sender * us, void * data, int size, lp_msg_type type) {
     us->current_buf_size += total_size;
 
     //If there's no space left in the current buffer, flush it.
-    if((MAX_MESSAGE_SIZE - us->current_buf_size) <= (int)sizeof(lp_message_header)) {
+    if(oversize) {
         udp_sender_force_flush(us);
+    } else if((us->packet_size - us->current_buf_size) <= (int)sizeof(lp_message_header)) {
+        udp_sender_flush_full(us);
     }
 }
 
@@ -531,7 +1193,8 @@ void udp_sender_enable_autoflush(udp_sender * us, unsigned milliseconds) {
 	struct timeval interval;
 	interval.tv_sec = (milliseconds/1000);
 	interval.tv_usec = (milliseconds % 1000) * 1000;
-	us->autoflush_event = set_periodic_event(&interval, udp_autoflush_cb, us);
+	us->autoflush_event = set_periodic_event_on_base(lpconfig_get_event_base(us->cfg),
+		&interval, udp_autoflush_cb, us);
 }
 
 void udp_sender_enable_default_autoflush(udp_sender * us) {
@@ -540,6 +1203,117 @@ void udp_sender_enable_default_autoflush(udp_sender * us) {
 	udp_sender_enable_autoflush(us, lpconfig_get_default_autoflush_interval(us->cfg));
 }
 
+void udp_sender_enable_fec(udp_sender * us, int group_size) {
+	assert(us->initialized);
+	assert(group_size > 0 && group_size <= FEC_MAX_GROUP_SIZE);
+	assert(us->fec_group_size == 0);
+
+	us->fec_parity_buf = calloc(1, MAX_UDP_PAYLOAD);
+	assert(us->fec_parity_buf != NULL);
+	us->fec_group_size = group_size;
+	//Different for each sender process, receivers reset their block when it changes
+	us->fec_incarnation = (uint32_t)random() ^ ((uint32_t)getpid() << 16) ^ (uint32_t)time(NULL);
+	LOG_MSG(INFO, ("Forward error correction enabled (1 parity every %d packets)\n", group_size));
+}
+
+//Segments are datagrams of the full path MTU (not fragmented),
+// messages are batched in a segment leaving room for a padding header
+static void udp_sender_set_segment_size(udp_sender * us) {
+	int mtu = socket_get_path_mtu(us->sock);
+	if(mtu <= UDP_IPV4_HEADERS_SIZE) {
+		mtu = UDP_DEFAULT_PATH_MTU;
+	}
+	int segment_size = mtu - UDP_IPV4_HEADERS_SIZE;
+	if(segment_size > MAX_UDP_PAYLOAD) {
+		segment_size = MAX_UDP_PAYLOAD;
+	}
+	us->offload_segment_size = segment_size;
+	us->packet_size = segment_size - sizeof(lp_message_header);
+	if(us->packet_size > MAX_MESSAGE_SIZE) {
+		us->packet_size = MAX_MESSAGE_SIZE;
+	}
+	LOG_MSG(INFO, ("Segmentation offload for %s:%d, path MTU %d, segments of %d bytes\n", 
+		us->ip_str, ntohs(us->saddr.sin_port), mtu, segment_size));
+}
+
+void udp_sender_enable_offload(udp_sender * us, int max_segments) {
+	assert(us->initialized);
+	assert(max_segments > 0 && max_segments <= (int)UDP_OFFLOAD_MAX_SEGMENTS);
+
+	//Packets queued in io_uring are not coalesced.
+	// Checks that the OS supports it, the segment size is given with each send
+	if(us->uring != NULL || !socket_set_udp_segment(us->sock, MAX_UDP_PAYLOAD) ||
+		!socket_set_udp_segment(us->sock, 0)) {
+		return;
+	}
+
+	//Room for segments of any size, and for a message sent alone
+	us->offload_buf = calloc(max_segments, MAX_UDP_PAYLOAD);
+	assert(us->offload_buf != NULL);
+	free(us->send_buf);
+	us->send_buf = us->offload_buf;
+	us->offload_segments = max_segments;
+	udp_sender_set_segment_size(us);
+}
+
+bool udp_sender_enable_io_uring(udp_sender * us, int buffers_count) {
+	assert(us->initialized);
+	assert(us->offload_segments == 0 && us->uring == NULL);
+	assert(us->current_buf_size == 0);
+
+	us->uring = uring_send_init(us->sock, buffers_count, MAX_UDP_PAYLOAD);
+	if(us->uring == NULL) {
+		LOG_MSG(WARNING, ("WARNING: io_uring not supported, using normal sends to %s:%d\n", 
+			us->ip_str, ntohs(us->saddr.sin_port)));
+		return false;
+	}
+
+	free(us->send_buf);
+	us->send_buf = uring_send_get_buffer(us->uring);
+	LOG_MSG(INFO, ("Sending through io_uring (%d buffers)\n", buffers_count));
+	return true;
+}
+
+bool udp_sender_reconnect(udp_sender * us, char * addr_str, int port) {
+	assert(us->initialized);
+
+	if (addr_str == NULL || strlen(addr_str) >= 16 || strlen(addr_str) < 7 || 
+		inet_addr(addr_str) == INADDR_NONE) {
+		printf("Error: Malformed address %s\n", (addr_str == NULL ? "(null)" : addr_str));
+		return false;
+	}
+
+	//Whatever was sent so far goes to the old destination
+	udp_sender_force_flush(us);
+	if(us->uring != NULL) {
+		uring_submit(us->uring);
+	}
+
+	memcpy(us->ip_str, addr_str, strlen(addr_str));
+	us->ip_str[strlen(addr_str)] = '\0';
+	us->saddr.sin_addr.s_addr = inet_addr(us->ip_str);
+	us->saddr.sin_port = htons(port);
+	if (connect(us->sock, (struct sockaddr *)&us->saddr, sizeof(struct sockaddr_in)) < 0) { 
+		perror("connect");
+		return false;
+	}
+
+	//The new path may have a different MTU
+	if(us->offload_segments > 0) {
+		udp_sender_set_segment_size(us);
+	}
+
+	LOG_MSG(INFO, ("Sender redirected to UDP address %s:%d\n", us->ip_str, port));
+	return true;
+}
+
+long unsigned udp_sender_get_syscalls(udp_sender * us) {
+	if(us->uring != NULL) {
+		return us->send_syscalls + uring_get_syscalls(us->uring);
+	}
+	return us->send_syscalls;
+}
+
 void udp_sender_print_stats(udp_sender * us, int current_time) {
 #ifndef UDP_STATS
 	return;
@@ -563,5 +1337,9 @@ void udp_sender_print_stats(udp_sender * us, int current_time) {
 	us->msg_sent = 0;
 	us->last_print_time = current_time;
 	
-	printf("  %lu messages sent\n", us->tot_msg_sent);
+	printf("  %lu messages sent (%lu send calls)\n", us->tot_msg_sent, us->send_syscalls);
+	if(us->fec_group_size > 0) {
+		printf("  %lu parity packets sent, %lu packets too big for FEC\n", 
+			us->fec_parity_sent, us->fec_unprotected);
+	}
 }
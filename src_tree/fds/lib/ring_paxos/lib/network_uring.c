@@ -0,0 +1,458 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include "paxos_config.h"
+#include "lp_utils.h"
+#include "lp_uring.h"
+
+#if defined(linux) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+/*
+	io_uring available (multishot receive requires Linux 6.0)
+*/
+#if defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+
+//Group of the buffers registered for receiving
+#define URING_BUFFER_GROUP 0
+//Marks the completion of the multishot receive
+#define URING_RECV_DATA 0
+
+struct uring_t {
+	int fd;
+	int sock;
+	unsigned entries;
+	long unsigned syscalls;
+
+	//Submission queue
+	void * sq_ptr;
+	size_t sq_size;
+	unsigned * sq_head;
+	unsigned * sq_tail;
+	unsigned * sq_mask;
+	unsigned * sq_array;
+	struct io_uring_sqe * sqes;
+	size_t sqes_size;
+	unsigned to_submit;
+
+	//Completion queue
+	void * cq_ptr;
+	size_t cq_size;
+	unsigned * cq_head;
+	unsigned * cq_tail;
+	unsigned * cq_mask;
+	struct io_uring_cqe * cqes;
+
+	//Packet buffers
+	char * buffers;
+	int buffers_count;
+	int buffer_size;
+
+	//Receive only, buffers are provided to the kernel with this ring
+	struct io_uring_buf_ring * buf_ring;
+	size_t buf_ring_size;
+	uint16_t buf_ring_tail;
+	bool recv_armed;
+
+	//Send only, buffers are used round-robin
+	bool * buffer_busy;
+	int next_buffer;
+	int sends_pending;
+
+	bool initialized;
+};
+
+static int uring_enter(uring * u, unsigned to_submit, unsigned min_complete) {
+	unsigned flags = (min_complete > 0 ? IORING_ENTER_GETEVENTS : 0);
+	u->syscalls += 1;
+	return syscall(__NR_io_uring_enter, u->fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static void uring_destroy(uring * u) {
+	if(u->buf_ring != NULL) {
+		munmap(u->buf_ring, u->buf_ring_size);
+	}
+	if(u->sqes != NULL && u->sqes != MAP_FAILED) {
+		munmap(u->sqes, u->sqes_size);
+	}
+	if(u->cq_ptr != NULL && u->cq_ptr != MAP_FAILED && u->cq_ptr != u->sq_ptr) {
+		munmap(u->cq_ptr, u->cq_size);
+	}
+	if(u->sq_ptr != NULL && u->sq_ptr != MAP_FAILED) {
+		munmap(u->sq_ptr, u->sq_size);
+	}
+	if(u->fd >= 0) {
+		close(u->fd);
+	}
+	free(u->buffers);
+	free(u->buffer_busy);
+	free(u);
+}
+
+//Creates the ring and maps its queues, the completion queue
+// must be large enough for all buffers in use
+static uring * uring_init(int sock, unsigned entries, int buffers_count, int buffer_size) {
+	uring * u = calloc(1, sizeof(uring));
+	assert(u != NULL);
+	assert(!u->initialized);
+	u->sock = sock;
+
+	struct io_uring_params p;
+	memset(&p, '\0', sizeof(struct io_uring_params));
+	p.flags = IORING_SETUP_CQSIZE;
+	p.cq_entries = (buffers_count > (int)entries ? (unsigned)buffers_count : entries) * 2;
+	u->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if(u->fd < 0) {
+		perror("io_uring_setup");
+		free(u);
+		return NULL;
+	}
+	u->entries = p.sq_entries;
+
+	u->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if(p.features & IORING_FEAT_SINGLE_MMAP) {
+		if(u->cq_size > u->sq_size) {
+			u->sq_size = u->cq_size;
+		}
+		u->cq_size = u->sq_size;
+	}
+
+	u->sq_ptr = mmap(NULL, u->sq_size, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+	if(u->sq_ptr == MAP_FAILED) {
+		perror("mmap (io_uring submission queue)");
+		uring_destroy(u);
+		return NULL;
+	}
+	if(p.features & IORING_FEAT_SINGLE_MMAP) {
+		u->cq_ptr = u->sq_ptr;
+	} else {
+		u->cq_ptr = mmap(NULL, u->cq_size, PROT_READ|PROT_WRITE,
+			MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+		if(u->cq_ptr == MAP_FAILED) {
+			perror("mmap (io_uring completion queue)");
+			uring_destroy(u);
+			return NULL;
+		}
+	}
+	u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	u->sqes = mmap(NULL, u->sqes_size, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_SQES);
+	if(u->sqes == MAP_FAILED) {
+		perror("mmap (io_uring entries)");
+		uring_destroy(u);
+		return NULL;
+	}
+
+	char * sq = u->sq_ptr;
+	u->sq_head = (unsigned *)(sq + p.sq_off.head);
+	u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	u->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+	u->sq_array = (unsigned *)(sq + p.sq_off.array);
+	char * cq = u->cq_ptr;
+	u->cq_head = (unsigned *)(cq + p.cq_off.head);
+	u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	u->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	u->buffers_count = buffers_count;
+	u->buffer_size = buffer_size;
+	u->buffers = calloc(buffers_count, buffer_size);
+	assert(u->buffers != NULL);
+	return u;
+}
+
+//Returns an empty submission entry, NULL if the queue is full
+static struct io_uring_sqe * uring_get_sqe(uring * u) {
+	unsigned tail = *u->sq_tail + u->to_submit;
+	unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+	if(tail - head >= u->entries) {
+		return NULL;
+	}
+	struct io_uring_sqe * sqe = &u->sqes[tail & *u->sq_mask];
+	memset(sqe, '\0', sizeof(struct io_uring_sqe));
+	u->sq_array[tail & *u->sq_mask] = tail & *u->sq_mask;
+	u->to_submit += 1;
+	return sqe;
+}
+
+//Makes the entries obtained with uring_get_sqe visible to the kernel
+// and submits them
+static int uring_flush_sq(uring * u, unsigned min_complete) {
+	unsigned count = u->to_submit;
+	__atomic_store_n(u->sq_tail, *u->sq_tail + count, __ATOMIC_RELEASE);
+	u->to_submit = 0;
+	if(count == 0 && min_complete == 0) {
+		return 0;
+	}
+	int result = uring_enter(u, count, min_complete);
+	if(result < 0 && errno != EINTR) {
+		perror("io_uring_enter");
+	}
+	return result;
+}
+
+/*** RECEIVE ***/
+
+//Gives a buffer (back) to the kernel
+static void uring_provide_buffer(uring * u, int bid) {
+	uint16_t mask = u->buffers_count - 1;
+	struct io_uring_buf * buf = &u->buf_ring->bufs[u->buf_ring_tail & mask];
+	buf->addr = (unsigned long)&u->buffers[bid * u->buffer_size];
+	buf->len = u->buffer_size;
+	buf->bid = bid;
+	u->buf_ring_tail += 1;
+}
+
+static void uring_publish_buffers(uring * u) {
+	__atomic_store_n(&u->buf_ring->tail, u->buf_ring_tail, __ATOMIC_RELEASE);
+}
+
+//(Re)starts the multishot receive, the kernel picks a free
+// buffer for each datagram and posts a completion
+static bool uring_arm_recv(uring * u) {
+	struct io_uring_sqe * sqe = uring_get_sqe(u);
+	assert(sqe != NULL);
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = u->sock;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BUFFER_GROUP;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->user_data = URING_RECV_DATA;
+	u->recv_armed = (uring_flush_sq(u, 0) >= 0);
+	return u->recv_armed;
+}
+
+uring * uring_recv_init(int sock, int buffers_count, int buffer_size) {
+	assert(buffers_count > 0 && (buffers_count & (buffers_count - 1)) == 0);
+
+	uring * u = uring_init(sock, 8, buffers_count, buffer_size);
+	if(u == NULL) {
+		return NULL;
+	}
+
+	//Register the buffers ring (must be page aligned)
+	u->buf_ring_size = buffers_count * sizeof(struct io_uring_buf);
+	u->buf_ring = mmap(NULL, u->buf_ring_size, PROT_READ|PROT_WRITE,
+		MAP_ANONYMOUS|MAP_PRIVATE, -1, 0);
+	if(u->buf_ring == MAP_FAILED) {
+		perror("mmap (io_uring buffers)");
+		u->buf_ring = NULL;
+		uring_destroy(u);
+		return NULL;
+	}
+	struct io_uring_buf_reg reg;
+	memset(&reg, '\0', sizeof(struct io_uring_buf_reg));
+	reg.ring_addr = (unsigned long)u->buf_ring;
+	reg.ring_entries = buffers_count;
+	reg.bgid = URING_BUFFER_GROUP;
+	if(syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+		perror("io_uring_register (buffers ring)");
+		uring_destroy(u);
+		return NULL;
+	}
+
+	int i;
+	for(i = 0; i < buffers_count; i++) {
+		uring_provide_buffer(u, i);
+	}
+	uring_publish_buffers(u);
+
+	if(!uring_arm_recv(u)) {
+		uring_destroy(u);
+		return NULL;
+	}
+
+	u->initialized = true;
+	return u;
+}
+
+int uring_recv_dispatch(uring * u, uring_datagram_cb cb, void * arg) {
+	assert(u->initialized);
+
+	int count = 0;
+	unsigned head = *u->cq_head;
+	unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+	while(head != tail) {
+		struct io_uring_cqe * cqe = &u->cqes[head & *u->cq_mask];
+
+		if(cqe->flags & IORING_CQE_F_BUFFER) {
+			int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+			if(cqe->res > 0) {
+				cb(&u->buffers[bid * u->buffer_size], cqe->res, arg);
+				count += 1;
+			}
+			uring_provide_buffer(u, bid);
+			uring_publish_buffers(u);
+		}
+
+		//Out of buffers (or error), needs to be restarted
+		if(!(cqe->flags & IORING_CQE_F_MORE)) {
+			if(cqe->res < 0 && cqe->res != -ENOBUFS) {
+				LOG_MSG(WARNING, ("WARNING: io_uring receive failed (%s)\n", strerror(-cqe->res)));
+			}
+			u->recv_armed = false;
+		}
+
+		head += 1;
+		//Processed callbacks can take a while, release entries as soon as possible
+		__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+		tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+	}
+
+	if(!u->recv_armed) {
+		uring_arm_recv(u);
+	}
+	return count;
+}
+
+/*** SEND ***/
+
+//Marks the buffers of completed sends as free
+static void uring_reap_sends(uring * u) {
+	unsigned head = *u->cq_head;
+	unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+	while(head != tail) {
+		struct io_uring_cqe * cqe = &u->cqes[head & *u->cq_mask];
+		int bid = (int)cqe->user_data;
+		assert(bid >= 0 && bid < u->buffers_count);
+		if(cqe->res < 0) {
+			LOG_MSG(WARNING, ("WARNING: io_uring send failed (%s)\n", strerror(-cqe->res)));
+		}
+		u->buffer_busy[bid] = false;
+		u->sends_pending -= 1;
+		head += 1;
+	}
+	__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+uring * uring_send_init(int sock, int buffers_count, int buffer_size) {
+	assert(buffers_count > 0);
+
+	uring * u = uring_init(sock, buffers_count, buffers_count, buffer_size);
+	if(u == NULL) {
+		return NULL;
+	}
+	u->buffer_busy = calloc(buffers_count, sizeof(bool));
+	assert(u->buffer_busy != NULL);
+
+	u->initialized = true;
+	return u;
+}
+
+char * uring_send_get_buffer(uring * u) {
+	assert(u->initialized);
+
+	int bid = u->next_buffer;
+	if(u->buffer_busy[bid]) {
+		uring_reap_sends(u);
+	}
+	while(u->buffer_busy[bid]) {
+		//All buffers queued or in flight, wait for one
+		uring_flush_sq(u, 1);
+		uring_reap_sends(u);
+	}
+	u->next_buffer = (bid + 1) % u->buffers_count;
+	return &u->buffers[bid * u->buffer_size];
+}
+
+void uring_send_queue(uring * u, char * buf, int size) {
+	assert(u->initialized);
+	assert(size <= u->buffer_size);
+
+	int bid = (buf - u->buffers) / u->buffer_size;
+	assert(bid >= 0 && bid < u->buffers_count && !u->buffer_busy[bid]);
+
+	struct io_uring_sqe * sqe = uring_get_sqe(u);
+	while(sqe == NULL) {
+		uring_flush_sq(u, 0);
+		sqe = uring_get_sqe(u);
+	}
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = u->sock;
+	sqe->addr = (unsigned long)buf;
+	sqe->len = size;
+	sqe->user_data = bid;
+	u->buffer_busy[bid] = true;
+	u->sends_pending += 1;
+}
+
+void uring_submit(uring * u) {
+	assert(u->initialized);
+
+	uring_flush_sq(u, 0);
+	uring_reap_sends(u);
+}
+
+int uring_get_fd(uring * u) {
+	return u->fd;
+}
+
+long unsigned uring_get_syscalls(uring * u) {
+	return u->syscalls;
+}
+
+/*
+	Anything else...
+*/
+#else
+
+uring * uring_recv_init(int sock, int buffers_count, int buffer_size) {
+	UNUSED_ARG(sock);
+	UNUSED_ARG(buffers_count);
+	UNUSED_ARG(buffer_size);
+	return NULL;
+}
+
+int uring_recv_dispatch(uring * u, uring_datagram_cb cb, void * arg) {
+	UNUSED_ARG(u);
+	UNUSED_ARG(cb);
+	UNUSED_ARG(arg);
+	return 0;
+}
+
+uring * uring_send_init(int sock, int buffers_count, int buffer_size) {
+	UNUSED_ARG(sock);
+	UNUSED_ARG(buffers_count);
+	UNUSED_ARG(buffer_size);
+	return NULL;
+}
+
+char * uring_send_get_buffer(uring * u) {
+	UNUSED_ARG(u);
+	return NULL;
+}
+
+void uring_send_queue(uring * u, char * buf, int size) {
+	UNUSED_ARG(u);
+	UNUSED_ARG(buf);
+	UNUSED_ARG(size);
+}
+
+void uring_submit(uring * u) {
+	UNUSED_ARG(u);
+}
+
+int uring_get_fd(uring * u) {
+	UNUSED_ARG(u);
+	return -1;
+}
+
+long unsigned uring_get_syscalls(uring * u) {
+	UNUSED_ARG(u);
+	return 0;
+}
+
+#endif
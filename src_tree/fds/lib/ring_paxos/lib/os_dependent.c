@@ -1,7 +1,9 @@
+#define _GNU_SOURCE
 #include <sys/types.h>
 #include <sys/sysctl.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 /*
 	Apple/OS X
@@ -22,10 +24,18 @@ int get_os_max_wbuf_size() {
 	return get_os_max_rbuf_size();
 }
 
+//Threads cannot be bound to a core (only affinity hints)
+bool set_cpu_affinity(int core) {
+	printf("Warning: cannot pin to core %d, not supported\n", core);
+	return false;
+}
+
 /*
 	Linux
 */
 #elif linux
+#include <sched.h>
+
 static int read_proc_variable(const char * path) {
 	int value;
 	char linebuf[100];
@@ -60,6 +70,18 @@ int get_os_max_rbuf_size() {
 	return read_proc_variable("/proc/sys/net/core/wmem_max");
 }
 
+bool set_cpu_affinity(int core) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	//0 is the calling thread
+	if(sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0) {
+		perror("Error setting CPU affinity");
+		return false;
+	}
+	return true;
+}
+
 /*
 	Anything else...
 */
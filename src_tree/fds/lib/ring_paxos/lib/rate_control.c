@@ -0,0 +1,54 @@
+#include <assert.h>
+
+#include "lp_rate_control.h"
+#include "lp_timers.h"
+
+void rate_control_init(rate_control * rc, config_mngr * cfg) {
+	rc->cfg = cfg;
+	rc->limit = lpconfig_get_max_p2_open_per_iteration(cfg);
+	assert(rc->limit > 0);
+	timerclear(&rc->hold_timeout);
+}
+
+//Message loss or a long delivery queue are taken as a sign of congestion
+bool rate_control_on_feedback(rate_control * rc, uint32_t missing_count, 
+	uint32_t pending_count, struct timeval * now) {
+	if(!lpconfig_get_adaptive_rate_control(rc->cfg)) {
+		return false;
+	}
+
+	bool congested = (missing_count > 0 ||
+		pending_count > (unsigned)lpconfig_get_working_set_size(rc->cfg)/2);
+	if(!congested) {
+		return false;
+	}
+
+	//Already reacted to this congestion event
+	if(!timer_is_expired(&rc->hold_timeout, now)) {
+		return false;
+	}
+
+	rc->limit /= 2;
+	if(rc->limit == 0) {
+		rc->limit = 1;
+	}
+	timer_set_timeout(now, &rc->hold_timeout, lpconfig_get_retransmit_request_interval(rc->cfg));
+	return true;
+}
+
+bool rate_control_on_tick(rate_control * rc, struct timeval * now) {
+	if(!lpconfig_get_adaptive_rate_control(rc->cfg)) {
+		return false;
+	}
+
+	if(rc->limit >= (unsigned)lpconfig_get_max_p2_open_per_iteration(rc->cfg)) {
+		return false;
+	}
+
+	if(!timer_is_expired(&rc->hold_timeout, now)) {
+		return false;
+	}
+
+	rc->limit += 1;
+	return true;
+}
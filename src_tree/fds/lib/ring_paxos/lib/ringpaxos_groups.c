@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdbool.h>
+
+#include "paxos_config.h"
+#include "lp_config_parser.h"
+#include "lp_utils.h"
+#include "lp_groups.h"
+
+//Per-group state, passed as argument to the learner delivery callback
+typedef struct group_slot_t {
+	int group_id;
+	learner_context * lc;
+	group_learner * parent;
+} group_slot;
+
+struct group_learner_t {
+	group_deliver_callback dcb;
+	void * cb_arg;
+	int groups_count;
+	group_slot groups[MAX_GROUPS];
+	bool initialized;
+};
+
+struct group_submit_proxy_t {
+	int groups_count;
+	submit_proxy * proxies[MAX_GROUPS];
+	bool initialized;
+};
+
+/*** HELPERS ***/
+
+//Group id and volumes of each config file
+typedef struct group_range_t {
+	int group_id;
+	volume_id_t first_volume;
+	volume_id_t last_volume;
+} group_range;
+
+//Parses the given config files only to read which group and volumes each
+// ring orders. Returns -1 if a config is invalid, or if two rings have the
+// same group id or overlapping volume ranges (a volume would have no single
+// ordering ring)
+static int groups_load(const char ** config_paths, int paths_count, group_range * ranges) {
+	int i, j;
+	for(i = 0; i < paths_count; i++) {
+		config_mngr * cfg;
+		if(config_mngr_init(config_paths[i], 0, NULL, NULL, &cfg) != 0) {
+			printf("Error: invalid group config %s\n", config_paths[i]);
+			return -1;
+		}
+		ranges[i].group_id = lpconfig_get_group_id(cfg);
+		ranges[i].first_volume = lpconfig_get_group_first_volume(cfg);
+		ranges[i].last_volume = lpconfig_get_group_last_volume(cfg);
+		lpconfig_destroy(cfg);
+
+		for(j = 0; j < i; j++) {
+			if(ranges[j].group_id == ranges[i].group_id) {
+				printf("Error: group %d is in both %s and %s\n",
+					ranges[i].group_id, config_paths[j], config_paths[i]);
+				return -1;
+			}
+			if(ranges[j].first_volume <= ranges[i].last_volume &&
+				ranges[i].first_volume <= ranges[j].last_volume) {
+				printf("Error: volumes of group %d (%u...%u) overlap with group %d (%u...%u)\n",
+					ranges[i].group_id, ranges[i].first_volume, ranges[i].last_volume,
+					ranges[j].group_id, ranges[j].first_volume, ranges[j].last_volume);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+//Learner delivery callback, adds the group to the delivered value
+static void on_group_deliver(void* value, size_t size, void * arg) {
+	group_slot * gs = arg;
+	group_learner * gl = gs->parent;
+	if(!gl->initialized) {
+		//group_learner_init failed after starting this learner
+		return;
+	}
+
+	gl->dcb(gs->group_id, value, size, gl->cb_arg);
+}
+
+/*** PUBLIC ***/
+
+int group_learner_init(
+	const char ** config_paths,
+	int paths_count,
+	volume_id_t first_volume,
+	volume_id_t last_volume,
+	group_deliver_callback dcb,
+	void * cb_arg,
+	group_learner ** gl_ptr)
+{
+	*gl_ptr = NULL;
+	assert(dcb != NULL);
+	assert(first_volume <= last_volume);
+	if(paths_count < 0 || paths_count > MAX_GROUPS) {
+		printf("Error: %d group configs, at most %d are supported (MAX_GROUPS)\n",
+			paths_count, MAX_GROUPS);
+		return -1;
+	}
+
+	group_range ranges[MAX_GROUPS];
+	if(groups_load(config_paths, paths_count, ranges) != 0) {
+		return -1;
+	}
+
+	group_learner * gl = calloc(1, sizeof(group_learner));
+	assert(gl != NULL);
+	assert(!gl->initialized);
+
+	gl->dcb = dcb;
+	gl->cb_arg = cb_arg;
+	//Set before any learner can deliver
+	gl->initialized = true;
+
+	int i, result;
+	for(i = 0; i < paths_count; i++) {
+		if(ranges[i].first_volume > last_volume || ranges[i].last_volume < first_volume) {
+			LOG_MSG(INFO, ("Not subscribing to %s, no hosted volume\n", config_paths[i]));
+			continue;
+		}
+
+		group_slot * gs = &gl->groups[gl->groups_count];
+		gs->group_id = ranges[i].group_id;
+		gs->parent = gl;
+		result = learner_init(config_paths[i], NULL, on_group_deliver, gs, &gs->lc);
+		if(result != 0) {
+			printf("Error: learner init failed for group %d (%s)\n",
+				gs->group_id, config_paths[i]);
+			//The learners already started cannot be stopped and keep
+			// pointing to gl, their values are dropped from now on
+			gl->initialized = false;
+			return -1;
+		}
+		gl->groups_count += 1;
+		LOG_MSG(INFO, ("Subscribed to group %d (%s)\n", gs->group_id, config_paths[i]));
+	}
+
+	if(gl->groups_count == 0) {
+		LOG_MSG(WARNING, ("Warning: no group covers volumes %u...%u\n",
+			first_volume, last_volume));
+	}
+
+	*gl_ptr = gl;
+	return 0;
+}
+
+int group_learner_get_groups_count(group_learner * gl) {
+	assert(gl->initialized);
+	return gl->groups_count;
+}
+
+learner_context * group_learner_get_learner(group_learner * gl, int index) {
+	assert(gl->initialized);
+	assert(index >= 0 && index < gl->groups_count);
+	return gl->groups[index].lc;
+}
+
+void group_learner_print_eventcounters(group_learner * gl) {
+	assert(gl->initialized);
+
+	int i;
+	for(i = 0; i < gl->groups_count; i++) {
+		printf("Group %d:\n", gl->groups[i].group_id);
+		learner_print_eventcounters(gl->groups[i].lc);
+	}
+}
+
+group_submit_proxy * group_submit_proxy_udp_init(const char ** config_paths, int paths_count) {
+	if(paths_count <= 0 || paths_count > MAX_GROUPS) {
+		printf("Error: %d group configs, between 1 and %d are supported (MAX_GROUPS)\n",
+			paths_count, MAX_GROUPS);
+		return NULL;
+	}
+
+	group_range ranges[MAX_GROUPS];
+	if(groups_load(config_paths, paths_count, ranges) != 0) {
+		return NULL;
+	}
+
+	group_submit_proxy * gsp = calloc(1, sizeof(group_submit_proxy));
+	assert(gsp != NULL);
+	assert(!gsp->initialized);
+
+	int i;
+	for(i = 0; i < paths_count; i++) {
+		gsp->proxies[i] = submit_proxy_udp_init(config_paths[i]);
+		if(gsp->proxies[i] == NULL) {
+			printf("Error: submit proxy init failed for %s\n", config_paths[i]);
+			//The proxies already created do not point to gsp, they are leaked
+			// (a submit proxy cannot be destroyed)
+			free(gsp);
+			return NULL;
+		}
+	}
+	gsp->groups_count = paths_count;
+
+	gsp->initialized = true;
+	return gsp;
+}
+
+int group_submit_command(group_submit_proxy * gsp, volume_id_t volume, submit_cmd_msg * scm) {
+	assert(gsp->initialized);
+
+	int i;
+	config_mngr * cfg;
+	for(i = 0; i < gsp->groups_count; i++) {
+		cfg = submit_proxy_get_config_mngr(gsp->proxies[i]);
+		if(lpconfig_group_has_volume(cfg, volume)) {
+			submit_command(gsp->proxies[i], scm);
+			return 0;
+		}
+	}
+
+	LOG_MSG(WARNING, ("Warning: no group for volume %u, value dropped\n", volume));
+	return -1;
+}
+
+void group_submit_proxy_flush_now(group_submit_proxy * gsp) {
+	assert(gsp->initialized);
+
+	int i;
+	for(i = 0; i < gsp->groups_count; i++) {
+		submit_proxy_flush_now(gsp->proxies[i]);
+	}
+}
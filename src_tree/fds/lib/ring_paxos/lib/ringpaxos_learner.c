@@ -1,19 +1,36 @@
 #include <stdbool.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include <time.h>
+#include <sys/time.h>
 
 #include "lp_learner.h"
 #include "lp_network.h"
 #include "lp_config_parser.h"
 #include "lp_utils.h"
+#include "lp_timers.h"
+#include "lp_varint.h"
 #include "ringpaxos_messages.h"
 
 struct learner_event_counters {
 	long unsigned map_request;
 	long unsigned chosenval_request;
+	long unsigned read_index_request;
+	long unsigned read_index_refused;
 };
 
+//A read waiting for its read index, see learner_read_index
+typedef struct pending_read_t {
+	read_ready_callback cb;
+	void * arg;
+	//Request that gives the read index
+	uint32_t nonce;
+	bool has_index;
+	bool valid;
+	iid_t read_index;
+} pending_read;
+
 struct learner_t {
 	bool initialized;
 	struct learner_event_counters lec;
@@ -24,7 +41,17 @@ struct learner_t {
 	topolo_mngr * tm;
 	char missing_cmd_request_buf[MAX_MESSAGE_SIZE];	
 	char missing_acc_request_buf[MAX_MESSAGE_SIZE];
+	unsigned missing_since_feedback;
 	void * cb_arg;
+
+	//Circular buffer of reads, in the order they were issued
+	pending_read * reads;
+	unsigned reads_head;
+	unsigned reads_count;
+	bool read_request_pending;
+	uint32_t pending_nonce;
+	uint32_t next_nonce;
+	struct timeval read_request_timeout;
 };
 
 
@@ -40,6 +67,8 @@ void learner_print_eventcounters(learner_context * l) {
 
 	PRINT_COUNT(l->lec.map_request);
 	PRINT_COUNT(l->lec.chosenval_request);
+	PRINT_COUNT(l->lec.read_index_request);
+	PRINT_COUNT(l->lec.read_index_refused);
 	printf("To multicaster:\n");
 	udp_sender_print_stats(l->mcast_send, time(NULL));
 	printf("From multicaster\n");
@@ -64,20 +93,115 @@ void on_topology_change(topology_info * tm, void * arg) {
 	learner_context * l = arg;
 	assert(l->initialized);
 	
-	UNUSED_ARG(l);
-    LOG_MSG(INFO, ("Topology changed!\n"));
+    LOG_MSG(INFO, ("Topology changed, the leader is now acceptor %d\n",
+        (int)lptopo_get_leader_id(l->tm)));
     
-    // TODO low_priority
-	//Re-connect to some acceptor for retransmissions
+	//Re-connect to the leader for retransmissions and feedback
+	//If it fails, requests go to the old leader until the next topology change
+	if(!udp_sender_reconnect(l->mcast_send,
+		lptopo_get_leader_addr(l->tm),
+		lptopo_get_leader_ring_port(l->tm))) {
+		LOG_MSG(WARNING, ("Warning: cannot connect to the leader\n"));
+	}
+}
+
+static void send_read_index_request(learner_context * l) {
+	read_index_request_msg msg;
+	msg.nonce = l->pending_nonce;
+	COUNT_EVENT(PAXOS, l->lec.read_index_request);
+	net_send_udp(l->mcast_send, &msg, sizeof(read_index_request_msg), read_index_request);
+	udp_sender_force_flush(l->mcast_send);
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	timer_set_timeout(&now, &l->read_request_timeout, lpconfig_get_retransmit_request_interval(l->cfg));
+}
+
+//Reads issued so far wait for a new request
+static void start_read_index_request(learner_context * l) {
+	assert(!l->read_request_pending);
+	l->read_request_pending = true;
+	l->pending_nonce = l->next_nonce;
+	l->next_nonce = (uint32_t)random();
+	send_read_index_request(l);
+}
+
+//Completes the reads (in order) whose read index was delivered
+static void check_pending_reads(learner_context * l) {
+	iid_t delivered = dq_get_highest_delivered(l->dq);
+	while(l->reads_count > 0) {
+		pending_read * r = &l->reads[l->reads_head];
+		if(!r->has_index || (r->valid && r->read_index > delivered)) {
+			break;
+		}
+		l->reads_head = (l->reads_head + 1) % MAX_PENDING_READS;
+		l->reads_count -= 1;
+		r->cb(r->valid, r->arg);
+	}
+}
+
+static void handle_read_index(learner_context * l, read_index_msg * msg, size_t size) {
+	if(size != sizeof(read_index_msg)) {
+		LOG_MSG(WARNING, ("WARNING: malformed read index message, dropping it\n"));
+		return;
+	}
+
+	//Reply for some other learner, or a duplicate
+	if(!l->read_request_pending || msg->nonce != l->pending_nonce) {
+		return;
+	}
+	l->read_request_pending = false;
+	if(!msg->valid) {
+		COUNT_EVENT(PAXOS, l->lec.read_index_refused);
+	}
+
+	bool reads_waiting = false;
+	unsigned i;
+	for(i = 0; i < l->reads_count; i++) {
+		pending_read * r = &l->reads[(l->reads_head + i) % MAX_PENDING_READS];
+		if(r->nonce == msg->nonce) {
+			r->has_index = true;
+			r->valid = msg->valid;
+			r->read_index = msg->read_index;
+		} else if(r->nonce == l->next_nonce) {
+			reads_waiting = true;
+		}
+	}
+
+	if(reads_waiting) {
+		start_read_index_request(l);
+	}
+	check_pending_reads(l);
+}
+
+int learner_read_index(learner_context * l, read_ready_callback cb, void * arg) {
+	assert(l->initialized);
+	if(l->reads_count >= MAX_PENDING_READS) {
+		return -1;
+	}
+
+	pending_read * r = &l->reads[(l->reads_head + l->reads_count) % MAX_PENDING_READS];
+	r->cb = cb;
+	r->arg = arg;
+	r->nonce = l->next_nonce;
+	r->has_index = false;
+	l->reads_count += 1;
+
+	if(!l->read_request_pending) {
+		start_read_index_request(l);
+	}
+	return 0;
 }
 
-void on_missing_cmdmap(iid_t inst_number, void * arg) {
+void on_missing_cmdmap(iid_t first, iid_t last, void * arg) {
 	learner_context * l = arg;
 	assert(l->initialized);
 	
 	map_requests_msg * msg = (map_requests_msg*)&l->missing_cmd_request_buf;
 	COUNT_EVENT(PAXOS, l->lec.map_request);
-	msg->inst_number[msg->requests_count] = inst_number;
+	l->missing_since_feedback += (last - first + 1);
+	msg->ranges[msg->requests_count].first = first;
+	msg->ranges[msg->requests_count].last = last;
 	msg->requests_count += 1;
 	
 	if(msg->requests_count >= REPEAT_REQUEST_MAX_ENTRIES) {
@@ -87,13 +211,15 @@ void on_missing_cmdmap(iid_t inst_number, void * arg) {
 	}	
 }
 
-void on_missing_acceptance(iid_t inst_number, void * arg) {
+void on_missing_acceptance(iid_t first, iid_t last, void * arg) {
 	learner_context * l = arg;
 	assert(l->initialized);
 	
 	chosencmd_requests_msg * msg = (chosencmd_requests_msg*)&l->missing_acc_request_buf;
 	COUNT_EVENT(PAXOS, l->lec.chosenval_request);
-	msg->inst_number[msg->requests_count] = inst_number;
+	l->missing_since_feedback += (last - first + 1);
+	msg->ranges[msg->requests_count].first = first;
+	msg->ranges[msg->requests_count].last = last;
 	msg->requests_count += 1;
 	
 	if(msg->requests_count >= REPEAT_REQUEST_MAX_ENTRIES) {
@@ -120,6 +246,24 @@ void post_delivery_check(void * arg) {
 		net_send_udp(l->mcast_send, msg2, FINVAL_REQS_MSG_SIZE(msg2), chosenval_request);
 		msg2->requests_count = 0;
 	}
+
+	//Let the multicaster know how this learner is keeping up
+	// (only used for its rate control)
+	if(lpconfig_get_adaptive_rate_control(l->cfg)) {
+		learner_feedback_msg feedback;
+		feedback.missing_count = l->missing_since_feedback;
+		feedback.pending_count = dq_pending_count(l->dq);
+		net_send_udp(l->mcast_send, &feedback, sizeof(learner_feedback_msg), learner_feedback);
+	}
+	l->missing_since_feedback = 0;
+
+	//Read index request or reply lost
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	if(l->read_request_pending && timer_is_expired(&l->read_request_timeout, &now)) {
+		send_read_index_request(l);
+	}
+	check_pending_reads(l);
 	
 	udp_sender_force_flush(l->mcast_send);
 }
@@ -132,20 +276,51 @@ void on_mcast_msg(void* data, size_t size, lp_msg_type type, void * arg) {
 	
     switch(type) {
         case command_map: {
-            cmdmap_msg* msg = data;
-            assert(size == CMDMAP_MSG_SIZE(msg));
+            cmdmap_msg msg;
+            if(!cmdmap_msg_decode(data, size, &msg)) {
+                LOG_MSG(WARNING, ("WARNING: malformed command map message, dropping it\n"));
+                break;
+            }
             delivery_queue_handle_command_map(l->dq, 
-                msg->inst_number, &msg->cmd_key, 
-                msg->cmd_size, msg->cmd_value);         
+                msg.inst_number, &msg.cmd_key, 
+                msg.cmd_size, msg.cmd_value);         
         }
         break;
             
         case acceptance: {
-            acceptance_msg* msg = data;
-            assert(size == sizeof(acceptance_msg));
-            delivery_queue_handle_acceptance(l->dq, msg->inst_number, &msg->cmd_key);
+            acceptance_msg msg;
+            if(!acceptance_msg_decode(data, size, &msg)) {
+                LOG_MSG(WARNING, ("WARNING: malformed acceptance message, dropping it\n"));
+                break;
+            }
+            delivery_queue_handle_acceptance(l->dq, msg.inst_number, &msg.cmd_key);
+        }
+        break;
+
+        case acceptance_batch: {
+            acceptance_batch_msg* msg = data;
+            command_id keys[ACCEPTANCE_BATCH_MAX_INSTANCES];
+            if(acceptance_batch_msg_decode(msg, size, keys) < 0) {
+                LOG_MSG(WARNING, ("WARNING: malformed acceptance batch message, dropping it\n"));
+                break;
+            }
+            unsigned i, count = 0;
+            for(i = 0; i < ACCEPTANCE_BATCH_MAX_INSTANCES; i++) {
+                if(msg->decided_bitmap & (1ULL << i)) {
+                    delivery_queue_handle_acceptance(l->dq, msg->from + i, &keys[count]);
+                    count++;
+                }
+            }
         }
         break;
+
+        case topology:
+            lptopo_handle_topology_msg(l->tm, (topology_msg*)data, size);
+        break;
+
+        case read_index:
+            handle_read_index(l, (read_index_msg*)data, size);
+        break;
         
         default: 
         LOG_MSG(DEBUG, ("Dropping message of type %d\n", type));
@@ -158,6 +333,7 @@ void post_receive_check(void * arg) {
 	assert(l->initialized);
 	
 	dq_deliver_loop(l->dq);
+	check_pending_reads(l);
 }
 
 int learner_init(
@@ -167,6 +343,17 @@ int learner_init(
 	void * cb_arg,
 	learner_context ** learner_ptr)
 {
+	return learner_init_on_base(NULL, config_file_path, cust_init, dcb, cb_arg, learner_ptr);
+}
+
+int learner_init_on_base(
+	struct event_base * base,
+	const char * config_file_path, 
+	custom_init_func cust_init, 
+	deliver_callback dcb,
+	void * cb_arg,
+	learner_context ** learner_ptr)
+{
 	
 	learner_context * l = malloc(sizeof(learner_context));
 	assert(l != NULL);
@@ -181,9 +368,19 @@ int learner_init(
 	l->tm = NULL;
 	memset(l->missing_cmd_request_buf, '\0', MAX_MESSAGE_SIZE);
 	memset(l->missing_acc_request_buf, '\0', MAX_MESSAGE_SIZE);
+	l->missing_since_feedback = 0;
 	
 	l->lec.map_request = 0;
 	l->lec.chosenval_request = 0;
+	l->lec.read_index_request = 0;
+	l->lec.read_index_refused = 0;
+
+	l->reads = calloc(MAX_PENDING_READS, sizeof(pending_read));
+	assert(l->reads != NULL);
+	l->reads_head = 0;
+	l->reads_count = 0;
+	l->read_request_pending = false;
+	l->next_nonce = (uint32_t)random();
 	
 	l->cb_arg = cb_arg;
 	
@@ -196,6 +393,8 @@ int learner_init(
 		&l->cfg                  /*cfg** holder*/
         );
     assert(result == 0);
+    //All the modules below register their events in this base
+    lpconfig_set_event_base(l->cfg, base);
     LOG_MSG(DEBUG, ("Configuration manager initialized!\n"));
 
     // Set event for topology change
@@ -0,0 +1,108 @@
+#include <string.h>
+#include <stdbool.h>
+
+#include "paxos_config.h"
+#include "lp_utils.h"
+#include "lp_varint.h"
+#include "ringpaxos_messages.h"
+
+//Instance number and key, at the beginning of the variable part of each message
+static size_t iid_key_encode(iid_t inst_number, command_id * key, uint8_t * buf) {
+	command_id cleared;
+	clear_cmd_key(&cleared);
+	size_t size = varint_encode(inst_number, buf);
+	return size + cmd_key_encode(key, &cleared, &buf[size]);
+}
+
+static size_t iid_key_decode(const uint8_t * buf, size_t len, iid_t * inst_number, command_id * key) {
+	size_t iid_size = varint_decode(buf, len, inst_number);
+	if(iid_size == 0) {
+		return 0;
+	}
+	command_id cleared;
+	clear_cmd_key(&cleared);
+	size_t key_size = cmd_key_decode(&buf[iid_size], len - iid_size, &cleared, key);
+	if(key_size == 0) {
+		return 0;
+	}
+	return iid_size + key_size;
+}
+
+size_t phase2_msg_encode(phase2_msg * msg, phase2_wire_msg * wire) {
+	wire->ballot = msg->ballot;
+	wire->accepts_count = msg->accepts_count;
+	return sizeof(phase2_wire_msg) + iid_key_encode(msg->inst_number, &msg->cmd_key, wire->data);
+}
+
+bool phase2_msg_decode(phase2_wire_msg * wire, size_t size, phase2_msg * msg) {
+	if(size < sizeof(phase2_wire_msg)) {
+		return false;
+	}
+	size_t len = size - sizeof(phase2_wire_msg);
+	if(iid_key_decode(wire->data, len, &msg->inst_number, &msg->cmd_key) != len) {
+		return false;
+	}
+	msg->ballot = wire->ballot;
+	msg->accepts_count = wire->accepts_count;
+	return true;
+}
+
+size_t cmdmap_msg_encode(cmdmap_msg * msg, cmdmap_wire_msg * wire) {
+	size_t size = iid_key_encode(msg->inst_number, &msg->cmd_key, wire->data);
+	size += varint_encode(msg->cmd_size, &wire->data[size]);
+	memcpy(&wire->data[size], msg->cmd_value, msg->cmd_size);
+	return size + msg->cmd_size;
+}
+
+bool cmdmap_msg_decode(cmdmap_wire_msg * wire, size_t size, cmdmap_msg * msg) {
+	size_t offset = iid_key_decode(wire->data, size, &msg->inst_number, &msg->cmd_key);
+	if(offset == 0) {
+		return false;
+	}
+	uint64_t cmd_size;
+	size_t cmd_size_len = varint_decode(&wire->data[offset], size - offset, &cmd_size);
+	if(cmd_size_len == 0) {
+		return false;
+	}
+	offset += cmd_size_len;
+	//The value is the rest of the message
+	if(cmd_size != (size - offset)) {
+		return false;
+	}
+	msg->cmd_size = (uint32_t)cmd_size;
+	msg->cmd_value = (char *)&wire->data[offset];
+	return true;
+}
+
+size_t acceptance_msg_encode(acceptance_msg * msg, acceptance_wire_msg * wire) {
+	return iid_key_encode(msg->inst_number, &msg->cmd_key, wire->data);
+}
+
+bool acceptance_msg_decode(acceptance_wire_msg * wire, size_t size, acceptance_msg * msg) {
+	return (size > 0 && iid_key_decode(wire->data, size, &msg->inst_number, &msg->cmd_key) == size);
+}
+
+int acceptance_batch_msg_decode(acceptance_batch_msg * msg, size_t size, command_id * keys) {
+	if(size < sizeof(acceptance_batch_msg) || size != ACCEPTANCE_BATCH_MSG_SIZE(msg)) {
+		return -1;
+	}
+	//Each key is encoded relative to the previous one
+	command_id prev_key;
+	clear_cmd_key(&prev_key);
+	size_t offset = 0, key_size;
+	int count = 0;
+	unsigned i;
+	for(i = 0; i < ACCEPTANCE_BATCH_MAX_INSTANCES; i++) {
+		if((msg->decided_bitmap & (1ULL << i)) == 0) {
+			continue;
+		}
+		key_size = cmd_key_decode(&msg->cmd_keys[offset], msg->keys_size - offset, &prev_key, &keys[count]);
+		if(key_size == 0) {
+			return -1;
+		}
+		offset += key_size;
+		CMD_KEY_COPY(&prev_key, &keys[count]);
+		count++;
+	}
+	return (offset == msg->keys_size ? count : -1);
+}
@@ -21,12 +21,18 @@ struct submit_proxy_t {
 };
 
 static void on_topology_change_proxy(topology_info * tinfo, void * arg) {
-	// TODO low priority
 	UNUSED_ARG(tinfo);
 	
 	submit_proxy * sp = arg;
 	assert(sp->initialized);
-	UNUSED_ARG(sp);
+
+	//Values are submitted to the current leader
+	//If it fails, values go to the old leader until the next topology change
+	if(!udp_sender_reconnect(sp->us,
+		lptopo_get_leader_addr(sp->tm),
+		lptopo_get_leader_clients_port(sp->tm))) {
+		LOG_MSG(WARNING, ("Warning: cannot connect to the leader\n"));
+	}
 };
 
 static void on_configuration_change_proxy(config_mngr * old_cfg, config_mngr * new_cfg, void * arg) {
@@ -95,3 +101,16 @@ void submit_proxy_flush_now(submit_proxy * sp) {
 	
 	udp_sender_force_flush(sp->us);
 }
+
+config_mngr * submit_proxy_get_config_mngr(submit_proxy * sp) {
+	assert(sp != NULL);
+	assert(sp->initialized);
+	assert(sp->cfg != NULL);
+	return sp->cfg;
+}
+
+void submit_proxy_handle_topology_msg(submit_proxy * sp, topology_msg * msg, size_t size) {
+	assert(sp != NULL);
+	assert(sp->initialized);
+	lptopo_handle_topology_msg(sp->tm, msg, size);
+}
@@ -3,6 +3,7 @@
 
 #include "lp_timers.h"
 #include "lp_utils.h"
+#include "lp_os_dependent.h"
 
 struct periodic_event_t {
     struct timeval interval;
@@ -29,12 +30,30 @@ periodic_event_wrapper(int fd, short event, void *arg) {
     assert(retval == 0);	    
 }
 
+void event_bind_base(struct event_base * base, struct event * ev) {
+    if(base != NULL) {
+        int retval = event_base_set(base, ev);
+        assert(retval == 0);
+    }
+}
+
 periodic_event *  
 set_periodic_event(
     struct timeval * interval,  /*Interval for this event*/
     periodic_event_callback cb, /*Called periodically*/
     void* arg   /*Argument passed to above function*/
     ) 
+    {
+        return set_periodic_event_on_base(NULL, interval, cb, arg);
+    }
+
+periodic_event *  
+set_periodic_event_on_base(
+    struct event_base * base,
+    struct timeval * interval,
+    periodic_event_callback cb,
+    void* arg
+    ) 
     {
         //Allocate struct with all info for this event
         periodic_event * p = calloc(1, sizeof(periodic_event));
@@ -43,6 +62,7 @@ set_periodic_event(
         
         // Set the event wrapper with the structure as arg
         evtimer_set(&p->ev, periodic_event_wrapper, p);
+        event_bind_base(base, &p->ev);
         evutil_timerclear(&p->interval);
 
         // Save callback and it's argument
@@ -110,3 +130,36 @@ bool timer_is_expired(struct timeval * deadline_time, struct timeval * curr_time
         (deadline_time->tv_usec < curr_time->tv_usec));
 }
 
+static void
+busy_poll_wrapper(int fd, short event, void *arg) {
+    UNUSED_ARG(fd);
+    UNUSED_ARG(event);
+
+    //Expire again at the next loop iteration
+    struct timeval now = {0, 0};
+    int retval = event_add((struct event *)arg, &now);
+    assert(retval == 0);
+}
+
+void enable_busy_poll(struct event_base * base) {
+    struct event * ev = calloc(1, sizeof(struct event));
+    assert(ev != NULL);
+
+    evtimer_set(ev, busy_poll_wrapper, ev);
+    event_bind_base(base, ev);
+    struct timeval now = {0, 0};
+    int retval = event_add(ev, &now);
+    assert(retval == 0);
+}
+
+void enable_low_latency_mode(config_mngr * cfg) {
+    if(lpconfig_get_cpu_core(cfg) >= 0) {
+        if(set_cpu_affinity(lpconfig_get_cpu_core(cfg))) {
+            LOG_MSG(INFO, ("Event loop pinned to core %d\n", lpconfig_get_cpu_core(cfg)));
+        }
+    }
+    if(lpconfig_get_busy_poll_usec(cfg) > 0) {
+        enable_busy_poll(lpconfig_get_event_base(cfg));
+        LOG_MSG(INFO, ("Event loop busy polling enabled\n"));
+    }
+}
@@ -1,32 +1,223 @@
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "lp_utils.h"
 #include "lp_topology.h"
+#include "lp_leader_election.h"
 
 // Description of the current topology
 struct topology_info_t {
-    void* placeholder;
+    uint32_t version;
+    //Chosen by reconfiguration, the actual leader may differ if it crashed
+    acceptor_id_t preferred_leader;
+    acceptor_id_t leader;
+    int ring_size;
+    acceptor_id_t ring[MAX_ACCEPTORS];
 };
 
 struct topolo_mngr_t {
 	config_mngr * cfg;
-	
+
     topology_info * current_topology;
     topo_change_callback cb;
 	void * cb_arg;
-	
+
+	//NULL unless this process is an acceptor and heartbeats are enabled
+	leader_election * le;
+
+	//Senders to the ring port of acceptors, created when
+	// a topology is sent to them for the first time
+	udp_sender * acceptors_send[MAX_ACCEPTORS];
+
 	bool initialized;
 };
 
 /*** HELPERS ***/
 
+static bool is_acceptor(config_mngr * cfg, acceptor_id_t id) {
+	return (id > 0 && id < MAX_ACCEPTORS &&
+		lpconfig_get_ring_port_of(cfg, id) != 0);
+}
+
+static int ring_position(topology_info * ti, acceptor_id_t acceptor) {
+	int i;
+	for(i = 0; i < ti->ring_size; i++) {
+		if(ti->ring[i] == acceptor) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static bool is_alive(topolo_mngr * tm, acceptor_id_t acceptor) {
+	return (tm->le == NULL || !leader_election_is_suspected(tm->le, acceptor));
+}
+
+//First member after the one at position that is alive
+// (itself if there is no other)
+static acceptor_id_t next_alive_member(topolo_mngr * tm, int position) {
+	topology_info * ti = tm->current_topology;
+	int i;
+	for(i = 1; i < ti->ring_size; i++) {
+		acceptor_id_t next = ti->ring[(position + i) % ti->ring_size];
+		if(is_alive(tm, next)) {
+			return next;
+		}
+	}
+	return ti->ring[position];
+}
+
 topology_info * build_topology_info(config_mngr * cfg) {
-	UNUSED_ARG(cfg);
 	struct topology_info_t * ti = calloc(1, sizeof(struct topology_info_t));
+	assert(ti != NULL);
+
+	//All acceptors in the configuration by increasing id
+	acceptor_id_t i;
+	for(i = 1; i < MAX_ACCEPTORS; i++) {
+		if(is_acceptor(cfg, i)) {
+			ti->ring[ti->ring_size] = i;
+			ti->ring_size += 1;
+		}
+	}
+	assert(ti->ring_size > 0);
+	ti->preferred_leader = (is_acceptor(cfg, 1) ? 1 : ti->ring[0]);
+	ti->leader = ti->preferred_leader;
+	ti->version = 0;
     return ti;
-    
+
+}
+
+static bool validate_topology(config_mngr * cfg, acceptor_id_t * ring, int ring_size, acceptor_id_t leader) {
+	if(ring_size < (int)lpconfig_get_quorum_size(cfg) || ring_size >= MAX_ACCEPTORS) {
+		printf("Error: invalid ring size %d (quorum is %u)\n", ring_size, lpconfig_get_quorum_size(cfg));
+		return false;
+	}
+
+	bool seen[MAX_ACCEPTORS];
+	memset(seen, 0, sizeof(seen));
+	bool leader_found = false;
+	int i;
+	for(i = 0; i < ring_size; i++) {
+		if(!is_acceptor(cfg, ring[i]) || seen[ring[i]]) {
+			printf("Error: invalid ring member %d\n", (int)ring[i]);
+			return false;
+		}
+		seen[ring[i]] = true;
+		leader_found = leader_found || (ring[i] == leader);
+	}
+	if(!leader_found) {
+		printf("Error: leader %d is not a ring member\n", (int)leader);
+		return false;
+	}
+	return true;
+}
+
+//Leader is the preferred one, or the next members in ring order if it crashed
+static void update_election(topolo_mngr * tm) {
+	topology_info * ti = tm->current_topology;
+	if(tm->le == NULL) {
+		return;
+	}
+
+	acceptor_id_t candidates[MAX_ACCEPTORS];
+	int first = ring_position(ti, ti->preferred_leader);
+	assert(first >= 0);
+	int i;
+	for(i = 0; i < ti->ring_size; i++) {
+		candidates[i] = ti->ring[(first + i) % ti->ring_size];
+	}
+	leader_election_set_candidates(tm->le, candidates, ti->ring_size);
+	ti->leader = leader_election_get_leader(tm->le);
+}
+
+static void notify_change(topolo_mngr * tm) {
+	topology_info * ti = tm->current_topology;
+	LOG_MSG(INFO, ("Topology version %u: leader %d, %d members\n",
+		ti->version, (int)ti->leader, ti->ring_size));
+	if(tm->cb != NULL) {
+		tm->cb(ti, tm->cb_arg);
+	}
+}
+
+static void on_election_change(void * arg) {
+	topolo_mngr * tm = arg;
+	assert(tm->initialized);
+
+	tm->current_topology->leader = leader_election_get_leader(tm->le);
+	notify_change(tm);
+}
+
+static bool self_is_acceptor(config_mngr * cfg) {
+	return is_acceptor(cfg, lpconfig_get_self_acceptor_id(cfg));
+}
+
+static void fill_topology_msg(topolo_mngr * tm, topology_msg * msg) {
+	topology_info * ti = tm->current_topology;
+	memset(msg, 0, sizeof(topology_msg));
+	msg->version = ti->version;
+	msg->preferred_leader = ti->preferred_leader;
+	msg->leader = ti->leader;
+	msg->ring_size = ti->ring_size;
+	memcpy(msg->ring, ti->ring, ti->ring_size * sizeof(acceptor_id_t));
 }
+
+static void send_topology_to(topolo_mngr * tm, topology_msg * msg, acceptor_id_t acceptor) {
+	if(acceptor == lpconfig_get_self_acceptor_id(tm->cfg)) {
+		return;
+	}
+	if(tm->acceptors_send[acceptor] == NULL) {
+		tm->acceptors_send[acceptor] = udp_sender_init(
+			lpconfig_get_ip_addr_of(tm->cfg, acceptor),
+			lpconfig_get_ring_port_of(tm->cfg, acceptor),
+			tm->cfg);
+		assert(tm->acceptors_send[acceptor] != NULL);
+	}
+	net_send_udp(tm->acceptors_send[acceptor], msg, sizeof(topology_msg), topology);
+	udp_sender_force_flush(tm->acceptors_send[acceptor]);
+}
+
+//Creates the next version, sends it to old and new members, then applies it
+static int change_topology(topolo_mngr * tm, acceptor_id_t * ring, int ring_size, acceptor_id_t leader) {
+	assert(tm->initialized);
+	topology_info * ti = tm->current_topology;
+
+	if(!validate_topology(tm->cfg, ring, ring_size, leader)) {
+		return -1;
+	}
+
+	bool was_member[MAX_ACCEPTORS];
+	memset(was_member, 0, sizeof(was_member));
+	int i;
+	for(i = 0; i < ti->ring_size; i++) {
+		was_member[ti->ring[i]] = true;
+	}
+
+	ti->version += 1;
+	ti->preferred_leader = leader;
+	ti->leader = leader;
+	ti->ring_size = ring_size;
+	memmove(ti->ring, ring, ring_size * sizeof(acceptor_id_t));
+	update_election(tm);
+
+	topology_msg msg;
+	fill_topology_msg(tm, &msg);
+	for(i = 0; i < ring_size; i++) {
+		send_topology_to(tm, &msg, ring[i]);
+		was_member[ring[i]] = false;
+	}
+	//Removed members must know too
+	acceptor_id_t a;
+	for(a = 1; a < MAX_ACCEPTORS; a++) {
+		if(was_member[a]) {
+			send_topology_to(tm, &msg, a);
+		}
+	}
+
+	notify_change(tm);
+	return 0;
+}
+
 /*** PUBLIC ***/
 
 int topology_mngr_init(
@@ -42,11 +233,11 @@ int topology_mngr_init(
         topolo_mngr * tm = calloc(1, sizeof(topolo_mngr));
         assert(tm != NULL);
         assert(!tm->initialized);
-        
+
         //Save callback for topology update
         tm->cb = on_topology_change;
 		tm->cb_arg = callbacks_arg;
-		
+
 		tm->cfg = cfg;
 
         //Build default topology_info from config
@@ -54,28 +245,33 @@ int topology_mngr_init(
         assert(tm->current_topology != NULL);
 
 		*tm_ptr = tm;
-		
+
 		tm->initialized = true;
-        
+
+		//Acceptors elect the leader
+		if(lpconfig_heartbeats_enabled(cfg) && self_is_acceptor(cfg)) {
+			tm->le = leader_election_init(on_election_change, tm, cfg);
+			assert(tm->le != NULL);
+			update_election(tm);
+		}
+
         return 0;
     }
 
 acceptor_id_t lptopo_get_successor_id(topolo_mngr * tm) {
     assert(tm->initialized);
 
-    acceptor_id_t successor = lpconfig_get_self_acceptor_id(tm->cfg) + 1;
-    if(successor > lpconfig_get_acceptors_count(tm->cfg)) {
-        assert (successor == lpconfig_get_acceptors_count(tm->cfg) + 1);
-        successor = 1;
+    int position = ring_position(tm->current_topology, lpconfig_get_self_acceptor_id(tm->cfg));
+    if(position < 0) {
+        //Not a member, anything sent goes to the leader
+        return lptopo_get_leader_id(tm);
     }
-    return successor;
+    return next_alive_member(tm, position);
 }
 
 int lptopo_get_successor_port(topolo_mngr * tm) {
     assert(tm->initialized);
 
-    //TODO low_priority
-
     acceptor_id_t successor = lptopo_get_successor_id(tm);
     return lpconfig_get_ring_port_of(tm->cfg, successor);
 }
@@ -83,33 +279,170 @@ int lptopo_get_successor_port(topolo_mngr * tm) {
 char * lptopo_get_successor_addr(topolo_mngr * tm) {
     assert(tm->initialized);
 
-    //TODO low_priority
-
     acceptor_id_t successor = lptopo_get_successor_id(tm);
     return lpconfig_get_ip_addr_of(tm->cfg, successor);
 }
 
-char * lptopo_get_leader_addr(topolo_mngr * tm) {
+acceptor_id_t lptopo_get_leader_id(topolo_mngr * tm) {
     assert(tm->initialized);
+    return tm->current_topology->leader;
+}
 
-    //TODO low_priority
+acceptor_id_t lptopo_get_first_in_ring_id(topolo_mngr * tm) {
+    assert(tm->initialized);
+    int position = ring_position(tm->current_topology, lptopo_get_leader_id(tm));
+    assert(position >= 0);
+    return next_alive_member(tm, position);
+}
 
-    return lpconfig_get_ip_addr_of(tm->cfg, 1);
+char * lptopo_get_leader_addr(topolo_mngr * tm) {
+    assert(tm->initialized);
+    return lpconfig_get_ip_addr_of(tm->cfg, lptopo_get_leader_id(tm));
 }
 
 int lptopo_get_leader_ring_port(topolo_mngr * tm) {
     assert(tm->initialized);
+    return lpconfig_get_ring_port_of(tm->cfg, lptopo_get_leader_id(tm));
 
-    //TODO low_priority
+}
 
-    return lpconfig_get_ring_port_of(tm->cfg, 1);
+int lptopo_get_leader_clients_port(topolo_mngr * tm) {
+    assert(tm->initialized);
+    return lpconfig_get_learners_port_of(tm->cfg, lptopo_get_leader_id(tm));
+}
 
+uint32_t lptopo_get_version(topolo_mngr * tm) {
+    assert(tm->initialized);
+    return tm->current_topology->version;
 }
 
-int lptopo_get_leader_clients_port(topolo_mngr * tm) {
+int lptopo_get_ring_size(topolo_mngr * tm) {
+    assert(tm->initialized);
+    return tm->current_topology->ring_size;
+}
+
+acceptor_id_t lptopo_get_ring_member(topolo_mngr * tm, int position) {
+    assert(tm->initialized);
+    assert(position >= 0 && position < tm->current_topology->ring_size);
+    return tm->current_topology->ring[position];
+}
+
+bool lptopo_is_member(topolo_mngr * tm, acceptor_id_t acceptor) {
+    assert(tm->initialized);
+    return (ring_position(tm->current_topology, acceptor) >= 0);
+}
+
+int lptopo_add_acceptor(topolo_mngr * tm, acceptor_id_t acceptor, int position) {
     assert(tm->initialized);
+    topology_info * ti = tm->current_topology;
 
-    //TODO low_priority
+    if(lptopo_is_member(tm, acceptor) || ti->ring_size + 1 >= MAX_ACCEPTORS) {
+        printf("Error: cannot add acceptor %d to the ring\n", (int)acceptor);
+        return -1;
+    }
+    if(position < 0 || position > ti->ring_size) {
+        position = ti->ring_size;
+    }
 
-    return lpconfig_get_learners_port_of(tm->cfg, 1);
+    acceptor_id_t ring[MAX_ACCEPTORS];
+    memcpy(ring, ti->ring, position * sizeof(acceptor_id_t));
+    ring[position] = acceptor;
+    memcpy(&ring[position+1], &ti->ring[position], (ti->ring_size - position) * sizeof(acceptor_id_t));
+    return change_topology(tm, ring, ti->ring_size + 1, ti->preferred_leader);
+}
+
+int lptopo_remove_acceptor(topolo_mngr * tm, acceptor_id_t acceptor) {
+    assert(tm->initialized);
+    topology_info * ti = tm->current_topology;
+
+    int position = ring_position(ti, acceptor);
+    if(position < 0 || ti->ring_size == 1) {
+        printf("Error: cannot remove acceptor %d from the ring\n", (int)acceptor);
+        return -1;
+    }
+
+    acceptor_id_t leader = ti->preferred_leader;
+    if(leader == acceptor) {
+        leader = ti->ring[(position + 1) % ti->ring_size];
+    }
+
+    acceptor_id_t ring[MAX_ACCEPTORS];
+    memcpy(ring, ti->ring, position * sizeof(acceptor_id_t));
+    memcpy(&ring[position], &ti->ring[position+1], (ti->ring_size - position - 1) * sizeof(acceptor_id_t));
+    return change_topology(tm, ring, ti->ring_size - 1, leader);
+}
+
+int lptopo_set_ring_order(topolo_mngr * tm, acceptor_id_t * members, int count) {
+    assert(tm->initialized);
+    topology_info * ti = tm->current_topology;
+
+    //Keep the leader if it is still a member
+    acceptor_id_t leader = (count > 0 ? members[0] : 0);
+    int i;
+    for(i = 0; i < count; i++) {
+        if(members[i] == ti->preferred_leader) {
+            leader = ti->preferred_leader;
+        }
+    }
+    return change_topology(tm, members, count, leader);
+}
+
+int lptopo_set_leader(topolo_mngr * tm, acceptor_id_t acceptor) {
+    assert(tm->initialized);
+    topology_info * ti = tm->current_topology;
+    return change_topology(tm, ti->ring, ti->ring_size, acceptor);
+}
+
+void lptopo_handle_heartbeat(topolo_mngr * tm, heartbeat_msg * msg, size_t size) {
+    assert(tm->initialized);
+    if(tm->le == NULL) {
+        LOG_MSG(WARNING, ("Warning: heartbeat received but leader election is disabled\n"));
+        return;
+    }
+    leader_election_handle_heartbeat(tm->le, msg, size);
+}
+
+void lptopo_handle_topology_msg(topolo_mngr * tm, topology_msg * msg, size_t size) {
+    assert(tm->initialized);
+    topology_info * ti = tm->current_topology;
+
+    if(size != sizeof(topology_msg) || msg->ring_size >= MAX_ACCEPTORS ||
+        !validate_topology(tm->cfg, msg->ring, msg->ring_size, msg->preferred_leader)) {
+        LOG_MSG(WARNING, ("Warning: invalid topology discarded\n"));
+        return;
+    }
+
+    //Same version, processes not electing the leader still
+    // learn who was elected from the leader itself
+    if(msg->version == ti->version && tm->le == NULL && msg->leader != ti->leader &&
+        ring_position(ti, msg->leader) >= 0) {
+        ti->leader = msg->leader;
+        notify_change(tm);
+        return;
+    }
+
+    if(msg->version <= ti->version) {
+        LOG_MSG(DEBUG, ("Topology version %u ignored (current is %u)\n", msg->version, ti->version));
+        return;
+    }
+
+    ti->version = msg->version;
+    ti->preferred_leader = msg->preferred_leader;
+    ti->ring_size = msg->ring_size;
+    memcpy(ti->ring, msg->ring, msg->ring_size * sizeof(acceptor_id_t));
+    //Acceptors elect it again, the others trust the sender
+    ti->leader = msg->leader;
+    if(ring_position(ti, ti->leader) < 0) {
+        ti->leader = ti->preferred_leader;
+    }
+    update_election(tm);
+    notify_change(tm);
+}
+
+void lptopo_send_topology(topolo_mngr * tm, udp_sender * us) {
+    assert(tm->initialized);
+    topology_msg msg;
+    fill_topology_msg(tm, &msg);
+    net_send_udp(us, &msg, sizeof(topology_msg), topology);
+    udp_sender_force_flush(us);
 }
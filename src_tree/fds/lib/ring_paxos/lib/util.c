@@ -111,6 +111,12 @@ is_my_ballot(ballot_t b, acceptor_id_t acc_id, unsigned incarnation) {
     return (b & 0xFFFF) == identificator;
 }
 
+acceptor_id_t
+__attribute__ ((warn_unused_result, __const__))
+get_ballot_owner(ballot_t b) {
+    return (acceptor_id_t)((b >> 8) & 0xFF);
+}
+
 
 void
 clear_cmd_key(command_id * cmd_key) {
@@ -121,6 +127,6 @@ clear_cmd_key(command_id * cmd_key) {
 
 //TODO trusting the str to be valid and large enough
 char * print_cmd_key(command_id * cmd_key, char * str) { 
-	sprintf(str, "{%u:%u:%u}", cmd_key->mcaster_id, cmd_key->mcaster_incarnation, cmd_key->cmd_seqnum);
+	sprintf(str, "{%u:%u:%lu}", cmd_key->mcaster_id, cmd_key->mcaster_incarnation, (long unsigned)cmd_key->cmd_seqnum);
 	return str;
 }
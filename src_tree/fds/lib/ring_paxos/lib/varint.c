@@ -0,0 +1,64 @@
+#include "lp_varint.h"
+
+size_t varint_encode(uint64_t v, uint8_t * buf) {
+	size_t i = 0;
+	while(v >= 0x80) {
+		buf[i] = (uint8_t)(v | 0x80);
+		v >>= 7;
+		i++;
+	}
+	buf[i] = (uint8_t)v;
+	return i + 1;
+}
+
+size_t varint_decode(const uint8_t * buf, size_t len, uint64_t * v) {
+	uint64_t result = 0;
+	unsigned shift = 0;
+	size_t i;
+	for(i = 0; i < len && i < VARINT_MAX_SIZE; i++) {
+		uint64_t group = buf[i] & 0x7F;
+		//The 10th byte can only hold the highest bit
+		if(i == VARINT_MAX_SIZE - 1 && group > 1) {
+			return 0;
+		}
+		result |= (group << shift);
+		if((buf[i] & 0x80) == 0) {
+			*v = result;
+			return i + 1;
+		}
+		shift += 7;
+	}
+	//Truncated or too long
+	return 0;
+}
+
+size_t varint_size(uint64_t v) {
+	size_t size = 1;
+	while(v >= 0x80) {
+		v >>= 7;
+		size++;
+	}
+	return size;
+}
+
+size_t cmd_key_encode(command_id * key, command_id * prev, uint8_t * buf) {
+	buf[0] = key->mcaster_id;
+	buf[1] = key->mcaster_incarnation;
+	int64_t diff = (int64_t)(key->cmd_seqnum - prev->cmd_seqnum);
+	return 2 + varint_encode(ZIGZAG_ENCODE(diff), &buf[2]);
+}
+
+size_t cmd_key_decode(const uint8_t * buf, size_t len, command_id * prev, command_id * key) {
+	if(len < 3) {
+		return 0;
+	}
+	uint64_t zz;
+	size_t size = varint_decode(&buf[2], len - 2, &zz);
+	if(size == 0) {
+		return 0;
+	}
+	key->mcaster_id = buf[0];
+	key->mcaster_incarnation = buf[1];
+	key->cmd_seqnum = prev->cmd_seqnum + (uint64_t)ZIGZAG_DECODE(zz);
+	return 2 + size;
+}
@@ -0,0 +1,126 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "paxos_config.h"
+#include "lp_utils.h"
+#include "lp_network.h"
+#include "ringpaxos_messages.h"
+
+// Conversions between the layouts of LP_WIRE_MIN_VERSION and LP_WIRE_VERSION,
+// used by the UDP network objects (see lp_wire.h).
+// When a new version changes some layouts, the conversions below are replaced
+// by the ones from the new previous version.
+
+// Version 2: fixed size instance numbers and keys
+typedef struct phase2_v2_msg_t {
+	iid_t inst_number;
+	ballot_t ballot;
+	uint32_t accepts_count;
+	command_id cmd_key;
+} LP_WIRE_PACKED phase2_v2_msg;
+
+typedef struct cmdmap_v2_msg_t {
+	iid_t inst_number;
+	command_id cmd_key;
+	uint32_t cmd_size;
+	char cmd_value[0];
+} LP_WIRE_PACKED cmdmap_v2_msg;
+
+typedef struct acceptance_v2_msg_t {
+	iid_t inst_number;
+	command_id cmd_key;
+} LP_WIRE_PACKED acceptance_v2_msg;
+
+_Static_assert(LP_WIRE_VERSION == 3, "conversions are for the layouts of version 2");
+_Static_assert(sizeof(phase2_v2_msg) == 26, "layout of phase2 (version 2) changed");
+_Static_assert(sizeof(cmdmap_v2_msg) == 22, "layout of command_map (version 2) changed");
+_Static_assert(sizeof(acceptance_v2_msg) == 18, "layout of acceptance (version 2) changed");
+//Upgrade grows a command_map up to its largest header, a downgrade grows a
+// message at most by the fixed size of the old layout
+_Static_assert(CMDMAP_WIRE_MSG_MAX_SIZE(0) - sizeof(cmdmap_v2_msg) <= LP_WIRE_COMPAT_MAX_GROWTH,
+	"upgraded command_map grows too much");
+_Static_assert(sizeof(phase2_v2_msg) <= LP_WIRE_COMPAT_MAX_GROWTH, "downgraded phase2 grows too much");
+_Static_assert(sizeof(cmdmap_v2_msg) <= LP_WIRE_COMPAT_MAX_GROWTH, "downgraded command_map grows too much");
+_Static_assert(sizeof(acceptance_v2_msg) <= LP_WIRE_COMPAT_MAX_GROWTH, "downgraded acceptance grows too much");
+
+int lp_wire_upgrade(int type, void * body, size_t size, void * out) {
+	switch(type) {
+		case phase2: {
+			phase2_v2_msg * old = body;
+			if(size != sizeof(phase2_v2_msg)) {
+				return -1;
+			}
+			phase2_msg msg;
+			msg.inst_number = old->inst_number;
+			msg.ballot = old->ballot;
+			msg.accepts_count = old->accepts_count;
+			CMD_KEY_COPY(&msg.cmd_key, &old->cmd_key);
+			return phase2_msg_encode(&msg, out);
+		}
+		case command_map: {
+			cmdmap_v2_msg * old = body;
+			if(size < sizeof(cmdmap_v2_msg) || size != sizeof(cmdmap_v2_msg) + old->cmd_size) {
+				return -1;
+			}
+			cmdmap_msg msg;
+			msg.inst_number = old->inst_number;
+			CMD_KEY_COPY(&msg.cmd_key, &old->cmd_key);
+			msg.cmd_size = old->cmd_size;
+			msg.cmd_value = old->cmd_value;
+			return cmdmap_msg_encode(&msg, out);
+		}
+		case acceptance: {
+			acceptance_v2_msg * old = body;
+			if(size != sizeof(acceptance_v2_msg)) {
+				return -1;
+			}
+			acceptance_msg msg;
+			msg.inst_number = old->inst_number;
+			CMD_KEY_COPY(&msg.cmd_key, &old->cmd_key);
+			return acceptance_msg_encode(&msg, out);
+		}
+		default:
+			return 0;
+	}
+}
+
+int lp_wire_downgrade(int type, void * body, size_t size, void * out) {
+	switch(type) {
+		case phase2: {
+			phase2_msg msg;
+			if(!phase2_msg_decode(body, size, &msg)) {
+				return -1;
+			}
+			phase2_v2_msg * old = out;
+			old->inst_number = msg.inst_number;
+			old->ballot = msg.ballot;
+			old->accepts_count = msg.accepts_count;
+			CMD_KEY_COPY(&old->cmd_key, &msg.cmd_key);
+			return sizeof(phase2_v2_msg);
+		}
+		case command_map: {
+			cmdmap_msg msg;
+			if(!cmdmap_msg_decode(body, size, &msg)) {
+				return -1;
+			}
+			cmdmap_v2_msg * old = out;
+			old->inst_number = msg.inst_number;
+			CMD_KEY_COPY(&old->cmd_key, &msg.cmd_key);
+			old->cmd_size = msg.cmd_size;
+			memcpy(old->cmd_value, msg.cmd_value, msg.cmd_size);
+			return sizeof(cmdmap_v2_msg) + msg.cmd_size;
+		}
+		case acceptance: {
+			acceptance_msg msg;
+			if(!acceptance_msg_decode(body, size, &msg)) {
+				return -1;
+			}
+			acceptance_v2_msg * old = out;
+			old->inst_number = msg.inst_number;
+			CMD_KEY_COPY(&old->cmd_key, &msg.cmd_key);
+			return sizeof(acceptance_v2_msg);
+		}
+		default:
+			return 0;
+	}
+}
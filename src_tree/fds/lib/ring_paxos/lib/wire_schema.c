@@ -0,0 +1,32 @@
+#include <stdint.h>
+
+#include "lp_network.h"
+#include "lp_submit_proxy.h"
+#include "ringpaxos_messages.h"
+
+// Compile-time checks of the wire format against the schema in lp_wire.h
+
+#define LP_WIRE_SIZE_CHECK(TYPE, ID, BODY, SIZE) \
+	_Static_assert(sizeof(BODY) == (SIZE), "layout of " #BODY " differs from the wire schema"); \
+	_Static_assert((ID) > 0 && (ID) <= UINT8_MAX, "id of " #TYPE " does not fit the message header");
+LP_WIRE_SCHEMA(LP_WIRE_SIZE_CHECK)
+
+_Static_assert(sizeof(lp_message_header) == 4, "layout of lp_message_header changed");
+_Static_assert(sizeof(command_id) == 10, "layout of command_id changed");
+_Static_assert(sizeof(phase2_range_entry) == 24, "layout of phase2_range_entry changed");
+_Static_assert(sizeof(iid_range) == 16, "layout of iid_range changed");
+_Static_assert(MAX_MESSAGE_SIZE <= UINT16_MAX, "message size does not fit the message header");
+_Static_assert(CMDMAP_WIRE_MSG_MAX_SIZE(MAX_COMMAND_SIZE) <= MAX_MESSAGE_SIZE, "largest command does not fit a command_map");
+//Acceptor ids go from 1 to MAX_ACCEPTORS, ACCEPTOR_BIT(id) must fit the 16 bits
+// of accept_bitmap (phase2_range_entry) and grants_bitmap (lease messages)
+_Static_assert(MAX_ACCEPTORS < 16, "acceptor ids do not fit accept_bitmap and grants_bitmap");
+
+#define LP_WIRE_MIN_SIZE_CASE(TYPE, ID, BODY, SIZE) \
+	case TYPE: return (SIZE);
+
+int lp_wire_min_size(int type) {
+	switch(type) {
+		LP_WIRE_SCHEMA(LP_WIRE_MIN_SIZE_CASE)
+		default: return -1;
+	}
+}
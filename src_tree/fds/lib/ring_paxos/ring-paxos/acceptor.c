@@ -16,17 +16,26 @@
 #include "lp_stable_storage.h"
 #include "lp_mcaster_storage.h"
 #include "lp_submit_proxy.h"
+#include "lp_varint.h"
+#include "lp_rate_control.h"
 
 #include "ringpaxos_messages.h"
 
 typedef struct acceptor_t {
 	
+	//Private libevent base, all events of this acceptor are registered here
+	struct event_base * base;
 	config_mngr * cfg;
 	clival_mngr * cvm;
 	topolo_mngr * tm;
+	//Current role, leader/multicaster or regular acceptor
+	// (changes with the topology, see on_topology_change)
+	bool is_multicaster;
 		
 	udp_receiver * pred_recv;
 	udp_sender * succ_send;
+	//Acceptor succ_send is connected to
+	acceptor_id_t successor_id;
 	periodic_event * print_counters_ev;
 	struct timeval print_counters_interval;
 
@@ -40,6 +49,10 @@ typedef struct acceptor_t {
 	unsigned p1_pending_count;
 	iid_t p1_highest_open;
 
+	//Instances up to this one were run by previous leaders, 
+	// never in the storage of this one
+	iid_t takeover_iid;
+
 	//Highest instance such that all lower ones are closed.
 	// I.e. 1:Cl, 2:Op, 3:Op, 4:Cl
 	// highest_closed is 1, NOT 4
@@ -48,6 +61,23 @@ typedef struct acceptor_t {
 	// (meaning that phase 2 was executed at least once).
 	iid_t highest_open_iid;
 
+	//Decided instances not multicast yet, sent together with 
+	// the next command map (or at the end of the clock tick)
+	iid_t acceptance_pending_from;
+	uint64_t acceptance_pending_bitmap;
+
+	//Max number of instances opened at each clock tick, 
+	// adapted to learners feedback if adaptive_rate_control is set
+	rate_control rate;
+
+	//Lease granted by a quorum of acceptors
+	struct timeval lease_valid_until;
+	struct timeval lease_renew_timeout;
+	//Read indexes are valid only once all the instances accepted before the 
+	// first lease of this leader are closed (some may be decided by the previous one)
+	bool lease_floor_set;
+	iid_t lease_floor;
+
 	struct mcaster_event_counters {
 		long unsigned p1_timeout;
 		long unsigned p2_timeout;
@@ -56,10 +86,18 @@ typedef struct acceptor_t {
 		long unsigned p2_window_full;
 		long unsigned p1_range_try;
 		long unsigned p1_range_success;
+		long unsigned p2_range;
+		long unsigned acceptance_batch;
+		long unsigned rate_decrease;
+		long unsigned rate_increase;
 		long unsigned map_request;
 		long unsigned map_request_ignored;
 		long unsigned chosenval_request;
+		long unsigned request_range_dropped;
 		long unsigned dropped_client_values;
+		long unsigned lease_renewed;
+		long unsigned read_index;
+		long unsigned read_index_refused;
 		int last_print_time;
 		//TODO if lpconfig_get_max_p2_open_per_iteration(acc->cfg) is >= 100 will crash
 		unsigned concurrent_p2_open[100]; 
@@ -71,25 +109,38 @@ typedef struct acceptor_t {
 	learner_mngr * lm;
 
 	iid_t highest_instance_seen;
+	iid_t highest_accepted_iid;
+
+	//Lease granted to some leader, no promise/accept for 
+	// other leaders until lease_expiry
+	acceptor_id_t lease_holder;
+	struct timeval lease_expiry;
 
 	struct acceptor_event_counters {
 		long unsigned range_promise;
 		long unsigned range_refuse;
 		long unsigned p2_noval_refuse;
+		long unsigned p2_range;
+		long unsigned lease_granted;
+		long unsigned lease_refused;
 	} aec;
 } acceptor;
 
 
 bool am_i_leader(acceptor * acc) {
-    //TODO low_priority
-    return (lpconfig_get_self_acceptor_id(acc->cfg) == 1);
+    return acc->is_multicaster;
 }
 
 bool am_i_first_in_ring(acceptor * acc) {
-    //TODO low_priority
-    return (lpconfig_get_self_acceptor_id(acc->cfg) == 2);	
+    return (lptopo_get_first_in_ring_id(acc->tm) == lpconfig_get_self_acceptor_id(acc->cfg));
 }
 
+//Role initialization, also invoked on leader change
+void multicaster_init(acceptor * acc);
+//Instances and leader state of a new term, on every promotion
+void multicaster_takeover(acceptor * acc);
+void regular_acceptor_init(acceptor * acc);
+
 //Acceptor events are defined in a separate file
 #include "acceptor_helpers.c"
 #include "acceptor_helpers_mcaster.c"
@@ -102,8 +153,14 @@ void common_init(acceptor * acc) {
 	// "clean" exit when a SIGINT (ctrl-c) is received
 	enable_ctrl_c_handler();
     
-	//Initialize libevent
-    event_init();
+	//Initialize libevent, every module using acc->cfg 
+	// registers its events in this base
+    acc->base = event_base_new();
+	assert(acc->base != NULL);
+	lpconfig_set_event_base(acc->cfg, acc->base);
+
+	//Optional CPU pinning and busy polling
+	enable_low_latency_mode(acc->cfg);
     
     // Set event for topology change
     result = topology_mngr_init(
@@ -116,6 +173,7 @@ void common_init(acceptor * acc) {
     LOG_MSG(DEBUG, ("Topology manager initialized!\n"));
     
     //Open UDP connection to successor
+    acc->successor_id = lptopo_get_successor_id(acc->tm);
     acc->succ_send = udp_sender_init(
         lptopo_get_successor_addr(acc->tm),  /*Ring addr of successor*/
         lptopo_get_successor_port(acc->tm),   /*Ring port for successor*/
@@ -166,7 +224,6 @@ void multicaster_init(acceptor * acc) {
     
     acc->msm = mcaster_storage_init(acc->cfg, acc->cvm);
     assert(acc->msm != NULL);
-    LOG_MSG(DEBUG, ("Multicast sender initialized"))
 
     //Create UDP multicast socket manager
     acc->mcast_send = mcast_sender_init(
@@ -180,8 +237,10 @@ void multicaster_init(acceptor * acc) {
         lpconfig_get_mcast_addr(acc->cfg), 
         lpconfig_get_mcast_port(acc->cfg)));
 
+    multicaster_takeover(acc);
+
     // Set periodic event for various routine checks
-    acc->periodic_ev = set_periodic_event(
+    acc->periodic_ev = set_periodic_event_on_base(acc->base,
         lpconfig_get_mcaster_clock_interval(acc->cfg),  /*Interval for this event*/
         on_mcaster_periodic_check, /*Called periodically to execute P2*/
         acc /*Argument passed to above function*/
@@ -194,7 +253,7 @@ void multicaster_init(acceptor * acc) {
 	//Init event counters
 	if(LP_EVENTCOUNTERS != LOG_NONE) {
 		memset(&acc->mec, '\0', sizeof(struct mcaster_event_counters));
-		acc->print_counters_ev = set_periodic_event(
+		acc->print_counters_ev = set_periodic_event_on_base(acc->base,
 			&acc->print_counters_interval,  /*Interval for this event*/
 			mcaster_print_counters, /*Called periodically to execute P2*/
 			acc /*Argument passed to above function*/
@@ -204,6 +263,32 @@ void multicaster_init(acceptor * acc) {
 
 }
 
+void multicaster_takeover(acceptor * acc) {
+    //Instances of a previous term as leader (if any), 
+    // another leader may have run them since
+    mcaster_storage_reset(acc->msm);
+    acc->p1_ready_count = 0;
+    acc->p1_pending_count = 0;
+    acc->acceptance_pending_bitmap = 0;
+
+    //An acceptor promoted to leader continues after the instances it saw, 
+    // the older ones are no longer in the acceptors storage. 
+    // Phase 1 is executed again for the ones that may still be open
+    acc->takeover_iid = mcaster_storage_takeover_iid(acc->cfg, acc->highest_instance_seen);
+    acc->highest_closed_iid = acc->takeover_iid;
+    acc->highest_open_iid = acc->highest_closed_iid;
+    acc->p1_highest_open = acc->highest_closed_iid;
+    LOG_MSG(PAXOS, ("Leader starts after inst:%lu\n", acc->highest_closed_iid));
+
+    //No lease from the previous term
+    timerclear(&acc->lease_valid_until);
+    timerclear(&acc->lease_renew_timeout);
+    acc->lease_floor_set = false;
+
+    //Start at the maximum rate allowed
+    rate_control_init(&acc->rate, acc->cfg);
+}
+
 void regular_acceptor_init(acceptor * acc) {
     LOG_MSG(PAXOS, ("This acceptor (id:%d) is NOT the current leader\n",
     lpconfig_get_self_acceptor_id(acc->cfg)));
@@ -250,7 +335,7 @@ void regular_acceptor_init(acceptor * acc) {
 	//Init event counters
 	if(LP_EVENTCOUNTERS != LOG_NONE) {
 		memset(&acc->aec, '\0', sizeof(struct acceptor_event_counters));
-		acc->print_counters_ev = set_periodic_event(
+		acc->print_counters_ev = set_periodic_event_on_base(acc->base,
 			&acc->print_counters_interval,  /*Interval for this event*/
 			acceptor_print_counters, /*Called periodically to execute P2*/
 			acc /*Argument passed to above function*/
@@ -283,6 +368,9 @@ int acceptor_init(const char * config_file_path, acceptor_id_t acc_id, acceptor
 
     //Initialization in common for all acceptors
     common_init(acc);
+
+    //Without heartbeats the leader is acceptor 1 until the topology is changed
+    acc->is_multicaster = (lptopo_get_leader_id(acc->tm) == acc_id);
     
     if(am_i_leader(acc)) {
         
@@ -322,7 +410,7 @@ int main (int argc, char const *argv[]) {
     LOG_MSG(DEBUG, ("Acceptor initialized!\n"));
 
     //Enter libevent infinite loop
-    event_dispatch();
+    event_base_dispatch(acc->base);
     
     return 0;
 }
@@ -11,7 +11,10 @@ void on_predecessor_msg(void* msg, size_t size, lp_msg_type type, void * arg) {
 				mcaster_handle_phase1_range_msg(acc, (phase1_range_msg*)msg, size);
 				break;
             case phase2:
-                mcaster_handle_phase2_msg(acc, (phase2_msg*)msg, size);
+                mcaster_handle_phase2_msg(acc, (phase2_wire_msg*)msg, size);
+                break;
+            case phase2_range:
+                mcaster_handle_phase2_range_msg(acc, (phase2_range_msg*)msg, size);
                 break;
 			case map_request:
 				mcaster_handle_map_request(acc, (map_requests_msg*)msg, size);
@@ -19,6 +22,21 @@ void on_predecessor_msg(void* msg, size_t size, lp_msg_type type, void * arg) {
 			case chosenval_request:
 				mcaster_handle_chosenval_request(acc, (chosencmd_requests_msg*)msg, size);
 				break;
+			case learner_feedback:
+				mcaster_handle_learner_feedback(acc, (learner_feedback_msg*)msg, size);
+				break;
+			case heartbeat:
+				lptopo_handle_heartbeat(acc->tm, (heartbeat_msg*)msg, size);
+				break;
+			case topology:
+				lptopo_handle_topology_msg(acc->tm, (topology_msg*)msg, size);
+				break;
+			case lease:
+				mcaster_handle_lease_msg(acc, (lease_msg*)msg, size);
+				break;
+			case read_index_request:
+				mcaster_handle_read_index_request(acc, (read_index_request_msg*)msg, size);
+				break;
             default:
                 LOG_MSG(WARNING, ("Warning: received message of unknown type %d\n", (int)type))
         }
@@ -32,8 +50,23 @@ void on_predecessor_msg(void* msg, size_t size, lp_msg_type type, void * arg) {
 				acceptor_handle_phase1_range_msg(acc, (phase1_range_msg*)msg, size);
 				break;
             case phase2:
-                acceptor_handle_phase2_msg(acc, (phase2_msg*)msg, size);
+                acceptor_handle_phase2_msg(acc, (phase2_wire_msg*)msg, size);
+                break;
+            case phase2_range:
+                acceptor_handle_phase2_range_msg(acc, (phase2_range_msg*)msg, size);
                 break;
+			case heartbeat:
+				lptopo_handle_heartbeat(acc->tm, (heartbeat_msg*)msg, size);
+				break;
+			case topology:
+				lptopo_handle_topology_msg(acc->tm, (topology_msg*)msg, size);
+				break;
+			case lease:
+				acceptor_handle_lease_msg(acc, (lease_msg*)msg, size);
+				break;
+			case read_index_request:
+				//Sent to the leader before a change, the learner will retry
+				break;
             default:
                 LOG_MSG(WARNING, ("Warning: received message of unknown type %d\n", (int)type))
         }
@@ -43,20 +76,39 @@ void on_predecessor_msg(void* msg, size_t size, lp_msg_type type, void * arg) {
 void on_multicast_msg(void* msg, size_t size, lp_msg_type type, void * arg) {
 	acceptor * acc = arg;
 
+	//Promoted to leader, these are its own messages
+	if(am_i_leader(acc)) {
+		return;
+	}
+
     switch(type) {
         case command_map:
-            acceptor_handle_cmdmap_msg(acc, (cmdmap_msg*)msg, size);
+            acceptor_handle_cmdmap_msg(acc, (cmdmap_wire_msg*)msg, size);
             break;
 		case acceptance:
-			acceptor_handle_acceptance_msg(acc, (acceptance_msg*)msg, size);
+			acceptor_handle_acceptance_msg(acc, (acceptance_wire_msg*)msg, size);
+			break;
+		case acceptance_batch:
+			acceptor_handle_acceptance_batch_msg(acc, (acceptance_batch_msg*)msg, size);
 			break;
 		case phase2:
 			//First phase2a is sent through multicast, only the first acceptor in the ring
 			// should process it, then it's going to be forwarded along the UDP ring
 			if(am_i_first_in_ring(acc)) {
-				acceptor_handle_phase2_msg(acc, (phase2_msg*)msg, size);				
+				acceptor_handle_phase2_msg(acc, (phase2_wire_msg*)msg, size);				
 			}
 			break;
+		case phase2_range:
+			if(am_i_first_in_ring(acc)) {
+				acceptor_handle_phase2_range_msg(acc, (phase2_range_msg*)msg, size);
+			}
+			break;
+		case topology:
+			lptopo_handle_topology_msg(acc->tm, (topology_msg*)msg, size);
+			break;
+		case read_index:
+			//For learners only
+			break;
         default:
             LOG_MSG(WARNING, ("Warning: received message of unknown type %d\n", (int)type))
     }
@@ -81,11 +133,61 @@ void on_configuration_change(config_mngr * old, config_mngr * new, void * arg) {
 
 // Event handler for topology change
 // (i.e. Some node crashes and there's a new ring overlay)
-void on_topology_change() {
-    LOG_MSG(INFO, ("Topology changed!\n"));
-    
-    // TODO low_priority
-    //Recreate sockets if needed
-    // Switch to leader/coordinator/multicaster 
-    // mode if required.
+void on_topology_change(topology_info * ti, void * arg) {
+	UNUSED_ARG(ti);
+	acceptor * acc = arg;
+	acceptor_id_t self = lpconfig_get_self_acceptor_id(acc->cfg);
+
+	//Still initializing the topology manager
+	if(acc->succ_send == NULL) {
+		return;
+	}
+
+    LOG_MSG(INFO, ("Topology changed (version %u), the leader is now acceptor %d\n", 
+        lptopo_get_version(acc->tm), (int)lptopo_get_leader_id(acc->tm)));
+
+	if(!lptopo_is_member(acc->tm, self)) {
+		LOG_MSG(WARNING, ("Warning: this acceptor is no longer a member of the ring\n"));
+	}
+
+	//Splice the ring around added, removed or crashed acceptors
+	acceptor_id_t successor = lptopo_get_successor_id(acc->tm);
+	if(successor != acc->successor_id) {
+		if(udp_sender_reconnect(acc->succ_send,
+			lptopo_get_successor_addr(acc->tm),
+			lptopo_get_successor_port(acc->tm))) {
+			acc->successor_id = successor;
+			LOG_MSG(INFO, ("Successor is now acceptor %d\n", (int)successor));
+		} else {
+			//successor_id unchanged, tried again at the next topology change
+			LOG_MSG(WARNING, ("Warning: cannot connect to successor %d\n", (int)successor));
+		}
+	}
+
+	//Switch to leader/coordinator/multicaster mode if required,
+	// the new leader recovers accepted values by running phase 1 with its ballot
+	bool elected = (lptopo_get_leader_id(acc->tm) == self);
+	if(elected && !acc->is_multicaster) {
+		acc->is_multicaster = true;
+		if(acc->msm == NULL) {
+			multicaster_init(acc);
+		} else {
+			//Promoted again, the leader of the meantime may have gone further
+			multicaster_takeover(acc);
+		}
+	} else if(!elected && acc->is_multicaster) {
+		LOG_MSG(PAXOS, ("This acceptor (id:%d) is no longer the leader\n", (int)self));
+		acc->is_multicaster = false;
+		//Instances opened as leader count as seen if promoted again
+		acc->highest_instance_seen = IID_MAX(acc->highest_instance_seen, 
+			IID_MAX(acc->highest_open_iid, acc->p1_highest_open));
+		if(acc->ssm == NULL) {
+			regular_acceptor_init(acc);
+		}
+	}
+
+	//Learners and submit proxies follow the leader
+	if(acc->is_multicaster) {
+		lptopo_send_topology(acc->tm, acc->mcast_send);
+	}
 }
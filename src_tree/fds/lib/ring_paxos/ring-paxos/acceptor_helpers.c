@@ -7,6 +7,9 @@ void acceptor_print_counters(void * arg) {
 	PRINT_COUNT(acc->aec.range_promise);
 	PRINT_COUNT(acc->aec.range_refuse);
 	PRINT_COUNT(acc->aec.p2_noval_refuse);
+	PRINT_COUNT(acc->aec.p2_range);
+	PRINT_COUNT(acc->aec.lease_granted);
+	PRINT_COUNT(acc->aec.lease_refused);
 	
 	PRINT_COUNT(acc->highest_instance_seen);
 	
@@ -25,10 +28,28 @@ void acceptor_flush_successor_socket(acceptor * acc) {
 	udp_sender_force_flush(acc->succ_send);
 }
 
+//True if a lease granted to another leader is still valid, then ballots 
+// of other leaders must not be promised/accepted
+bool acceptor_lease_blocks(acceptor * acc, ballot_t ballot) {
+	if(acc->lease_holder == 0 || acc->lease_holder == get_ballot_owner(ballot)) {
+		return false;
+	}
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return !timer_is_expired(&acc->lease_expiry, &now);
+}
+
 void acceptor_handle_phase1_msg(acceptor * acc, phase1_msg* msg, size_t size) {
     
     assert(size == msg->cmd_size + sizeof(phase1_msg));
     
+    //The message is dropped, the leader retries after p1_interval
+    if(acceptor_lease_blocks(acc, msg->ballot)) {
+        LOG_MSG(PAXOS, ("Refusing promise inst:%lu, lease granted to acceptor %d\n",
+            msg->inst_number, (int)acc->lease_holder));
+        return;
+    }
+
     //Retrieve information from stable storage, if any
     instance_record * ir = ssm_get_record(acc->ssm, msg->inst_number);
     assert(ir->inst_number == msg->inst_number);
@@ -95,6 +116,11 @@ void acceptor_handle_phase1_msg(acceptor * acc, phase1_msg* msg, size_t size) {
 void acceptor_handle_phase1_range_msg(acceptor * acc, phase1_range_msg* msg, size_t size) {
 	assert(size == sizeof(phase1_range_msg));
 	
+	if(acceptor_lease_blocks(acc, msg->ballot)) {
+		LOG_MSG(PAXOS, ("Refusing P1 instances range, lease granted to acceptor %d\n",
+			(int)acc->lease_holder));
+		return;
+	}
 	
 	//Instances for which leader is asking for promise were never
 	// executed so far, we can safely grant the request for all of them
@@ -149,21 +175,28 @@ void acceptor_handle_phase1_range_msg(acceptor * acc, phase1_range_msg* msg, siz
 }
 
 
-void acceptor_handle_phase2_msg(acceptor * acc, phase2_msg* msg, size_t size) {
-    assert(size == sizeof(phase2_msg));
+//Executes phase 2 for a single instance, returns true if the
+// command is accepted (and saved in stable storage)
+bool acceptor_accept_phase2(acceptor * acc, iid_t inst_number, ballot_t ballot, command_id * key) {
     
     //Retrieve information from stable storage, if any
-    instance_record * ir = ssm_get_record(acc->ssm, msg->inst_number);
-    assert(ir->inst_number == msg->inst_number);
+    instance_record * ir = ssm_get_record(acc->ssm, inst_number);
+    assert(ir->inst_number == inst_number);
     
     //Ballot is less than promised ballot
-    if(msg->ballot < ir->ballot) {
+    if(ballot < ir->ballot) {
         LOG_MSG(PAXOS, ("Refusing to accept, inst:%lu, bal:%u promised to bal:%u\n", 
-            msg->inst_number, msg->ballot, ir->ballot));
-        return;
+            inst_number, ballot, ir->ballot));
+        return false;
+    }
+
+    //Some other leader holds the lease
+    if(acceptor_lease_blocks(acc, ballot)) {
+        LOG_MSG(PAXOS, ("Refusing to accept, inst:%lu, lease granted to acceptor %d\n", 
+            inst_number, (int)acc->lease_holder));
+        return false;
     }
        
-    command_id * key = &msg->cmd_key;
     command_id * accepted_key = &ir->accepted_cmd_key;
     command_id * proposed_key = &ir->proposed_cmd_key;
     
@@ -174,31 +207,31 @@ void acceptor_handle_phase2_msg(acceptor * acc, phase2_msg* msg, size_t size) {
 	char str[32];
 	LOG_MSG_COND(DEBUG, (is_proposed_cmd && is_accepted_cmd), 
 		("Command %s for instance %lu is stored as both proposed and accepted\n", 
-		print_cmd_key(key, str), msg->inst_number));
+		print_cmd_key(key, str), inst_number));
     assert((is_proposed_cmd && is_accepted_cmd) == false);
     
     //Command for this identifier is not known, cannot accept it
     // [map-accept-graph Edge A1, A7, A3]
     if((!is_accepted_cmd) && (!is_proposed_cmd)) {
         LOG_MSG(PAXOS, ("Refusing to accept, inst:%lu, unknown command value\n", 
-            msg->inst_number));
+            inst_number));
 		COUNT_EVENT(PAXOS, acc->aec.p2_noval_refuse);
-        return;        
+        return false;        
     }
     
     //Ballot is valid, the command is going to be accepted
-	if(msg->inst_number > acc->highest_instance_seen) {
+	if(inst_number > acc->highest_instance_seen) {
 		//Track highest instance accepted/promised
-		acc->highest_instance_seen = msg->inst_number;
+		acc->highest_instance_seen = inst_number;
 	}
 	
-    void * command_slot = command_slot = ssm_get_command_slot(acc->ssm, msg->inst_number);
+    void * command_slot = command_slot = ssm_get_command_slot(acc->ssm, inst_number);
 
     //This command is already accepted, accept it again
     // [map-accept-graph Edge A4]
     if(is_accepted_cmd) {
         LOG_MSG(PAXOS, ("Accept inst:%lu, previously accepted value\n",
-            msg->inst_number));
+            inst_number));
         
         //Mapping for another command is stored in 'proposed', 
         // can now get rid of it
@@ -221,7 +254,7 @@ void acceptor_handle_phase2_msg(acceptor * acc, phase2_msg* msg, size_t size) {
     // [map-accept-graph Edge A2]
     if(is_proposed_cmd && ir->accepted_cmd == NULL) {
         LOG_MSG(PAXOS, ("Accept inst:%lu, map known, no previous accept\n",
-            msg->inst_number));
+            inst_number));
         assert(ir->proposed_cmd == command_slot);
 
         CMD_KEY_COPY(accepted_key, proposed_key);
@@ -237,7 +270,7 @@ void acceptor_handle_phase2_msg(acceptor * acc, phase2_msg* msg, size_t size) {
     //Accept the new value and overwrite the old one
     // [map-accept-graph Edge A8]
     LOG_MSG(PAXOS, ("Accept inst:%lu, map known, replacing previous accept\n",
-        msg->inst_number));
+        inst_number));
     assert(ir->accepted_cmd != NULL && ir->proposed_cmd != NULL &&
         ir->accepted_cmd != ir->proposed_cmd);
     assert(is_proposed_cmd);
@@ -256,19 +289,92 @@ void acceptor_handle_phase2_msg(acceptor * acc, phase2_msg* msg, size_t size) {
 acceptor_p2_store_and_send:
 
     //Save ballot just accepted
-    ir->ballot = msg->ballot;
-    ir->accept_ballot = msg->ballot;
+    ir->ballot = ballot;
+    ir->accept_ballot = ballot;
+    if(inst_number > acc->highest_accepted_iid) {
+        acc->highest_accepted_iid = inst_number;
+    }
 
     //Save changes in stable storage
     ssm_update_record(acc->ssm, ir);
+    return true;
+};
+
+void acceptor_handle_phase2_msg(acceptor * acc, phase2_wire_msg* wire, size_t size) {
+    phase2_msg msg;
+    if(!phase2_msg_decode(wire, size, &msg)) {
+        LOG_MSG(WARNING, ("WARNING: malformed phase 2 message, dropping it\n"));
+        return;
+    }
+
+    if(!acceptor_accept_phase2(acc, msg.inst_number, msg.ballot, &msg.cmd_key)) {
+        return;
+    }
     
-    //Forward message to successor
-    msg->accepts_count += 1;
-    net_send_udp(acc->succ_send, msg, sizeof(phase2_msg), phase2);
+    //Forward message to successor, only the count changes
+    wire->accepts_count += 1;
+    net_send_udp(acc->succ_send, wire, size, phase2);
+};
+
+void acceptor_handle_phase2_range_msg(acceptor * acc, phase2_range_msg* msg, size_t size) {
+    assert(size == PH2_RANGE_MSG_SIZE(msg));
+
+    LOG_MSG(PAXOS, ("Phase 2 for %u instances\n", msg->entries_count));
+    COUNT_EVENT(PAXOS, acc->aec.p2_range);
+
+    //Try to accept each instance, mark the ones accepted in the bitmap
+    uint16_t self_bit = ACCEPTOR_BIT(lpconfig_get_self_acceptor_id(acc->cfg));
+    phase2_range_entry * pre;
+    unsigned i;
+    for(i = 0; i < msg->entries_count; i++) {
+        pre = &msg->entries[i];
+        if(acceptor_accept_phase2(acc, pre->inst_number, pre->ballot, &pre->cmd_key)) {
+            pre->accept_bitmap |= self_bit;
+        }
+    }
+
+    //Forward message to successor, even if some (or all) entries were refused, 
+    // the multicaster retries those
+    net_send_udp(acc->succ_send, msg, size, phase2_range);
 };
 
-void acceptor_handle_cmdmap_msg(acceptor * acc, cmdmap_msg* msg, size_t size) {
-    assert(size == CMDMAP_MSG_SIZE(msg));
+void acceptor_handle_lease_msg(acceptor * acc, lease_msg* msg, size_t size) {
+    assert(size == sizeof(lease_msg));
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    //Granted only to the current leader, and once the lease 
+    // of the previous one expired. Forwarded anyway.
+    bool expired = (acc->lease_holder == 0 || timer_is_expired(&acc->lease_expiry, &now));
+    if(msg->leader != lptopo_get_leader_id(acc->tm) || 
+        (msg->leader != acc->lease_holder && !expired)) {
+        LOG_MSG(PAXOS, ("Refusing lease to acceptor %d\n", (int)msg->leader));
+        COUNT_EVENT(PAXOS, acc->aec.lease_refused);
+        net_send_udp(acc->succ_send, msg, size, lease);
+        return;
+    }
+
+    //The lease starts when the message is received, 
+    // a bit later than for the leader
+    acc->lease_holder = msg->leader;
+    timer_set_timeout(&now, &acc->lease_expiry, lpconfig_get_leader_lease_duration(acc->cfg));
+    COUNT_EVENT(PAXOS, acc->aec.lease_granted);
+
+    msg->grants_bitmap |= ACCEPTOR_BIT(lpconfig_get_self_acceptor_id(acc->cfg));
+    if(acc->highest_accepted_iid > msg->highest_accepted) {
+        msg->highest_accepted = acc->highest_accepted_iid;
+    }
+    net_send_udp(acc->succ_send, msg, size, lease);
+}
+
+void acceptor_handle_cmdmap_msg(acceptor * acc, cmdmap_wire_msg* wire, size_t size) {
+    cmdmap_msg decoded;
+    cmdmap_msg * msg = &decoded;
+    if(!cmdmap_msg_decode(wire, size, msg)) {
+        LOG_MSG(WARNING, ("WARNING: malformed command map message, dropping it\n"));
+        return;
+    }
 
     // Each cmdmap contains a key and a command, 
     // consensus is executed on the key, while the command is delivered to learners
@@ -364,13 +470,35 @@ void acceptor_handle_cmdmap_msg(acceptor * acc, cmdmap_msg* msg, size_t size) {
 };
 
 void 
-acceptor_handle_acceptance_msg(acceptor * acc, acceptance_msg* msg, size_t size) {
-    assert(size == sizeof(acceptance_msg));
+acceptor_handle_acceptance_msg(acceptor * acc, acceptance_wire_msg* wire, size_t size) {
+    acceptance_msg msg;
+    if(!acceptance_msg_decode(wire, size, &msg)) {
+        LOG_MSG(WARNING, ("WARNING: malformed acceptance message, dropping it\n"));
+        return;
+    }
 
     //Multicaster is telling us that a value was chosen (consensus) in some instance
     //(This is not relevant unless the acceptor is also a learner)
-    LOG_MSG(PAXOS, ("Final value for inst:%lu received\n", msg->inst_number));
+    LOG_MSG(PAXOS, ("Final value for inst:%lu received\n", msg.inst_number));
     
-    ssm_save_delivered_value(acc->ssm, msg->inst_number, &msg->cmd_key);
+    ssm_save_delivered_value(acc->ssm, msg.inst_number, &msg.cmd_key);
+}
+
+void 
+acceptor_handle_acceptance_batch_msg(acceptor * acc, acceptance_batch_msg* msg, size_t size) {
+    command_id keys[ACCEPTANCE_BATCH_MAX_INSTANCES];
+    if(acceptance_batch_msg_decode(msg, size, keys) < 0) {
+        LOG_MSG(WARNING, ("WARNING: malformed acceptance batch message, dropping it\n"));
+        return;
+    }
+
+    unsigned i, count = 0;
+    for(i = 0; i < ACCEPTANCE_BATCH_MAX_INSTANCES; i++) {
+        if(msg->decided_bitmap & (1ULL << i)) {
+            LOG_MSG(PAXOS, ("Final value for inst:%lu received\n", msg->from + i));
+            ssm_save_delivered_value(acc->ssm, msg->from + i, &keys[count]);
+            count++;
+        }
+    }
 }
 
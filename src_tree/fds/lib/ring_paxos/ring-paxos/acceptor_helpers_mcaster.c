@@ -16,9 +16,22 @@ void mcaster_print_counters(void * arg) {
 	PRINT_COUNT(acc->mec.p2_window_full);
 	PRINT_COUNT(acc->mec.p1_range_try);
 	PRINT_COUNT(acc->mec.p1_range_success);
+	PRINT_COUNT(acc->mec.p2_range);
+	PRINT_COUNT(acc->mec.acceptance_batch);
+	PRINT_COUNT(acc->mec.rate_decrease);
+	PRINT_COUNT(acc->mec.rate_increase);
+	
+	struct timeval * clock_tv = lpconfig_get_mcaster_clock_interval(acc->cfg);
+	double ticks_per_sec = 1000000.0 / (clock_tv->tv_sec * 1000000 + clock_tv->tv_usec);
+	printf("Current rate: %u instances per tick (%.0f instances/s)\n",
+		acc->rate.limit, acc->rate.limit * ticks_per_sec);
 	PRINT_COUNT(acc->mec.chosenval_request);
 	PRINT_COUNT(acc->mec.map_request);
 	PRINT_COUNT(acc->mec.map_request_ignored);
+	PRINT_COUNT(acc->mec.request_range_dropped);
+	PRINT_COUNT(acc->mec.lease_renewed);
+	PRINT_COUNT(acc->mec.read_index);
+	PRINT_COUNT(acc->mec.read_index_refused);
 	
 	PRINT_COUNT(acc->highest_closed_iid);
 	PRINT_COUNT(acc->highest_open_iid);
@@ -81,7 +94,9 @@ void mcaster_do_phase1_range(acceptor * acc, iid_t from, iid_t to, ballot_t b) {
 }
 
 void mcaster_do_phase2(acceptor * acc, mcaster_instance_record * mir) {
-    phase2_msg msg; //TSAFE Remove
+    phase2_msg msg;
+    char wire_buf[PH2_WIRE_MSG_MAX_SIZE]; //TSAFE Remove
+    phase2_wire_msg * wire = (phase2_wire_msg*)wire_buf;
     command_id * dest = &msg.cmd_key;
     command_id * src = &mir->assigned_cmd_key;
 
@@ -90,33 +105,135 @@ void mcaster_do_phase2(acceptor * acc, mcaster_instance_record * mir) {
     msg.ballot = mir->ballot;
     msg.accepts_count = 0;
     CMD_KEY_COPY(dest, src);
-    net_send_udp(acc->mcast_send, &msg, sizeof(phase2_msg), phase2);
+    net_send_udp(acc->mcast_send, wire, phase2_msg_encode(&msg, wire), phase2);
     
     //Save state into instance record
     mir->status = p2_pending;
     timer_set_timeout(&acc->mcaster_clock, &mir->timeout, lpconfig_get_p2_interval(acc->cfg));
 }
 
+//Appends an instance to a phase 2 range message (sent later with mcaster_do_phase2_range)
+void mcaster_append_phase2_range(acceptor * acc, phase2_range_msg * msg, mcaster_instance_record * mir) {
+    assert(msg->entries_count < PH2_RANGE_MAX_ENTRIES);
+    phase2_range_entry * pre = &msg->entries[msg->entries_count];
+    command_id * dest = &pre->cmd_key;
+    command_id * src = &mir->assigned_cmd_key;
+
+    pre->inst_number = mir->inst_number;
+    pre->ballot = mir->ballot;
+    pre->accept_bitmap = 0;
+    CMD_KEY_COPY(dest, src);
+    msg->entries_count += 1;
+    
+    //Save state into instance record
+    mir->status = p2_pending;
+    timer_set_timeout(&acc->mcaster_clock, &mir->timeout, lpconfig_get_p2_interval(acc->cfg));
+}
+
+//Sends phase 2 for all instances in the message at once, 
+// or as a normal phase 2 message if there is a single instance
+void mcaster_do_phase2_range(acceptor * acc, phase2_range_msg * msg) {
+    if(msg->entries_count == 0) {
+        return;
+    }
+
+    if(msg->entries_count == 1) {
+        phase2_msg single;
+        char wire_buf[PH2_WIRE_MSG_MAX_SIZE];
+        phase2_wire_msg * wire = (phase2_wire_msg*)wire_buf;
+        command_id * dest = &single.cmd_key;
+        command_id * src = &msg->entries[0].cmd_key;
+        single.inst_number = msg->entries[0].inst_number;
+        single.ballot = msg->entries[0].ballot;
+        single.accepts_count = 0;
+        CMD_KEY_COPY(dest, src);
+        net_send_udp(acc->mcast_send, wire, phase2_msg_encode(&single, wire), phase2);
+    } else {
+        LOG_MSG(PAXOS, ("Executing phase 2 for %u instances\n", msg->entries_count));
+        COUNT_EVENT(PAXOS, acc->mec.p2_range);
+        net_send_udp(acc->mcast_send, msg, PH2_RANGE_MSG_SIZE(msg), phase2_range);
+    }
+    msg->entries_count = 0;
+}
+
+//Multicasts the acceptance of all the instances decided since the last call
+// (if any) in a single acceptance_batch message
+void mcaster_flush_acceptances(acceptor * acc) {
+    if(acc->acceptance_pending_bitmap == 0) {
+        return;
+    }
+
+    char batch_msg_buf[MAX_MESSAGE_SIZE]; //TSAFE Remove
+    acceptance_batch_msg * msg = (acceptance_batch_msg*)&batch_msg_buf;
+    msg->from = acc->acceptance_pending_from;
+    msg->decided_bitmap = acc->acceptance_pending_bitmap;
+
+    mcaster_instance_record * mir;
+    command_id prev_key;
+    clear_cmd_key(&prev_key);
+    size_t keys_size = 0;
+    unsigned i, count = 0;
+    for(i = 0; i < ACCEPTANCE_BATCH_MAX_INSTANCES; i++) {
+        if((msg->decided_bitmap & (1ULL << i)) == 0) {
+            continue;
+        }
+        mir = mcaster_storage_get(acc->msm, msg->from + i);
+        assert(mir->inst_number == msg->from + i && mir->status == done);
+        keys_size += cmd_key_encode(&mir->assigned_cmd_key, &prev_key, &msg->cmd_keys[keys_size]);
+        CMD_KEY_COPY(&prev_key, &mir->assigned_cmd_key);
+        count++;
+    }
+    msg->keys_size = keys_size;
+
+    LOG_MSG(PAXOS, ("Broadcasting acceptance of %u instances from inst:%lu\n", 
+        count, msg->from));
+    COUNT_EVENT(PAXOS, acc->mec.acceptance_batch);
+    net_send_udp(acc->mcast_send, msg, ACCEPTANCE_BATCH_MSG_SIZE(msg), acceptance_batch);
+    acc->acceptance_pending_bitmap = 0;
+}
+
+//Marks the instance as decided, the acceptance is multicast later on 
+// with mcaster_flush_acceptances
+void mcaster_queue_acceptance(acceptor * acc, mcaster_instance_record * mir) {
+	assert(mir->status == done);
+    iid_t from = acc->acceptance_pending_from;
+
+    //Does not fit in the current batch, send the current one first
+    if(acc->acceptance_pending_bitmap != 0 &&
+        (mir->inst_number < from || mir->inst_number >= from + ACCEPTANCE_BATCH_MAX_INSTANCES)) {
+        mcaster_flush_acceptances(acc);
+    }
+
+    if(acc->acceptance_pending_bitmap == 0) {
+        acc->acceptance_pending_from = mir->inst_number;
+    }
+    acc->acceptance_pending_bitmap |= (1ULL << (mir->inst_number - acc->acceptance_pending_from));
+}
+
 void mcaster_broadcast_mapping(acceptor * acc, mcaster_instance_record * mir) {
     char map_msg_buf[MAX_MESSAGE_SIZE]; //TSAFE Remove
 
+    //Decided instances ride on the same packet of this mapping
+    mcaster_flush_acceptances(acc);
+
 	char str[32];
 	LOG_MSG(PAXOS, ("Broadcasting mapping of instance:%lu, key:%s\n",
 		mir->inst_number, print_cmd_key(&mir->assigned_cmd_key, str)));
 
     // Create a cmd_map message consisting of
     // command identifier, command value, instance number (in which it will be proposed)
-    cmdmap_msg * msg = (cmdmap_msg*)&map_msg_buf;
+    cmdmap_msg msg;
+    cmdmap_wire_msg * wire = (cmdmap_wire_msg*)&map_msg_buf;
     command_id * src = &mir->assigned_cmd_key;
-    command_id * dest = &msg->cmd_key;
+    command_id * dest = &msg.cmd_key;
 
-    msg->inst_number = mir->inst_number;
-    msg->cmd_size = mir->assigned_cmd_size;
+    msg.inst_number = mir->inst_number;
+    msg.cmd_size = mir->assigned_cmd_size;
+    msg.cmd_value = mir->assigned_cmd_value;
     CMD_KEY_COPY(dest, src);
-    memcpy(msg->cmd_value, mir->assigned_cmd_value, mir->assigned_cmd_size);
     
     //And broadcast it to all acceptors
-    net_send_udp(acc->mcast_send, msg, CMDMAP_MSG_SIZE(msg), command_map);
+    net_send_udp(acc->mcast_send, wire, cmdmap_msg_encode(&msg, wire), command_map);
 	timer_set_timeout(&acc->mcaster_clock, &mir->repeat_cmdmap_timeout, lpconfig_get_retransmit_request_interval(acc->cfg));
 }
 
@@ -124,7 +241,9 @@ void mcaster_broadcast_acceptance(acceptor * acc, mcaster_instance_record * mir)
 	assert(mir->status == done);
     //Broadcast the fact that some value (identifier) was chosen (consensus)
     //for some instance
-    acceptance_msg msg; //TSAFE Remove
+    acceptance_msg msg;
+    char wire_buf[ACCEPTANCE_WIRE_MSG_MAX_SIZE]; //TSAFE Remove
+    acceptance_wire_msg * wire = (acceptance_wire_msg*)wire_buf;
     LOG_MSG(PAXOS, ("Broadcasting acceptance of inst:%lu\n", 
         mir->inst_number));
     msg.inst_number = mir->inst_number;
@@ -132,7 +251,7 @@ void mcaster_broadcast_acceptance(acceptor * acc, mcaster_instance_record * mir)
     command_id * src = &mir->assigned_cmd_key;
     command_id * dst = &msg.cmd_key;
     CMD_KEY_COPY(dst, src);
-    net_send_udp(acc->mcast_send, &msg, sizeof(acceptance_msg), acceptance);
+    net_send_udp(acc->mcast_send, wire, acceptance_msg_encode(&msg, wire), acceptance);
 }
 
 void mcaster_open_new_instances_P1(acceptor * acc) {
@@ -233,6 +352,11 @@ void mcaster_open_new_instances_P2(acceptor * acc) {
     void * client_cmd_value;
     size_t client_cmd_size;
     mcaster_instance_record * mir;
+
+    //Phase 2 of all instances opened here is executed with a single message
+    char p2_range_buf[MAX_MESSAGE_SIZE]; //TSAFE Remove
+    phase2_range_msg * p2_range = (phase2_range_msg*)&p2_range_buf;
+    p2_range->entries_count = 0;
     
 	int open_count = 0;
 	bool is_window_full = ((acc->highest_open_iid - acc->highest_closed_iid) >= active_instances_range_size);
@@ -263,6 +387,13 @@ void mcaster_open_new_instances_P2(acceptor * acc) {
 	    assert(mir != NULL);
 	    assert(mir->inst_number == current_iid);
 		
+		//Phase 2 already started with a value recovered in phase 1, skip it
+		if(mir->status == p2_pending || mir->status == done) {
+			acc->p1_ready_count -= 1;
+			acc->highest_open_iid += 1;
+			continue;
+		}
+
 		//Can't begin phase 2 while phase 1 is still pending
 		if(mir->status != p1_done) {
 			assert(mir->status == p1_pending);
@@ -284,17 +415,21 @@ void mcaster_open_new_instances_P2(acceptor * acc) {
 		LOG_MSG(PAXOS, ("Opening new instance:%ld\n", current_iid));
 		acc->p1_ready_count -= 1;
         
-        //Broadcast value and execute phase 2 for it
+        //Broadcast value and add it to the next phase 2 message
         mcaster_broadcast_mapping(acc, mir);
-        mcaster_do_phase2(acc, mir);
+        if(p2_range->entries_count >= PH2_RANGE_MAX_ENTRIES) {
+            mcaster_do_phase2_range(acc, p2_range);
+        }
+        mcaster_append_phase2_range(acc, p2_range, mir);
 
         acc->highest_open_iid += 1;
 		open_count += 1;
-		if(open_count >= lpconfig_get_max_p2_open_per_iteration(acc->cfg)) {
+		if(open_count >= (int)acc->rate.limit) {
 			break;
 		}
 		
     }
+    mcaster_do_phase2_range(acc, p2_range);
 	COUNT_EVENT_DISTRIBUTION(acc->mec.concurrent_p2_open, open_count);
 };
 
@@ -397,7 +532,16 @@ void mcaster_handle_phase1_msg(acceptor * acc, phase1_msg* msg, size_t size) {
 	
 	mir->status = p1_done;
 
-	if(mir->assigned_cmd_value == NULL) {
+	if(mir->assigned_cmd_value == NULL && msg->highest_accepted_ballot != 0) {
+	//Some acceptor accepted a value proposed by a previous leader (i.e. before
+	// a leader change), the instance cannot be used for new values:
+	// complete it with the returned one
+		LOG_MSG(PAXOS, ("Phase 1 completed with a previous leader value, inst:%lu\n", 
+			mir->inst_number));
+		mcaster_storage_replace_assigned_value(acc->msm, mir, &msg->cmd_key, &msg->cmd_value, msg->cmd_size);
+		mcaster_broadcast_mapping(acc, mir);
+		mcaster_do_phase2(acc, mir);
+	} else if(mir->assigned_cmd_value == NULL) {
 	//No assigned value means that we are just pre-executing, leave the instance there
 	// it will be used later	
 		LOG_MSG(PAXOS, ("Phase 1 completed for inst %lu\n", mir->inst_number));
@@ -438,10 +582,8 @@ void mcaster_handle_phase1_msg(acceptor * acc, phase1_msg* msg, size_t size) {
 	}   
 };
 
-//A phase 2 message is received that went around the ring.
-void mcaster_handle_phase2_msg(acceptor * acc, phase2_msg* msg, size_t size) {
-    assert(size == sizeof(phase2_msg));
-    
+//A phase 2 message is received that went around the ring (decoded).
+static void mcaster_handle_phase2(acceptor * acc, phase2_msg* msg) {
     //Message is relative to old instance already closed
     if(msg->inst_number <= acc->highest_closed_iid) {
         LOG_MSG(PAXOS_DBG, ("Discarding message for closed instance %lu\n", 
@@ -484,7 +626,7 @@ void mcaster_handle_phase2_msg(acceptor * acc, phase2_msg* msg, size_t size) {
     LOG_MSG(PAXOS, ("Inst:%lu closed successfully!\n", msg->inst_number));
 
 	mir->status = done;
-    mcaster_broadcast_acceptance(acc, mir);
+    mcaster_queue_acceptance(acc, mir);
 	
 	while(mir->status == done && mir->inst_number == (acc->highest_closed_iid+1)) {
     	//Update range of currently open instances
@@ -497,53 +639,221 @@ void mcaster_handle_phase2_msg(acceptor * acc, phase2_msg* msg, size_t size) {
 	}
 };
 
+void mcaster_handle_phase2_msg(acceptor * acc, phase2_wire_msg* wire, size_t size) {
+    phase2_msg msg;
+    if(!phase2_msg_decode(wire, size, &msg)) {
+        LOG_MSG(WARNING, ("WARNING: malformed phase 2 message, dropping it\n"));
+        return;
+    }
+    mcaster_handle_phase2(acc, &msg);
+}
+
+//A phase 2 range message is received that went around the ring.
+//Each entry is handled as an individual phase 2 message
+void mcaster_handle_phase2_range_msg(acceptor * acc, phase2_range_msg* msg, size_t size) {
+    assert(size == PH2_RANGE_MSG_SIZE(msg));
+
+    phase2_msg p2_temp_msg;
+    phase2_range_entry * pre;
+    unsigned i;
+    for(i = 0; i < msg->entries_count; i++) {
+        pre = &msg->entries[i];
+        p2_temp_msg.inst_number = pre->inst_number;
+        p2_temp_msg.ballot = pre->ballot;
+        p2_temp_msg.accepts_count = __builtin_popcount(pre->accept_bitmap);
+        CMD_KEY_COPY((&p2_temp_msg.cmd_key), (&pre->cmd_key));
+        mcaster_handle_phase2(acc, &p2_temp_msg);
+    }
+}
+
+//Some learner reported how it is keeping up with the multicast stream
+// (see lp_rate_control.h)
+void mcaster_handle_learner_feedback(acceptor * acc, learner_feedback_msg* msg, size_t size) {
+	assert(size == sizeof(learner_feedback_msg));
+
+	unsigned previous_limit = acc->rate.limit;
+	if(rate_control_on_feedback(&acc->rate, msg->missing_count, msg->pending_count, &acc->mcaster_clock)) {
+		LOG_MSG(PAXOS, ("Learner congested (missing:%u, pending:%u), rate %u -> %u\n",
+			msg->missing_count, msg->pending_count, previous_limit, acc->rate.limit));
+		COUNT_EVENT(PAXOS, acc->mec.rate_decrease);
+	}
+}
+
+//Additive increase of the rate, at each clock tick without congestion
+void mcaster_update_rate(acceptor * acc) {
+	if(rate_control_on_tick(&acc->rate, &acc->mcaster_clock)) {
+		COUNT_EVENT(PAXOS, acc->mec.rate_increase);
+	}
+}
+
+//Restricts a range requested by a learner to the instances opened 
+// and still stored, returns false if nothing is left or if it is malformed
+static bool mcaster_clamp_request_range(acceptor * acc, iid_range * range, iid_t * first, iid_t * last) {
+	//Older instances would be created in the storage (and never closed)
+	iid_t lowest = IID_MAX(mcaster_storage_lowest_iid(acc->msm, acc->highest_open_iid), 
+		acc->takeover_iid + 1);
+	
+	if(range->first > range->last || range->first > acc->highest_open_iid || 
+		range->last < lowest) {
+		LOG_MSG(PAXOS, ("Dropping request for instance range [%lu...%lu], stored [%lu...%lu]\n", 
+			range->first, range->last, lowest, acc->highest_open_iid));
+		COUNT_EVENT(PAXOS, acc->mec.request_range_dropped);
+		return false;
+	}
+	
+	*first = IID_MAX(range->first, lowest);
+	*last = (range->last > acc->highest_open_iid ? acc->highest_open_iid : range->last);
+	return true;
+}
+
 void mcaster_handle_map_request(acceptor * acc, map_requests_msg* msg, size_t size) {
 	assert(size ==CMDMAP_REQS_MSG_SIZE(msg));
-	LOG_MSG(PAXOS, ("Learner requested mapping of %u instances\n", 
+	LOG_MSG(PAXOS, ("Learner requested mapping of %u instance ranges\n", 
 		msg->requests_count));
 	
 	unsigned i;
+	iid_t iid, first, last;
 	for(i = 0; i < msg->requests_count; i++) {
-		COUNT_EVENT(PAXOS, acc->mec.map_request);
-		mcaster_instance_record * mir = mcaster_storage_get(acc->msm, msg->inst_number[i]);
-	    assert(mir != NULL);
-	    assert(mir->inst_number == msg->inst_number[i]);
-	
-		//To avoid re-broadcasting multiple times the same request
-		// (if multiple processes lost it)
-		//A minimum time has to pass between retransmissions
-		if(timer_is_expired(&mir->repeat_cmdmap_timeout, &acc->mcaster_clock)) {
-			//This function also sets the timeout for the next allowed retransmission
-			mcaster_broadcast_mapping(acc, mir);
-		} else {	
-			COUNT_EVENT(PAXOS, acc->mec.map_request_ignored);
-			LOG_MSG(PAXOS_DBG, ("Request for mapping ignored, already sent recently (Inst:%lu)\n",
-				mir->inst_number));
+		if(!mcaster_clamp_request_range(acc, &msg->ranges[i], &first, &last)) {
+			continue;
 		}
+		for(iid = first; iid <= last; iid++) {
+			COUNT_EVENT(PAXOS, acc->mec.map_request);
+			mcaster_instance_record * mir = mcaster_storage_get(acc->msm, iid);
+			assert(mir != NULL);
+			assert(mir->inst_number == iid);
+			
+			//No value assigned yet (or opened by a previous leader)
+			if(mir->status != p2_pending && mir->status != done) {
+				continue;
+			}
 	
+			//To avoid re-broadcasting multiple times the same request
+			// (if multiple processes lost it)
+			//A minimum time has to pass between retransmissions
+			if(timer_is_expired(&mir->repeat_cmdmap_timeout, &acc->mcaster_clock)) {
+				//This function also sets the timeout for the next allowed retransmission
+				mcaster_broadcast_mapping(acc, mir);
+			} else {	
+				COUNT_EVENT(PAXOS, acc->mec.map_request_ignored);
+				LOG_MSG(PAXOS_DBG, ("Request for mapping ignored, already sent recently (Inst:%lu)\n",
+					mir->inst_number));
+			}
+		}
 	}
 }
 
 void mcaster_handle_chosenval_request(acceptor * acc, chosencmd_requests_msg* msg, size_t size) {
 	assert(size == FINVAL_REQS_MSG_SIZE(msg));
-	LOG_MSG(PAXOS, ("Learner requested chosen value of %u instances\n",
+	LOG_MSG(PAXOS, ("Learner requested chosen value of %u instance ranges\n",
 		msg->requests_count));
 		
 	unsigned i;
+	iid_t iid, first, last;
 	for(i = 0; i < msg->requests_count; i++) {
-		COUNT_EVENT(PAXOS, acc->mec.chosenval_request);
-		mcaster_instance_record * mir = mcaster_storage_get(acc->msm, msg->inst_number[i]);
-	    assert(mir != NULL);
-	    assert(mir->inst_number == msg->inst_number[i]);
-
-		if(mir->status == done) {
-			mcaster_broadcast_acceptance(acc, mir);
-		} else {
-			LOG_MSG(PAXOS_DBG, ("Final value is not chosen yet for inst:%lu\n", msg->inst_number[i]));
+		if(!mcaster_clamp_request_range(acc, &msg->ranges[i], &first, &last)) {
+			continue;
+		}
+		for(iid = first; iid <= last; iid++) {
+			COUNT_EVENT(PAXOS, acc->mec.chosenval_request);
+			mcaster_instance_record * mir = mcaster_storage_get(acc->msm, iid);
+			assert(mir != NULL);
+			assert(mir->inst_number == iid);
+
+			if(mir->status == done) {
+				mcaster_broadcast_acceptance(acc, mir);
+			} else {
+				LOG_MSG(PAXOS_DBG, ("Final value is not chosen yet for inst:%lu\n", iid));
+			}
 		}
 	}	
 }
 
+// Sends a lease renewal around the ring, every third of the lease duration
+// (it leaves in the same packet as phase 1 messages of this tick, if any)
+void mcaster_renew_lease(acceptor * acc) {
+	if(!lpconfig_leases_enabled(acc->cfg)) {
+		return;
+	}
+	if(!timer_is_expired(&acc->lease_renew_timeout, &acc->mcaster_clock)) {
+		return;
+	}
+
+	lease_msg msg;
+	msg.leader = lpconfig_get_self_acceptor_id(acc->cfg);
+	msg.sent_sec = acc->mcaster_clock.tv_sec;
+	msg.sent_usec = acc->mcaster_clock.tv_usec;
+	msg.grants_bitmap = 0;
+	msg.highest_accepted = 0;
+	net_send_udp(acc->succ_send, &msg, sizeof(lease_msg), lease);
+
+	struct timeval * duration = lpconfig_get_leader_lease_duration(acc->cfg);
+	long renew_usec = (duration->tv_sec * 1000000 + duration->tv_usec) / 3;
+	struct timeval renew_interval = {renew_usec / 1000000, renew_usec % 1000000};
+	timer_set_timeout(&acc->mcaster_clock, &acc->lease_renew_timeout, &renew_interval);
+}
+
+bool mcaster_has_lease(acceptor * acc) {
+	return (lpconfig_leases_enabled(acc->cfg) && 
+		!timer_is_expired(&acc->lease_valid_until, &acc->mcaster_clock));
+}
+
+//A lease renewal went around the ring
+void mcaster_handle_lease_msg(acceptor * acc, lease_msg* msg, size_t size) {
+	assert(size == sizeof(lease_msg));
+
+	//Sent before some leader change
+	if(msg->leader != lpconfig_get_self_acceptor_id(acc->cfg)) {
+		return;
+	}
+
+	if((unsigned)__builtin_popcount(msg->grants_bitmap) < lpconfig_get_quorum_size(acc->cfg)) {
+		LOG_MSG(PAXOS, ("Lease not granted by a quorum\n"));
+		return;
+	}
+
+	//Valid from the time it was sent, shortened to tolerate clock drift
+	struct timeval * duration = lpconfig_get_leader_lease_duration(acc->cfg);
+	long lease_usec = (duration->tv_sec * 1000000 + duration->tv_usec);
+	lease_usec = (lease_usec / 100) * (100 - LEASE_CLOCK_DRIFT_PERCENT);
+	struct timeval safe_duration = {lease_usec / 1000000, lease_usec % 1000000};
+	struct timeval sent = {msg->sent_sec, msg->sent_usec};
+	struct timeval expiry;
+	timer_set_timeout(&sent, &expiry, &safe_duration);
+	if(timercmp(&expiry, &acc->lease_valid_until, >)) {
+		acc->lease_valid_until = expiry;
+	}
+	COUNT_EVENT(PAXOS, acc->mec.lease_renewed);
+
+	if(!acc->lease_floor_set) {
+		acc->lease_floor = msg->highest_accepted;
+		acc->lease_floor_set = true;
+		LOG_MSG(PAXOS, ("First lease granted, reads allowed after inst:%lu is closed\n", 
+			acc->lease_floor));
+	}
+}
+
+//Replies with the highest instance such that all lower ones are closed,
+// learners that delivered up to it can serve reads locally
+void mcaster_handle_read_index_request(acceptor * acc, read_index_request_msg* msg, size_t size) {
+	assert(size == sizeof(read_index_request_msg));
+
+	read_index_msg reply;
+	reply.nonce = msg->nonce;
+	reply.read_index = acc->highest_closed_iid;
+	reply.valid = (mcaster_has_lease(acc) && acc->lease_floor_set && 
+		acc->highest_closed_iid >= acc->lease_floor);
+	if(reply.valid) {
+		COUNT_EVENT(PAXOS, acc->mec.read_index);
+	} else {
+		COUNT_EVENT(PAXOS, acc->mec.read_index_refused);
+	}
+
+	//Sent right away, learners are waiting for it
+	net_send_udp(acc->mcast_send, &reply, sizeof(read_index_msg), read_index);
+	udp_sender_force_flush(acc->mcast_send);
+}
+
 // Called when a client submits a value, may return false if the queue
 // is already too long and the value is discardeds
 bool mcaster_handle_value_submit(void* msg, size_t size, clival_mngr * cvm, void * arg) {
@@ -552,7 +862,7 @@ bool mcaster_handle_value_submit(void* msg, size_t size, clival_mngr * cvm, void
 
 	submit_cmd_msg * smsg = msg;
 	assert(SUBMIT_CMD_MSG_SIZE(smsg) == size);
-    LOG_MSG(PAXOS, ("Received new client command of size %lu\n", smsg->cmd_size));
+    LOG_MSG(PAXOS, ("Received new client command of size %u\n", smsg->cmd_size));
 	bool enqueued = cvm_save_value(cvm, smsg->cmd_value, smsg->cmd_size);
 	if (!enqueued) {
 		COUNT_EVENT(PAXOS, acc->mec.dropped_client_values);
@@ -563,6 +873,11 @@ bool mcaster_handle_value_submit(void* msg, size_t size, clival_mngr * cvm, void
 void on_mcaster_periodic_check(void * arg) {
 	acceptor * acc = arg;
 
+	//No longer the leader (the event is not removed)
+	if(!am_i_leader(acc)) {
+		return;
+	}
+
     LOG_MSG(DEBUG, ("Executing multicaster periodic check\n"));
 
 	//Make sure some number of future instances already completed phase1
@@ -576,8 +891,14 @@ void on_mcaster_periodic_check(void * arg) {
     
     // Start phase 2 to deliver values/commands submitted by clients
     mcaster_update_wallclock(acc);
+    mcaster_update_rate(acc);
     mcaster_open_new_instances_P2(acc);
     
+    // Acceptances not sent together with some mapping are sent now
+    mcaster_flush_acceptances(acc);
+
+    mcaster_renew_lease(acc);
+
     // If any send buffer has data in it, flush it now
     udp_sender_force_flush(acc->mcast_send);
     udp_sender_force_flush(acc->succ_send);
@@ -122,6 +122,9 @@ int main (int argc, char const *argv[]) {
 	learner_init(config_file_path, custom_init, on_deliver, &ls, &learner);
 
 	ls.lc = learner;
+
+	//Optional CPU pinning and busy polling
+	enable_low_latency_mode(learner_get_config_mngr(learner));
 	
 	event_dispatch(); //Start libevent loop
 	
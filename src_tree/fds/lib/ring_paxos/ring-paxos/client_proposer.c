@@ -86,7 +86,7 @@ void submit_loop() {
 			if(verbose) {
 
 				char * str = (char*)&smsg->cmd_value;
-				printf("* Submit %d (size:%lu)\n", count, smsg->cmd_size);
+				printf("* Submit %d (size:%u)\n", count, smsg->cmd_size);
 				printf("* [%c, %c, %c, ...] <<< \n", str[0], str[1], str[2]);
 			}
 		}
@@ -305,6 +305,9 @@ int main (int argc, char const *argv[]) {
 	//Start the learner
 	learner_init(config_file_path, client_pl_init, on_deliver, &cl, &cl.l);
 
+	//Optional CPU pinning and busy polling
+	enable_low_latency_mode(learner_get_config_mngr(cl.l));
+
 	//Enter libevent infinite loop
 	event_dispatch();
     return 0;
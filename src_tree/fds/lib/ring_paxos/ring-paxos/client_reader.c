@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <limits.h>
+
+#include "lp_timers.h"
+#include "lp_network.h"
+#include "lp_topology.h"
+#include "lp_submit_proxy.h"
+#include "lp_learner.h"
+#include "lp_utils.h"
+
+#include "ringpaxos_messages.h"
+
+/*
+	This is a learner application benchmarking linearizable reads.
+	It keeps CONCURRENT_READS outstanding reads, each completed read is
+	immediately replaced by another one. Two ways of reading are compared:
+	 - lease: ask the leader for a read index (learner_read_index), requires
+	   leader_lease_duration to be set in the configuration of the acceptors
+	 - noop: submit a no-op value and wait for its delivery, a full Paxos round
+	Throughput and latency of reads are printed periodically.
+	In lease mode, reads refused by the leader (no valid lease) fall back to a no-op.
+	Usage: client_reader <config_file> lease|noop
+*/
+
+#define CONCURRENT_READS 80
+
+#define MONITOR_LATENCY 1 //Set to 0 or 1 to turn off/on
+
+typedef struct noop_value_t {
+	long magic;
+	long client_id;
+	unsigned slot;
+	unsigned seq;
+} noop_value;
+
+struct client_t;
+
+typedef struct client_read_t {
+	struct client_t * cl;
+	unsigned slot;
+	//Current no-op, if the read goes through Paxos
+	bool noop_pending;
+	unsigned noop_seq;
+	struct timeval start_time;
+	struct timeval timeout;
+} client_read;
+
+typedef struct client_t {
+
+	learner_context * l;
+	bool use_leases;
+	long client_id;
+
+	udp_sender * us;
+
+	struct timeval noop_timeout_interval;
+	struct timeval current_time;
+	periodic_event * periodic_check;
+
+	struct timeval print_stats_interval;
+	periodic_event * periodic_stats;
+	int start_time;
+
+	long unsigned read_count;
+	long unsigned refused_count;
+	long unsigned timeout_count;
+
+	unsigned latency_samples_count;
+	long unsigned latency_samples_sum;
+	long unsigned min_latency;
+	long unsigned max_latency;
+
+	client_read reads[CONCURRENT_READS];
+	char submit_buffer[sizeof(submit_cmd_msg) + sizeof(noop_value)];
+
+} client;
+
+#define NOOP_MAGIC 0x6e6f6f70
+
+static void start_read(client_read * r);
+
+void save_latency(client * cl, struct timeval * start_time, struct timeval * end_time) {
+	if(!MONITOR_LATENCY) {
+		return;
+	}
+
+	long unsigned usec_diff = (end_time->tv_sec - start_time->tv_sec)*1000000;
+	usec_diff += (end_time->tv_usec - start_time->tv_usec);
+
+	cl->latency_samples_sum += usec_diff;
+	cl->latency_samples_count += 1;
+
+	//Update min and max
+	if(usec_diff > cl->max_latency) {
+		cl->max_latency = usec_diff;
+	}
+	if(usec_diff < cl->min_latency) {
+		cl->min_latency = usec_diff;
+	}
+}
+
+void print_stats(void * arg) {
+	client * cl = arg;
+	if(cl->read_count > 0) {
+		int elapsed_secs = time(NULL) - cl->start_time;
+		long unsigned read_rate = cl->read_count/elapsed_secs;
+
+		printf("\n%lu reads (%s) in %d sec\n", cl->read_count,
+			(cl->use_leases ? "lease" : "noop"), elapsed_secs);
+		printf("%lu reads/s\n", read_rate);
+		printf("%lu refused by the leader, %lu no-op timeouts\n",
+			cl->refused_count, cl->timeout_count);
+	}
+
+	if(MONITOR_LATENCY && cl->latency_samples_count > 0) {
+
+		double avg_latency = ((double)cl->latency_samples_sum)/cl->latency_samples_count;
+		printf("Avg latency: %.0fus (sample min:%lu, max %lu)\n",
+			avg_latency, cl->min_latency, cl->max_latency);
+
+		cl->latency_samples_count = 0;
+		cl->latency_samples_sum = 0;
+		cl->max_latency = 0;
+		cl->min_latency = LONG_MAX;
+	}
+
+	learner_print_eventcounters(cl->l);
+
+}
+
+static void complete_read(client_read * r) {
+	client * cl = r->cl;
+	cl->read_count += 1;
+	gettimeofday(&cl->current_time, NULL);
+	save_latency(cl, &r->start_time, &cl->current_time);
+
+	//A read of the application state would be served here
+	start_read(r);
+}
+
+static void submit_noop(client_read * r) {
+	client * cl = r->cl;
+	submit_cmd_msg * sm = (submit_cmd_msg*)cl->submit_buffer;
+	noop_value * nv = (noop_value*)sm->cmd_value;
+	nv->magic = NOOP_MAGIC;
+	nv->client_id = cl->client_id;
+	nv->slot = r->slot;
+	nv->seq = r->noop_seq;
+	sm->cmd_size = sizeof(noop_value);
+	net_send_udp(cl->us, sm, SUBMIT_CMD_MSG_SIZE(sm), client_submit);
+
+	r->noop_pending = true;
+	gettimeofday(&cl->current_time, NULL);
+	timer_set_timeout(&cl->current_time, &r->timeout, &cl->noop_timeout_interval);
+}
+
+static void on_read_ready(bool success, void * arg) {
+	client_read * r = arg;
+	if(success) {
+		complete_read(r);
+		return;
+	}
+
+	//No valid lease, go through Paxos
+	r->cl->refused_count += 1;
+	r->noop_seq += 1;
+	submit_noop(r);
+}
+
+static void start_read(client_read * r) {
+	client * cl = r->cl;
+	gettimeofday(&r->start_time, NULL);
+
+	if(cl->use_leases) {
+		//Too many reads waiting, same as refused
+		if(learner_read_index(cl->l, on_read_ready, r) != 0) {
+			on_read_ready(false, r);
+		}
+	} else {
+		r->noop_seq += 1;
+		submit_noop(r);
+	}
+}
+
+//Re-submit the no-ops not delivered in time
+void noop_timeout_check(void* arg) {
+	client * cl = arg;
+
+	gettimeofday(&cl->current_time, NULL);
+
+	unsigned i;
+	for(i = 0; i < CONCURRENT_READS; i++) {
+		client_read * r = &cl->reads[i];
+		if(r->noop_pending && timer_is_expired(&r->timeout, &cl->current_time)) {
+			cl->timeout_count += 1;
+			submit_noop(r);
+		}
+	}
+	udp_sender_force_flush(cl->us);
+}
+
+//Custom init for the learner
+void client_reader_init(void * arg) {
+	client * cl = arg;
+
+	printf("ReadClient: %d concurrent reads through %s\n", CONCURRENT_READS,
+		(cl->use_leases ? "read index (leader lease)" : "no-op submission"));
+
+	cl->us = udp_sender_init(
+		lptopo_get_leader_addr(learner_get_topolo_mngr(cl->l)),
+		lptopo_get_leader_clients_port(learner_get_topolo_mngr(cl->l)),
+		learner_get_config_mngr(cl->l));
+	assert(cl->us != NULL);
+	udp_sender_enable_autoflush(cl->us, 25);
+
+	//Periodically check for timeouts
+	cl->periodic_check =
+	set_periodic_event(
+	    &cl->noop_timeout_interval,  /*Interval for this event*/
+	    noop_timeout_check, /*Called periodically*/
+	    cl /*Argument passed to above function*/
+	    );
+
+	//Periodically print statistics
+	cl->periodic_stats =
+	set_periodic_event(
+	    &cl->print_stats_interval,  /*Interval for this event*/
+	    print_stats, /*Called periodically*/
+	    cl /*Argument passed to above function*/
+	    );
+
+	printf("Client initialization completed\n");
+	cl->start_time = time(NULL);
+	gettimeofday(&cl->current_time, NULL);
+
+	unsigned i;
+	for(i = 0; i < CONCURRENT_READS; i++) {
+		cl->reads[i].cl = cl;
+		cl->reads[i].slot = i;
+		start_read(&cl->reads[i]);
+	}
+}
+
+// Invoked when a value is delivered, the ones of interest are no-ops of this client
+void on_deliver(void* cmd_value, size_t cmd_size, void * arg) {
+	client * cl = arg;
+
+	if(cmd_size != sizeof(noop_value)) {
+		return;
+	}
+	noop_value * nv = cmd_value;
+	if(nv->magic != NOOP_MAGIC || nv->client_id != cl->client_id || nv->slot >= CONCURRENT_READS) {
+		return;
+	}
+
+	client_read * r = &cl->reads[nv->slot];
+	if(!r->noop_pending || nv->seq != r->noop_seq) {
+		//Delivered twice after a timeout
+		return;
+	}
+	r->noop_pending = false;
+	complete_read(r);
+}
+
+static void clear(client * cl) {
+	cl->l = NULL;
+	cl->us = NULL;
+	cl->use_leases = false;
+	cl->client_id = 0;
+
+	cl->noop_timeout_interval.tv_sec = 1;
+	cl->noop_timeout_interval.tv_usec = 0;
+	cl->current_time.tv_sec = 1;
+	cl->current_time.tv_usec = 0;
+
+	cl->periodic_check = NULL;
+
+	cl->print_stats_interval.tv_sec = 5;
+	cl->print_stats_interval.tv_usec = 0;
+	cl->periodic_stats = NULL;
+	cl->start_time = 0;
+
+	cl->read_count = 0;
+	cl->refused_count = 0;
+	cl->timeout_count = 0;
+
+	cl->latency_samples_count = 0;
+	cl->latency_samples_sum = 0;
+	cl->min_latency = LONG_MAX;
+	cl->max_latency = 0;
+
+	memset(cl->reads, '\0', CONCURRENT_READS*sizeof(client_read));
+	memset(cl->submit_buffer, '\0', sizeof(cl->submit_buffer));
+}
+
+int main (int argc, char const *argv[]) {
+
+	// "clean" exit when a SIGINT (ctrl-c) is received
+	enable_ctrl_c_handler();
+
+    print_cmdline_args(argc, argv);
+
+    if(argc != 3 || (strcmp(argv[2], "lease") != 0 && strcmp(argv[2], "noop") != 0)) {
+        printf("Usage: %s <config_file> lease|noop\n", argv[0]);
+        exit(1);
+    }
+    const char * config_file_path = argv[1];
+
+	event_init(); //Init libevent
+
+	static client cl;
+	clear(&cl);
+	cl.use_leases = (strcmp(argv[2], "lease") == 0);
+	srandom(time(NULL) ^ getpid());
+	cl.client_id = random();
+
+	//Start the learner
+	learner_init(config_file_path, client_reader_init, on_deliver, &cl, &cl.l);
+
+	//Optional CPU pinning and busy polling
+	enable_low_latency_mode(learner_get_config_mngr(cl.l));
+
+	//Enter libevent infinite loop
+	event_dispatch();
+    return 0;
+}
@@ -0,0 +1,180 @@
+/*
+	Loopback latency benchmark for the low latency mode:
+	a child process echoes every message back, the round trip
+	time is measured with the default event loop and with busy polling
+	(and pinning, if there are enough cores). Prints p50/p99 latency.
+	Fails only if the echo does not reply.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "lp_timers.h"
+#include "lp_os_dependent.h"
+#include "test_header.h"
+
+#define ROUND_TRIPS 2000
+
+typedef struct ping_msg_t {
+	int seq;
+	struct timeval sent;
+} ping_msg;
+
+static int port = 6676;
+static udp_sender * ping_send;
+static int ping_seq;
+static int last_checked_seq;
+static int stalls_count;
+static long latency_usec[ROUND_TRIPS];
+
+/*** ECHO (child process) ***/
+
+void handle_ping(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	udp_sender * us = arg;
+	assert(type == test1);
+	net_send_udp(us, data, datasize, test2);
+	udp_sender_force_flush(us);
+}
+
+static void run_echo(config_mngr * cfg, bool busy_poll, int core) {
+	event_init();
+	if(core >= 0) {
+		set_cpu_affinity(core);
+	}
+	if(busy_poll) {
+		enable_busy_poll(NULL);
+	}
+	udp_sender * us = udp_sender_init("127.0.0.1", port + 1, cfg);
+	assert(us != NULL);
+	udp_receiver * ur = udp_receiver_init(NULL, port, handle_ping, us, cfg);
+	assert(ur != NULL);
+	event_dispatch();
+	exit(0);
+}
+
+/*** PING ***/
+
+static void send_ping() {
+	ping_msg pm;
+	pm.seq = ping_seq;
+	gettimeofday(&pm.sent, NULL);
+	net_send_udp(ping_send, &pm, sizeof(ping_msg), test1);
+	udp_sender_force_flush(ping_send);
+}
+
+void handle_pong(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	UNUSED_ARG(arg);
+	assert(type == test2);
+	assert(datasize == sizeof(ping_msg));
+
+	ping_msg * pm = data;
+	if(pm->seq != ping_seq) {
+		//Reply to a ping sent again
+		return;
+	}
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	latency_usec[ping_seq] = (now.tv_sec - pm->sent.tv_sec) * 1000000 + (now.tv_usec - pm->sent.tv_usec);
+	ping_seq += 1;
+
+	if(ping_seq == ROUND_TRIPS) {
+		event_loopexit(NULL);
+		return;
+	}
+	send_ping();
+}
+
+//Starts the pings, then sends again if no progress (i.e. echo not ready)
+void progress_check(void * arg) {
+	UNUSED_ARG(arg);
+	if(ping_seq == last_checked_seq) {
+		stalls_count += 1;
+		if(stalls_count > 20) {
+			printf("No reply from echo process, exiting\n");
+			exit(1);
+		}
+		send_ping();
+	}
+	last_checked_seq = ping_seq;
+}
+
+static int compare_long(const void * a, const void * b) {
+	long x = *(const long *)a;
+	long y = *(const long *)b;
+	return (x > y) - (x < y);
+}
+
+static void run(config_mngr * cfg, bool low_latency) {
+	int cores = sysconf(_SC_NPROCESSORS_ONLN);
+	//Two busy processes on a single core would just take turns
+	bool echo_busy = low_latency && cores >= 2;
+
+	pid_t echo_pid = fork();
+	assert(echo_pid >= 0);
+	if(echo_pid == 0) {
+		run_echo(cfg, echo_busy, (echo_busy ? 1 : -1));
+	}
+
+	ping_seq = 0;
+	last_checked_seq = -1;
+	stalls_count = 0;
+
+	event_init();
+	if(low_latency) {
+		if(cores >= 2) {
+			set_cpu_affinity(0);
+		}
+		enable_busy_poll(NULL);
+	}
+	ping_send = udp_sender_init("127.0.0.1", port, cfg);
+	assert(ping_send != NULL);
+	udp_receiver * ur = udp_receiver_init(NULL, port + 1, handle_pong, NULL, cfg);
+	assert(ur != NULL);
+
+	struct timeval check_interval = {0, 100000};
+	set_periodic_event(&check_interval, progress_check, NULL);
+
+	event_dispatch();
+
+	kill(echo_pid, SIGKILL);
+	waitpid(echo_pid, NULL, 0);
+
+	qsort(latency_usec, ROUND_TRIPS, sizeof(long), compare_long);
+	printf("%s: %d round trips, p50 %ld usec, p99 %ld usec, max %ld usec\n",
+		(low_latency ? (echo_busy ? "Busy poll (both sides)" : "Busy poll (ping side)") : "Default"),
+		ROUND_TRIPS, latency_usec[ROUND_TRIPS / 2],
+		latency_usec[(ROUND_TRIPS * 99) / 100], latency_usec[ROUND_TRIPS - 1]);
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+    int result = -1;
+	config_mngr * cfg;
+    result = config_mngr_init("./etc/config1.cfg", 2, NULL, NULL, &cfg);
+    assert(result == 0);
+
+	run(cfg, false);
+
+	port += 2;
+	run(cfg, true);
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
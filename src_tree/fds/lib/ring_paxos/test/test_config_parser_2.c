@@ -55,6 +55,8 @@ int main (int argc, char const *argv[]) {
 	assert(lpconfig_get_mcaster_clock_interval(cfg)->tv_usec == 10);
 	
 	assert(lpconfig_get_max_p2_open_per_iteration(cfg) == 12); 
+	assert(lpconfig_get_adaptive_rate_control(cfg) == 1);
+	assert(lpconfig_get_mcast_fec_group_size(cfg) == 8);
 	assert(lpconfig_get_max_client_values_queue_size(cfg) == 250);
 	
 	assert(lpconfig_get_retransmit_request_interval(cfg)->tv_sec == 1); 
@@ -57,6 +57,8 @@ int main (int argc, char const *argv[]) {
 	
 	
 	assert(lpconfig_get_max_p2_open_per_iteration(cfg) == 10); 
+	assert(lpconfig_get_adaptive_rate_control(cfg) == 0);
+	assert(lpconfig_get_mcast_fec_group_size(cfg) == 0);
 	assert(lpconfig_get_max_client_values_queue_size(cfg) == 100);
 	
 	assert(lpconfig_get_retransmit_request_interval(cfg)->tv_sec == 1); 
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "forced_assert.h"
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "test_header.h"
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+    
+    int result = -1;
+    acceptor_id_t acc_id;
+    
+    // Valid config with a multicast group
+    acc_id = 2;
+
+	config_mngr * cfg;
+	
+    result = config_mngr_init("./etc/config4.cfg", acc_id, NULL,  NULL, &cfg);
+
+    assert(result == 0);
+
+	assert(strcmp("239.00.0.2", lpconfig_get_mcast_addr(cfg)) == 0);
+	assert(lpconfig_get_mcast_port(cfg) == 6668); 
+
+	assert(lpconfig_get_group_id(cfg) == 3);
+	assert(lpconfig_get_group_first_volume(cfg) == 1024);
+	assert(lpconfig_get_group_last_volume(cfg) == 2047);
+	
+	assert(!lpconfig_group_has_volume(cfg, 0));
+	assert(!lpconfig_group_has_volume(cfg, 1023));
+	assert(lpconfig_group_has_volume(cfg, 1024));
+	assert(lpconfig_group_has_volume(cfg, 2047));
+	assert(!lpconfig_group_has_volume(cfg, 2048));
+	
+    lpconfig_destroy(cfg);
+
+    // No group set, default group covers all volumes
+    result = config_mngr_init("./etc/config3.cfg", acc_id, NULL,  NULL, &cfg);
+    assert(result == 0);
+
+	assert(lpconfig_get_group_id(cfg) == 0);
+	assert(lpconfig_group_has_volume(cfg, 0));
+	assert(lpconfig_group_has_volume(cfg, 0xFFFFFFFF));
+
+    lpconfig_destroy(cfg);
+
+    // Invalid volume range
+    result = config_mngr_init("./etc/config-error9.cfg", acc_id, NULL, NULL, &cfg);
+    assert(result == -1);
+    
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <event.h>
+
+#include "forced_assert.h"
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_delivery_queue.h"
+#include "test_header.h"
+
+#define WORKING_SET 20
+#define OVERFLOW 100
+
+static iid_t delivered_count = 0;
+
+static void on_deliver(void * value, size_t size, void * arg) {
+	UNUSED_ARG(arg);
+	iid_t * inst = value;
+	assert(size == sizeof(iid_t));
+	//Values must be delivered in order, without gaps
+	assert(*inst == delivered_count + 1);
+	delivered_count += 1;
+}
+
+static void on_missing(iid_t first, iid_t last, void * arg) {
+	UNUSED_ARG(first);
+	UNUSED_ARG(last);
+	UNUSED_ARG(arg);
+}
+
+static void submit(delivery_queue * dq, iid_t i) {
+	command_id key = {1, 0, (uint16_t)i};
+	delivery_queue_handle_command_map(dq, i, &key, sizeof(iid_t), &i);
+	delivery_queue_handle_acceptance(dq, i, &key);
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	event_init();
+
+	config_mngr * cfg;
+    int result = config_mngr_init("./etc/config5.cfg", 0, NULL, NULL, &cfg);
+    assert(result == 0);
+	assert(lpconfig_get_working_set_size(cfg) == WORKING_SET);
+	assert(lpconfig_get_delivery_overflow_size(cfg) == OVERFLOW);
+
+	delivery_queue * dq = delivery_queue_init(on_deliver, NULL, 
+		on_missing, on_missing, NULL, NULL, cfg);
+	assert(dq != NULL);
+
+	//Everything but instance 1, spills beyond the working set
+	iid_t i;
+	for(i = 2; i < WORKING_SET + OVERFLOW; i++) {
+		submit(dq, i);
+	}
+	assert(delivered_count == 0);
+
+	//Beyond the overflow area, dropped
+	submit(dq, WORKING_SET + OVERFLOW);
+	
+	//Filling the gap delivers everything in the buffer and in the overflow
+	submit(dq, 1);
+	assert(delivered_count == WORKING_SET + OVERFLOW - 1);
+
+	//Dropped instance can be received again
+	submit(dq, WORKING_SET + OVERFLOW);
+	assert(delivered_count == WORKING_SET + OVERFLOW);
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <event.h>
+
+#include "forced_assert.h"
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_delivery_queue.h"
+#include "test_header.h"
+
+//Gaps are reported as ranges of consecutive instances
+// (see config5.cfg, working set is 20 instances)
+
+#define MAX_RANGES 10
+
+static iid_t map_ranges[MAX_RANGES][2];
+static int map_ranges_count = 0;
+static iid_t fin_ranges[MAX_RANGES][2];
+static int fin_ranges_count = 0;
+
+static void on_deliver(void * value, size_t size, void * arg) {
+	UNUSED_ARG(value);
+	UNUSED_ARG(size);
+	UNUSED_ARG(arg);
+}
+
+static void on_missing_map(iid_t first, iid_t last, void * arg) {
+	UNUSED_ARG(arg);
+	printf("Missing map %lu...%lu\n", (unsigned long)first, (unsigned long)last);
+	assert(map_ranges_count < MAX_RANGES);
+	map_ranges[map_ranges_count][0] = first;
+	map_ranges[map_ranges_count][1] = last;
+	map_ranges_count += 1;
+}
+
+static void on_missing_acceptance(iid_t first, iid_t last, void * arg) {
+	UNUSED_ARG(arg);
+	printf("Missing acceptance %lu...%lu\n", (unsigned long)first, (unsigned long)last);
+	assert(fin_ranges_count < MAX_RANGES);
+	fin_ranges[fin_ranges_count][0] = first;
+	fin_ranges[fin_ranges_count][1] = last;
+	fin_ranges_count += 1;
+}
+
+//Invoked at the end of each gap check
+static void on_post_check(void * arg) {
+	UNUSED_ARG(arg);
+	event_loopexit(NULL);
+}
+
+static void submit_map(delivery_queue * dq, iid_t i) {
+	command_id key = {1, 0, (uint16_t)i};
+	delivery_queue_handle_command_map(dq, i, &key, sizeof(iid_t), &i);
+}
+
+static void submit_acceptance(delivery_queue * dq, iid_t i) {
+	command_id key = {1, 0, (uint16_t)i};
+	delivery_queue_handle_acceptance(dq, i, &key);
+}
+
+static void submit(delivery_queue * dq, iid_t i) {
+	submit_map(dq, i);
+	submit_acceptance(dq, i);
+}
+
+//Lets the periodic gap check run once
+static void run_gap_check() {
+	map_ranges_count = 0;
+	fin_ranges_count = 0;
+	event_dispatch();
+}
+
+static void check_range(iid_t ranges[][2], int index, iid_t first, iid_t last) {
+	assert(ranges[index][0] == first);
+	assert(ranges[index][1] == last);
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	event_init();
+
+	config_mngr * cfg;
+    int result = config_mngr_init("./etc/config5.cfg", 0, NULL, NULL, &cfg);
+    assert(result == 0);
+
+	delivery_queue * dq = delivery_queue_init(on_deliver, NULL, 
+		on_missing_map, on_missing_acceptance, on_post_check, NULL, cfg);
+	assert(dq != NULL);
+
+	// 1:delivered, 2-4:unknown, 5:complete, 6:map only, 
+	// 7:acceptance only, 8-9:unknown, 10:complete
+	submit(dq, 1);
+	submit(dq, 5);
+	submit_map(dq, 6);
+	submit_acceptance(dq, 7);
+	submit(dq, 10);
+
+	run_gap_check();
+	assert(map_ranges_count == 2);
+	check_range(map_ranges, 0, 2, 4);
+	check_range(map_ranges, 1, 7, 9);
+	assert(fin_ranges_count == 3);
+	check_range(fin_ranges, 0, 2, 4);
+	check_range(fin_ranges, 1, 6, 6);
+	check_range(fin_ranges, 2, 8, 9);
+
+	// Fill the gaps up to 15, then leave gaps 
+	// across the end of the circular buffer
+	iid_t i;
+	for(i = 2; i <= 15; i++) {
+		submit(dq, i);
+	}
+	submit(dq, 18);
+	submit(dq, 25);
+
+	run_gap_check();
+	assert(map_ranges_count == 2);
+	check_range(map_ranges, 0, 16, 17);
+	check_range(map_ranges, 1, 19, 24);
+	assert(fin_ranges_count == 2);
+	check_range(fin_ranges, 0, 16, 17);
+	check_range(fin_ranges, 1, 19, 24);
+
+	// No gaps, nothing to request
+	for(i = 16; i <= 25; i++) {
+		submit(dq, i);
+	}
+	run_gap_check();
+	assert(map_ranges_count == 0);
+	assert(fin_ranges_count == 0);
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
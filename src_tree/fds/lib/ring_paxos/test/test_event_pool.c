@@ -0,0 +1,125 @@
+/*
+	Many independent instances in the same process: each group has its 
+	own configuration and a sender/receiver pair registered in one of the 
+	bases of an event pool. Runs for a fixed time with a single thread 
+	and with multiple threads, prints the aggregate throughput.
+	Fails if some group is not served or receives messages of another group.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <sys/time.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "lp_timers.h"
+#include "lp_event_pool.h"
+#include "test_header.h"
+
+#define GROUPS_COUNT 32
+#define MSG_SIZE 100
+#define MSGS_PER_TICK 32
+#define RUN_SECONDS 1
+
+typedef struct group_t {
+	int id;
+	config_mngr * cfg;
+	udp_sender * us;
+	udp_receiver * ur;
+	long unsigned sent_count;
+	long unsigned received_count;
+} group;
+
+static group groups[GROUPS_COUNT];
+static int port = 6700;
+
+void handle_msg(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	group * g = arg;
+	assert(type == test1);
+	assert(datasize == MSG_SIZE);
+	//Never receives messages sent by another group
+	assert(*(int*)data == g->id);
+	g->received_count += 1;
+}
+
+//Runs in the thread serving the group base
+void send_tick(void * arg) {
+	group * g = arg;
+	char msg[MSG_SIZE];
+	memset(msg, 'x', MSG_SIZE);
+	*(int*)msg = g->id;
+
+	int i;
+	for(i = 0; i < MSGS_PER_TICK; i++) {
+		net_send_udp(g->us, msg, MSG_SIZE, test1);
+		g->sent_count += 1;
+	}
+	udp_sender_force_flush(g->us);
+}
+
+static void run(int threads_count) {
+	event_pool * ep = event_pool_init(threads_count);
+	assert(ep != NULL);
+
+	//Sends at every iteration of the loop
+	struct timeval send_interval = {0, 0};
+	int i, result;
+	for(i = 0; i < GROUPS_COUNT; i++) {
+		group * g = &groups[i];
+		memset(g, '\0', sizeof(group));
+		g->id = i;
+
+		result = config_mngr_init("./etc/config1.cfg", 2, NULL, NULL, &g->cfg);
+		assert(result == 0);
+		lpconfig_set_event_base(g->cfg, event_pool_get_base(ep, i));
+
+		g->ur = udp_receiver_init(NULL, port + i, handle_msg, g, g->cfg);
+		assert(g->ur != NULL);
+		g->us = udp_sender_init("127.0.0.1", port + i, g->cfg);
+		assert(g->us != NULL);
+		set_periodic_event_on_base(event_pool_get_base(ep, i), &send_interval, send_tick, g);
+	}
+	port += GROUPS_COUNT;
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	event_pool_start(ep);
+	sleep(RUN_SECONDS);
+	event_pool_stop(ep);
+	gettimeofday(&end, NULL);
+
+	double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+	long unsigned tot_sent = 0, tot_received = 0, min_received = groups[0].received_count;
+	for(i = 0; i < GROUPS_COUNT; i++) {
+		tot_sent += groups[i].sent_count;
+		tot_received += groups[i].received_count;
+		if(groups[i].received_count < min_received) {
+			min_received = groups[i].received_count;
+		}
+	}
+	printf("%d groups, %d threads: %.0f msg/s delivered (%lu/%lu), slowest group %lu messages\n",
+		GROUPS_COUNT, threads_count, tot_received / elapsed, tot_received, tot_sent, min_received);
+
+	assert(min_received > 0);
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	int cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+	run(1);
+	run(cores >= 4 ? cores : 4);
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
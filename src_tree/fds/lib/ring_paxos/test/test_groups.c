@@ -0,0 +1,143 @@
+/*
+	Partitioned multicast: the group submit proxy sends each command to
+	the leader of the group owning its volume, the group learner joins
+	only the groups covering its volumes. Groups with the same id or
+	overlapping volumes are rejected, and so are more than MAX_GROUPS
+	config files.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_groups.h"
+#include "test_header.h"
+
+//See etc/config7.cfg (group 1, volumes 0...999) and
+// etc/config8.cfg (group 2, volumes 1000...1999)
+static const char * groups[2] = {"./etc/config7.cfg", "./etc/config8.cfg"};
+//Clients port of the leader of each group
+static int leader_ports[2] = {5571, 5581};
+
+//Volumes 1500...2499, overlapping with group 2
+static const char * overlapping[2] = {"./etc/config8.cfg", "./etc/config9.cfg"};
+//Volumes 2000...2999, same id as group 1
+static const char * duplicate[2] = {"./etc/config7.cfg", "./etc/config10.cfg"};
+//Never parsed, the count is checked first
+static const char * too_many[MAX_GROUPS + 1];
+
+static void deliver(int group_id, void* value, size_t size, void* arg) {
+	UNUSED_ARG(group_id);
+	UNUSED_ARG(value);
+	UNUSED_ARG(size);
+	UNUSED_ARG(arg);
+}
+
+//Listens on the port of a leader instead of the acceptor
+static int leader_socket(int port) {
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+	assert(sock >= 0);
+	struct sockaddr_in addr;
+	bzero(&addr, sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	addr.sin_port = htons(port);
+	int result = bind(sock, (struct sockaddr *)&addr, sizeof(struct sockaddr_in));
+	assert(result == 0);
+	return sock;
+}
+
+//True if a packet was received, loopback delivers it before sendto returns
+static bool leader_received(int sock) {
+	char buf[MAX_UDP_PAYLOAD];
+	int size = recv(sock, buf, MAX_UDP_PAYLOAD, MSG_DONTWAIT);
+	assert(size > 0 || errno == EAGAIN || errno == EWOULDBLOCK);
+	return (size > 0);
+}
+
+//Submits a command for the volume, returns the group whose leader received it
+static int submit_to(group_submit_proxy * gsp, int * socks, volume_id_t volume) {
+	char buf[sizeof(submit_cmd_msg) + 16];
+	submit_cmd_msg * scm = (submit_cmd_msg *)buf;
+	scm->cmd_size = snprintf(scm->cmd_value, 16, "volume %u", volume);
+
+	if(group_submit_command(gsp, volume, scm) != 0) {
+		return -1;
+	}
+	group_submit_proxy_flush_now(gsp);
+
+	int group = -1;
+	int i;
+	for(i = 0; i < 2; i++) {
+		if(leader_received(socks[i])) {
+			assert(group == -1);
+			group = i + 1;
+		}
+	}
+	return group;
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	event_init();
+
+	//Submit proxy
+	int socks[2];
+	socks[0] = leader_socket(leader_ports[0]);
+	socks[1] = leader_socket(leader_ports[1]);
+
+	group_submit_proxy * gsp = group_submit_proxy_udp_init(groups, 2);
+	assert(gsp != NULL);
+	assert(submit_to(gsp, socks, 0) == 1);
+	assert(submit_to(gsp, socks, 999) == 1);
+	assert(submit_to(gsp, socks, 1000) == 2);
+	assert(submit_to(gsp, socks, 1999) == 2);
+	assert(submit_to(gsp, socks, 42) == 1);
+	//No group for this volume, nothing sent
+	assert(submit_to(gsp, socks, 2000) == -1);
+
+	assert(group_submit_proxy_udp_init(overlapping, 2) == NULL);
+	assert(group_submit_proxy_udp_init(duplicate, 2) == NULL);
+	assert(group_submit_proxy_udp_init(too_many, MAX_GROUPS + 1) == NULL);
+	assert(group_submit_proxy_udp_init(groups, 0) == NULL);
+
+	//Learner
+	group_learner * gl;
+	int result = group_learner_init(groups, 2, 1500, 2500, deliver, NULL, &gl);
+	assert(result == 0);
+	assert(group_learner_get_groups_count(gl) == 1);
+	config_mngr * cfg = learner_get_config_mngr(group_learner_get_learner(gl, 0));
+	assert(lpconfig_get_group_id(cfg) == 2);
+
+	result = group_learner_init(groups, 2, 900, 1100, deliver, NULL, &gl);
+	assert(result == 0);
+	assert(group_learner_get_groups_count(gl) == 2);
+	cfg = learner_get_config_mngr(group_learner_get_learner(gl, 0));
+	assert(lpconfig_get_group_id(cfg) == 1);
+	cfg = learner_get_config_mngr(group_learner_get_learner(gl, 1));
+	assert(lpconfig_get_group_id(cfg) == 2);
+
+	result = group_learner_init(overlapping, 2, 0, 100, deliver, NULL, &gl);
+	assert(result == -1);
+	assert(gl == NULL);
+	result = group_learner_init(duplicate, 2, 0, 100, deliver, NULL, &gl);
+	assert(result == -1);
+	result = group_learner_init(too_many, MAX_GROUPS + 1, 0, 100, deliver, NULL, &gl);
+	assert(result == -1);
+	assert(gl == NULL);
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
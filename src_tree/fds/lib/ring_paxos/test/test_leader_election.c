@@ -0,0 +1,239 @@
+/*
+	Leader failover: three acceptor processes elect a leader through
+	heartbeats (see config6.cfg), a client sends a write every millisecond
+	to all of them and only the current leader acknowledges it.
+	The leader process is killed, prints how long writes were not
+	acknowledged. Fails if acceptor 2 does not take over within a second
+	or if some other acceptor acknowledges writes.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "lp_timers.h"
+#include "lp_topology.h"
+#include "test_header.h"
+
+#define ACCEPTORS 3
+//Writes acknowledged by the first leader before killing it
+#define ACKS_BEFORE_KILL 300
+//Writes acknowledged by the new leader before stopping
+#define ACKS_AFTER_FAILOVER 300
+#define MAX_UNAVAILABILITY_MSEC 1000
+
+typedef struct write_msg_t {
+	int seq;
+	acceptor_id_t acked_by;
+} write_msg;
+
+static char * config_path = "./etc/config6.cfg";
+static int client_port = 7790;
+
+/*** ACCEPTOR (child process) ***/
+
+static topolo_mngr * acc_tm;
+static udp_sender * client_send;
+static struct timeval last_write;
+
+void acceptor_handle_msg(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	config_mngr * cfg = arg;
+
+	switch(type) {
+		case heartbeat:
+			lptopo_handle_heartbeat(acc_tm, (heartbeat_msg*)data, datasize);
+			break;
+		case test1: {
+			assert(datasize == sizeof(write_msg));
+			gettimeofday(&last_write, NULL);
+			if(lptopo_get_leader_id(acc_tm) == lpconfig_get_self_acceptor_id(cfg)) {
+				write_msg * wm = data;
+				wm->acked_by = lpconfig_get_self_acceptor_id(cfg);
+				net_send_udp(client_send, wm, sizeof(write_msg), test2);
+				udp_sender_force_flush(client_send);
+			}
+			break;
+		}
+		default:
+			assert(false);
+	}
+}
+
+//Exits if the client is gone
+void acceptor_client_check(void * arg) {
+	UNUSED_ARG(arg);
+	struct timeval now, deadline;
+	struct timeval max_idle = {2, 0};
+	gettimeofday(&now, NULL);
+	timer_set_timeout(&last_write, &deadline, &max_idle);
+	if(timer_is_expired(&deadline, &now)) {
+		exit(0);
+	}
+}
+
+static void run_acceptor(acceptor_id_t id) {
+	config_mngr * cfg;
+	int result = config_mngr_init(config_path, id, NULL, NULL, &cfg);
+	assert(result == 0);
+
+	event_init();
+	result = topology_mngr_init(NULL, NULL, cfg, &acc_tm);
+	assert(result == 0);
+	assert(lptopo_get_leader_id(acc_tm) == 1);
+
+	client_send = udp_sender_init("127.0.0.1", client_port, cfg);
+	assert(client_send != NULL);
+	udp_receiver * ur = udp_receiver_init(NULL, lpconfig_get_ring_port_of(cfg, id), acceptor_handle_msg, cfg, cfg);
+	assert(ur != NULL);
+
+	gettimeofday(&last_write, NULL);
+	struct timeval check_interval = {0, 500000};
+	set_periodic_event(&check_interval, acceptor_client_check, NULL);
+
+	event_dispatch();
+	exit(0);
+}
+
+/*** CLIENT ***/
+
+static pid_t acceptor_pids[ACCEPTORS+1];
+static udp_sender * acceptor_send[ACCEPTORS+1];
+static bool killed[ACCEPTORS+1];
+static long unsigned acks_count[ACCEPTORS+1];
+static int write_seq;
+static struct timeval last_ack_before_kill;
+static struct timeval first_ack_after_kill;
+static acceptor_id_t new_leader;
+static int checks_count;
+
+static long elapsed_usec(struct timeval * from, struct timeval * to) {
+	return (to->tv_sec - from->tv_sec) * 1000000 + (to->tv_usec - from->tv_usec);
+}
+
+void send_write(void * arg) {
+	UNUSED_ARG(arg);
+	write_msg wm;
+	wm.seq = write_seq++;
+	wm.acked_by = 0;
+
+	int i;
+	for(i = 1; i <= ACCEPTORS; i++) {
+		if(!killed[i]) {
+			net_send_udp(acceptor_send[i], &wm, sizeof(write_msg), test1);
+			udp_sender_force_flush(acceptor_send[i]);
+		}
+	}
+}
+
+void client_handle_ack(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	UNUSED_ARG(arg);
+	assert(type == test2);
+	assert(datasize == sizeof(write_msg));
+
+	write_msg * wm = data;
+	assert(wm->acked_by >= 1 && wm->acked_by <= ACCEPTORS);
+	acks_count[wm->acked_by] += 1;
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	if(!killed[1]) {
+		assert(wm->acked_by == 1);
+		last_ack_before_kill = now;
+		if(acks_count[1] == ACKS_BEFORE_KILL) {
+			printf("Killing leader (acceptor 1)\n");
+			kill(acceptor_pids[1], SIGKILL);
+			killed[1] = true;
+		}
+		return;
+	}
+
+	if(wm->acked_by == 1) {
+		//Sent before the kill
+		return;
+	}
+
+	if(new_leader == 0) {
+		new_leader = wm->acked_by;
+		first_ack_after_kill = now;
+	}
+	if(acks_count[new_leader] == ACKS_AFTER_FAILOVER) {
+		event_loopexit(NULL);
+	}
+}
+
+void timeout_check(void * arg) {
+	UNUSED_ARG(arg);
+	checks_count += 1;
+	if(checks_count > 50) {
+		printf("Timeout, acks from acceptors 1:%lu 2:%lu 3:%lu\n",
+			acks_count[1], acks_count[2], acks_count[3]);
+		exit(1);
+	}
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	int i;
+	for(i = 1; i <= ACCEPTORS; i++) {
+		acceptor_pids[i] = fork();
+		assert(acceptor_pids[i] >= 0);
+		if(acceptor_pids[i] == 0) {
+			run_acceptor(i);
+		}
+	}
+
+	config_mngr * cfg;
+    int result = config_mngr_init(config_path, 0, NULL, NULL, &cfg);
+    assert(result == 0);
+
+	event_init();
+	udp_receiver * ur = udp_receiver_init(NULL, client_port, client_handle_ack, NULL, cfg);
+	assert(ur != NULL);
+	for(i = 1; i <= ACCEPTORS; i++) {
+		acceptor_send[i] = udp_sender_init("127.0.0.1", lpconfig_get_ring_port_of(cfg, i), cfg);
+		assert(acceptor_send[i] != NULL);
+	}
+
+	struct timeval write_interval = {0, 1000};
+	set_periodic_event(&write_interval, send_write, NULL);
+	struct timeval check_interval = {0, 100000};
+	set_periodic_event(&check_interval, timeout_check, NULL);
+
+	event_dispatch();
+
+	for(i = 2; i <= ACCEPTORS; i++) {
+		kill(acceptor_pids[i], SIGKILL);
+	}
+	for(i = 1; i <= ACCEPTORS; i++) {
+		waitpid(acceptor_pids[i], NULL, 0);
+	}
+
+	long unavailable_usec = elapsed_usec(&last_ack_before_kill, &first_ack_after_kill);
+	printf("Acceptor %d took over, writes not acknowledged for %ld msec\n",
+		(int)new_leader, unavailable_usec / 1000);
+	printf("Writes acknowledged by acceptors 1:%lu 2:%lu 3:%lu\n",
+		acks_count[1], acks_count[2], acks_count[3]);
+
+	assert(new_leader == 2);
+	assert(acks_count[3] == 0);
+	assert(unavailable_usec < MAX_UNAVAILABILITY_MSEC * 1000);
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
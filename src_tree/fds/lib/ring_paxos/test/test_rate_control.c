@@ -0,0 +1,109 @@
+/*
+	Rate control of the multicaster: a learner reports message loss,
+	the rate is halved once (not again during the hold time) and then
+	recovers one instance per clock tick up to max_p2_open_per_iteration.
+	Without adaptive_rate_control the rate never changes.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <string.h>
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_timers.h"
+#include "lp_rate_control.h"
+#include "test_header.h"
+
+//See etc/config2.cfg
+#define MAX_RATE 12
+#define WORKING_SET 200
+
+//Advances the clock by the interval
+static void advance_clock(struct timeval * now, struct timeval * interval) {
+	struct timeval t = *now;
+	timeradd(&t, interval, now);
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	event_init();
+
+	config_mngr * cfg;
+    int result = config_mngr_init("./etc/config2.cfg", 1, NULL, NULL, &cfg);
+    assert(result == 0);
+	assert(lpconfig_get_adaptive_rate_control(cfg) == 1);
+	assert(lpconfig_get_max_p2_open_per_iteration(cfg) == MAX_RATE);
+	assert(lpconfig_get_working_set_size(cfg) == WORKING_SET);
+	struct timeval * tick = lpconfig_get_mcaster_clock_interval(cfg);
+	struct timeval * hold = lpconfig_get_retransmit_request_interval(cfg);
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	rate_control rc;
+	rate_control_init(&rc, cfg);
+	assert(rc.limit == MAX_RATE);
+
+	//At the maximum rate already
+	assert(!rate_control_on_tick(&rc, &now));
+	assert(rc.limit == MAX_RATE);
+
+	//Learner keeping up
+	assert(!rate_control_on_feedback(&rc, 0, WORKING_SET/2, &now));
+	assert(rc.limit == MAX_RATE);
+
+	//Learner lost some messages, rate is halved
+	assert(rate_control_on_feedback(&rc, 3, 0, &now));
+	assert(rc.limit == MAX_RATE/2);
+
+	//Same congestion event reported by other learners,
+	// and clock ticks during the hold time: no change
+	advance_clock(&now, tick);
+	assert(!rate_control_on_feedback(&rc, 5, 0, &now));
+	assert(!rate_control_on_feedback(&rc, 0, WORKING_SET, &now));
+	assert(!rate_control_on_tick(&rc, &now));
+	assert(rc.limit == MAX_RATE/2);
+
+	//After the hold time, one more instance per tick
+	advance_clock(&now, hold);
+	unsigned expected = MAX_RATE/2;
+	while(expected < MAX_RATE) {
+		advance_clock(&now, tick);
+		assert(rate_control_on_tick(&rc, &now));
+		expected += 1;
+		assert(rc.limit == expected);
+	}
+	advance_clock(&now, tick);
+	assert(!rate_control_on_tick(&rc, &now));
+	assert(rc.limit == MAX_RATE);
+
+	//Long delivery queue, repeated congestion events: never below 1
+	int i;
+	for(i = 0; i < 10; i++) {
+		assert(rate_control_on_feedback(&rc, 0, WORKING_SET, &now));
+		advance_clock(&now, hold);
+		advance_clock(&now, tick);
+	}
+	assert(rc.limit == 1);
+
+	//Adaptive rate control disabled (default)
+	config_mngr * cfg2;
+    result = config_mngr_init("./etc/config5.cfg", 0, NULL, NULL, &cfg2);
+    assert(result == 0);
+	assert(lpconfig_get_adaptive_rate_control(cfg2) == 0);
+	rate_control rc2;
+	rate_control_init(&rc2, cfg2);
+	unsigned fixed_rate = rc2.limit;
+	assert(!rate_control_on_feedback(&rc2, 3, 0, &now));
+	assert(!rate_control_on_tick(&rc2, &now));
+	assert(rc2.limit == fixed_rate);
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+	Read index of a learner: reads issued while MAX_PENDING_READS are
+	waiting are refused (not queued), a malformed read index reply
+	multicast by the leader is dropped and the reads keep waiting.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <string.h>
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "lp_timers.h"
+#include "lp_learner.h"
+#include "test_header.h"
+
+static int completed = 0;
+static int ticks = 0;
+
+static void deliver(void* value, size_t size, void * arg) {
+	UNUSED_ARG(value);
+	UNUSED_ARG(size);
+	UNUSED_ARG(arg);
+}
+
+static void on_read_ready(bool success, void * arg) {
+	UNUSED_ARG(success);
+	UNUSED_ARG(arg);
+	completed += 1;
+}
+
+//Sends a malformed reply the first time (too long, the network layer only
+// drops truncated ones), then checks the learner is still there
+static void tick(void * arg) {
+	udp_sender * us = arg;
+	ticks += 1;
+
+	if(ticks == 1) {
+		char malformed[sizeof(read_index_msg) + 1];
+		memset(malformed, 0, sizeof(malformed));
+		net_send_udp(us, malformed, sizeof(malformed), read_index);
+		udp_sender_force_flush(us);
+		return;
+	}
+
+	assert(completed == 0);
+	printf("TEST SUCCESSFUL!\n");
+	exit(0);
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	event_init();
+
+	//See etc/config7.cfg, no acceptor is running
+	learner_context * l;
+	int result = learner_init("./etc/config7.cfg", NULL, deliver, NULL, &l);
+	assert(result == 0);
+	config_mngr * cfg = learner_get_config_mngr(l);
+
+	int i;
+	for(i = 0; i < MAX_PENDING_READS; i++) {
+		assert(learner_read_index(l, on_read_ready, NULL) == 0);
+	}
+	//Full, refused without invoking the callback
+	assert(learner_read_index(l, on_read_ready, NULL) == -1);
+	assert(completed == 0);
+
+	//Replies of the leader are multicast
+	udp_sender * us = mcast_sender_init(lpconfig_get_mcast_addr(cfg),
+		lpconfig_get_mcast_port(cfg), cfg);
+	assert(us != NULL);
+
+	struct timeval interval;
+	interval.tv_sec = 0;
+	interval.tv_usec = 200000;
+	set_periodic_event(&interval, tick, us);
+
+	event_dispatch();
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+	Leader takeover after enough traffic to wrap the acceptors storage:
+	an acceptor promoted to leader must not open instances that were
+	already overwritten in the storage (ssm_get_record would look for
+	them in the archive), and must run phase 1 again for all the 
+	instances the previous leader may have left open. The same holds
+	for a leader demoted and promoted again after another one ran.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <string.h>
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_stable_storage.h"
+#include "lp_mcaster_storage.h"
+#include "test_header.h"
+
+#define WORKING_SET 20
+#define MAX_ACTIVE 5
+#define PREEXECUTION 5
+//Instances executed by the previous leader, wraps the storage many times
+#define TRAFFIC (10 * WORKING_SET + 7)
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	event_init();
+
+	config_mngr * cfg;
+    int result = config_mngr_init("./etc/config5.cfg", 0, NULL, NULL, &cfg);
+    assert(result == 0);
+	assert(lpconfig_get_working_set_size(cfg) == WORKING_SET);
+	assert(lpconfig_get_max_active_instances(cfg) == MAX_ACTIVE);
+	assert(lpconfig_get_preexecution_window_size(cfg) == PREEXECUTION);
+
+	//Fresh ring, the first leader starts from the beginning
+	assert(mcaster_storage_takeover_iid(cfg, 0) == 0);
+	assert(mcaster_storage_takeover_iid(cfg, MAX_ACTIVE + PREEXECUTION) == 0);
+
+	//A regular acceptor promises and accepts instances of the previous leader
+	stable_storage_mngr * ssm = stable_storage_init(cfg);
+	assert(ssm != NULL);
+	iid_t highest_seen = 0;
+	iid_t i;
+	for(i = 1; i <= TRAFFIC; i++) {
+		instance_record * ir = ssm_get_record(ssm, i);
+		assert(ir->inst_number == i);
+		ir->ballot = 101;
+		ir->accept_ballot = 101;
+		highest_seen = i;
+	}
+
+	//The previous leader crashes, this acceptor takes over
+	iid_t takeover = mcaster_storage_takeover_iid(cfg, highest_seen);
+	printf("Highest instance seen %lu, new leader starts after %lu\n", highest_seen, takeover);
+	//Instances possibly left open are recovered with phase 1
+	assert(takeover + MAX_ACTIVE + PREEXECUTION <= highest_seen);
+	//And are all still in the storage
+	assert(takeover + WORKING_SET > highest_seen);
+
+	//Phase 1 for the instances after the takeover point, 
+	// then new instances of the new leader
+	mcaster_storage_mngr * msm = mcaster_storage_init(cfg, NULL);
+	assert(msm != NULL);
+	for(i = takeover + 1; i <= highest_seen + PREEXECUTION; i++) {
+		instance_record * ir = ssm_get_record(ssm, i);
+		assert(ir->inst_number == i);
+		if(i <= highest_seen) {
+			assert(ir->accept_ballot == 101);
+		}
+		ir->ballot = 202;
+
+		mcaster_instance_record * mir = mcaster_storage_get(msm, i);
+		assert(mir->inst_number == i && mir->status == ready);
+		mir->status = done;
+	}
+
+	//Learners requests are clamped to the instances still stored,
+	// and not before the takeover, all of them can be retrieved
+	iid_t highest_open = highest_seen + PREEXECUTION;
+	iid_t lowest = mcaster_storage_lowest_iid(msm, highest_open);
+	assert(lowest > 1 && lowest <= takeover + 1);
+	for(i = IID_MAX(lowest, takeover + 1); i <= highest_open; i++) {
+		mcaster_instance_record * mir = mcaster_storage_get(msm, i);
+		assert(mir->inst_number == i);
+	}
+	assert(mcaster_storage_lowest_iid(msm, PREEXECUTION) == 1);
+
+	//This leader assigns values to some instances and leaves them open,
+	// then it is demoted and another leader runs for a while
+	uint64_t last_seqnum = 0;
+	for(i = highest_open + 1; i <= highest_open + MAX_ACTIVE; i++) {
+		mcaster_instance_record * mir = mcaster_storage_get(msm, i);
+		mcaster_storage_assign_value(msm, mir, malloc(1), 1);
+		last_seqnum = mir->assigned_cmd_key.cmd_seqnum;
+		mir->status = p2_pending;
+	}
+	highest_seen = highest_open + MAX_ACTIVE;
+	for(i = highest_seen + 1; i <= highest_seen + TRAFFIC; i++) {
+		instance_record * ir = ssm_get_record(ssm, i);
+		assert(ir->inst_number == i);
+		ir->ballot = 303;
+		ir->accept_ballot = 303;
+	}
+	highest_seen += TRAFFIC;
+
+	//Promoted again: it starts from the position of the other leader,
+	// not from its own, and its old instances are forgotten
+	mcaster_storage_reset(msm);
+	takeover = mcaster_storage_takeover_iid(cfg, highest_seen);
+	assert(takeover + MAX_ACTIVE + PREEXECUTION <= highest_seen);
+	assert(takeover + WORKING_SET > highest_seen);
+	for(i = takeover + 1; i <= highest_seen + PREEXECUTION; i++) {
+		instance_record * ir = ssm_get_record(ssm, i);
+		assert(ir->inst_number == i);
+		ir->ballot = 404;
+
+		mcaster_instance_record * mir = mcaster_storage_get(msm, i);
+		assert(mir->inst_number == i && mir->status == ready);
+		assert(mir->assigned_cmd_value == NULL);
+		if(i > highest_seen) {
+			//Keys of the new term are not reused
+			mcaster_storage_assign_value(msm, mir, malloc(1), 1);
+			assert(mir->assigned_cmd_key.cmd_seqnum > last_seqnum);
+		}
+		mir->status = done;
+	}
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+	Topology manager: a process that is not an acceptor reconfigures the ring
+	(remove, add, reorder, move the leader) of config5.cfg. Each acceptor is
+	simulated by a topology manager receiving on its ring port, checks that
+	all of them apply every version and compute the right successor.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <sys/time.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "lp_topology.h"
+#include "test_header.h"
+
+#define ACCEPTORS 3
+
+static char * config_path = "./etc/config5.cfg";
+
+static topolo_mngr * acceptor_tm[ACCEPTORS+1];
+static int changes_count[ACCEPTORS+1];
+
+void on_acceptor_topology_change(topology_info * ti, void * arg) {
+	UNUSED_ARG(ti);
+	int id = *(int*)arg;
+	changes_count[id] += 1;
+}
+
+void acceptor_handle_msg(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	int id = *(int*)arg;
+	assert(type == topology);
+	lptopo_handle_topology_msg(acceptor_tm[id], (topology_msg*)data, datasize);
+}
+
+//Lets topology messages sent so far reach the acceptors
+static void deliver_messages() {
+	struct timeval tv = {0, 100000};
+	event_loopexit(&tv);
+	event_dispatch();
+}
+
+static void check_ring(topolo_mngr * tm, acceptor_id_t * expected, int count, acceptor_id_t leader) {
+	assert(lptopo_get_ring_size(tm) == count);
+	int i;
+	for(i = 0; i < count; i++) {
+		assert(lptopo_get_ring_member(tm, i) == expected[i]);
+	}
+	assert(lptopo_get_leader_id(tm) == leader);
+}
+
+//All acceptors have the same topology as tm, each one sends to the next member
+static void check_acceptors(topolo_mngr * tm, int expected_changes) {
+	int id;
+	for(id = 1; id <= ACCEPTORS; id++) {
+		topolo_mngr * atm = acceptor_tm[id];
+		assert(changes_count[id] == expected_changes);
+		assert(lptopo_get_version(atm) == lptopo_get_version(tm));
+		assert(lptopo_get_leader_id(atm) == lptopo_get_leader_id(tm));
+		assert(lptopo_get_first_in_ring_id(atm) == lptopo_get_first_in_ring_id(tm));
+		assert(lptopo_get_ring_size(atm) == lptopo_get_ring_size(tm));
+
+		int i, size = lptopo_get_ring_size(tm);
+		for(i = 0; i < size; i++) {
+			assert(lptopo_get_ring_member(atm, i) == lptopo_get_ring_member(tm, i));
+			if(lptopo_get_ring_member(tm, i) == id) {
+				assert(lptopo_get_successor_id(atm) == lptopo_get_ring_member(tm, (i+1) % size));
+			}
+		}
+		//Non-members send to the leader
+		if(!lptopo_is_member(tm, id)) {
+			assert(lptopo_get_successor_id(atm) == lptopo_get_leader_id(tm));
+		}
+	}
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	int result;
+	static int ids[ACCEPTORS+1] = {0, 1, 2, 3};
+
+	event_init();
+
+	int id;
+	for(id = 1; id <= ACCEPTORS; id++) {
+		config_mngr * acfg;
+		result = config_mngr_init(config_path, id, NULL, NULL, &acfg);
+		assert(result == 0);
+		result = topology_mngr_init(on_acceptor_topology_change, &ids[id], acfg, &acceptor_tm[id]);
+		assert(result == 0);
+		udp_receiver * ur = udp_receiver_init(NULL, lpconfig_get_ring_port_of(acfg, id), acceptor_handle_msg, &ids[id], acfg);
+		assert(ur != NULL);
+	}
+
+	config_mngr * cfg;
+    result = config_mngr_init(config_path, 0, NULL, NULL, &cfg);
+    assert(result == 0);
+	topolo_mngr * tm;
+	result = topology_mngr_init(NULL, NULL, cfg, &tm);
+	assert(result == 0);
+
+	//Default: all acceptors by id, leader 1
+	acceptor_id_t initial[] = {1, 2, 3};
+	check_ring(tm, initial, 3, 1);
+	assert(lptopo_get_version(tm) == 0);
+	assert(lptopo_get_first_in_ring_id(tm) == 2);
+	assert(lptopo_get_successor_id(acceptor_tm[1]) == 2);
+	assert(lptopo_get_successor_id(acceptor_tm[3]) == 1);
+	check_acceptors(tm, 0);
+
+	//Remove the leader, the next member takes its role
+	result = lptopo_remove_acceptor(tm, 1);
+	assert(result == 0);
+	acceptor_id_t removed[] = {2, 3};
+	check_ring(tm, removed, 2, 2);
+	assert(lptopo_get_version(tm) == 1);
+	assert(lptopo_get_first_in_ring_id(tm) == 3);
+	deliver_messages();
+	check_acceptors(tm, 1);
+
+	//Less members than quorum_size
+	result = lptopo_remove_acceptor(tm, 3);
+	assert(result == -1);
+	//Not a member
+	result = lptopo_remove_acceptor(tm, 1);
+	assert(result == -1);
+
+	//Back at the head of the ring, the leader does not change
+	result = lptopo_add_acceptor(tm, 1, 0);
+	assert(result == 0);
+	acceptor_id_t added[] = {1, 2, 3};
+	check_ring(tm, added, 3, 2);
+	assert(lptopo_get_first_in_ring_id(tm) == 3);
+	deliver_messages();
+	check_acceptors(tm, 2);
+
+	//Not in the configuration, already a member
+	result = lptopo_add_acceptor(tm, 9, -1);
+	assert(result == -1);
+	result = lptopo_add_acceptor(tm, 3, -1);
+	assert(result == -1);
+
+	//New order
+	acceptor_id_t order[] = {3, 1, 2};
+	result = lptopo_set_ring_order(tm, order, 3);
+	assert(result == 0);
+	check_ring(tm, order, 3, 2);
+	assert(lptopo_get_first_in_ring_id(tm) == 3);
+	deliver_messages();
+	check_acceptors(tm, 3);
+
+	//Duplicate member
+	acceptor_id_t duplicate[] = {3, 1, 3};
+	result = lptopo_set_ring_order(tm, duplicate, 3);
+	assert(result == -1);
+
+	//Move the leader
+	result = lptopo_set_leader(tm, 1);
+	assert(result == 0);
+	check_ring(tm, order, 3, 1);
+	assert(lptopo_get_first_in_ring_id(tm) == 2);
+	deliver_messages();
+	check_acceptors(tm, 4);
+	assert(lptopo_get_version(tm) == 4);
+
+	result = lptopo_set_leader(tm, 7);
+	assert(result == -1);
+	assert(lptopo_get_version(tm) == 4);
+
+	//A message delivered late (older version) is ignored
+	topolo_mngr * old_tm;
+	result = topology_mngr_init(NULL, NULL, cfg, &old_tm);
+	assert(result == 0);
+	result = lptopo_remove_acceptor(old_tm, 2);
+	assert(result == 0);
+	deliver_messages();
+	check_acceptors(tm, 4);
+	assert(lptopo_is_member(acceptor_tm[1], 2));
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
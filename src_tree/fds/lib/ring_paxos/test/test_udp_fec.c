@@ -0,0 +1,144 @@
+/*
+	Forward error correction: the sender protects each group of 4 packets
+	with a parity packet. A relay socket in the middle drops one of the
+	packets, the receiver should rebuild it from the parity.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "lp_timers.h"
+#include "test_header.h"
+
+#define FEC_K 4
+#define DROPPED_PACKET 1
+
+static char * msgs[FEC_K] = {
+    "This is message 0.",
+    "Message 1 is the one that gets lost, and it is longer than the others.",
+    "Message 2.",
+    "...And message 3 closes the block."
+};
+
+static bool received[FEC_K] = {false, false, false, false};
+static int timeout_count = 0;
+static int recv_port = 6670;
+static int relay_port = 6671;
+
+void timeout_check(void * arg) {
+    UNUSED_ARG(arg);
+    timeout_count += 1;
+    printf("waiting....\n");
+
+    if(timeout_count > 5) {
+        printf("Not all messages received, exiting\n");
+        exit(1);
+    }
+}
+
+void handle_msg(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	UNUSED_ARG(arg);
+
+	assert(type == test1);
+
+    unsigned int i;
+    for(i = 0; i < FEC_K; i++) {
+        if(strlen(msgs[i]) == datasize && strncmp(msgs[i], data, datasize) == 0) {
+            printf("Received message %d\n", (int)i);
+            received[i] = true;
+            break;
+        }
+    }
+    assert(i < FEC_K);
+
+    for(i = 0; i < FEC_K; i++) {
+        if(!received[i]) {
+            return;
+        }
+    }
+
+    printf("All messages received!\n");
+    printf("TEST SUCCESSFUL!\n");
+    exit(0);
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+    int result = -1;
+    acceptor_id_t acc_id;
+
+    // Valid config
+    acc_id = 2;
+	config_mngr * cfg;
+    result = config_mngr_init("./etc/config1.cfg", acc_id, NULL, NULL, &cfg);
+    assert(result == 0);
+
+    event_init();
+
+    udp_receiver * ur = udp_receiver_init(NULL, recv_port, handle_msg, NULL, cfg);
+    assert(ur != NULL);
+	udp_receiver_enable_fec(ur, FEC_K);
+
+	//Relay, forwards packets from sender to receiver
+	int relay_sock = socket(AF_INET, SOCK_DGRAM, 0);
+	assert(relay_sock >= 0);
+	struct sockaddr_in addr;
+	bzero(&addr, sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	addr.sin_port = htons(relay_port);
+	result = bind(relay_sock, (struct sockaddr *)&addr, sizeof(struct sockaddr_in));
+	assert(result == 0);
+
+    udp_sender * us = udp_sender_init("127.0.0.1", relay_port, cfg);
+    assert(us != NULL);
+	udp_sender_enable_fec(us, FEC_K);
+
+	//One message per packet, then the parity packet is sent automatically
+	int i;
+	for(i = 0; i < FEC_K; i++) {
+		net_send_udp(us, msgs[i], strlen(msgs[i]), test1);
+		udp_sender_force_flush(us);
+	}
+
+	//Forward all packets but one
+	char buf[MAX_UDP_PAYLOAD];
+	addr.sin_port = htons(recv_port);
+	for(i = 0; i < (FEC_K+1); i++) {
+		int size = recv(relay_sock, buf, MAX_UDP_PAYLOAD, 0);
+		assert(size > 0);
+		if(i == DROPPED_PACKET) {
+			printf("Dropping packet %d (%d bytes)\n", i, size);
+			continue;
+		}
+		result = sendto(relay_sock, buf, size, 0, (struct sockaddr *)&addr, sizeof(struct sockaddr_in));
+		assert(result == size);
+	}
+
+    struct timeval recv_check;
+    recv_check.tv_sec = 1;
+    recv_check.tv_usec = 0;
+    set_periodic_event(&recv_check, timeout_check, NULL);
+
+    //Infinite event loop, will exit when all messages are received
+    event_dispatch();
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+	Forward error correction with a restarted sender: a first sender
+	protects a few blocks and goes away, a new one (new incarnation)
+	starts again from packet 0. A relay drops one packet of the first
+	block of the new sender, the receiver should forget the block of the
+	old one and rebuild the packet from the parity.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "lp_timers.h"
+#include "test_header.h"
+
+#define FEC_K 4
+#define DROPPED_PACKET 2
+//Packets of the old sender, it stops in the middle of its third block
+#define OLD_PACKETS (2 * FEC_K + 1)
+
+static char * msgs[FEC_K] = {
+    "New sender, message 0.",
+    "New sender, message 1.",
+    "New sender, message 2 is lost and rebuilt from the parity.",
+    "New sender, message 3."
+};
+
+static bool received[FEC_K] = {false, false, false, false};
+static int timeout_count = 0;
+static int recv_port = 6672;
+static int relay_port = 6673;
+
+void timeout_check(void * arg) {
+    UNUSED_ARG(arg);
+    timeout_count += 1;
+    printf("waiting....\n");
+
+    if(timeout_count > 5) {
+        printf("Not all messages received, exiting\n");
+        exit(1);
+    }
+}
+
+void handle_msg(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	UNUSED_ARG(arg);
+
+	//Messages of the old sender
+	if(type == test2) {
+		return;
+	}
+	assert(type == test1);
+
+    unsigned int i;
+    for(i = 0; i < FEC_K; i++) {
+        if(strlen(msgs[i]) == datasize && strncmp(msgs[i], data, datasize) == 0) {
+            printf("Received message %d\n", (int)i);
+            received[i] = true;
+            break;
+        }
+    }
+    assert(i < FEC_K);
+
+    for(i = 0; i < FEC_K; i++) {
+        if(!received[i]) {
+            return;
+        }
+    }
+
+    printf("All messages received!\n");
+    printf("TEST SUCCESSFUL!\n");
+    exit(0);
+}
+
+//Forwards count packets from the relay to the receiver, but the dropped one
+static void relay_packets(int relay_sock, struct sockaddr_in * addr, int count, int dropped) {
+	char buf[MAX_UDP_PAYLOAD];
+	int i;
+	for(i = 0; i < count; i++) {
+		int size = recv(relay_sock, buf, MAX_UDP_PAYLOAD, 0);
+		assert(size > 0);
+		if(i == dropped) {
+			printf("Dropping packet %d (%d bytes)\n", i, size);
+			continue;
+		}
+		int result = sendto(relay_sock, buf, size, 0, (struct sockaddr *)addr, sizeof(struct sockaddr_in));
+		assert(result == size);
+	}
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+	config_mngr * cfg;
+    int result = config_mngr_init("./etc/config1.cfg", 2, NULL, NULL, &cfg);
+    assert(result == 0);
+
+    event_init();
+
+    udp_receiver * ur = udp_receiver_init(NULL, recv_port, handle_msg, NULL, cfg);
+    assert(ur != NULL);
+	udp_receiver_enable_fec(ur, FEC_K);
+
+	//Relay, forwards packets from the senders to the receiver
+	int relay_sock = socket(AF_INET, SOCK_DGRAM, 0);
+	assert(relay_sock >= 0);
+	struct sockaddr_in addr;
+	bzero(&addr, sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	addr.sin_port = htons(relay_port);
+	result = bind(relay_sock, (struct sockaddr *)&addr, sizeof(struct sockaddr_in));
+	assert(result == 0);
+	addr.sin_port = htons(recv_port);
+
+	//Old sender, all its packets (and parities) are delivered
+    udp_sender * old_us = udp_sender_init("127.0.0.1", relay_port, cfg);
+    assert(old_us != NULL);
+	udp_sender_enable_fec(old_us, FEC_K);
+	char old_msg[] = "Old sender message";
+	int i;
+	for(i = 0; i < OLD_PACKETS; i++) {
+		net_send_udp(old_us, old_msg, strlen(old_msg), test2);
+		udp_sender_force_flush(old_us);
+	}
+	relay_packets(relay_sock, &addr, OLD_PACKETS + (OLD_PACKETS / FEC_K), -1);
+
+	//New sender, restarts from packet 0
+    udp_sender * us = udp_sender_init("127.0.0.1", relay_port, cfg);
+    assert(us != NULL);
+	udp_sender_enable_fec(us, FEC_K);
+	for(i = 0; i < FEC_K; i++) {
+		net_send_udp(us, msgs[i], strlen(msgs[i]), test1);
+		udp_sender_force_flush(us);
+	}
+	relay_packets(relay_sock, &addr, FEC_K + 1, DROPPED_PACKET);
+
+    struct timeval recv_check;
+    recv_check.tv_sec = 1;
+    recv_check.tv_usec = 0;
+    set_periodic_event(&recv_check, timeout_check, NULL);
+
+    //Infinite event loop, will exit when all messages are received
+    event_dispatch();
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*
+	Loopback benchmark for the io_uring backend:
+	the same amount of data is sent with and without io_uring,
+	prints the number of system calls per MB delivered.
+	Fails only if data is not delivered.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <sys/time.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "lp_timers.h"
+#include "test_header.h"
+
+#define MSG_SIZE 1000
+#define TOTAL_MSGS 4000
+#define MSGS_PER_TICK 64
+
+#define URING_BUFFERS 64
+
+static int port = 6674;
+static char msg_data[MSG_SIZE];
+static int sent_count;
+static long unsigned received_count;
+static long unsigned received_bytes;
+static periodic_event * send_ev;
+
+void handle_msg(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	UNUSED_ARG(data);
+	UNUSED_ARG(arg);
+
+	assert(type == test1);
+	assert(datasize == MSG_SIZE);
+	received_count += 1;
+	received_bytes += datasize;
+}
+
+void send_tick(void * arg) {
+	udp_sender * us = arg;
+
+	if(sent_count >= TOTAL_MSGS) {
+		return;
+	}
+
+	int i;
+	for(i = 0; i < MSGS_PER_TICK && sent_count < TOTAL_MSGS; i++) {
+		net_send_udp(us, msg_data, MSG_SIZE, test1);
+		sent_count += 1;
+	}
+	udp_sender_force_flush(us);
+
+	if(sent_count == TOTAL_MSGS) {
+		//Let the receiver drain its buffer
+		struct timeval drain = {0, 300000};
+		event_loopexit(&drain);
+	}
+}
+
+static void run(config_mngr * cfg, bool use_uring, int receiver_port) {
+	sent_count = 0;
+	received_count = 0;
+	received_bytes = 0;
+
+    udp_receiver * ur = udp_receiver_init(NULL, receiver_port, handle_msg, NULL, cfg);
+    assert(ur != NULL);
+    udp_sender * us = udp_sender_init("127.0.0.1", receiver_port, cfg);
+    assert(us != NULL);
+	if(use_uring) {
+		if(!udp_receiver_enable_io_uring(ur, URING_BUFFERS) ||
+			!udp_sender_enable_io_uring(us, URING_BUFFERS)) {
+			printf("io_uring not supported, skipping\n");
+			return;
+		}
+	}
+
+	struct timeval send_interval = {0, 1000};
+	send_ev = set_periodic_event(&send_interval, send_tick, us);
+
+	event_dispatch();
+
+	double delivered_mb = received_bytes / (1024.0 * 1024.0);
+	long unsigned send_calls = udp_sender_get_syscalls(us);
+	long unsigned recv_calls = udp_receiver_get_syscalls(ur);
+	printf("io_uring %s: delivered %lu/%d messages (%.2f MB)\n",
+		(use_uring ? "ON " : "OFF"), received_count, TOTAL_MSGS, delivered_mb);
+	if(delivered_mb > 0) {
+		printf("  %lu send calls, %lu read calls, %.1f system calls per MB\n",
+			send_calls, recv_calls, (send_calls + recv_calls) / delivered_mb);
+	}
+
+	assert(received_count > 0);
+}
+
+int main (int argc, char const *argv[]) {
+
+    UNUSED_ARG(argc);
+    UNUSED_ARG(argv);
+
+    int result = -1;
+	config_mngr * cfg;
+    result = config_mngr_init("./etc/config1.cfg", 2, NULL, NULL, &cfg);
+    assert(result == 0);
+
+	memset(msg_data, 'x', MSG_SIZE);
+
+    event_init();
+	run(cfg, false, port);
+
+	event_init();
+	run(cfg, true, port + 1);
+
+	printf("TEST SUCCESSFUL!\n");
+    return 0;
+}
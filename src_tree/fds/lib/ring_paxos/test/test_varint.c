@@ -0,0 +1,261 @@
+/*
+	64-bit identifiers: varint encoding of values and command keys around
+	the points where 16 and 32 bit counters used to wrap, per-instance
+	messages with compact instance numbers and keys, acceptance batches
+	with a corrupt key, and sequence numbers of the multicaster storage
+	going past 0xFFFF.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <string.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_mcaster_storage.h"
+#include "lp_varint.h"
+#include "ringpaxos_messages.h"
+#include "test_header.h"
+
+static char * config_path = "./etc/config1.cfg";
+
+static void check_value(uint64_t v) {
+	uint8_t buf[VARINT_MAX_SIZE];
+	uint64_t decoded = 0;
+	size_t size = varint_encode(v, buf);
+	assert(size == varint_size(v));
+	assert(varint_decode(buf, size, &decoded) == size);
+	assert(decoded == v);
+	//Truncated
+	assert(varint_decode(buf, size - 1, &decoded) == 0);
+}
+
+//All values from start to start+count, each one encoded
+// as difference from the previous key
+static void check_keys(uint64_t start, unsigned count);
+
+//Encodes and decodes the per-instance messages, returns the size of the phase 2
+static size_t check_messages(iid_t inst_number, uint64_t cmd_seqnum) {
+	command_id key;
+	key.mcaster_id = 2;
+	key.mcaster_incarnation = 9;
+	key.cmd_seqnum = cmd_seqnum;
+
+	char p2_buf[PH2_WIRE_MSG_MAX_SIZE];
+	phase2_wire_msg * p2_wire = (phase2_wire_msg *)p2_buf;
+	phase2_msg p2, p2_decoded;
+	p2.inst_number = inst_number;
+	p2.ballot = 101;
+	p2.accepts_count = 2;
+	CMD_KEY_COPY(&p2.cmd_key, &key);
+	size_t p2_size = phase2_msg_encode(&p2, p2_wire);
+	assert(p2_size <= PH2_WIRE_MSG_MAX_SIZE);
+	assert(phase2_msg_decode(p2_wire, p2_size, &p2_decoded));
+	assert(p2_decoded.inst_number == inst_number && p2_decoded.ballot == 101);
+	assert(p2_decoded.accepts_count == 2);
+	assert(CMD_KEY_EQUALS((&p2_decoded.cmd_key), (&key)));
+	//Truncated, or with trailing bytes
+	assert(!phase2_msg_decode(p2_wire, p2_size - 1, &p2_decoded));
+	assert(!phase2_msg_decode(p2_wire, p2_size + 1, &p2_decoded));
+	assert(!phase2_msg_decode(p2_wire, sizeof(phase2_wire_msg) - 1, &p2_decoded));
+
+	char value[] = "some command value";
+	char map_buf[CMDMAP_WIRE_MSG_MAX_SIZE(sizeof(value))];
+	cmdmap_wire_msg * map_wire = (cmdmap_wire_msg *)map_buf;
+	cmdmap_msg map, map_decoded;
+	map.inst_number = inst_number;
+	map.cmd_size = sizeof(value);
+	map.cmd_value = value;
+	CMD_KEY_COPY(&map.cmd_key, &key);
+	size_t map_size = cmdmap_msg_encode(&map, map_wire);
+	assert(map_size <= sizeof(map_buf));
+	assert(cmdmap_msg_decode(map_wire, map_size, &map_decoded));
+	assert(map_decoded.inst_number == inst_number);
+	assert(CMD_KEY_EQUALS((&map_decoded.cmd_key), (&key)));
+	assert(map_decoded.cmd_size == sizeof(value));
+	assert(memcmp(map_decoded.cmd_value, value, sizeof(value)) == 0);
+	//The value size does not match the rest of the message
+	assert(!cmdmap_msg_decode(map_wire, map_size - 1, &map_decoded));
+	assert(!cmdmap_msg_decode(map_wire, map_size + 1, &map_decoded));
+	assert(!cmdmap_msg_decode(map_wire, 0, &map_decoded));
+
+	char acc_buf[ACCEPTANCE_WIRE_MSG_MAX_SIZE];
+	acceptance_wire_msg * acc_wire = (acceptance_wire_msg *)acc_buf;
+	acceptance_msg acc, acc_decoded;
+	acc.inst_number = inst_number;
+	CMD_KEY_COPY(&acc.cmd_key, &key);
+	size_t acc_size = acceptance_msg_encode(&acc, acc_wire);
+	assert(acc_size <= ACCEPTANCE_WIRE_MSG_MAX_SIZE);
+	assert(acceptance_msg_decode(acc_wire, acc_size, &acc_decoded));
+	assert(acc_decoded.inst_number == inst_number);
+	assert(CMD_KEY_EQUALS((&acc_decoded.cmd_key), (&key)));
+	assert(!acceptance_msg_decode(acc_wire, acc_size - 1, &acc_decoded));
+	assert(!acceptance_msg_decode(acc_wire, 0, &acc_decoded));
+
+	return p2_size;
+}
+
+//Instances 0, 3 and 63 of a batch decided, the middle key of another multicaster
+static void check_acceptance_batch(void) {
+	command_id keys[3], decoded[ACCEPTANCE_BATCH_MAX_INSTANCES];
+	unsigned bits[3] = {0, 3, 63};
+	char buf[sizeof(acceptance_batch_msg) + 3 * CMD_KEY_MAX_ENCODED_SIZE];
+	acceptance_batch_msg * msg = (acceptance_batch_msg *)buf;
+	msg->from = 0xFFFFFFFFULL;
+	msg->decided_bitmap = 0;
+
+	command_id prev;
+	clear_cmd_key(&prev);
+	size_t keys_size = 0, last_key_offset = 0;
+	unsigned i;
+	for(i = 0; i < 3; i++) {
+		last_key_offset = keys_size;
+		keys[i].mcaster_id = (i == 1 ? 2 : 1);
+		keys[i].mcaster_incarnation = 5;
+		keys[i].cmd_seqnum = 0xFFFF + i;
+		msg->decided_bitmap |= (1ULL << bits[i]);
+		keys_size += cmd_key_encode(&keys[i], &prev, &msg->cmd_keys[keys_size]);
+		CMD_KEY_COPY(&prev, &keys[i]);
+	}
+	msg->keys_size = keys_size;
+	size_t size = ACCEPTANCE_BATCH_MSG_SIZE(msg);
+
+	assert(acceptance_batch_msg_decode(msg, size, decoded) == 3);
+	for(i = 0; i < 3; i++) {
+		assert(CMD_KEY_EQUALS((&decoded[i]), (&keys[i])));
+	}
+
+	//Truncated
+	assert(acceptance_batch_msg_decode(msg, size - 1, decoded) == -1);
+	assert(acceptance_batch_msg_decode(msg, sizeof(acceptance_batch_msg) - 1, decoded) == -1);
+	//Fewer keys than decided instances
+	msg->decided_bitmap |= (1ULL << 10);
+	assert(acceptance_batch_msg_decode(msg, size, decoded) == -1);
+	msg->decided_bitmap &= ~(1ULL << 10);
+	//Bytes left after the last key
+	msg->decided_bitmap &= ~(1ULL << 63);
+	assert(acceptance_batch_msg_decode(msg, size, decoded) == -1);
+	msg->decided_bitmap |= (1ULL << 63);
+	//Last key does not decode (varint never ends)
+	memset(&msg->cmd_keys[last_key_offset], 0x80, keys_size - last_key_offset);
+	assert(acceptance_batch_msg_decode(msg, size, decoded) == -1);
+}
+
+static void check_keys(uint64_t start, unsigned count) {
+	uint8_t buf[CMD_KEY_MAX_ENCODED_SIZE];
+	command_id prev, key, decoded;
+	clear_cmd_key(&prev);
+	prev.cmd_seqnum = start - 1;
+	key.mcaster_id = 3;
+	key.mcaster_incarnation = 7;
+
+	unsigned i;
+	for(i = 0; i < count; i++) {
+		key.cmd_seqnum = start + i;
+		size_t size = cmd_key_encode(&key, &prev, buf);
+		assert(size == 3);
+		assert(cmd_key_decode(buf, size, &prev, &decoded) == size);
+		assert(CMD_KEY_EQUALS((&decoded), (&key)));
+		CMD_KEY_COPY(&prev, &key);
+	}
+}
+
+int main (int argc, char const *argv[]) {
+
+	UNUSED_ARG(argc);
+	UNUSED_ARG(argv);
+
+	//Encoded size
+	assert(varint_size(0) == 1);
+	assert(varint_size(0x7F) == 1);
+	assert(varint_size(0x80) == 2);
+	assert(varint_size(0x3FFF) == 2);
+	assert(varint_size(0xFFFF) == 3);
+	assert(varint_size(0xFFFFFFFFULL) == 5);
+	assert(varint_size(UINT64_MAX) == VARINT_MAX_SIZE);
+
+	//Around each power of 2
+	unsigned bit;
+	for(bit = 0; bit < 64; bit++) {
+		uint64_t p = (1ULL << bit);
+		check_value(p - 1);
+		check_value(p);
+		check_value(p + 1);
+	}
+	check_value(UINT64_MAX);
+
+	//Invalid: too long, or overflowing 64 bits
+	uint8_t invalid[VARINT_MAX_SIZE + 1];
+	memset(invalid, 0x80, sizeof(invalid));
+	uint64_t v;
+	assert(varint_decode(invalid, sizeof(invalid), &v) == 0);
+	memset(invalid, 0xFF, VARINT_MAX_SIZE - 1);
+	invalid[VARINT_MAX_SIZE - 1] = 0x02;
+	assert(varint_decode(invalid, VARINT_MAX_SIZE, &v) == 0);
+
+	//Signed differences
+	assert(ZIGZAG_ENCODE(0) == 0);
+	assert(ZIGZAG_ENCODE(-1) == 1);
+	assert(ZIGZAG_ENCODE(1) == 2);
+	assert(ZIGZAG_DECODE(ZIGZAG_ENCODE(INT64_MIN)) == INT64_MIN);
+	assert(ZIGZAG_DECODE(ZIGZAG_ENCODE(INT64_MAX)) == INT64_MAX);
+
+	//Consecutive keys through the former wrap points
+	check_keys(1, 1000);
+	check_keys(0xFFFF - 500, 1000);
+	check_keys(0xFFFFFFFFULL - 500, 1000);
+	check_keys(UINT64_MAX - 1000, 1000);
+
+	//Key of another multicaster, going backwards
+	uint8_t buf[CMD_KEY_MAX_ENCODED_SIZE];
+	command_id prev, key, decoded;
+	prev.mcaster_id = 1;
+	prev.mcaster_incarnation = 1;
+	prev.cmd_seqnum = 0x100000000ULL;
+	key.mcaster_id = 2;
+	key.mcaster_incarnation = 4;
+	key.cmd_seqnum = 12;
+	size_t size = cmd_key_encode(&key, &prev, buf);
+	assert(size <= CMD_KEY_MAX_ENCODED_SIZE);
+	assert(cmd_key_decode(buf, size, &prev, &decoded) == size);
+	assert(CMD_KEY_EQUALS((&decoded), (&key)));
+	assert(cmd_key_decode(buf, 2, &prev, &decoded) == 0);
+
+	//Per-instance messages, smaller than with fixed-size
+	// fields (26 bytes for a phase 2) in the common case
+	assert(check_messages(1, 1) == 12);
+	assert(check_messages(1000000, 1000000) == 16);
+	check_messages(0xFFFFFFFFULL + 1, 0xFFFF + 1);
+	check_messages(UINT64_MAX, UINT64_MAX);
+	assert(check_messages(UINT64_MAX, INT64_MAX) == PH2_WIRE_MSG_MAX_SIZE);
+	check_acceptance_batch();
+
+	char str[32];
+	key.mcaster_id = 255;
+	key.mcaster_incarnation = 255;
+	key.cmd_seqnum = UINT64_MAX;
+	assert(strcmp(print_cmd_key(&key, str), "{255:255:18446744073709551615}") == 0);
+
+	//The multicaster assigns keys past 0xFFFF without wrapping
+	config_mngr * cfg;
+	int result = config_mngr_init(config_path, 1, NULL, NULL, &cfg);
+	assert(result == 0);
+	mcaster_storage_mngr * msm = mcaster_storage_init(cfg, NULL);
+	assert(msm != NULL);
+
+	uint64_t expected_seqnum = 1;
+	iid_t inst;
+	for(inst = 1; inst < 0x30000; inst++) {
+		mcaster_instance_record * mir = mcaster_storage_get(msm, inst);
+		assert(mir->status == ready);
+		mcaster_storage_assign_value(msm, mir, malloc(1), 1);
+		assert(mir->assigned_cmd_key.mcaster_id == 1);
+		assert(mir->assigned_cmd_key.cmd_seqnum == expected_seqnum);
+		expected_seqnum += 1;
+		mir->status = done;
+	}
+
+	printf("TEST SUCCESSFUL!\n");
+	return 0;
+}
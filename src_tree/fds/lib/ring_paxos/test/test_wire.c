@@ -0,0 +1,129 @@
+/*
+	Wire format: packets are built byte by byte (little-endian header:
+	size, type, version) and sent to a receiver. Messages of unknown types
+	(from a newer version) are skipped, packets from versions older than
+	LP_WIRE_MIN_VERSION and truncated messages are dropped.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <sys/time.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "lp_submit_proxy.h"
+#include "ringpaxos_messages.h"
+#include "test_header.h"
+
+#define PORT 6680
+
+static int received_count = 0;
+static lp_msg_type last_type = notype;
+static char last_data[64];
+
+void handle_message(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	UNUSED_ARG(arg);
+	assert(datasize < sizeof(last_data));
+	received_count += 1;
+	last_type = type;
+	memcpy(last_data, data, datasize);
+	last_data[datasize] = '\0';
+}
+
+//Lets the packets sent so far reach the receiver
+static void deliver_messages() {
+	struct timeval tv = {0, 100000};
+	event_loopexit(&tv);
+	event_dispatch();
+}
+
+//Appends a message header and body to buf
+static size_t add_message(char * buf, size_t offset, uint8_t type, uint8_t version, const char * body, uint16_t size) {
+	buf[offset] = (char)(size & 0xFF);
+	buf[offset + 1] = (char)(size >> 8);
+	buf[offset + 2] = (char)type;
+	buf[offset + 3] = (char)version;
+	memcpy(&buf[offset + 4], body, size);
+	return offset + 4 + size;
+}
+
+static void send_packet(int sock, char * buf, size_t size) {
+	struct sockaddr_in saddr;
+	memset(&saddr, '\0', sizeof(struct sockaddr_in));
+	saddr.sin_family = AF_INET;
+	saddr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	saddr.sin_port = htons(PORT);
+	int data_sent = sendto(sock, buf, size, 0, (struct sockaddr *)&saddr, sizeof(struct sockaddr_in));
+	assert(data_sent == (int)size);
+}
+
+int main (int argc, char const *argv[]) {
+
+	UNUSED_ARG(argc);
+	UNUSED_ARG(argv);
+
+	//Schema
+	assert(sizeof(lp_message_header) == 4);
+	assert(lp_wire_min_size(phase1) == (int)sizeof(phase1_msg));
+	assert(lp_wire_min_size(client_submit) == (int)sizeof(submit_cmd_msg));
+	assert(lp_wire_min_size(test1) == 0);
+	assert(lp_wire_min_size(notype) == -1);
+	assert(lp_wire_min_size(200) == -1);
+
+	config_mngr * cfg;
+	int result = config_mngr_init("./etc/config1.cfg", 2, NULL, NULL, &cfg);
+	assert(result == 0);
+
+	event_init();
+	udp_receiver * ur = udp_receiver_init(NULL, PORT, handle_message, NULL, cfg);
+	assert(ur != NULL);
+
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+	assert(sock >= 0);
+	char buf[256];
+	size_t size;
+
+	//Unknown type from a newer version is skipped, the next one delivered
+	size = add_message(buf, 0, 200, LP_WIRE_VERSION + 1, "newer", 5);
+	size = add_message(buf, size, test1, LP_WIRE_VERSION + 1, "abc", 3);
+	send_packet(sock, buf, size);
+	deliver_messages();
+	assert(received_count == 1);
+	assert(last_type == test1);
+	assert(strcmp(last_data, "abc") == 0);
+
+	//Older than the minimum version, the whole packet is dropped
+	size = add_message(buf, 0, test1, LP_WIRE_MIN_VERSION - 1, "old", 3);
+	size = add_message(buf, size, test2, LP_WIRE_VERSION, "xyz", 3);
+	send_packet(sock, buf, size);
+	deliver_messages();
+	assert(received_count == 1);
+
+	//Shorter than a phase1
+	size = add_message(buf, 0, phase1, LP_WIRE_VERSION, "0123456789", 10);
+	send_packet(sock, buf, size);
+	deliver_messages();
+	assert(received_count == 1);
+
+	//Sent through a udp_sender
+	udp_sender * us = udp_sender_init("127.0.0.1", PORT, cfg);
+	assert(us != NULL);
+	net_send_udp(us, "hello", 5, test2);
+	udp_sender_force_flush(us);
+	deliver_messages();
+	assert(received_count == 2);
+	assert(last_type == test2);
+	assert(strcmp(last_data, "hello") == 0);
+
+	printf("TEST SUCCESSFUL!\n");
+	return 0;
+}
@@ -0,0 +1,246 @@
+/*
+	Wire compatibility: a receiver of the current version understands
+	the messages of a sender of the previous version (layouts of version 2,
+	built byte by byte), and a sender configured with wire_version 2
+	(etc/config11.cfg) sends phase2, command_map and acceptance in the
+	layout of version 2.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "forced_assert.h"
+#include <sys/time.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <event.h>
+
+#include "lp_utils.h"
+#include "lp_config_parser.h"
+#include "lp_network.h"
+#include "ringpaxos_messages.h"
+#include "test_header.h"
+
+#define PORT 6690
+//A receiver of version 2, reads the packets from a socket
+#define OLD_RECEIVER_PORT 6691
+
+//Layouts of version 2
+typedef struct phase2_v2_msg_t {
+	iid_t inst_number;
+	ballot_t ballot;
+	uint32_t accepts_count;
+	command_id cmd_key;
+} LP_WIRE_PACKED phase2_v2_msg;
+
+typedef struct cmdmap_v2_msg_t {
+	iid_t inst_number;
+	command_id cmd_key;
+	uint32_t cmd_size;
+	char cmd_value[0];
+} LP_WIRE_PACKED cmdmap_v2_msg;
+
+typedef struct acceptance_v2_msg_t {
+	iid_t inst_number;
+	command_id cmd_key;
+} LP_WIRE_PACKED acceptance_v2_msg;
+
+static int received_count = 0;
+static phase2_msg last_phase2;
+static cmdmap_msg last_cmdmap;
+static char last_value[16];
+static acceptance_msg last_acceptance;
+
+void handle_message(void* data, size_t datasize, lp_msg_type type, void * arg) {
+	UNUSED_ARG(arg);
+	received_count += 1;
+	switch(type) {
+		case phase2:
+			assert(phase2_msg_decode(data, datasize, &last_phase2));
+			break;
+		case command_map:
+			assert(cmdmap_msg_decode(data, datasize, &last_cmdmap));
+			assert(last_cmdmap.cmd_size < sizeof(last_value));
+			memcpy(last_value, last_cmdmap.cmd_value, last_cmdmap.cmd_size);
+			last_value[last_cmdmap.cmd_size] = '\0';
+			break;
+		case acceptance:
+			assert(acceptance_msg_decode(data, datasize, &last_acceptance));
+			break;
+		default:
+			assert(false);
+	}
+}
+
+//Lets the packets sent so far reach the receiver
+static void deliver_messages() {
+	struct timeval tv = {0, 100000};
+	event_loopexit(&tv);
+	event_dispatch();
+}
+
+static void set_key(command_id * key, uint8_t mcaster_id, uint64_t seq) {
+	clear_cmd_key(key);
+	key->mcaster_id = mcaster_id;
+	key->mcaster_incarnation = 1;
+	key->cmd_seqnum = seq;
+}
+
+//Appends a message header and body to buf
+static size_t add_message(char * buf, size_t offset, uint8_t type, uint8_t version, const void * body, uint16_t size) {
+	buf[offset] = (char)(size & 0xFF);
+	buf[offset + 1] = (char)(size >> 8);
+	buf[offset + 2] = (char)type;
+	buf[offset + 3] = (char)version;
+	memcpy(&buf[offset + 4], body, size);
+	return offset + 4 + size;
+}
+
+static void send_packet(int sock, char * buf, size_t size) {
+	struct sockaddr_in saddr;
+	memset(&saddr, '\0', sizeof(struct sockaddr_in));
+	saddr.sin_family = AF_INET;
+	saddr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	saddr.sin_port = htons(PORT);
+	int data_sent = sendto(sock, buf, size, 0, (struct sockaddr *)&saddr, sizeof(struct sockaddr_in));
+	assert(data_sent == (int)size);
+}
+
+//Next message received by the old receiver, returns its body
+static char * old_receive(int sock, char * buf, lp_message_header ** mh) {
+	int size = recv(sock, buf, MAX_UDP_PAYLOAD, MSG_DONTWAIT);
+	assert(size >= (int)sizeof(lp_message_header));
+	*mh = (lp_message_header *)buf;
+	assert((*mh)->version == 2);
+	assert((int)((*mh)->size + sizeof(lp_message_header)) == size);
+	return (*mh)->data;
+}
+
+int main (int argc, char const *argv[]) {
+
+	UNUSED_ARG(argc);
+	UNUSED_ARG(argv);
+
+	assert(LP_WIRE_MIN_VERSION == 2);
+
+	config_mngr * cfg;
+	int result = config_mngr_init("./etc/config1.cfg", 2, NULL, NULL, &cfg);
+	assert(result == 0);
+	assert(lpconfig_get_wire_version(cfg) == LP_WIRE_VERSION);
+
+	event_init();
+	udp_receiver * ur = udp_receiver_init(NULL, PORT, handle_message, NULL, cfg);
+	assert(ur != NULL);
+
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+	assert(sock >= 0);
+	char buf[256];
+	size_t size;
+
+	//Sender of version 2, one packet with the 3 messages
+	phase2_v2_msg p2;
+	p2.inst_number = 5000000000ULL;
+	p2.ballot = 7;
+	p2.accepts_count = 2;
+	set_key(&p2.cmd_key, 3, 1234);
+
+	char map_buf[sizeof(cmdmap_v2_msg) + 5];
+	cmdmap_v2_msg * map = (cmdmap_v2_msg *)map_buf;
+	map->inst_number = 42;
+	set_key(&map->cmd_key, 1, 99);
+	map->cmd_size = 5;
+	memcpy(map->cmd_value, "hello", 5);
+
+	acceptance_v2_msg acc;
+	acc.inst_number = 43;
+	set_key(&acc.cmd_key, 2, 100000);
+
+	size = add_message(buf, 0, phase2, 2, &p2, sizeof(p2));
+	size = add_message(buf, size, command_map, 2, map, sizeof(map_buf));
+	size = add_message(buf, size, acceptance, 2, &acc, sizeof(acc));
+	send_packet(sock, buf, size);
+	deliver_messages();
+	assert(received_count == 3);
+
+	assert(last_phase2.inst_number == p2.inst_number);
+	assert(last_phase2.ballot == 7);
+	assert(last_phase2.accepts_count == 2);
+	assert(memcmp(&last_phase2.cmd_key, &p2.cmd_key, sizeof(command_id)) == 0);
+
+	assert(last_cmdmap.inst_number == 42);
+	assert(memcmp(&last_cmdmap.cmd_key, &map->cmd_key, sizeof(command_id)) == 0);
+	assert(strcmp(last_value, "hello") == 0);
+
+	assert(last_acceptance.inst_number == 43);
+	assert(memcmp(&last_acceptance.cmd_key, &acc.cmd_key, sizeof(command_id)) == 0);
+
+	//Malformed in the layout of version 2 (no room for the value),
+	// dropped but the rest of the packet is delivered
+	map->cmd_size = 6;
+	size = add_message(buf, 0, command_map, 2, map, sizeof(map_buf));
+	size = add_message(buf, size, acceptance, 2, &acc, sizeof(acc));
+	send_packet(sock, buf, size);
+	deliver_messages();
+	assert(received_count == 4);
+
+	//Sender of the current version with wire_version 2
+	config_mngr * old_cfg;
+	result = config_mngr_init("./etc/config11.cfg", 2, NULL, NULL, &old_cfg);
+	assert(result == 0);
+	assert(lpconfig_get_wire_version(old_cfg) == 2);
+
+	int old_sock = socket(AF_INET, SOCK_DGRAM, 0);
+	assert(old_sock >= 0);
+	struct sockaddr_in addr;
+	memset(&addr, '\0', sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	addr.sin_port = htons(OLD_RECEIVER_PORT);
+	result = bind(old_sock, (struct sockaddr *)&addr, sizeof(struct sockaddr_in));
+	assert(result == 0);
+
+	udp_sender * us = udp_sender_init("127.0.0.1", OLD_RECEIVER_PORT, cfg);
+	udp_sender * old_us = udp_sender_init("127.0.0.1", OLD_RECEIVER_PORT, old_cfg);
+	assert(us != NULL && old_us != NULL);
+
+	char wire[PH2_WIRE_MSG_MAX_SIZE];
+	phase2_msg msg;
+	msg.inst_number = p2.inst_number;
+	msg.ballot = p2.ballot;
+	msg.accepts_count = p2.accepts_count;
+	CMD_KEY_COPY(&msg.cmd_key, &p2.cmd_key);
+	size_t wire_size = phase2_msg_encode(&msg, (phase2_wire_msg *)wire);
+
+	char old_buf[MAX_UDP_PAYLOAD];
+	lp_message_header * mh;
+	net_send_udp(old_us, wire, wire_size, phase2);
+	udp_sender_force_flush(old_us);
+	phase2_v2_msg * old_p2 = (phase2_v2_msg *)old_receive(old_sock, old_buf, &mh);
+	assert(mh->type == phase2 && mh->size == sizeof(phase2_v2_msg));
+	assert(memcmp(old_p2, &p2, sizeof(phase2_v2_msg)) == 0);
+
+	//Unchanged layouts are sent as they are
+	net_send_udp(old_us, "abc", 3, test1);
+	udp_sender_force_flush(old_us);
+	char * body = old_receive(old_sock, old_buf, &mh);
+	assert(mh->type == test1 && mh->size == 3 && memcmp(body, "abc", 3) == 0);
+
+	//Not sent if malformed
+	net_send_udp(old_us, wire, wire_size - 1, phase2);
+	udp_sender_force_flush(old_us);
+	assert(recv(old_sock, old_buf, MAX_UDP_PAYLOAD, MSG_DONTWAIT) < 0 && errno == EAGAIN);
+
+	//The current version is not understood by the old receiver
+	net_send_udp(us, wire, wire_size, phase2);
+	udp_sender_force_flush(us);
+	assert(recv(old_sock, old_buf, MAX_UDP_PAYLOAD, MSG_DONTWAIT) > 0);
+	mh = (lp_message_header *)old_buf;
+	assert(mh->version == LP_WIRE_VERSION && mh->size == wire_size);
+
+	printf("TEST SUCCESSFUL!\n");
+	return 0;
+}